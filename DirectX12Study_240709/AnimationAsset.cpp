@@ -0,0 +1,78 @@
+#include "pch.h"
+
+#include "AnimationAsset.h"
+
+AnimationAsset::~AnimationAsset()
+{
+    SAFE_RELEASE(m_bakedBuffer);
+}
+
+std::shared_ptr<AnimationAsset> AnimationAsset::Create(AnimationData data)
+{
+    auto asset    = std::make_shared<AnimationAsset>();
+    asset->m_data = std::move(data);
+    asset->m_data.Prepare();
+    asset->m_poseCache.resize(sm_poseCacheSize);
+    return asset;
+}
+
+const std::vector<Matrix> &AnimationAsset::Update(AnimationState &state, int clipID, double time,
+                                                  bool skipDetailBones)
+{
+    const double tick = m_data.clips[clipID].GetTick(time);
+
+    state.clipID = clipID;
+    state.time   = time;
+
+    for (auto &cached : m_poseCache)
+    {
+        if (cached.clipID == clipID && cached.tick == tick && cached.skipDetailBones == skipDetailBones)
+        {
+            m_numCacheHits++;
+            return cached.palette;
+        }
+    }
+
+    if (state.cursorClip != clipID || state.cursors.size() != m_data.GetNumBones())
+    {
+        state.cursors.assign(m_data.GetNumBones(), AnimationCursor());
+        state.cursorClip = clipID;
+    }
+
+    m_data.Evaluate(clipID, tick, state.cursors, m_pose, skipDetailBones);
+    m_numEvaluations++;
+
+    CachedPose &cached = m_poseCache[m_nextCacheSlot];
+    m_nextCacheSlot    = (m_nextCacheSlot + 1) % sm_poseCacheSize;
+
+    cached.clipID          = clipID;
+    cached.tick            = tick;
+    cached.skipDetailBones = skipDetailBones;
+    cached.palette         = m_pose.palette;
+
+    return cached.palette;
+}
+
+void AnimationAsset::Bake(ID3D12Device *device, float sampleRate)
+{
+    SAFE_RELEASE(m_bakedBuffer);
+
+    m_baked = AnimationBaker::Bake(m_data, sampleRate);
+    D3DUtils::CreateDefaultBuffer(device, &m_bakedBuffer, m_baked.palettes.data(),
+                                  uint32_t(m_baked.palettes.size() * sizeof(Matrix)));
+
+    // Only the GPU buffer is read from here on.
+    m_baked.palettes.clear();
+    m_baked.palettes.shrink_to_fit();
+}
+
+uint32_t AnimationAsset::UpdateBaked(AnimationState &state, int clipID, double time) const
+{
+    const AnimationClip &clip = m_data.clips[clipID];
+    const uint32_t frame      = m_baked.GetFrame(clip, clipID, clip.GetTick(time));
+
+    state.clipID = clipID;
+    state.time   = time;
+
+    return m_baked.GetPaletteOffset(frame);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "AnimationBaker.h"
+#include "AnimationData.h"
+
+#include <memory>
+
+// AnimationData shared by every SkinnedMeshModel that uses the same skeleton and clips.
+// Models keep only an AnimationState. Evaluated palettes are cached by (clip, tick), so models
+// that play the same clip at the same time evaluate the pose once.
+class AnimationAsset
+{
+  public:
+    ~AnimationAsset();
+
+    static std::shared_ptr<AnimationAsset> Create(AnimationData data);
+
+    // Bakes every clip at sampleRate and copies the palettes to a GPU buffer, see BakedAnimation.
+    void Bake(ID3D12Device *device, float sampleRate);
+
+    bool HasBaked() const
+    {
+        return m_bakedBuffer != nullptr;
+    }
+
+    // Baked counterpart of Update. Returns the offset of the frame in the baked buffer.
+    uint32_t UpdateBaked(AnimationState &state, int clipID, double time) const;
+
+    D3D12_GPU_VIRTUAL_ADDRESS GetBakedPaletteGPU() const
+    {
+        return m_bakedBuffer->GetGPUVirtualAddress();
+    }
+
+    const AnimationData &GetData() const
+    {
+        return m_data;
+    }
+
+    // Moves state to time in clipID and returns its skinning palette. Root motion is not part of the
+    // palette, see UpdateRootMotion. Main thread only.
+    const std::vector<Matrix> &Update(AnimationState &state, int clipID, double time,
+                                      bool skipDetailBones = false);
+
+    // Root motion at time. Cheap, call it every frame even when the pose is evaluated less often.
+    void UpdateRootMotion(AnimationState &state, int clipID, double time) const
+    {
+        m_data.UpdateRootMotion(state, clipID, time);
+    }
+
+    // Root motion in model space, to be applied on top of the world matrix.
+    Matrix GetRootMotion(const AnimationState &state) const
+    {
+        return m_data.defaultMatrixInv * state.rootTransform * m_data.defaultMatrix;
+    }
+
+    uint64_t GetNumEvaluations() const
+    {
+        return m_numEvaluations;
+    }
+
+    uint64_t GetNumCacheHits() const
+    {
+        return m_numCacheHits;
+    }
+
+  private:
+    struct CachedPose
+    {
+        int32_t clipID       = -1;
+        double tick          = -1.0;
+        bool skipDetailBones = false;
+        std::vector<Matrix> palette;
+    };
+
+    static const uint32_t sm_poseCacheSize = 16;
+
+  private:
+    AnimationData m_data;
+    AnimationPose m_pose;
+
+    std::vector<CachedPose> m_poseCache;
+    uint32_t m_nextCacheSlot = 0;
+
+    uint64_t m_numEvaluations = 0;
+    uint64_t m_numCacheHits   = 0;
+
+    BakedAnimation m_baked;
+    ID3D12Resource *m_bakedBuffer = nullptr;
+};
@@ -0,0 +1,124 @@
+#include "AnimationBaker.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace DirectX;
+
+uint32_t BakedAnimation::GetFrame(const AnimationClip &clip, int clipID, double tick) const
+{
+    const Clip &c = clips[clipID];
+    if (c.numFrames <= 1 || clip.duration <= 0.0)
+    {
+        return c.firstFrame;
+    }
+
+    // The last frame is the pose at the end of the clip, so rounding up near the end doesn't wrap to frame 0.
+    const uint32_t frame = uint32_t(tick / clip.duration * (c.numFrames - 1) + 0.5);
+    return c.firstFrame + XMMin(frame, c.numFrames - 1);
+}
+
+BakedAnimation AnimationBaker::Bake(const AnimationData &data, float sampleRate)
+{
+    BakedAnimation baked;
+    baked.sampleRate = sampleRate;
+    baked.numBones   = data.GetNumBones();
+    baked.clips.resize(data.clips.size());
+
+    uint32_t numFrames = 0;
+    for (size_t i = 0; i < data.clips.size(); i++)
+    {
+        const AnimationClip &clip = data.clips[i];
+        const double seconds      = clip.tickPerSecond > 0.0 ? clip.duration / clip.tickPerSecond : 0.0;
+
+        baked.clips[i].firstFrame = numFrames;
+        baked.clips[i].numFrames  = uint32_t(ceil(seconds * sampleRate)) + 1;
+        numFrames += baked.clips[i].numFrames;
+    }
+
+    baked.palettes.resize(size_t(numFrames) * baked.numBones);
+
+    // One clip per job. Evaluate is const, each job keeps its own cursors and pose.
+    g_JobSystem.ParallelFor(uint32_t(data.clips.size()), 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+        std::vector<AnimationCursor> cursors(baked.numBones);
+        AnimationPose pose;
+
+        for (uint32_t clipID = begin; clipID < end; clipID++)
+        {
+            const AnimationClip &clip       = data.clips[clipID];
+            const BakedAnimation::Clip &dst = baked.clips[clipID];
+
+            for (uint32_t f = 0; f < dst.numFrames; f++)
+            {
+                const double tick = dst.numFrames > 1 ? clip.duration * f / (dst.numFrames - 1) : 0.0;
+                data.Evaluate(clipID, tick, cursors, pose);
+
+                std::copy(pose.palette.begin(), pose.palette.end(),
+                          baked.palettes.begin() + baked.GetPaletteOffset(dst.firstFrame + f));
+            }
+        }
+    });
+
+    return baked;
+}
+
+float AnimationBaker::MeasureError(const AnimationData &data, const BakedAnimation &baked, uint32_t samplesPerFrame)
+{
+    const uint32_t numBones = data.GetNumBones();
+
+    // Bind position of each bone in the space of the vertices the palette moves. The palette starts with
+    // bindTransform (defaultMatrixInv * offsetMatrix), so the inverse offset goes back through defaultMatrix.
+    std::vector<Vector3> bindPos(numBones);
+    for (uint32_t i = 0; i < numBones; i++)
+    {
+        bindPos[i] = (data.offsetMatrix[i].Invert() * data.defaultMatrix).Translation();
+    }
+
+    std::vector<AnimationCursor> cursors(numBones);
+    AnimationPose pose;
+    float maxError = 0.0f;
+
+    for (int clipID = 0; clipID < int(data.clips.size()); clipID++)
+    {
+        const AnimationClip &clip = data.clips[clipID];
+        const uint32_t numSamples = baked.clips[clipID].numFrames * samplesPerFrame;
+        cursors.assign(numBones, AnimationCursor());
+
+        for (uint32_t s = 0; s < numSamples; s++)
+        {
+            const double tick = clip.duration * s / numSamples;
+            data.Evaluate(clipID, tick, cursors, pose);
+
+            const Matrix *frame = &baked.palettes[baked.GetPaletteOffset(baked.GetFrame(clip, clipID, tick))];
+            for (uint32_t b = 0; b < numBones; b++)
+            {
+                const Vector3 live = Vector3::Transform(bindPos[b], pose.palette[b].Transpose());
+                const Vector3 bake = Vector3::Transform(bindPos[b], frame[b].Transpose());
+                maxError           = XMMax(maxError, (live - bake).Length());
+            }
+        }
+    }
+
+    return maxError;
+}
+
+bool AnimationBaker::Report(const AnimationData &data, const std::vector<float> &sampleRates, float tolerance)
+{
+    bool withinTolerance = true;
+
+    for (const float rate : sampleRates)
+    {
+        BakedAnimation baked = Bake(data, rate);
+        const float error    = MeasureError(data, baked);
+
+        std::cout << "Baked animation " << rate << " fps : " << baked.palettes.size() / XMMax(baked.numBones, 1u)
+                  << " frames, " << baked.GetBytes() / 1024 << " KB, max error " << error
+                  << (error > tolerance ? " (over tolerance)" : "") << std::endl;
+
+        withinTolerance = withinTolerance && error <= tolerance;
+    }
+
+    return withinTolerance;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AnimationData.h"
+
+// Palettes of every clip sampled at a fixed rate. A model playing a baked clip only picks a frame:
+// the shader reads bonesTransform[frameOffset + boneIndex] straight from the baked buffer.
+struct BakedAnimation
+{
+    struct Clip
+    {
+        uint32_t firstFrame = 0;
+        uint32_t numFrames  = 0;
+    };
+
+    float sampleRate  = 0.0f; // frames per second
+    uint32_t numBones = 0;
+    std::vector<Clip> clips;
+    std::vector<Matrix> palettes; // numBones per frame, transposed like AnimationPose::palette
+
+    // Frame nearest to tick (from AnimationClip::GetTick). Frames cover [0, duration] of the clip.
+    uint32_t GetFrame(const AnimationClip &clip, int clipID, double tick) const;
+
+    // Index of the first palette matrix of frame.
+    uint32_t GetPaletteOffset(uint32_t frame) const
+    {
+        return frame * numBones;
+    }
+
+    size_t GetBytes() const
+    {
+        return palettes.size() * sizeof(Matrix);
+    }
+};
+
+// Offline / load time baker. Runs without a device, the GPU copy is made by AnimationAsset.
+class AnimationBaker
+{
+  public:
+    static BakedAnimation Bake(const AnimationData &data, float sampleRate);
+
+    // Largest distance between baked and live skinning, measured at the bind position of every bone
+    // at samplesPerFrame times per baked frame. Same units as the model.
+    static float MeasureError(const AnimationData &data, const BakedAnimation &baked, uint32_t samplesPerFrame = 4);
+
+    // Bakes at each rate and prints memory and error. Returns false if a rate exceeds tolerance.
+    static bool Report(const AnimationData &data, const std::vector<float> &sampleRates, float tolerance);
+};
@@ -0,0 +1,424 @@
+#include "AnimationCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace DirectX;
+
+namespace
+{
+// Angle of the rotation from a to b, 2 * atan2(|v|, |w|) of conjugate(a) * b in double. 2 * acos of a float dot
+// product jumps from 0 to about 0.04 degrees, more than the default rotTolerance.
+float RotationError(const Quaternion &a, const Quaternion &b)
+{
+    const double ax = a.x, ay = a.y, az = a.z, aw = a.w;
+    const double bx = b.x, by = b.y, bz = b.z, bw = b.w;
+
+    const double w = aw * bw + ax * bx + ay * by + az * bz;
+    const double x = aw * bx - bw * ax - (ay * bz - az * by);
+    const double y = aw * by - bw * ay - (az * bx - ax * bz);
+    const double z = aw * bz - bw * az - (ax * by - ay * bx);
+    return float(2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::abs(w)));
+}
+
+float VectorError(const Vector3 &a, const Vector3 &b)
+{
+    return (a - b).Length();
+}
+
+Vector3 Interpolate(const Vector3 &a, const Vector3 &b, float f)
+{
+    return Vector3::Lerp(a, b, f);
+}
+
+Quaternion Interpolate(const Quaternion &a, const Quaternion &b, float f)
+{
+    return Quaternion::Lerp(a, b, f);
+}
+
+float Error(const Vector3 &a, const Vector3 &b)
+{
+    return VectorError(a, b);
+}
+
+float Error(const Quaternion &a, const Quaternion &b)
+{
+    return RotationError(a, b);
+}
+
+// Indices of the keys to keep. A key is dropped when interpolating between the previous kept key
+// and the next key rebuilds every skipped key within tolerance.
+template <typename T>
+std::vector<uint32_t> ReduceKeys(const std::vector<float> &times, const std::vector<T> &values, float tolerance)
+{
+    std::vector<uint32_t> kept;
+    if (values.empty())
+    {
+        return kept;
+    }
+
+    bool constant = true;
+    for (size_t i = 1; i < values.size() && constant; i++)
+    {
+        constant = Error(values[i], values[0]) <= tolerance;
+    }
+    if (constant)
+    {
+        kept.push_back(0);
+        return kept;
+    }
+
+    kept.push_back(0);
+    uint32_t last = 0;
+
+    for (uint32_t i = 1; i + 1 < uint32_t(values.size()); i++)
+    {
+        const uint32_t next = i + 1;
+        const float span    = times[next] - times[last];
+
+        bool removable = span > 0.0f;
+        for (uint32_t j = last + 1; j < next && removable; j++)
+        {
+            const float f = (times[j] - times[last]) / span;
+            removable     = Error(Interpolate(values[last], values[next], f), values[j]) <= tolerance;
+        }
+
+        if (!removable)
+        {
+            kept.push_back(i);
+            last = i;
+        }
+    }
+
+    kept.push_back(uint32_t(values.size()) - 1);
+    return kept;
+}
+
+uint16_t QuantizeTime(float tick, double duration)
+{
+    if (duration <= 0.0)
+    {
+        return 0;
+    }
+    return uint16_t(std::clamp(double(tick) / duration, 0.0, 1.0) * 65535.0 + 0.5);
+}
+
+void EncodeTimes(const std::vector<float> &times, const std::vector<uint32_t> &kept, double duration,
+                 bool useFloatTimes, AnimationClip::CompressedTrack::KeyTimes &out)
+{
+    out.times.clear();
+    out.floatTimes.clear();
+
+    for (uint32_t k : kept)
+    {
+        if (useFloatTimes)
+            out.floatTimes.push_back(times[k]);
+        else
+            out.times.push_back(QuantizeTime(times[k], duration));
+    }
+}
+
+void EncodeVec3(const std::vector<float> &times, const std::vector<Vector3> &values,
+                const std::vector<uint32_t> &kept, double duration, bool useFloats, bool useFloatTimes,
+                AnimationClip::CompressedTrack::Vec3Channel &out)
+{
+    out.values.clear();
+    out.floatValues.clear();
+
+    if (kept.empty())
+    {
+        return;
+    }
+
+    Vector3 vmin = values[kept[0]];
+    Vector3 vmax = values[kept[0]];
+    for (uint32_t k : kept)
+    {
+        vmin = Vector3::Min(vmin, values[k]);
+        vmax = Vector3::Max(vmax, values[k]);
+    }
+
+    out.min    = vmin;
+    out.extent = vmax - vmin;
+
+    EncodeTimes(times, kept, duration, useFloatTimes, out);
+
+    if (useFloats)
+    {
+        for (uint32_t k : kept)
+        {
+            out.floatValues.push_back(values[k]);
+        }
+        return;
+    }
+
+    out.values.resize(kept.size() * 3);
+    for (size_t i = 0; i < kept.size(); i++)
+    {
+        const Vector3 &v = values[kept[i]];
+        const float src[3] = {v.x - vmin.x, v.y - vmin.y, v.z - vmin.z};
+        const float ext[3] = {out.extent.x, out.extent.y, out.extent.z};
+        for (int c = 0; c < 3; c++)
+        {
+            out.values[3 * i + c] =
+                ext[c] > 0.0f ? uint16_t(std::clamp(src[c] / ext[c], 0.0f, 1.0f) * 65535.0f + 0.5f) : 0;
+        }
+    }
+}
+
+// Sample a compressed channel the same way AnimationData::SampleCompressed does.
+template <typename T> uint32_t FindCompressedKey(const std::vector<T> &times, float t)
+{
+    uint32_t k = 0;
+    while (k + 1 < times.size() && float(times[k + 1]) <= t)
+    {
+        k++;
+    }
+    return k;
+}
+
+template <typename T> float CompressedFactor(const std::vector<T> &times, float t, uint32_t k)
+{
+    if (k + 1 >= times.size())
+    {
+        return 0.0f;
+    }
+    const float span = float(times[k + 1]) - float(times[k]);
+    return span > 0.0f ? std::clamp((t - float(times[k])) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+template <typename Channel, typename T>
+float MaxError(const Channel &ch, const std::vector<float> &times, const std::vector<T> &values, double duration)
+{
+    float maxError = 0.0f;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        uint32_t k;
+        float f;
+        if (ch.floatTimes.empty())
+        {
+            const float t = duration > 0.0 ? float(times[i] / duration * 65535.0) : 0.0f;
+            k             = FindCompressedKey(ch.times, t);
+            f             = CompressedFactor(ch.times, t, k);
+        }
+        else
+        {
+            k = FindCompressedKey(ch.floatTimes, times[i]);
+            f = CompressedFactor(ch.floatTimes, times[i], k);
+        }
+
+        const T v = f > 0.0f ? Interpolate(ch.Decode(k), ch.Decode(k + 1), f) : ch.Decode(k);
+        maxError  = XMMax(maxError, Error(v, values[i]));
+    }
+    return maxError;
+}
+
+// Reduces the keys with reduceTolerance and encodes the kept ones into out. The interpolation, the quantized values
+// and the 16-bit key times all add error, so the reduction tolerance is tightened until the decoded channel is within
+// tolerance at every source key. When even every key isn't enough, the channel moves too far within one 16-bit time
+// step and keeps float key times. Returns the error.
+template <typename T, typename Channel, typename Encode>
+float CompressChannel(const std::vector<float> &times, const std::vector<T> &values, float tolerance,
+                      float reduceTolerance, double duration, Channel &out, uint32_t &numKept, Encode encode)
+{
+    float error = 0.0f;
+    for (bool useFloatTimes : {false, true})
+    {
+        float reduce = reduceTolerance;
+        for (int attempt = 0;; attempt++)
+        {
+            const std::vector<uint32_t> kept = ReduceKeys(times, values, reduce);
+            encode(kept, useFloatTimes);
+            numKept = uint32_t(kept.size());
+
+            error = MaxError(out, times, values, duration);
+            if (error <= tolerance)
+            {
+                return error;
+            }
+            if (reduce <= 0.0f)
+            {
+                break;
+            }
+
+            // A few halvings cover the rounding. Past that only keys that interpolation rebuilds exactly are removed.
+            reduce = attempt < 3 ? reduce * 0.5f : 0.0f;
+        }
+    }
+    return error;
+}
+
+float CompressVec3(const std::vector<float> &times, const std::vector<Vector3> &values, float tolerance,
+                   double duration, AnimationClip::CompressedTrack::Vec3Channel &out, uint32_t &numKept)
+{
+    Vector3 vmin = values.empty() ? Vector3(0.0f) : values[0];
+    Vector3 vmax = vmin;
+    for (const Vector3 &v : values)
+    {
+        vmin = Vector3::Min(vmin, v);
+        vmax = Vector3::Max(vmax, v);
+    }
+
+    // Largest distance between a value and its 16-bit encoding over the whole range of the channel. When the 16-bit
+    // step alone uses more than half of the tolerance (root motion over a long clip), the values stay floats.
+    // Otherwise the reduction gets what the quantization leaves.
+    const float quantError = 0.5f * (vmax - vmin).Length() / 65535.0f;
+    const bool useFloats   = quantError > 0.5f * tolerance;
+
+    return CompressChannel(times, values, tolerance, useFloats ? tolerance : tolerance - quantError, duration, out,
+                           numKept, [&](const std::vector<uint32_t> &kept, bool useFloatTimes) {
+                               EncodeVec3(times, values, kept, duration, useFloats, useFloatTimes, out);
+                           });
+}
+
+float CompressRotation(const std::vector<float> &times, const std::vector<Quaternion> &values, float tolerance,
+                       double duration, AnimationClip::CompressedTrack::RotChannel &out, uint32_t &numKept)
+{
+    return CompressChannel(times, values, tolerance, tolerance, duration, out, numKept,
+                           [&](const std::vector<uint32_t> &kept, bool useFloatTimes) {
+                               EncodeTimes(times, kept, duration, useFloatTimes, out);
+                               out.values.resize(kept.size() * 3);
+                               for (size_t i = 0; i < kept.size(); i++)
+                               {
+                                   AnimationCompressor::EncodeRotation(values[kept[i]], &out.values[3 * i]);
+                               }
+                           });
+}
+} // namespace
+
+void AnimationCompressor::EncodeRotation(const Quaternion &rot, uint16_t out[3])
+{
+    Quaternion q = rot;
+    q.Normalize();
+
+    float c[4] = {q.x, q.y, q.z, q.w};
+
+    uint32_t largest = 0;
+    for (uint32_t k = 1; k < 4; k++)
+    {
+        if (fabsf(c[k]) > fabsf(c[largest]))
+        {
+            largest = k;
+        }
+    }
+
+    // q and -q are the same rotation. Keep the dropped component positive so it can be rebuilt with sqrt.
+    const float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint64_t bits = uint64_t(largest) << 45;
+    for (uint32_t k = 0, j = 0; k < 4; k++)
+    {
+        if (k == largest)
+        {
+            continue;
+        }
+        const float v    = std::clamp(c[k] * sign / 0.70710678f, -1.0f, 1.0f);
+        const uint64_t u = uint64_t((v * 0.5f + 0.5f) * 32767.0f + 0.5f);
+        bits |= u << (30 - 15 * j);
+        j++;
+    }
+
+    out[0] = uint16_t(bits >> 32);
+    out[1] = uint16_t(bits >> 16);
+    out[2] = uint16_t(bits);
+}
+
+size_t AnimationCompressor::RawBytes(const AnimationClip &clip)
+{
+    size_t bytes = 0;
+    for (const auto &track : clip.tracks)
+    {
+        bytes += track.posTimes.size() * sizeof(float) + track.pos.size() * sizeof(Vector3);
+        bytes += track.rotTimes.size() * sizeof(float) + track.rot.size() * sizeof(Quaternion);
+        bytes += track.scaleTimes.size() * sizeof(float) + track.scale.size() * sizeof(Vector3);
+    }
+    return bytes;
+}
+
+size_t AnimationCompressor::CompressedBytes(const AnimationClip &clip)
+{
+    size_t bytes = 0;
+    for (const auto &track : clip.compressedTracks)
+    {
+        bytes += sizeof(AnimationClip::CompressedTrack);
+        bytes += (track.pos.times.size() + track.pos.values.size()) * sizeof(uint16_t);
+        bytes += (track.rot.times.size() + track.rot.values.size()) * sizeof(uint16_t);
+        bytes += (track.scale.times.size() + track.scale.values.size()) * sizeof(uint16_t);
+        bytes += (track.pos.floatValues.size() + track.scale.floatValues.size()) * sizeof(Vector3);
+        bytes += (track.pos.floatTimes.size() + track.rot.floatTimes.size() + track.scale.floatTimes.size()) *
+                 sizeof(float);
+    }
+    return bytes;
+}
+
+AnimationCompressor::Stats AnimationCompressor::Compress(AnimationClip &clip, const Settings &settings)
+{
+    Stats stats;
+    stats.rawBytes = RawBytes(clip);
+
+    if (clip.IsCompressed())
+    {
+        stats.compressedBytes = CompressedBytes(clip);
+        return stats;
+    }
+
+    clip.compressedTracks.resize(clip.tracks.size());
+
+    for (size_t b = 0; b < clip.tracks.size(); b++)
+    {
+        const auto &src = clip.tracks[b];
+        auto &dst       = clip.compressedTracks[b];
+
+        // Reduction error and quantization error together, measured at every source key.
+        uint32_t numPos, numRot, numScale;
+        const float posError =
+            CompressVec3(src.posTimes, src.pos, settings.posTolerance, clip.duration, dst.pos, numPos);
+        const float rotError =
+            CompressRotation(src.rotTimes, src.rot, settings.rotTolerance, clip.duration, dst.rot, numRot);
+        const float scaleError =
+            CompressVec3(src.scaleTimes, src.scale, settings.scaleTolerance, clip.duration, dst.scale, numScale);
+
+        stats.rawKeys += uint32_t(src.pos.size() + src.rot.size() + src.scale.size());
+        stats.keptKeys += numPos + numRot + numScale;
+
+        stats.maxPosError   = XMMax(stats.maxPosError, posError);
+        stats.maxRotError   = XMMax(stats.maxRotError, rotError);
+        stats.maxScaleError = XMMax(stats.maxScaleError, scaleError);
+    }
+
+    clip.tracks.clear();
+    clip.tracks.shrink_to_fit();
+
+    stats.compressedBytes = CompressedBytes(clip);
+    return stats;
+}
+
+void AnimationCompressor::Compress(AnimationData &anim, const Settings &settings)
+{
+    size_t rawBytes        = 0;
+    size_t compressedBytes = 0;
+
+    for (auto &clip : anim.clips)
+    {
+        Stats stats = Compress(clip, settings);
+        rawBytes += stats.rawBytes;
+        compressedBytes += stats.compressedBytes;
+
+        Report(clip, stats);
+    }
+
+    if (anim.clips.size() > 1)
+    {
+        std::cout << "Clips total : " << rawBytes / 1024.0f << " KB -> " << compressedBytes / 1024.0f << " KB"
+                  << std::endl;
+    }
+}
+
+void AnimationCompressor::Report(const AnimationClip &clip, const Stats &stats)
+{
+    std::cout << "Clip " << clip.name << " : " << stats.rawBytes / 1024.0f << " KB -> "
+              << stats.compressedBytes / 1024.0f << " KB, keys " << stats.rawKeys << " -> " << stats.keptKeys
+              << ", max error pos " << stats.maxPosError << " rot " << XMConvertToDegrees(stats.maxRotError)
+              << " deg scale " << stats.maxScaleError << std::endl;
+}
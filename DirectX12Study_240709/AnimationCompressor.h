@@ -0,0 +1,45 @@
+#pragma once
+
+#include "AnimationData.h"
+
+struct AnimationCompressionSettings
+{
+    float posTolerance   = 0.01f;   // clip units (cm for Mixamo clips)
+    float rotTolerance   = 0.0005f; // radians
+    float scaleTolerance = 0.0001f;
+};
+
+// Converts AnimationClip::tracks into AnimationClip::compressedTracks at load time.
+//  - channels whose keys are all within tolerance of the first key keep one key
+//  - keys that interpolation of their neighbours rebuilds within tolerance are removed
+//  - rotations are stored as smallest three (48 bits), positions and scales as 16 bits per component,
+//    or as floats when the 16-bit step of the channel is too coarse for the tolerance
+//  - key times are 16-bit fractions of the duration, or floats for channels that move too far in one step
+//  - the removal is tightened until the decoded channel is within tolerance at every source key
+// AnimationData::Sample decodes the compressed tracks directly.
+class AnimationCompressor
+{
+  public:
+    using Settings = AnimationCompressionSettings;
+
+    struct Stats
+    {
+        size_t rawBytes        = 0;
+        size_t compressedBytes = 0;
+        uint32_t rawKeys       = 0;
+        uint32_t keptKeys      = 0;
+        float maxPosError      = 0.0f;
+        float maxRotError      = 0.0f; // radians
+        float maxScaleError    = 0.0f;
+    };
+
+    // Compresses every clip of anim and prints the memory before and after.
+    static void Compress(AnimationData &anim, const Settings &settings = Settings());
+    static Stats Compress(AnimationClip &clip, const Settings &settings = Settings());
+    static void Report(const AnimationClip &clip, const Stats &stats);
+
+    static size_t RawBytes(const AnimationClip &clip);
+    static size_t CompressedBytes(const AnimationClip &clip);
+
+    static void EncodeRotation(const Quaternion &q, uint16_t out[3]);
+};
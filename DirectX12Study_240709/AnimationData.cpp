@@ -1,3 +1,496 @@
-#include "pch.h"
-
 #include "AnimationData.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+// Index of the last key at or before tick, starting the search from the cached cursor.
+template <typename T> uint32_t FindKey(const std::vector<T> &times, float tick, uint32_t cursor)
+{
+    if (cursor >= times.size() || times[cursor] > tick)
+    {
+        cursor = 0; // looped or jumped backwards
+    }
+
+    while (cursor + 1 < times.size() && times[cursor + 1] <= tick)
+    {
+        cursor++;
+    }
+
+    return cursor;
+}
+
+// Rotation of q around +y (swing-twist decomposition). q = swing * twist.
+Quaternion YawTwist(const Quaternion &q, float &yaw)
+{
+    const float len = sqrtf(q.y * q.y + q.w * q.w);
+    if (len < 1e-6f)
+    {
+        yaw = 0.0f; // 180 degree swing, no defined twist
+        return Quaternion();
+    }
+
+    yaw = 2.0f * atan2f(q.y, q.w);
+    return Quaternion(0.0f, q.y / len, 0.0f, q.w / len);
+}
+
+template <typename T> float KeyFactor(const std::vector<T> &times, float tick, uint32_t cursor)
+{
+    if (cursor + 1 >= times.size())
+    {
+        return 0.0f;
+    }
+
+    const float span = float(times[cursor + 1]) - float(times[cursor]);
+    return span > 0.0f ? std::clamp((tick - float(times[cursor])) / span, 0.0f, 1.0f) : 0.0f;
+}
+
+// Moves cursor to the key at or before the sample and returns the factor towards the next key.
+// t : tick as a fraction of the duration in 16 bits, for the channels that don't keep float times.
+float FindCompressedKey(const AnimationClip::CompressedTrack::KeyTimes &ch, double tick, float t, uint32_t &cursor)
+{
+    if (!ch.floatTimes.empty())
+    {
+        cursor = FindKey(ch.floatTimes, float(tick), cursor);
+        return KeyFactor(ch.floatTimes, float(tick), cursor);
+    }
+
+    cursor = FindKey(ch.times, t, cursor);
+    return KeyFactor(ch.times, t, cursor);
+}
+} // namespace
+
+Quaternion AnimationClip::CompressedTrack::RotChannel::Decode(uint32_t i) const
+{
+    const uint16_t *v   = &values[3 * i];
+    const uint64_t bits = (uint64_t(v[0]) << 32) | (uint64_t(v[1]) << 16) | uint64_t(v[2]);
+
+    const uint32_t largest = uint32_t(bits >> 45) & 3;
+
+    // The three smaller components are in [-1/sqrt(2), 1/sqrt(2)].
+    float c[3];
+    for (int k = 0; k < 3; k++)
+    {
+        const uint32_t q = uint32_t(bits >> (30 - 15 * k)) & 0x7fff;
+        c[k]             = (float(q) / 32767.0f * 2.0f - 1.0f) * 0.70710678f;
+    }
+
+    float q[4];
+    float sum = 0.0f;
+    for (int k = 0, j = 0; k < 4; k++)
+    {
+        if (k != largest)
+        {
+            q[k] = c[j++];
+            sum += q[k] * q[k];
+        }
+    }
+    q[largest] = sqrtf(XMMax(1.0f - sum, 0.0f));
+
+    return Quaternion(q[0], q[1], q[2], q[3]);
+}
+
+AnimationClip::Key AnimationData::SampleCompressed(int clipID, int boneID, double tick,
+                                                   AnimationCursor &cursor) const
+{
+    const auto &clip  = clips[clipID];
+    const auto &track = clip.compressedTracks[boneID];
+
+    // Key times are stored as fractions of the duration, or in ticks (KeyTimes::floatTimes).
+    const float t = clip.duration > 0.0 ? float(tick / clip.duration * 65535.0) : 0.0f;
+
+    AnimationClip::Key key;
+
+    if (track.pos.GetNumKeys() > 0)
+    {
+        const float f = FindCompressedKey(track.pos, tick, t, cursor.pos);
+        key.pos = f > 0.0f ? Vector3::Lerp(track.pos.Decode(cursor.pos), track.pos.Decode(cursor.pos + 1), f)
+                           : track.pos.Decode(cursor.pos);
+    }
+
+    if (track.rot.GetNumKeys() > 0)
+    {
+        const float f = FindCompressedKey(track.rot, tick, t, cursor.rot);
+        key.rot = f > 0.0f ? Quaternion::Lerp(track.rot.Decode(cursor.rot), track.rot.Decode(cursor.rot + 1), f)
+                           : track.rot.Decode(cursor.rot);
+    }
+
+    if (track.scale.GetNumKeys() > 0)
+    {
+        const float f = FindCompressedKey(track.scale, tick, t, cursor.scale);
+        key.scale     = f > 0.0f ? Vector3::Lerp(track.scale.Decode(cursor.scale),
+                                                 track.scale.Decode(cursor.scale + 1), f)
+                                 : track.scale.Decode(cursor.scale);
+    }
+
+    return key;
+}
+
+AnimationClip::Key AnimationData::Sample(int clipID, int boneID, double tick, AnimationCursor &cursor) const
+{
+    if (clips[clipID].IsCompressed())
+    {
+        return SampleCompressed(clipID, boneID, tick, cursor);
+    }
+
+    const auto &track = clips[clipID].tracks[boneID];
+    const float t     = float(tick);
+
+    AnimationClip::Key key;
+
+    if (!track.pos.empty())
+    {
+        cursor.pos     = FindKey(track.posTimes, t, cursor.pos);
+        const float f  = KeyFactor(track.posTimes, t, cursor.pos);
+        const auto &p0 = track.pos[cursor.pos];
+        key.pos        = f > 0.0f ? Vector3::Lerp(p0, track.pos[cursor.pos + 1], f) : p0;
+    }
+
+    if (!track.rot.empty())
+    {
+        cursor.rot     = FindKey(track.rotTimes, t, cursor.rot);
+        const float f  = KeyFactor(track.rotTimes, t, cursor.rot);
+        const auto &q0 = track.rot[cursor.rot];
+        // nlerp along the shortest arc. Keys are dense enough that the speed error of nlerp is not visible.
+        key.rot = f > 0.0f ? Quaternion::Lerp(q0, track.rot[cursor.rot + 1], f) : q0;
+    }
+
+    if (!track.scale.empty())
+    {
+        cursor.scale   = FindKey(track.scaleTimes, t, cursor.scale);
+        const float f  = KeyFactor(track.scaleTimes, t, cursor.scale);
+        const auto &s0 = track.scale[cursor.scale];
+        key.scale      = f > 0.0f ? Vector3::Lerp(s0, track.scale[cursor.scale + 1], f) : s0;
+    }
+
+    return key;
+}
+
+void AnimationData::Prepare()
+{
+    const size_t numBones = offsetMatrix.size();
+
+    // Bone ids come from a pre-order walk of the node tree, so this is normally the identity.
+    // Sort by depth anyway so a parent is always evaluated before its children.
+    std::vector<int32_t> depth(numBones, 0);
+    for (size_t i = 0; i < numBones; i++)
+    {
+        for (int32_t p = boneParentId[i]; p >= 0; p = boneParentId[p])
+        {
+            depth[i]++;
+        }
+    }
+
+    evalOrder.resize(numBones);
+    for (size_t i = 0; i < numBones; i++)
+    {
+        evalOrder[i] = int32_t(i);
+    }
+    std::stable_sort(evalOrder.begin(), evalOrder.end(), [&](int32_t l, int32_t r) { return depth[l] < depth[r]; });
+
+    // Detail bones are end bones and short chains hanging from a bone with 4 or more children
+    // (the fingers of a hand). Children come after their parent in evalOrder.
+    std::vector<int32_t> height(numBones, 0);
+    std::vector<int32_t> numChildren(numBones, 0);
+    for (auto it = evalOrder.rbegin(); it != evalOrder.rend(); ++it)
+    {
+        const int32_t parent = boneParentId[*it];
+        if (parent >= 0)
+        {
+            height[parent] = XMMax(height[parent], height[*it] + 1);
+            numChildren[parent]++;
+        }
+    }
+
+    isDetailBone.assign(numBones, 0);
+    for (const int32_t boneID : evalOrder)
+    {
+        const int32_t parent = boneParentId[boneID];
+        if (parent < 0)
+        {
+            continue;
+        }
+
+        const bool finger    = numChildren[parent] >= 4 && height[boneID] <= 3;
+        isDetailBone[boneID] = isDetailBone[parent] || finger || height[boneID] == 0;
+    }
+
+    rootBone = -1;
+    for (int32_t boneID = 0; boneID < int32_t(numBones) && rootBone < 0; boneID++)
+    {
+        rootBone = boneParentId[boneID] < 0 ? boneID : -1;
+    }
+
+    for (int clipID = 0; clipID < int(clips.size()); clipID++)
+    {
+        BuildRootMotion(clipID);
+
+        std::vector<AnimationClip::Key> firstKeys(numBones);
+        for (int boneID = 0; boneID < int(numBones); boneID++)
+        {
+            AnimationCursor cursor;
+            firstKeys[boneID] = Sample(clipID, boneID, 0.0, cursor);
+        }
+        clips[clipID].firstKeys = std::move(firstKeys);
+    }
+
+    defaultMatrixInv = defaultMatrix.Invert();
+
+    bindTransform.resize(numBones);
+    for (size_t i = 0; i < numBones; i++)
+    {
+        bindTransform[i] = defaultMatrixInv * offsetMatrix[i];
+    }
+}
+
+void AnimationData::Evaluate(int clipID, double tick, std::vector<AnimationCursor> &cursors, AnimationPose &pose,
+                             bool skipDetailBones) const
+{
+    const size_t numBones = offsetMatrix.size();
+
+    if (pose.palette.size() != numBones)
+    {
+        pose.local.Resize(numBones);
+        pose.localTransform.resize(pose.local.posX.size());
+        pose.modelTransform.resize(numBones);
+        pose.palette.resize(numBones);
+    }
+
+    for (int boneID = 0; boneID < int(numBones); boneID++)
+    {
+        auto key = skipDetailBones && isDetailBone[boneID] ? clips[clipID].firstKeys[boneID]
+                                                           : Sample(clipID, boneID, tick, cursors[boneID]);
+
+        if (boneID == rootBone)
+        {
+            // Same split as BuildRootMotion: the yaw and the translation move the model.
+            float yaw;
+            Quaternion twist = YawTwist(key.rot, yaw);
+            twist.Conjugate();
+            key.rot = key.rot * twist;
+        }
+
+        if (boneParentId[boneID] < 0)
+        {
+            key.pos = Vector3(0.0f);
+        }
+
+        pose.local.Set(boneID, key);
+    }
+
+    BuildLocalTransforms(pose);
+
+    // Local to model space and the skinning palette in one walk. Parents come first in evalOrder.
+    for (const int32_t boneID : evalOrder)
+    {
+        const int parentIdx = boneParentId[boneID];
+
+        pose.modelTransform[boneID] = parentIdx >= 0 ? pose.localTransform[boneID] * pose.modelTransform[parentIdx]
+                                                     : pose.localTransform[boneID];
+        pose.palette[boneID] = (bindTransform[boneID] * pose.modelTransform[boneID] * defaultMatrix).Transpose();
+    }
+}
+
+void AnimationData::BuildRootMotion(int clipID)
+{
+    AnimationClip &clip            = clips[clipID];
+    AnimationClip::RootMotion &out = clip.rootMotion;
+
+    out = AnimationClip::RootMotion();
+    if (rootBone < 0)
+    {
+        return;
+    }
+
+    // Key times of the root.
+    std::vector<float> times = {0.0f, float(clip.duration)};
+    if (clip.IsCompressed())
+    {
+        const auto &track = clip.compressedTracks[rootBone];
+        for (uint32_t i = 0; i < uint32_t(track.pos.GetNumKeys()); i++)
+            times.push_back(track.pos.GetTick(i, clip.duration));
+        for (uint32_t i = 0; i < uint32_t(track.rot.GetNumKeys()); i++)
+            times.push_back(track.rot.GetTick(i, clip.duration));
+    }
+    else
+    {
+        const auto &track = clip.tracks[rootBone];
+        times.insert(times.end(), track.posTimes.begin(), track.posTimes.end());
+        times.insert(times.end(), track.rotTimes.begin(), track.rotTimes.end());
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    times.erase(std::remove_if(times.begin(), times.end(), [&](float t) { return t > float(clip.duration); }),
+                times.end());
+
+    AnimationCursor cursor;
+    for (const float t : times)
+    {
+        const AnimationClip::Key key = Sample(clipID, rootBone, t, cursor);
+
+        float yaw;
+        YawTwist(key.rot, yaw);
+        if (!out.yaw.empty())
+        {
+            // Keep the curve continuous so interpolation never goes the long way around.
+            while (yaw - out.yaw.back() > XM_PI)
+                yaw -= XM_2PI;
+            while (yaw - out.yaw.back() < -XM_PI)
+                yaw += XM_2PI;
+        }
+
+        out.times.push_back(t);
+        out.pos.push_back(key.pos);
+        out.yaw.push_back(yaw);
+    }
+
+    out.loopOffset = out.Sample(0.0, true).Invert() * out.Sample(clip.duration, true);
+}
+
+Matrix AnimationClip::RootMotion::Sample(double tick, bool groundOnly) const
+{
+    if (times.empty())
+    {
+        return Matrix();
+    }
+
+    const size_t i1  = XMMin(size_t(std::upper_bound(times.begin(), times.end(), float(tick)) - times.begin()),
+                             times.size() - 1);
+    const size_t i0  = i1 > 0 ? i1 - 1 : 0;
+    const float span = times[i1] - times[i0];
+    const float f    = span > 0.0f ? std::clamp((float(tick) - times[i0]) / span, 0.0f, 1.0f) : 0.0f;
+
+    Vector3 p = Vector3::Lerp(pos[i0], pos[i1], f);
+    if (groundOnly)
+    {
+        p.y = 0.0f;
+    }
+
+    return Matrix::CreateRotationY(yaw[i0] + (yaw[i1] - yaw[i0]) * f) * Matrix::CreateTranslation(p);
+}
+
+void AnimationData::UpdateRootMotion(AnimationState &state, int clipID, double time) const
+{
+    const AnimationClip &clip              = clips[clipID];
+    const AnimationClip::RootMotion &curve = clip.rootMotion;
+
+    const double tick   = clip.GetTick(time);
+    const int64_t loop  = clip.duration > 0.0 ? int64_t(floor(time * clip.tickPerSecond / clip.duration)) : 0;
+    const Matrix ground = curve.Sample(tick, true);
+
+    if (state.rootClip != clipID)
+    {
+        // Continue from where the model stands. The first clip starts at the origin facing its own yaw.
+        Matrix target = state.rootGround;
+        if (state.rootClip < 0)
+        {
+            target = ground;
+            target.Translation(Vector3(0.0f));
+        }
+
+        state.rootBase = ground.Invert() * target;
+        state.rootClip = clipID;
+        state.rootLoop = loop;
+    }
+
+    // Every wrap moves the start of the clip to where its end was.
+    for (; state.rootLoop < loop; state.rootLoop++)
+    {
+        state.rootBase = curve.loopOffset * state.rootBase;
+    }
+    for (; state.rootLoop > loop; state.rootLoop--)
+    {
+        state.rootBase = curve.loopOffset.Invert() * state.rootBase;
+    }
+
+    state.rootTransform = curve.Sample(tick) * state.rootBase;
+    state.rootGround    = ground * state.rootBase;
+}
+
+// Scale * Rotation * Translation for 4 bones at a time. Same layout as Key::GetTransform.
+void AnimationData::BuildLocalTransforms(AnimationPose &pose)
+{
+    const PoseSoA &p = pose.local;
+
+    for (size_t i = 0; i < p.posX.size(); i += 4)
+    {
+        const XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.rotX[i]));
+        const XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.rotY[i]));
+        const XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.rotZ[i]));
+        const XMVECTOR w = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.rotW[i]));
+
+        const XMVECTOR sx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.scaleX[i]));
+        const XMVECTOR sy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.scaleY[i]));
+        const XMVECTOR sz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&p.scaleZ[i]));
+
+        const XMVECTOR one = XMVectorSplatOne();
+        const XMVECTOR x2  = XMVectorAdd(x, x);
+        const XMVECTOR y2  = XMVectorAdd(y, y);
+        const XMVECTOR z2  = XMVectorAdd(z, z);
+
+        const XMVECTOR xx = XMVectorMultiply(x, x2);
+        const XMVECTOR yy = XMVectorMultiply(y, y2);
+        const XMVECTOR zz = XMVectorMultiply(z, z2);
+        const XMVECTOR xy = XMVectorMultiply(x, y2);
+        const XMVECTOR xz = XMVectorMultiply(x, z2);
+        const XMVECTOR yz = XMVectorMultiply(y, z2);
+        const XMVECTOR wx = XMVectorMultiply(w, x2);
+        const XMVECTOR wy = XMVectorMultiply(w, y2);
+        const XMVECTOR wz = XMVectorMultiply(w, z2);
+
+        // Rows of the rotation matrix (XMMatrixRotationQuaternion), scaled by the bone scale.
+        XMFLOAT4A m[9];
+        XMStoreFloat4A(&m[0], XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(yy, zz)), sx));
+        XMStoreFloat4A(&m[1], XMVectorMultiply(XMVectorAdd(xy, wz), sx));
+        XMStoreFloat4A(&m[2], XMVectorMultiply(XMVectorSubtract(xz, wy), sx));
+        XMStoreFloat4A(&m[3], XMVectorMultiply(XMVectorSubtract(xy, wz), sy));
+        XMStoreFloat4A(&m[4], XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, zz)), sy));
+        XMStoreFloat4A(&m[5], XMVectorMultiply(XMVectorAdd(yz, wx), sy));
+        XMStoreFloat4A(&m[6], XMVectorMultiply(XMVectorAdd(xz, wy), sz));
+        XMStoreFloat4A(&m[7], XMVectorMultiply(XMVectorSubtract(yz, wx), sz));
+        XMStoreFloat4A(&m[8], XMVectorMultiply(XMVectorSubtract(one, XMVectorAdd(xx, yy)), sz));
+
+        const float *lane[9] = {&m[0].x, &m[1].x, &m[2].x, &m[3].x, &m[4].x, &m[5].x, &m[6].x, &m[7].x, &m[8].x};
+        for (size_t k = 0; k < 4; k++)
+        {
+            pose.localTransform[i + k] = Matrix(lane[0][k], lane[1][k], lane[2][k], 0.0f,  //
+                                                lane[3][k], lane[4][k], lane[5][k], 0.0f,  //
+                                                lane[6][k], lane[7][k], lane[8][k], 0.0f,  //
+                                                p.posX[i + k], p.posY[i + k], p.posZ[i + k], 1.0f);
+        }
+    }
+}
+
+void PoseSoA::Resize(size_t numBones)
+{
+    const size_t n = (numBones + 3) & ~size_t(3);
+
+    // Padding lanes hold the identity transform.
+    posX.assign(n, 0.0f);
+    posY.assign(n, 0.0f);
+    posZ.assign(n, 0.0f);
+    rotX.assign(n, 0.0f);
+    rotY.assign(n, 0.0f);
+    rotZ.assign(n, 0.0f);
+    rotW.assign(n, 1.0f);
+    scaleX.assign(n, 1.0f);
+    scaleY.assign(n, 1.0f);
+    scaleZ.assign(n, 1.0f);
+}
+
+void PoseSoA::Set(size_t i, const AnimationClip::Key &key)
+{
+    posX[i]   = key.pos.x;
+    posY[i]   = key.pos.y;
+    posZ[i]   = key.pos.z;
+    rotX[i]   = key.rot.x;
+    rotY[i]   = key.rot.y;
+    rotZ[i]   = key.rot.z;
+    rotW[i]   = key.rot.w;
+    scaleX[i] = key.scale.x;
+    scaleY[i] = key.scale.y;
+    scaleZ[i] = key.scale.z;
+}
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <directxtk/SimpleMath.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 using DirectX::SimpleMath::Matrix;
 using DirectX::SimpleMath::Quaternion;
 using DirectX::SimpleMath::Vector2;
@@ -7,6 +14,7 @@ using DirectX::SimpleMath::Vector3;
 
 struct AnimationClip
 {
+    // Local transform of a bone at some time.
     struct Key
     {
         Vector3 pos    = Vector3(0.0f);
@@ -19,59 +27,199 @@ struct AnimationClip
         }
     };
 
+    // Keys of one bone. Each channel keeps its own key times (in ticks), they don't have to match.
+    struct Track
+    {
+        std::vector<float> posTimes;
+        std::vector<Vector3> pos;
+        std::vector<float> rotTimes;
+        std::vector<Quaternion> rot;
+        std::vector<float> scaleTimes;
+        std::vector<Vector3> scale;
+    };
+
+    // Track after AnimationCompressor. Constant channels keep a single key and keys that linear
+    // interpolation rebuilds within tolerance are removed.
+    struct CompressedTrack
+    {
+        // Key times as 16-bit fractions of the duration. A channel that moves further than the tolerance
+        // within one 16-bit step keeps its key times in ticks instead.
+        struct KeyTimes
+        {
+            std::vector<uint16_t> times;
+            std::vector<float> floatTimes; // ticks, used instead of times when not empty
+
+            size_t GetNumKeys() const
+            {
+                return floatTimes.empty() ? times.size() : floatTimes.size();
+            }
+
+            float GetTick(uint32_t i, double duration) const
+            {
+                return floatTimes.empty() ? float(times[i] / 65535.0 * duration) : floatTimes[i];
+            }
+        };
+
+        // 16 bits per component inside [min, min + extent]. A channel whose range is too wide for the
+        // 16-bit step to stay within tolerance keeps float values instead.
+        struct Vec3Channel : KeyTimes
+        {
+            Vector3 min    = Vector3(0.0f);
+            Vector3 extent = Vector3(0.0f);
+            std::vector<uint16_t> values;     // 3 per key
+            std::vector<Vector3> floatValues; // used instead of values when not empty
+
+            Vector3 Decode(uint32_t i) const
+            {
+                if (!floatValues.empty())
+                {
+                    return floatValues[i];
+                }
+                const uint16_t *v = &values[3 * i];
+                return min + extent * Vector3(v[0], v[1], v[2]) / 65535.0f;
+            }
+        };
+
+        // Smallest three, 48 bits per key. 2 bits for the index of the dropped (largest) component
+        // and 15 bits for each of the others.
+        struct RotChannel : KeyTimes
+        {
+            std::vector<uint16_t> values; // 3 per key
+
+            Quaternion Decode(uint32_t i) const;
+        };
+
+        Vec3Channel pos;
+        RotChannel rot;
+        Vec3Channel scale;
+    };
+
+    // Motion of the root bone that moves the model instead of the palette: yaw around +y and translation.
+    // Built by AnimationData::Prepare at the key times of the root, so it matches what Evaluate removes.
+    struct RootMotion
+    {
+        std::vector<float> times; // ticks
+        std::vector<Vector3> pos;
+        std::vector<float> yaw;   // radians, unwrapped
+        Matrix loopOffset;        // ground motion (yaw, x, z) from the start to the end of the clip
+
+        // Rotation(yaw) * Translation(pos) at tick. groundOnly drops the height.
+        Matrix Sample(double tick, bool groundOnly = false) const;
+    };
+
     std::string name;
-    double duration;
+    double duration;      // ticks
     double tickPerSecond;
     unsigned int numChannels;
-    std::vector<std::vector<Key>> keys; // bone ŭ Ѵ. keys[num bone][num frame]
+    std::vector<Track> tracks;                     // tracks[bone id], empty once the clip is compressed
+    std::vector<CompressedTrack> compressedTracks; // compressedTracks[bone id]
+    std::vector<Key> firstKeys;                    // pose at tick 0, used for bones skipped by animation LOD
+    RootMotion rootMotion;
+
+    bool IsCompressed() const
+    {
+        return !compressedTracks.empty();
+    }
+
+    // Playback time in seconds -> tick inside [0, duration).
+    double GetTick(double time) const
+    {
+        if (duration <= 0.0)
+        {
+            return 0.0;
+        }
+        double tick = fmod(time * tickPerSecond, duration);
+        return tick < 0.0 ? tick + duration : tick;
+    }
 };
 
+// Last key index used per channel of a bone. Playback moves forward, so the next lookup
+// usually starts at the right key.
+struct AnimationCursor
+{
+    uint32_t pos   = 0;
+    uint32_t rot   = 0;
+    uint32_t scale = 0;
+};
+
+// Local pose of every bone in SoA layout. Padded to a multiple of 4 bones so the local matrices
+// are built 4 bones at a time.
+struct PoseSoA
+{
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> rotX, rotY, rotZ, rotW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    void Resize(size_t numBones);
+    void Set(size_t i, const AnimationClip::Key &key);
+};
+
+// Output of AnimationData::Evaluate. Also keeps the scratch arrays so they are reused between calls.
+struct AnimationPose
+{
+    PoseSoA local;
+    std::vector<Matrix> localTransform;
+    std::vector<Matrix> modelTransform;
+    std::vector<Matrix> palette; // skinning matrices, already transposed for the shader
+};
+
+// Playback state of one model. The skeleton and the clips are shared through AnimationAsset.
+struct AnimationState
+{
+    int32_t clipID = 0;
+    double time    = 0.0; // seconds
+    Matrix rootTransform;  // root motion at time, see AnimationData::UpdateRootMotion
+
+    // Root motion integration. rootTransform = RootMotion::Sample(tick) * rootBase.
+    int32_t rootClip = -1;
+    int64_t rootLoop = 0;
+    Matrix rootBase;   // loop offsets and clip changes so far, ground plane only
+    Matrix rootGround; // rootTransform without the height
+
+    std::vector<AnimationCursor> cursors;
+    int32_t cursorClip = -1;
+};
+
+// Skeleton and clips. Read only once Prepare has run, so one instance can be shared by many models.
 struct AnimationData
 {
     std::unordered_map<std::string, int32_t> boneNameToId;
     std::map<uint32_t, std::string> boneIdToName;
     std::vector<int32_t> boneParentId;
     std::vector<Matrix> offsetMatrix;
-    std::vector<Matrix> boneTransform;
     Matrix defaultMatrix;
-    Matrix accumulrateRootTransform;
     std::vector<AnimationClip> clips;
-    Vector3 prevPos = Vector3(0.0f);
 
-    Matrix Get(int clipID, int boneID, int frameCount)
+    // built by Prepare
+    std::vector<int32_t> evalOrder;    // parents before children
+    std::vector<Matrix> bindTransform; // defaultMatrix.Invert() * offsetMatrix
+    std::vector<uint8_t> isDetailBone; // end bones and fingers, skipped by animation LOD
+    Matrix defaultMatrixInv;
+    int32_t rootBone = -1; // carries the root motion
+
+    uint32_t GetNumBones() const
     {
-        return defaultMatrix.Invert() * offsetMatrix[boneID] * boneTransform[boneID] * defaultMatrix;
+        return uint32_t(offsetMatrix.size());
     }
 
-    void Update(int clipID, int frame)
-    {
-        auto &clip = clips[clipID];
+    void Prepare();
 
-        for (int boneID = 0; boneID < boneTransform.size(); boneID++)
-        {
-            auto &keys          = clip.keys[boneID];
-            const int parentIdx = boneParentId[boneID];
-            Matrix parentMatrix = parentIdx >= 0 ? boneTransform[parentIdx] : accumulrateRootTransform;
+    // tick : from AnimationClip::GetTick. cursors : one per bone, owned by the caller.
+    // The palette leaves out the root motion (AnimationClip::RootMotion), UpdateRootMotion applies it.
+    // skipDetailBones : bones marked in isDetailBone keep the first key of the clip.
+    void Evaluate(int clipID, double tick, std::vector<AnimationCursor> &cursors, AnimationPose &pose,
+                  bool skipDetailBones = false) const;
 
-            auto key = keys.size() > 0 ? keys[frame % keys.size()] : AnimationClip::Key();
+    AnimationClip::Key Sample(int clipID, int boneID, double tick, AnimationCursor &cursor) const;
 
-            if (parentIdx < 0)
-            {
-                if (frame != 0)
-                {
-                    accumulrateRootTransform = Matrix::CreateTranslation(key.pos - prevPos) * accumulrateRootTransform;
-                }
-                else
-                {
-                    auto temp = accumulrateRootTransform.Translation();
-                    temp.y    = key.pos.y;
-                    accumulrateRootTransform.Translation(temp);
-                }
-                prevPos = key.pos;
-                key.pos = Vector3(0.0f);
-            }
+    // Sets state.rootTransform for time (seconds) in clipID. Only depends on the time, not on how often
+    // it is called: loops add the loop offset of the clip and a clip change keeps the model where it is.
+    void UpdateRootMotion(AnimationState &state, int clipID, double time) const;
 
-            boneTransform[boneID] = key.GetTransform() * parentMatrix;
-        }
-    }
-};
\ No newline at end of file
+  private:
+    void BuildRootMotion(int clipID);
+
+    AnimationClip::Key SampleCompressed(int clipID, int boneID, double tick, AnimationCursor &cursor) const;
+
+    static void BuildLocalTransforms(AnimationPose &pose);
+};
@@ -7,7 +7,9 @@
 #include "GeometryGenerator.h"
 #include "GraphicsCommon.h"
 #include "Input.h"
+#include "JobSystem.h"
 #include "Model.h"
+#include "TextureCache.h"
 #include "Timer.h"
 #include "FrameResource.h"
 
@@ -54,6 +56,8 @@ AppBase::~AppBase()
 
 	Graphics::DestroyGraphicsCommon();
 
+	g_JobSystem.Shutdown();
+
 	// Cleanup
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
@@ -97,6 +101,11 @@ bool AppBase::Initialize()
 	CREATE_OBJ(m_timer, Timer);
 	m_timer->Initialize();
 
+	// CPU job workers. The main thread takes part in every ParallelFor, so leave one core for it.
+	g_JobSystem.Initialize(XMMax(std::thread::hardware_concurrency(), 2u) - 1);
+
+	m_assetLoader.Initialize(m_device, m_commandQueue);
+
 	// Mouse & Keyboard input initialize.
 	GameInput::Initialize();
 
@@ -133,6 +142,8 @@ bool AppBase::Initialize()
 
 void AppBase::Destroy()
 {
+	// Loads that haven't been published are dropped. The workers run out their queue, then the GPU its copies.
+	g_JobSystem.Shutdown();
 	WaitForGpu();
 }
 
@@ -149,6 +160,12 @@ void AppBase::Update(const float dt)
 		CloseHandle(eventHandle);
 	}
 
+	g_TextureCache.Update(m_curFence + 1, m_fence->GetCompletedValue());
+
+	m_curFrameResource->ResetBonePalette();
+
+	m_assetLoader.Update();
+
 	m_timer->Update();
 
 	GameInput::Update(dt);
@@ -165,6 +182,8 @@ void AppBase::Update(const float dt)
 
 	for (auto& e : m_opaqueList)
 	{
+		if (e->m_isPending)
+			continue;
 		e->GetMaterialConstCPU().metalnessFactor = m_metalness;
 		e->GetMaterialConstCPU().roughnessFactor = m_roughness;
 		e->Update(m_curFrameResource->m_meshConstsBuffer, m_curFrameResource->m_materialConstsBuffer);
@@ -207,7 +226,7 @@ void AppBase::Render()
 
 int32_t AppBase::Run()
 {
-	// Main sample loop.
+	// Main sample loop. Loads started by Initialize finish in Update, their descriptors are null SRVs until then.
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
 	{
@@ -958,19 +977,23 @@ void AppBase::WaitForGpu()
 		WaitForSingleObject(eventHandle, INFINITE);
 		CloseHandle(eventHandle);
 	}
+
+	g_TextureCache.Update(m_curFence + 1, m_curFence);
 }
 
 void AppBase::InitCubemap(std::wstring basePath, std::wstring envFilename, std::wstring diffuseFilename,
 	std::wstring specularFilename, std::wstring brdfFilename)
 {
-	D3DUtils::CreateDDSTexture(m_device, m_commandQueue, (basePath + envFilename).c_str(), &m_cubeMapResource[0],
-		m_cubeMapHandle[0]);
-	D3DUtils::CreateDDSTexture(m_device, m_commandQueue, (basePath + diffuseFilename).c_str(), &m_cubeMapResource[1],
-		m_cubeMapHandle[1]);
-	D3DUtils::CreateDDSTexture(m_device, m_commandQueue, (basePath + specularFilename).c_str(), &m_cubeMapResource[2],
-		m_cubeMapHandle[2]);
-	D3DUtils::CreateDDSTexture(m_device, m_commandQueue, (basePath + brdfFilename).c_str(), &m_cubeMapResource[3],
-		m_cubeMapHandle[3]);
+	const std::wstring filenames[4] = { envFilename, diffuseFilename, specularFilename, brdfFilename };
+
+	// The four are bound as one table starting at m_cubeMapHandle[0], so allocate them here in order
+	// and let the files load in parallel.
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		m_cubeMapHandle[i] = Graphics::s_Texture.Alloc(1);
+		m_assetLoader.LoadDDSTexture(basePath + filenames[i], D3D12_CPU_DESCRIPTOR_HANDLE(m_cubeMapHandle[i]), i < 3,
+			[this, i](TextureAsset& texture) { m_cubeMapResource[i] = texture.resource; });
+	}
 }
 
 void AppBase::InitLights()
@@ -1100,10 +1123,10 @@ void AppBase::WorkerThread(int threadIndex)
 		pShadowCommandList->OMSetRenderTargets(0, nullptr, false, &m_shadowMap[i].GetDSV());
 		pShadowCommandList->ClearDepthStencilView(m_shadowMap[i].GetDSV(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
 
-		// render object.
+		// render object. Render, not RenderVisible: the meshlets were culled for the main camera, not the light.
 		for (auto& e : m_opaqueList)
 		{
-			if (e->m_castShadow)
+			if (e->m_castShadow && !e->m_isPending)
 			{
 				pShadowCommandList->SetPipelineState(e->GetDepthOnlyPSO());
 				e->Render(pShadowCommandList);
@@ -1140,10 +1163,11 @@ void AppBase::WorkerThread(int threadIndex)
 	int count = 0;
 	for (auto& e : m_opaqueList)
 	{
-		if (e->m_isDraw == true)
+		if (e->m_isDraw == true && !e->m_isPending)
 		{
 			pSceneCommandList->SetPipelineState(e->GetPSO(m_isWireFrame));
-			e->Render(pSceneCommandList);
+			// The main camera pass, the one Engine::Update culls the meshlets for.
+			e->RenderVisible(pSceneCommandList);
 
 			if (m_drawAsNormal)
 			{
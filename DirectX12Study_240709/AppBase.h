@@ -1,5 +1,6 @@
 #pragma once
 
+#include "AssetLoader.h"
 #include "ColorBuffer.h"
 #include "ConstantBuffer.h"
 #include "DepthBuffer.h"
@@ -115,6 +116,9 @@ protected:
 	ID3D12CommandQueue* m_commandQueue = nullptr;
 	ID3D12GraphicsCommandList* m_commandList = nullptr;
 
+	// Loads started in Initialize are finished before the first frame, later ones during Update.
+	AssetLoader m_assetLoader;
+
 	GlobalConsts m_globalConstsData = {};
 	GlobalConsts m_shadowConstsData[MAX_LIGHTS] = {};
 	//UploadBuffer<GlobalConsts> m_globalConstsBuffer;
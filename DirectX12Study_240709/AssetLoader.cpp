@@ -0,0 +1,179 @@
+#include "pch.h"
+
+#include "AssetLoader.h"
+#include "DDSCache.h"
+#include "JobSystem.h"
+
+AssetLoader::~AssetLoader()
+{
+    // Workers are joined before this (AppBase shuts g_JobSystem down first), nothing pushes anymore.
+    Completion *completion = m_completed.exchange(nullptr);
+    while (completion)
+    {
+        Completion *next = completion->next;
+        delete completion;
+        completion = next;
+    }
+
+    for (Completion *c : m_waiting)
+    {
+        delete c;
+    }
+    m_waiting.clear();
+}
+
+void AssetLoader::Initialize(ID3D12Device *device, ID3D12CommandQueue *commandQueue)
+{
+    m_device       = device;
+    m_commandQueue = commandQueue;
+}
+
+AssetHandle<TextureAsset> AssetLoader::LoadTexture(const std::string &filename, D3D12_CPU_DESCRIPTOR_HANDLE descHandle,
+                                                   bool isSRGB, XMFLOAT3 color,
+                                                   std::function<void(TextureAsset &)> onReady)
+{
+    return UploadAsync(
+        [this, filename, isSRGB, color](ResourceUploadBatch &batch, TextureAsset &texture) {
+            TextureImage image;
+            if (filename.empty())
+            {
+                image = D3DUtils::ReadTexture(filename, color, isSRGB);
+                MipGenerator::Generate(image);
+            }
+            else
+            {
+                DDSCacheSettings settings;
+                settings.isSRGB           = isSRGB;
+                const std::string ddsPath = DDSCache::Fetch(filename, settings, image);
+                if (!ddsPath.empty())
+                {
+                    const std::wstring wPath(ddsPath.begin(), ddsPath.end());
+                    ThrowIfFailed(CreateDDSTextureFromFile(m_device, batch, wPath.c_str(), &texture.resource));
+                    return;
+                }
+            }
+            D3DUtils::UploadTexture(m_device, batch, image, &texture.resource);
+        },
+        descHandle, false, std::move(onReady));
+}
+
+AssetHandle<TextureAsset> AssetLoader::LoadDDSTexture(const std::wstring &filename,
+                                                      D3D12_CPU_DESCRIPTOR_HANDLE descHandle, bool isCubemap,
+                                                      std::function<void(TextureAsset &)> onReady)
+{
+    return UploadAsync(
+        [this, filename](ResourceUploadBatch &batch, TextureAsset &texture) {
+            ThrowIfFailed(CreateDDSTextureFromFile(m_device, batch, filename.c_str(), &texture.resource, false, 0,
+                                                   nullptr, &texture.isCubemap));
+        },
+        descHandle, isCubemap, std::move(onReady));
+}
+
+uint32_t AssetLoader::Update()
+{
+    // Take everything pushed so far in one exchange. Only this thread removes nodes, so there is no ABA.
+    Completion *list = m_completed.exchange(nullptr, std::memory_order_acquire);
+
+    // The list is newest first, publish in completion order.
+    const size_t firstNew = m_waiting.size();
+    for (; list; list = list->next)
+    {
+        m_waiting.push_back(list);
+    }
+    std::reverse(m_waiting.begin() + firstNew, m_waiting.end());
+
+    uint32_t numReady = 0;
+    size_t numWaiting = 0;
+    for (size_t i = 0; i < m_waiting.size(); i++)
+    {
+        Completion *completion = m_waiting[i];
+        bool isDone            = false;
+        try
+        {
+            isDone = completion->finish();
+        }
+        catch (...)
+        {
+            // The failed load is over. Drop its slot and the ones already freed, keep the rest for the next Update,
+            // then let the caller see the error.
+            delete completion;
+            m_numPending--;
+            m_waiting.erase(m_waiting.begin() + numWaiting, m_waiting.begin() + i + 1);
+            throw;
+        }
+
+        if (!isDone)
+        {
+            m_waiting[numWaiting++] = completion;
+            continue;
+        }
+
+        delete completion;
+        m_numPending--;
+        numReady++;
+    }
+    m_waiting.resize(numWaiting);
+
+    return numReady;
+}
+
+void AssetLoader::Run(std::function<Finish()> work)
+{
+    m_numPending++;
+
+    g_JobSystem.Dispatch([this, work = std::move(work)](uint32_t threadIndex) {
+        Completion *completion = new Completion;
+        try
+        {
+            completion->finish = work();
+        }
+        catch (...)
+        {
+            completion->finish = [error = std::current_exception()]() -> bool { std::rethrow_exception(error); };
+        }
+        Push(completion);
+    });
+}
+
+void AssetLoader::Push(Completion *completion)
+{
+    completion->next = m_completed.load(std::memory_order_relaxed);
+    while (!m_completed.compare_exchange_weak(completion->next, completion, std::memory_order_release,
+                                              std::memory_order_relaxed))
+    {
+    }
+}
+
+AssetHandle<TextureAsset> AssetLoader::UploadAsync(std::function<void(ResourceUploadBatch &, TextureAsset &)> upload,
+                                                   D3D12_CPU_DESCRIPTOR_HANDLE descHandle, bool isCubemap,
+                                                   std::function<void(TextureAsset &)> onReady)
+{
+    D3DUtils::CreateNullSRV(m_device, descHandle, isCubemap);
+
+    AssetHandle<TextureAsset> handle;
+    handle.m_state = std::make_shared<AssetHandle<TextureAsset>::State>();
+
+    Run([this, state = handle.m_state, upload = std::move(upload), descHandle, onReady]() -> Finish {
+        // Each load records into its own command list, ExecuteCommandLists is free threaded.
+        ResourceUploadBatch batch(m_device);
+        batch.Begin();
+        upload(batch, state->value);
+        std::shared_future<void> uploaded = batch.End(m_commandQueue).share();
+
+        return [this, state, descHandle, onReady, uploaded]() {
+            if (uploaded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                return false;
+            }
+
+            D3DUtils::CreateTextureSRV(m_device, state->value.resource, descHandle, state->value.isCubemap);
+            state->ready = true;
+            if (onReady)
+            {
+                onReady(state->value);
+            }
+            return true;
+        };
+    });
+    return handle;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+
+// Result of an asynchronous load. The value is written on a worker and published by AssetLoader::Update,
+// so IsReady and Get are for the main thread.
+template <typename T> class AssetHandle
+{
+  public:
+    bool IsValid() const
+    {
+        return m_state != nullptr;
+    }
+
+    bool IsReady() const
+    {
+        return m_state && m_state->ready;
+    }
+
+    T &Get() const
+    {
+        assert(IsReady());
+        return m_state->value;
+    }
+
+  private:
+    friend class AssetLoader;
+
+    struct State
+    {
+        T value    = {};
+        bool ready = false;
+    };
+
+    std::shared_ptr<State> m_state;
+};
+
+struct TextureAsset
+{
+    ID3D12Resource *resource = nullptr; // released by whoever takes it from the handle
+    bool isCubemap           = false;
+};
+
+// Runs file reads, decoding and mesh processing on g_JobSystem and hands the results back to the main thread.
+// Finished jobs push themselves on a lock-free list, Update drains it once per frame and does the part that has
+// to stay on the main thread (descriptors, callbacks). Textures are uploaded with their own ResourceUploadBatch
+// and become ready when the GPU copy is done, nothing waits on the GPU.
+class AssetLoader
+{
+  public:
+    ~AssetLoader();
+
+    void Initialize(ID3D12Device *device, ID3D12CommandQueue *commandQueue);
+
+    // load runs on a worker. onReady runs on the main thread in the Update that publishes the result.
+    // Any thread can start a load. An exception thrown by load or onReady is rethrown from Update, one per call,
+    // and the load counts as finished.
+    template <typename T>
+    AssetHandle<T> Load(std::function<T()> load, std::function<void(T &)> onReady = {})
+    {
+        AssetHandle<T> handle;
+        handle.m_state = std::make_shared<typename AssetHandle<T>::State>();
+
+        Run([state = handle.m_state, load = std::move(load), onReady = std::move(onReady)]() -> Finish {
+            state->value = load();
+            return [state, onReady]() {
+                state->ready = true;
+                if (onReady)
+                {
+                    onReady(state->value);
+                }
+                return true;
+            };
+        });
+        return handle;
+    }
+
+    // The SRV is written to descHandle. Allocate it on the main thread before the call, DescriptorHeap::Alloc
+    // isn't thread safe and tables expect the order they were allocated in. Until the texture is ready descHandle
+    // holds a null SRV, so it can be bound right away. A file is loaded as BC7 with mips through DDSCache.
+    AssetHandle<TextureAsset> LoadTexture(const std::string &filename, D3D12_CPU_DESCRIPTOR_HANDLE descHandle,
+                                          bool isSRGB = false, XMFLOAT3 color = {},
+                                          std::function<void(TextureAsset &)> onReady = {});
+    // isCubemap : dimension of the null SRV, it has to match what the shader declares.
+    AssetHandle<TextureAsset> LoadDDSTexture(const std::wstring &filename, D3D12_CPU_DESCRIPTOR_HANDLE descHandle,
+                                             bool isCubemap, std::function<void(TextureAsset &)> onReady = {});
+
+    // Main thread, once per frame. Publishes what finished since the last call without blocking.
+    // Returns the number of loads that became ready.
+    uint32_t Update();
+
+    uint32_t GetNumPending() const
+    {
+        return m_numPending;
+    }
+
+  private:
+    // Main thread part of a load. Returns false to be called again next Update (GPU copy still running).
+    using Finish = std::function<bool()>;
+
+    struct Completion
+    {
+        Finish finish;
+        Completion *next = nullptr;
+    };
+
+    void Run(std::function<Finish()> work);
+    void Push(Completion *completion);
+
+    AssetHandle<TextureAsset> UploadAsync(std::function<void(ResourceUploadBatch &, TextureAsset &)> upload,
+                                          D3D12_CPU_DESCRIPTOR_HANDLE descHandle, bool isCubemap,
+                                          std::function<void(TextureAsset &)> onReady);
+
+  private:
+    ID3D12Device *m_device             = nullptr;
+    ID3D12CommandQueue *m_commandQueue = nullptr;
+
+    std::atomic<Completion *> m_completed{nullptr}; // pushed by workers, newest first
+    std::vector<Completion *> m_waiting;            // main thread only, in completion order
+    std::atomic<uint32_t> m_numPending{0};
+};
@@ -39,6 +39,13 @@ bool CollisionSample::Initialize()
         m_sphereCollider.center = center;
 
         m_boundingSphere = DirectX::BoundingSphere(center, radius);
+
+        CollisionShape shape;
+        shape.type   = CollisionShape::SPHERE;
+        shape.p0     = center;
+        shape.radius = radius;
+        m_shapes.push_back(shape);
+        m_contactGenerator.Initialize();
     }
 
     //// ﰢ 
@@ -80,6 +87,8 @@ bool CollisionSample::Initialize()
             m_triangleCollider.positions.push_back(v.position);
         }
 
+        m_heightField.Initialize({m_triangleCollider.positions.begin(), m_triangleCollider.positions.end()}, 25, 25);
+
         for (auto i : grid.indices)
         {
             m_triangleCollider.indices.push_back(i);
@@ -151,6 +160,8 @@ void CollisionSample::UpdateGui(const float frameRate)
 {
     AppBase::UpdateGui(frameRate);
 
+    ImGui::Text("Contacts: %d, depth: %.4f", int(m_contactGenerator.GetContacts().size()), m_contactDepth);
+
     // Light
     if (ImGui::CollapsingHeader("Lights"))
     {
@@ -564,19 +575,20 @@ void CollisionSample::Update(const float dt)
 
     m_boundingSphere.Center = m_opaqueList[0]->GetPos();
 
-    bool hit = false;
+    // Only the cells under the sphere footprint are tested.
+    bool hit = m_heightField.Intersects(m_boundingSphere);
 
-    // ü ϳ  ,  ü ؼ  浹ó ϴ  ũ.
+    // The same cells are the pair list of the narrow phase. Its contacts are only shown in the GUI, the sphere still
+    // just stops on a hit.
+    m_shapes[0].p0 = m_boundingSphere.Center;
+    m_pairTriangles.clear();
+    m_pairs.clear();
+    m_heightField.AddPairs(m_shapes, m_pairTriangles, m_pairs);
 
-    for (uint32_t i = 0; i < m_triangleCollider.indices.size(); i += 3)
+    m_contactDepth = 0.0f;
+    for (const Contact &contact : m_contactGenerator.Generate(m_shapes, m_pairTriangles, m_pairs))
     {
-        if (m_boundingSphere.Intersects(m_triangleCollider.positions[m_triangleCollider.indices[i]],
-                                        m_triangleCollider.positions[m_triangleCollider.indices[i + 1]],
-                                        m_triangleCollider.positions[m_triangleCollider.indices[i + 2]]))
-        {
-            hit = true;
-            break;
-        }
+        m_contactDepth = XMMax(m_contactDepth, contact.depth);
     }
 
     // W  ߻
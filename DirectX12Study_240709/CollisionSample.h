@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AppBase.h"
+#include "HeightField.h"
 #include <directxtk/simplemath.h>
 
 struct Ray
@@ -312,4 +313,13 @@ class CollisionSample : public AppBase
 
     DirectX::BoundingSphere m_boundingSphere;
     bool m_gravityFlag = true;
+
+    HeightField m_heightField;
+
+    // The sphere as a narrow phase shape, paired with the height field cells under it every frame.
+    ContactGenerator m_contactGenerator;
+    std::vector<CollisionShape> m_shapes;
+    std::vector<XMFLOAT3> m_pairTriangles;
+    std::vector<CollisionPair> m_pairs;
+    float m_contactDepth = 0.0f; // deepest contact of the last Update
 };
@@ -81,6 +81,15 @@ cbuffer MeshConsts : register(b1)
     uint useHeightMap;
     float heightScale;
     float texCoordScale;
+    uint boneOffset;
+
+    // Decode of QuantizedVertex (VertexQuantizer.h), only read by the QUANTIZED shaders.
+    float3 positionMin;
+    float dummy0;
+    float3 positionExtent;
+    float dummy1;
+    float2 texCoordOffset;
+    float2 dummy2;
 };
 
 cbuffer MaterialConstants : register(b2)
@@ -100,10 +109,8 @@ struct VSInput
     float3 tangentModel : TANGENT;
     
 #ifdef SKINNED
-    float4 boneWeights0 : BLENDWEIGHT0;
-    float4 boneWeights1 : BLENDWEIGHT1;
-    uint4 boneIndices0 : BLENDINDICES0;
-    uint4 boneIndices1 : BLENDINDICES1;
+    float4 boneWeights : BLENDWEIGHT0; // UNORM8x4
+    uint4 boneIndices : BLENDINDICES0;
 #endif
 };
 
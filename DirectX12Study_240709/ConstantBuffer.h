@@ -13,6 +13,15 @@ __declspec(align(256)) struct MeshConsts
     uint32_t useHeightMap;
     float heightScale =0.1f;
     float texCoordScale;
+    uint32_t boneOffset = 0; // first matrix of this model in the frame's bone palette buffer
+
+    // Decode of QuantizedVertex, see VertexQuantizer. Unused with float vertices.
+    Vector3 positionMin    = Vector3(0.0f);
+    float dummy0           = 0.0f;
+    Vector3 positionExtent = Vector3(1.0f);
+    float dummy1           = 0.0f;
+    Vector2 texCoordOffset = Vector2(0.0f);
+    Vector2 dummy2         = Vector2(0.0f);
 };
 // Light
 #define MAX_LIGHTS        3
@@ -124,6 +133,12 @@ template <typename T_CONST> class UploadBuffer
         memcpy(&m_mappedData[idx * m_bufferSize], data, sizeof(T_CONST));
     }
 
+    // count elements starting at idx in one copy
+    void Upload(int idx, const void *data, uint32_t count)
+    {
+        memcpy(&m_mappedData[idx * m_bufferSize], data, sizeof(T_CONST) * count);
+    }
+
   private:
     uint32_t m_bufferSize          = 0;
     ID3D12Resource *m_uploadBuffer = nullptr;
@@ -0,0 +1,346 @@
+#include "ContactGenerator.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+float XM_CALLCONV Dot(FXMVECTOR a, FXMVECTOR b)
+{
+    return XMVectorGetX(XMVector3Dot(a, b));
+}
+
+float XM_CALLCONV LengthSq(FXMVECTOR v)
+{
+    return XMVectorGetX(XMVector3LengthSq(v));
+}
+
+XMVECTOR TriangleNormal(const XMFLOAT3 *tri)
+{
+    const XMVECTOR a = XMLoadFloat3(&tri[0]);
+    return XMVector3Normalize(
+        XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&tri[1]), a), XMVectorSubtract(XMLoadFloat3(&tri[2]), a)));
+}
+
+// Closest points between segments p1-q1 and p2-q2. (Real-Time Collision Detection 5.1.9)
+float XM_CALLCONV ClosestPointsSegmentSegment(FXMVECTOR p1, FXMVECTOR q1, FXMVECTOR p2, GXMVECTOR q2, XMVECTOR &c1,
+                                              XMVECTOR &c2)
+{
+    const float eps = 1e-6f;
+
+    XMVECTOR d1 = XMVectorSubtract(q1, p1);
+    XMVECTOR d2 = XMVectorSubtract(q2, p2);
+    XMVECTOR r  = XMVectorSubtract(p1, p2);
+    float a     = Dot(d1, d1);
+    float e     = Dot(d2, d2);
+    float f     = Dot(d2, r);
+    float s     = 0.0f;
+    float t     = 0.0f;
+
+    if (a <= eps && e <= eps)
+    {
+        c1 = p1;
+        c2 = p2;
+        return LengthSq(XMVectorSubtract(c1, c2));
+    }
+
+    if (a <= eps)
+    {
+        t = std::clamp(f / e, 0.0f, 1.0f);
+    }
+    else
+    {
+        float c = Dot(d1, r);
+        if (e <= eps)
+        {
+            s = std::clamp(-c / a, 0.0f, 1.0f);
+        }
+        else
+        {
+            float b     = Dot(d1, d2);
+            float denom = a * e - b * b;
+
+            s = denom != 0.0f ? std::clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+
+            if (t < 0.0f)
+            {
+                t = 0.0f;
+                s = std::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else if (t > 1.0f)
+            {
+                t = 1.0f;
+                s = std::clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+
+    c1 = XMVectorMultiplyAdd(d1, XMVectorReplicate(s), p1);
+    c2 = XMVectorMultiplyAdd(d2, XMVectorReplicate(t), p2);
+    return LengthSq(XMVectorSubtract(c1, c2));
+}
+} // namespace
+
+void ContactGenerator::Initialize(uint32_t maxContactsPerThread, uint32_t batchSize)
+{
+    m_batchSize            = batchSize;
+    m_maxContactsPerThread = maxContactsPerThread;
+
+    m_threadBuffers.resize(g_JobSystem.GetNumThreads());
+    for (auto &buffer : m_threadBuffers)
+    {
+        buffer.contacts.resize(m_maxContactsPerThread);
+    }
+}
+
+const std::vector<Contact> &ContactGenerator::Generate(const std::vector<CollisionShape> &shapes,
+                                                       const std::vector<XMFLOAT3> &triangles,
+                                                       const std::vector<CollisionPair> &pairs)
+{
+    m_contacts.clear();
+    m_numDropped = 0;
+
+    if (pairs.empty())
+    {
+        return m_contacts;
+    }
+
+    if (m_threadBuffers.size() < g_JobSystem.GetNumThreads())
+    {
+        Initialize(m_maxContactsPerThread, m_batchSize);
+    }
+
+    // Sorting groups pairs of the same type and the same first shape, so a batch runs one code path
+    // and walks the shape array forward. It also makes the output independent of the broadphase order.
+    m_sortedPairs = pairs;
+    std::sort(m_sortedPairs.begin(), m_sortedPairs.end(), [](const CollisionPair &l, const CollisionPair &r) {
+        if (l.type != r.type)
+            return l.type < r.type;
+        if (l.a != r.a)
+            return l.a < r.a;
+        return l.b < r.b;
+    });
+
+    for (auto &buffer : m_threadBuffers)
+    {
+        buffer.numContacts = 0;
+        buffer.numDropped  = 0;
+    }
+
+    const uint32_t numPairs   = uint32_t(m_sortedPairs.size());
+    const uint32_t numBatches = (numPairs + m_batchSize - 1) / m_batchSize;
+    m_batchRanges.resize(numBatches);
+
+    g_JobSystem.ParallelFor(numPairs, m_batchSize, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        ProcessBatch(begin / m_batchSize, begin, end, threadIndex, shapes, triangles);
+    });
+
+    // Merge in batch order.
+    for (uint32_t b = 0; b < numBatches; b++)
+    {
+        const BatchRange &range = m_batchRanges[b];
+        const auto &src         = m_threadBuffers[range.thread].contacts;
+        m_contacts.insert(m_contacts.end(), src.begin() + range.offset, src.begin() + range.offset + range.count);
+    }
+
+    for (const auto &buffer : m_threadBuffers)
+    {
+        m_numDropped += buffer.numDropped;
+    }
+
+    return m_contacts;
+}
+
+void ContactGenerator::ProcessBatch(uint32_t batch, uint32_t begin, uint32_t end, uint32_t threadIndex,
+                                    const std::vector<CollisionShape> &shapes, const std::vector<XMFLOAT3> &triangles)
+{
+    ThreadBuffer &buffer = m_threadBuffers[threadIndex];
+    BatchRange range     = {threadIndex, buffer.numContacts, 0};
+
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const CollisionPair &pair = m_sortedPairs[i];
+
+        Contact contact = {};
+        bool hit        = false;
+
+        switch (pair.type)
+        {
+        case CollisionPair::SPHERE_SPHERE:
+            hit = SphereSphere(shapes[pair.a], shapes[pair.b], contact);
+            break;
+        case CollisionPair::SPHERE_TRIANGLE:
+            hit = SphereTriangle(shapes[pair.a].p0, shapes[pair.a].radius, &triangles[3 * pair.b], contact);
+            break;
+        case CollisionPair::CAPSULE_TRIANGLE:
+            hit = CapsuleTriangle(shapes[pair.a], &triangles[3 * pair.b], contact);
+            break;
+        }
+
+        if (!hit)
+        {
+            continue;
+        }
+
+        if (buffer.numContacts == buffer.contacts.size())
+        {
+            buffer.numDropped++;
+            continue;
+        }
+
+        contact.pairType = pair.type;
+        contact.a        = pair.a;
+        contact.b        = pair.b;
+
+        buffer.contacts[buffer.numContacts++] = contact;
+        range.count++;
+    }
+
+    m_batchRanges[batch] = range;
+}
+
+bool ContactGenerator::SphereSphere(const CollisionShape &a, const CollisionShape &b, Contact &contact)
+{
+    const XMVECTOR center = XMLoadFloat3(&b.p0);
+    const XMVECTOR d      = XMVectorSubtract(XMLoadFloat3(&a.p0), center);
+    const float r         = a.radius + b.radius;
+    const float len       = LengthSq(d);
+
+    if (len > r * r)
+    {
+        return false;
+    }
+
+    const float dist = sqrtf(len);
+    const XMVECTOR n = dist > 1e-6f ? XMVectorScale(d, 1.0f / dist) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    XMStoreFloat3(&contact.normal, n);
+    XMStoreFloat3(&contact.position, XMVectorMultiplyAdd(n, XMVectorReplicate(b.radius), center));
+    contact.depth = r - dist;
+
+    return true;
+}
+
+bool ContactGenerator::SphereTriangle(const XMFLOAT3 &center, const float radius, const XMFLOAT3 *tri,
+                                      Contact &contact)
+{
+    const XMVECTOR p = XMLoadFloat3(&center);
+    const XMVECTOR q =
+        ClosestPointOnTriangle(p, XMLoadFloat3(&tri[0]), XMLoadFloat3(&tri[1]), XMLoadFloat3(&tri[2]));
+    const XMVECTOR d = XMVectorSubtract(p, q);
+    const float len  = LengthSq(d);
+
+    if (len > radius * radius)
+    {
+        return false;
+    }
+
+    const float dist = sqrtf(len);
+    XMStoreFloat3(&contact.normal, dist > 1e-6f ? XMVectorScale(d, 1.0f / dist) : TriangleNormal(tri));
+    XMStoreFloat3(&contact.position, q);
+    contact.depth = radius - dist;
+
+    return true;
+}
+
+bool ContactGenerator::CapsuleTriangle(const CollisionShape &a, const XMFLOAT3 *tri, Contact &contact)
+{
+    const XMVECTOR t0 = XMLoadFloat3(&tri[0]);
+    const XMVECTOR t1 = XMLoadFloat3(&tri[1]);
+    const XMVECTOR t2 = XMLoadFloat3(&tri[2]);
+    const XMVECTOR p0 = XMLoadFloat3(&a.p0);
+    const XMVECTOR p1 = XMLoadFloat3(&a.p1);
+    const XMVECTOR n  = TriangleNormal(tri);
+
+    const float d0 = Dot(XMVectorSubtract(p0, t0), n);
+    const float d1 = Dot(XMVectorSubtract(p1, t0), n);
+
+    // The segment crosses the plane inside the triangle.
+    if (d0 * d1 < 0.0f)
+    {
+        const XMVECTOR p = XMVectorLerp(p0, p1, d0 / (d0 - d1));
+        if (LengthSq(XMVectorSubtract(ClosestPointOnTriangle(p, t0, t1, t2), p)) < 1e-10f)
+        {
+            // Push out along the side where most of the segment is.
+            const bool front = fabsf(d0) >= fabsf(d1) ? d0 > 0.0f : d1 > 0.0f;
+            XMStoreFloat3(&contact.normal, front ? n : XMVectorNegate(n));
+            XMStoreFloat3(&contact.position, p);
+            contact.depth = a.radius + XMMin(fabsf(d0), fabsf(d1));
+            return true;
+        }
+    }
+
+    // Otherwise the closest feature is a segment end point or a triangle edge.
+    XMVECTOR bestS = p0;
+    XMVECTOR bestT = ClosestPointOnTriangle(p0, t0, t1, t2);
+    float best     = LengthSq(XMVectorSubtract(bestS, bestT));
+
+    XMVECTOR t = ClosestPointOnTriangle(p1, t0, t1, t2);
+    if (LengthSq(XMVectorSubtract(p1, t)) < best)
+    {
+        bestS = p1;
+        bestT = t;
+        best  = LengthSq(XMVectorSubtract(p1, t));
+    }
+
+    const XMVECTOR corners[3] = {t0, t1, t2};
+    for (int e = 0; e < 3; e++)
+    {
+        XMVECTOR cs, ct;
+        float dist2 = ClosestPointsSegmentSegment(p0, p1, corners[e], corners[(e + 1) % 3], cs, ct);
+        if (dist2 < best)
+        {
+            bestS = cs;
+            bestT = ct;
+            best  = dist2;
+        }
+    }
+
+    XMFLOAT3 center;
+    XMStoreFloat3(&center, bestS);
+    return SphereTriangle(center, a.radius, tri, contact);
+}
+
+XMVECTOR XM_CALLCONV ContactGenerator::ClosestPointOnTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, GXMVECTOR c)
+{
+    // Real-Time Collision Detection 5.1.5
+    XMVECTOR ab = XMVectorSubtract(b, a);
+    XMVECTOR ac = XMVectorSubtract(c, a);
+    XMVECTOR ap = XMVectorSubtract(p, a);
+
+    float d1 = Dot(ab, ap);
+    float d2 = Dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return a;
+
+    XMVECTOR bp = XMVectorSubtract(p, b);
+    float d3    = Dot(ab, bp);
+    float d4    = Dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return b;
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return XMVectorMultiplyAdd(ab, XMVectorReplicate(d1 / (d1 - d3)), a);
+
+    XMVECTOR cp = XMVectorSubtract(p, c);
+    float d5    = Dot(ab, cp);
+    float d6    = Dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return c;
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return XMVectorMultiplyAdd(ac, XMVectorReplicate(d2 / (d2 - d6)), a);
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return XMVectorMultiplyAdd(XMVectorSubtract(c, b), XMVectorReplicate((d4 - d3) / ((d4 - d3) + (d5 - d6))), b);
+
+    float denom = 1.0f / (va + vb + vc);
+    float v     = vb * denom;
+    float w     = vc * denom;
+    return XMVectorMultiplyAdd(ac, XMVectorReplicate(w), XMVectorMultiplyAdd(ab, XMVectorReplicate(v), a));
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+using DirectX::XMFLOAT3;
+
+struct CollisionShape
+{
+    enum TYPE
+    {
+        SPHERE  = 0,
+        CAPSULE = 1,
+    };
+
+    TYPE type    = SPHERE;
+    XMFLOAT3 p0  = XMFLOAT3(0.0f, 0.0f, 0.0f); // sphere center, capsule segment start
+    XMFLOAT3 p1  = XMFLOAT3(0.0f, 0.0f, 0.0f); // capsule segment end
+    float radius = 0.0f;
+};
+
+// Output of the broadphase. b is a shape index for SPHERE_SPHERE and a triangle index otherwise.
+struct CollisionPair
+{
+    enum TYPE
+    {
+        SPHERE_SPHERE    = 0,
+        SPHERE_TRIANGLE  = 1,
+        CAPSULE_TRIANGLE = 2,
+    };
+
+    uint32_t type = SPHERE_SPHERE;
+    uint32_t a    = 0;
+    uint32_t b    = 0;
+};
+
+// normal points from b to a, a has to move by normal * depth to resolve the contact.
+struct Contact
+{
+    uint32_t pairType;
+    uint32_t a;
+    uint32_t b;
+    XMFLOAT3 position;
+    XMFLOAT3 normal;
+    float depth;
+};
+
+// Narrow phase. Pairs are sorted, cut into batches and processed on g_JobSystem.
+// Every thread writes into its own fixed size buffer, and the buffers are merged in batch order,
+// so the contact list is the same for any number of threads. A thread whose buffer is full drops
+// its further contacts and counts them, the list is only deterministic while GetNumDropped() is 0.
+class ContactGenerator
+{
+  public:
+    void Initialize(uint32_t maxContactsPerThread = 1024, uint32_t batchSize = 64);
+
+    // triangles : 3 vertices per triangle.
+    const std::vector<Contact> &Generate(const std::vector<CollisionShape> &shapes,
+                                         const std::vector<XMFLOAT3> &triangles,
+                                         const std::vector<CollisionPair> &pairs);
+
+    const std::vector<Contact> &GetContacts() const
+    {
+        return m_contacts;
+    }
+
+    // Contacts of the last Generate that didn't fit maxContactsPerThread.
+    uint32_t GetNumDropped() const
+    {
+        return m_numDropped;
+    }
+
+  public:
+    static bool SphereSphere(const CollisionShape &a, const CollisionShape &b, Contact &contact);
+    static bool SphereTriangle(const XMFLOAT3 &center, const float radius, const XMFLOAT3 *tri, Contact &contact);
+    static bool CapsuleTriangle(const CollisionShape &a, const XMFLOAT3 *tri, Contact &contact);
+
+    static DirectX::XMVECTOR XM_CALLCONV ClosestPointOnTriangle(DirectX::FXMVECTOR p, DirectX::FXMVECTOR a,
+                                                                DirectX::FXMVECTOR b, DirectX::GXMVECTOR c);
+
+  private:
+    // Contacts of a batch in the buffer of the thread that ran it.
+    struct BatchRange
+    {
+        uint32_t thread;
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    struct ThreadBuffer
+    {
+        std::vector<Contact> contacts; // sized once by Initialize, never grows
+        uint32_t numContacts = 0;
+        uint32_t numDropped  = 0;
+    };
+
+    void ProcessBatch(uint32_t batch, uint32_t begin, uint32_t end, uint32_t threadIndex,
+                      const std::vector<CollisionShape> &shapes, const std::vector<XMFLOAT3> &triangles);
+
+  private:
+    uint32_t m_batchSize            = 64;
+    uint32_t m_maxContactsPerThread = 1024;
+    uint32_t m_numDropped           = 0;
+
+    std::vector<ThreadBuffer> m_threadBuffers;
+    std::vector<CollisionPair> m_sortedPairs;
+    std::vector<BatchRange> m_batchRanges; // one per batch, each written by a single thread
+    std::vector<Contact> m_contacts;
+};
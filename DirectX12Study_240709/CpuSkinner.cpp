@@ -0,0 +1,357 @@
+#include "CpuSkinner.h"
+#include "JobSystem.h"
+#include "Stopwatch.h"
+
+#include <algorithm>
+#include <cfloat>
+
+void CpuSkinner::Initialize(const std::vector<MeshData> &meshes, bool buildBVH)
+{
+    m_useBVH = buildBVH;
+    m_meshes.clear();
+    m_meshes.reserve(meshes.size());
+
+    for (const MeshData &meshData : meshes)
+    {
+        const ConstArray<SkinnedVertex> src = meshData.GetSkinnedVertices();
+        if (src.empty())
+        {
+            continue;
+        }
+
+        SkinnedMesh mesh;
+        mesh.numVertices    = uint32_t(src.size());
+        const size_t padded = (src.size() + 3) & ~size_t(3);
+
+        mesh.posX.resize(padded);
+        mesh.posY.resize(padded);
+        mesh.posZ.resize(padded);
+        mesh.weights.resize(padded * 4);
+        mesh.indices.resize(padded * 4);
+
+        for (size_t i = 0; i < padded; i++)
+        {
+            const SkinnedVertex &v = src[XMMin(i, src.size() - 1)];
+            mesh.posX[i]           = v.position.x;
+            mesh.posY[i]           = v.position.y;
+            mesh.posZ[i]           = v.position.z;
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                mesh.weights[4 * i + j] = v.boneWeights[j] / 255.0f;
+                mesh.indices[4 * i + j] = v.boneIndices[j];
+            }
+        }
+
+        mesh.outX = mesh.posX;
+        mesh.outY = mesh.posY;
+        mesh.outZ = mesh.posZ;
+
+        // LOD 0 only, the coarser levels follow it in the same index buffer.
+        const auto indices      = meshData.GetIndices();
+        const size_t numIndices = meshData.lods.empty() ? indices.size() : meshData.lods[0].indexCount;
+        mesh.triangles.assign(indices.begin(), indices.begin() + numIndices);
+        if (m_useBVH)
+        {
+            BuildBVH(mesh);
+        }
+
+        m_meshes.push_back(std::move(mesh));
+    }
+}
+
+void CpuSkinner::Skin(const std::vector<Matrix> &palette)
+{
+    const Stopwatch stopwatch;
+
+    g_JobSystem.ParallelFor(uint32_t(m_meshes.size()), 1, [&](uint32_t first, uint32_t last, uint32_t) {
+        for (uint32_t i = first; i < last; i++)
+        {
+            SkinMesh(m_meshes[i], palette);
+            if (m_useBVH)
+            {
+                RefitBVH(m_meshes[i]);
+            }
+        }
+    });
+
+    for (size_t i = 0; i < m_meshes.size(); i++)
+    {
+        if (i == 0)
+            m_bounds = m_meshes[i].bounds;
+        else
+            BoundingBox::CreateMerged(m_bounds, m_bounds, m_meshes[i].bounds);
+    }
+
+    m_lastSkinTime = stopwatch.GetElapsedMs();
+}
+
+void CpuSkinner::SkinMesh(SkinnedMesh &mesh, const std::vector<Matrix> &palette)
+{
+    for (size_t i = 0; i < mesh.posX.size(); i += 4)
+    {
+        // Blend the first 3 rows of the palette matrices per vertex. Rows of the transposed palette are the
+        // columns of the skinning matrix, so row r dotted with (p, 1) gives component r of the result.
+        XMVECTOR rows[3][4];
+        for (size_t k = 0; k < 4; k++)
+        {
+            const float *w     = &mesh.weights[4 * (i + k)];
+            const uint8_t *idx = &mesh.indices[4 * (i + k)];
+
+            XMVECTOR r0 = XMVectorZero();
+            XMVECTOR r1 = XMVectorZero();
+            XMVECTOR r2 = XMVectorZero();
+            for (size_t j = 0; j < 4; j++)
+            {
+                const XMFLOAT4 *m = reinterpret_cast<const XMFLOAT4 *>(&palette[idx[j]]);
+                const XMVECTOR wj = XMVectorReplicate(w[j]);
+
+                r0 = XMVectorMultiplyAdd(XMLoadFloat4(&m[0]), wj, r0);
+                r1 = XMVectorMultiplyAdd(XMLoadFloat4(&m[1]), wj, r1);
+                r2 = XMVectorMultiplyAdd(XMLoadFloat4(&m[2]), wj, r2);
+            }
+            rows[0][k] = r0;
+            rows[1][k] = r1;
+            rows[2][k] = r2;
+        }
+
+        const XMVECTOR px = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&mesh.posX[i]));
+        const XMVECTOR py = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&mesh.posY[i]));
+        const XMVECTOR pz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(&mesh.posZ[i]));
+
+        float *out[3] = {&mesh.outX[i], &mesh.outY[i], &mesh.outZ[i]};
+        for (size_t c = 0; c < 3; c++)
+        {
+            // Transposed, t.r[n] holds element n of the row for the 4 vertices.
+            const XMMATRIX t = XMMatrixTranspose(XMMATRIX(rows[c][0], rows[c][1], rows[c][2], rows[c][3]));
+
+            XMVECTOR v = XMVectorMultiplyAdd(t.r[0], px, t.r[3]);
+            v          = XMVectorMultiplyAdd(t.r[1], py, v);
+            v          = XMVectorMultiplyAdd(t.r[2], pz, v);
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4 *>(out[c]), v);
+        }
+    }
+
+    // Padding repeats the last vertex, so it doesn't change the bounds.
+    float lo[3], hi[3];
+    const float *streams[3] = {mesh.outX.data(), mesh.outY.data(), mesh.outZ.data()};
+    for (size_t c = 0; c < 3; c++)
+    {
+        XMVECTOR vmin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR vmax = XMVectorReplicate(-FLT_MAX);
+        for (size_t i = 0; i < mesh.posX.size(); i += 4)
+        {
+            const XMVECTOR v = XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(streams[c] + i));
+            vmin             = XMVectorMin(vmin, v);
+            vmax             = XMVectorMax(vmax, v);
+        }
+
+        XMFLOAT4 a, b;
+        XMStoreFloat4(&a, vmin);
+        XMStoreFloat4(&b, vmax);
+        lo[c] = XMMin(XMMin(a.x, a.y), XMMin(a.z, a.w));
+        hi[c] = XMMax(XMMax(b.x, b.y), XMMax(b.z, b.w));
+    }
+
+    BoundingBox::CreateFromPoints(mesh.bounds, Vector3(lo[0], lo[1], lo[2]), Vector3(hi[0], hi[1], hi[2]));
+}
+
+void CpuSkinner::BuildBVH(SkinnedMesh &mesh)
+{
+    const uint32_t numTriangles = uint32_t(mesh.triangles.size() / 3);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    std::vector<uint32_t> order(numTriangles);
+    std::vector<Vector3> centroid(numTriangles);
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        order[t] = t;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = mesh.triangles[3 * t + k];
+            centroid[t] += Vector3(mesh.posX[v], mesh.posY[v], mesh.posZ[v]) / 3.0f;
+        }
+    }
+
+    // Median split on the longest axis of the centroids, built on the bind pose. Only the bounds change
+    // when the mesh is skinned, the topology is kept and refit every frame.
+    struct Task
+    {
+        uint32_t node, first, count;
+    };
+    std::vector<Task> stack = {{0, 0, numTriangles}};
+    mesh.nodes.assign(1, BVHNode());
+
+    while (!stack.empty())
+    {
+        const Task task = stack.back();
+        stack.pop_back();
+
+        if (task.count <= sm_maxLeafTriangles)
+        {
+            mesh.nodes[task.node].first = task.first;
+            mesh.nodes[task.node].count = task.count;
+            continue;
+        }
+
+        Vector3 cmin = centroid[order[task.first]];
+        Vector3 cmax = cmin;
+        for (uint32_t i = task.first; i < task.first + task.count; i++)
+        {
+            cmin = Vector3::Min(cmin, centroid[order[i]]);
+            cmax = Vector3::Max(cmax, centroid[order[i]]);
+        }
+        const Vector3 extent = cmax - cmin;
+        const int axis       = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        const uint32_t half = task.count / 2;
+        std::nth_element(order.begin() + task.first, order.begin() + task.first + half,
+                         order.begin() + task.first + task.count, [&](uint32_t l, uint32_t r) {
+                             return (&centroid[l].x)[axis] < (&centroid[r].x)[axis];
+                         });
+
+        const uint32_t left         = uint32_t(mesh.nodes.size());
+        mesh.nodes[task.node].first = left;
+        mesh.nodes[task.node].count = 0;
+        mesh.nodes.resize(mesh.nodes.size() + 2);
+
+        stack.push_back({left, task.first, half});
+        stack.push_back({left + 1, task.first + half, task.count - half});
+    }
+
+    // Triangles in leaf order, so a leaf covers a contiguous range.
+    std::vector<uint32_t> triangles(mesh.triangles.size());
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            triangles[3 * t + k] = mesh.triangles[3 * order[t] + k];
+        }
+    }
+    mesh.triangles = std::move(triangles);
+
+    RefitBVH(mesh);
+}
+
+void CpuSkinner::RefitBVH(SkinnedMesh &mesh)
+{
+    // Children come after their parent, so a reverse walk visits children first.
+    for (size_t n = mesh.nodes.size(); n-- > 0;)
+    {
+        BVHNode &node = mesh.nodes[n];
+
+        if (node.count == 0)
+        {
+            node.min = Vector3::Min(mesh.nodes[node.first].min, mesh.nodes[node.first + 1].min);
+            node.max = Vector3::Max(mesh.nodes[node.first].max, mesh.nodes[node.first + 1].max);
+            continue;
+        }
+
+        node.min = Vector3(FLT_MAX);
+        node.max = Vector3(-FLT_MAX);
+        for (uint32_t i = 3 * node.first; i < 3 * (node.first + node.count); i++)
+        {
+            const uint32_t v = mesh.triangles[i];
+            const Vector3 p  = Vector3(mesh.outX[v], mesh.outY[v], mesh.outZ[v]);
+            node.min         = Vector3::Min(node.min, p);
+            node.max         = Vector3::Max(node.max, p);
+        }
+    }
+}
+
+bool CpuSkinner::Intersects(const Vector3 &origin, const Vector3 &dir, float &dist) const
+{
+    bool hit = false;
+    dist     = FLT_MAX;
+
+    for (const SkinnedMesh &mesh : m_meshes)
+    {
+        float d = 0.0f;
+        if (!mesh.bounds.Intersects(origin, dir, d) || d > dist)
+        {
+            continue;
+        }
+
+        if (m_useBVH)
+        {
+            if (IntersectsBVH(mesh, origin, dir, d) && d < dist)
+            {
+                dist = d;
+                hit  = true;
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i + 2 < mesh.triangles.size(); i += 3)
+        {
+            const uint32_t *t = &mesh.triangles[i];
+            if (TriangleTests::Intersects(origin, dir, Vector3(mesh.outX[t[0]], mesh.outY[t[0]], mesh.outZ[t[0]]),
+                                          Vector3(mesh.outX[t[1]], mesh.outY[t[1]], mesh.outZ[t[1]]),
+                                          Vector3(mesh.outX[t[2]], mesh.outY[t[2]], mesh.outZ[t[2]]), d) &&
+                d < dist)
+            {
+                dist = d;
+                hit  = true;
+            }
+        }
+    }
+
+    return hit;
+}
+
+bool CpuSkinner::IntersectsBVH(const SkinnedMesh &mesh, const Vector3 &origin, const Vector3 &dir, float &dist)
+{
+    const Vector3 invDir = Vector3(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+    bool hit = false;
+    dist     = FLT_MAX;
+
+    if (mesh.nodes.empty())
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> stack = {0};
+    while (!stack.empty())
+    {
+        const BVHNode &node = mesh.nodes[stack.back()];
+        stack.pop_back();
+
+        // Slab test.
+        const Vector3 t0 = (node.min - origin) * invDir;
+        const Vector3 t1 = (node.max - origin) * invDir;
+        const Vector3 lo = Vector3::Min(t0, t1);
+        const Vector3 hi = Vector3::Max(t0, t1);
+        const float tmin = XMMax(XMMax(lo.x, lo.y), XMMax(lo.z, 0.0f));
+        const float tmax = XMMin(XMMin(hi.x, hi.y), hi.z);
+        if (tmin > tmax || tmin > dist)
+        {
+            continue;
+        }
+
+        if (node.count == 0)
+        {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+            continue;
+        }
+
+        for (uint32_t i = 3 * node.first; i < 3 * (node.first + node.count); i += 3)
+        {
+            const uint32_t *t = &mesh.triangles[i];
+            float d           = 0.0f;
+            if (TriangleTests::Intersects(origin, dir, Vector3(mesh.outX[t[0]], mesh.outY[t[0]], mesh.outZ[t[0]]),
+                                          Vector3(mesh.outX[t[1]], mesh.outY[t[1]], mesh.outZ[t[1]]),
+                                          Vector3(mesh.outX[t[2]], mesh.outY[t[2]], mesh.outZ[t[2]]), d) &&
+                d < dist)
+            {
+                dist = d;
+                hit  = true;
+            }
+        }
+    }
+
+    return hit;
+}
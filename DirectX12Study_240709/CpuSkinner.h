@@ -0,0 +1,83 @@
+#pragma once
+
+#include "MeshData.h"
+#include <DirectXCollision.h>
+
+using DirectX::BoundingBox;
+using DirectX::SimpleMath::Matrix;
+
+// CPU copy of the skinned positions of a model for bounds, picking and collision. Rendering keeps
+// skinning in DefaultVS. Positions are skinned 4 vertices at a time from SoA streams, one job per mesh.
+class CpuSkinner
+{
+  public:
+    // buildBVH : triangle BVH per mesh, refit after every Skin, used by Intersects.
+    void Initialize(const std::vector<MeshData> &meshes, bool buildBVH = false);
+
+    // palette : AnimationPose::palette layout (transposed). Updates positions, bounds and the BVH.
+    void Skin(const std::vector<Matrix> &palette);
+
+    // Model space, without root motion.
+    const BoundingBox &GetBounds() const
+    {
+        return m_bounds;
+    }
+
+    // Closest hit along a model space ray, dir normalized.
+    bool Intersects(const Vector3 &origin, const Vector3 &dir, float &dist) const;
+
+    uint32_t GetNumMeshes() const
+    {
+        return uint32_t(m_meshes.size());
+    }
+
+    // Skinned position of vertex i of mesh.
+    Vector3 GetPosition(uint32_t mesh, uint32_t i) const
+    {
+        const SkinnedMesh &m = m_meshes[mesh];
+        return Vector3(m.outX[i], m.outY[i], m.outZ[i]);
+    }
+
+    double GetLastSkinTime() const
+    {
+        return m_lastSkinTime;
+    }
+
+  private:
+    struct BVHNode
+    {
+        Vector3 min;
+        Vector3 max;
+        uint32_t first = 0; // first triangle for a leaf, left child otherwise (right child is first + 1)
+        uint32_t count = 0; // triangles, 0 for an inner node
+    };
+
+    struct SkinnedMesh
+    {
+        uint32_t numVertices = 0;
+
+        // Bind pose, padded to a multiple of 4 with copies of the last vertex.
+        std::vector<float> posX, posY, posZ;
+        std::vector<float> weights;    // 4 per vertex
+        std::vector<uint8_t> indices;  // 4 per vertex
+        std::vector<float> outX, outY, outZ;
+
+        std::vector<uint32_t> triangles; // 3 indices per triangle, reordered by the BVH build
+        std::vector<BVHNode> nodes;      // children always come after their parent
+
+        BoundingBox bounds;
+    };
+
+    static void SkinMesh(SkinnedMesh &mesh, const std::vector<Matrix> &palette);
+    static void BuildBVH(SkinnedMesh &mesh);
+    static void RefitBVH(SkinnedMesh &mesh);
+    static bool IntersectsBVH(const SkinnedMesh &mesh, const Vector3 &origin, const Vector3 &dir, float &dist);
+
+  private:
+    static const uint32_t sm_maxLeafTriangles = 4;
+
+    std::vector<SkinnedMesh> m_meshes;
+    BoundingBox m_bounds;
+    bool m_useBVH         = false;
+    double m_lastSkinTime = 0.0; // ms
+};
@@ -2,6 +2,7 @@
 
 #include "AppBase.h"
 #include "D3DUtils.h"
+#include "MipGenerator.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <DirectXTexEXR.h>
 #include <stb_image.h>
@@ -15,14 +16,144 @@ size_t GetPixelSize(const DXGI_FORMAT pixelFormat);
 ID3D12Resource *D3DUtils::CreateTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
                                         const std::string &filename, ID3D12Resource **texture,
                                         D3D12_CPU_DESCRIPTOR_HANDLE &descHandle, XMFLOAT3 color, bool isSRGB)
+{
+    TextureImage image = ReadTexture(filename, color, isSRGB);
+    MipGenerator::Generate(image);
+
+    return CreateTexture(device, commandList, image, texture, descHandle);
+}
+
+namespace
+{
+// One subresource per mip level of image.
+std::vector<D3D12_SUBRESOURCE_DATA> CreateTextureResource(ID3D12Device *device, const TextureImage &image,
+                                                          ID3D12Resource **texture)
+{
+    // Describe and create a Texture2D.
+    D3D12_RESOURCE_DESC textureDesc = {};
+    textureDesc.MipLevels           = UINT16(image.mipLevels);
+    textureDesc.Format              = image.format;
+    textureDesc.Width               = UINT64(image.width);
+    textureDesc.Height              = UINT64(image.height);
+    textureDesc.Flags               = D3D12_RESOURCE_FLAG_NONE;
+    textureDesc.DepthOrArraySize    = 1;
+    textureDesc.SampleDesc.Count    = 1;
+    textureDesc.SampleDesc.Quality  = 0;
+    textureDesc.Dimension           = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+    ThrowIfFailed(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                                                  D3D12_HEAP_FLAG_NONE, &textureDesc, D3D12_RESOURCE_STATE_COPY_DEST,
+                                                  nullptr, IID_PPV_ARGS(texture)));
+
+    std::vector<D3D12_SUBRESOURCE_DATA> textureData(image.mipLevels);
+    const uint8_t *pixels = image.pixels.data();
+    uint32_t width = image.width, height = image.height;
+    for (auto &level : textureData)
+    {
+        size_t rowPitch, slicePitch;
+        D3DUtils::GetPitch(image.format, width, height, rowPitch, slicePitch);
+        level.pData      = (const void *)pixels;
+        level.RowPitch   = LONG_PTR(rowPitch);
+        level.SlicePitch = LONG_PTR(slicePitch);
+
+        pixels += slicePitch;
+        width  = XMMax(width / 2, 1u);
+        height = XMMax(height / 2, 1u);
+    }
+    return textureData;
+}
 
-// Ӹ  ...
+// Copies textureData into texture through a new upload heap, which is returned.
+ID3D12Resource *UploadSubresources(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                   ID3D12Resource *texture, const std::vector<D3D12_SUBRESOURCE_DATA> &textureData)
+{
+    const UINT numLevels          = UINT(textureData.size());
+    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture, 0, numLevels);
+
+    // Create the GPU upload buffer.Z
+    ID3D12Resource *textureUploadHeap = nullptr;
+    ThrowIfFailed(
+        device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE,
+                                        &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
+                                        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&textureUploadHeap)));
+
+    //  ؽƮ 
+    UpdateSubresources(commandList, texture, textureUploadHeap, 0, 0, numLevels, textureData.data());
+    commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture, D3D12_RESOURCE_STATE_COPY_DEST,
+                                                                          D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+    return textureUploadHeap;
+}
+} // namespace
+
+ID3D12Resource *D3DUtils::CreateTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                        const TextureImage &image, ID3D12Resource **texture,
+                                        D3D12_CPU_DESCRIPTOR_HANDLE &descHandle)
+{
+    ID3D12Resource *textureUploadHeap = CreateTexture(device, commandList, image, texture);
+    CreateTextureSRV(device, *texture, descHandle);
+
+    return textureUploadHeap;
+}
+
+ID3D12Resource *D3DUtils::CreateTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                        const TextureImage &image, ID3D12Resource **texture)
+{
+    const std::vector<D3D12_SUBRESOURCE_DATA> textureData = CreateTextureResource(device, image, texture);
+
+    return UploadSubresources(device, commandList, *texture, textureData);
+}
+
+ID3D12Resource *D3DUtils::CreateDDSTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                           const std::wstring &filename, ID3D12Resource **texture)
+{
+    std::unique_ptr<uint8_t[]> ddsData;
+    std::vector<D3D12_SUBRESOURCE_DATA> textureData;
+    ThrowIfFailed(LoadDDSTextureFromFile(device, filename.c_str(), texture, ddsData, textureData));
+
+    // textureData points into ddsData, the copy into the upload heap is made before it's freed.
+    return UploadSubresources(device, commandList, *texture, textureData);
+}
+
+void D3DUtils::GetPitch(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t &rowPitch, size_t &slicePitch)
+{
+    size_t blockSize = 0;
+    switch (format)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_UNORM:
+        blockSize = 8;
+        break;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_UNORM:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        blockSize = 16;
+        break;
+    }
+
+    if (blockSize > 0)
+    {
+        rowPitch   = size_t((width + 3) / 4) * blockSize;
+        slicePitch = rowPitch * ((height + 3) / 4);
+    }
+    else
+    {
+        rowPitch   = size_t(width) * GetPixelSize(format);
+        slicePitch = rowPitch * height;
+    }
+}
+
+TextureImage D3DUtils::ReadTexture(const std::string &filename, XMFLOAT3 color, bool isSRGB)
 {
     int32_t width = 0, height = 0, channels = 0;
 
     uint8_t *image = nullptr;
 
-    DXGI_FORMAT format = isSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+    TextureImage ret;
+    ret.format = isSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
 
     uint8_t *ext = Utils::get_extension(filename.c_str());
     ToLower(&ext);
@@ -30,7 +161,7 @@ ID3D12Resource *D3DUtils::CreateTexture(ID3D12Device *device, ID3D12GraphicsComm
     if (!filename.empty())
     {
         if (!strcmp((const char *)ext, "exr"))
-            ReadEXRImage(&image, filename, width, height, channels, format);
+            ReadEXRImage(&image, filename, width, height, channels, ret.format);
         else
             ReadImage(&image, filename, width, height, channels);
     }
@@ -39,52 +170,90 @@ ID3D12Resource *D3DUtils::CreateTexture(ID3D12Device *device, ID3D12GraphicsComm
         ReadImage(&image, width, height, channels, color);
     }
 
-    channels = 4;
+    ret.width  = uint32_t(width);
+    ret.height = uint32_t(height);
+    if (image)
+    {
+        ret.pixels.assign(image, image + size_t(width) * height * GetPixelSize(ret.format));
+    }
 
-    // Describe and create a Texture2D.
-    D3D12_RESOURCE_DESC textureDesc = {};
-    textureDesc.MipLevels           = 1;
-    textureDesc.Format              = format;
-    textureDesc.Width               = UINT64(width);
-    textureDesc.Height              = UINT64(height);
-    textureDesc.Flags               = D3D12_RESOURCE_FLAG_NONE;
-    textureDesc.DepthOrArraySize    = 1;
-    textureDesc.SampleDesc.Count    = 1;
-    textureDesc.SampleDesc.Quality  = 0;
-    textureDesc.Dimension           = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    SAFE_ARR_DELETE(image);
 
-    ThrowIfFailed(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-                                                  D3D12_HEAP_FLAG_NONE, &textureDesc, D3D12_RESOURCE_STATE_COPY_DEST,
-                                                  nullptr, IID_PPV_ARGS(texture)));
+    return ret;
+}
 
-    const UINT64 uploadBufferSize = GetRequiredIntermediateSize(*texture, 0, 1);
+TextureImage D3DUtils::ReadTexture(const EmbeddedTexture &texture, bool isSRGB)
+{
+    TextureImage ret;
+    ret.format = isSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
 
-    // Create the GPU upload buffer.Z
-    ID3D12Resource *textureUploadHeap = nullptr;
-    ThrowIfFailed(
-        device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE,
-                                        &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-                                        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&textureUploadHeap)));
-    D3D12_SUBRESOURCE_DATA textureData = {};
-    textureData.pData                  = (void *)image;
-    textureData.RowPitch               = width * GetPixelSize(format);
-    textureData.SlicePitch             = textureData.RowPitch * height;
+    if (texture.width > 0)
+    {
+        ret.width  = texture.width;
+        ret.height = texture.height;
+        ret.pixels.resize(size_t(ret.width) * ret.height * 4);
+        for (size_t i = 0; i + 3 < texture.data.size() && i < ret.pixels.size(); i += 4)
+        {
+            ret.pixels[i]     = texture.data[i + 2];
+            ret.pixels[i + 1] = texture.data[i + 1];
+            ret.pixels[i + 2] = texture.data[i];
+            ret.pixels[i + 3] = texture.data[i + 3];
+        }
+        return ret;
+    }
+
+    int32_t width = 0, height = 0, channels = 0;
+    uint8_t *image =
+        stbi_load_from_memory(texture.data.data(), int(texture.data.size()), &width, &height, &channels, 4);
+    if (!image)
+    {
+        std::cout << "embedded texture can't be decoded : " << stbi_failure_reason() << std::endl;
+        return ReadTexture("", {}, isSRGB);
+    }
+
+    ret.width  = uint32_t(width);
+    ret.height = uint32_t(height);
+    ret.pixels.assign(image, image + size_t(width) * height * 4);
+    stbi_image_free(image);
+
+    return ret;
+}
+
+void D3DUtils::UploadTexture(ID3D12Device *device, ResourceUploadBatch &batch, const TextureImage &image,
+                             ID3D12Resource **texture)
+{
+    const std::vector<D3D12_SUBRESOURCE_DATA> textureData = CreateTextureResource(device, image, texture);
+
+    batch.Upload(*texture, 0, textureData.data(), UINT(textureData.size()));
+    batch.Transition(*texture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+}
+
+void D3DUtils::CreateTextureSRV(ID3D12Device *device, ID3D12Resource *texture,
+                                D3D12_CPU_DESCRIPTOR_HANDLE descHandle, bool isCubemap)
+{
+    const D3D12_RESOURCE_DESC desc = texture->GetDesc();
 
-    //  ؽƮ 
-    UpdateSubresources(commandList, *texture, textureUploadHeap, 0, 0, 1, &textureData);
-    commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(*texture, D3D12_RESOURCE_STATE_COPY_DEST,
-                                                                          D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
     // Describe and create a SRV for the texture.
     D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
     srvDesc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.Format                          = textureDesc.Format;
-    srvDesc.ViewDimension                   = D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.Texture2D.MipLevels             = 1;
-    device->CreateShaderResourceView(*texture, &srvDesc, descHandle);
-
-    SAFE_ARR_DELETE(image);
+    srvDesc.Format                          = desc.Format;
+    srvDesc.ViewDimension = isCubemap ? D3D12_SRV_DIMENSION_TEXTURECUBE : D3D12_SRV_DIMENSION_TEXTURE2D;
+    // TextureCube has the same layout as Texture2D for these fields.
+    srvDesc.TextureCube.MostDetailedMip     = 0;
+    srvDesc.TextureCube.MipLevels           = desc.MipLevels;
+    srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
+    device->CreateShaderResourceView(texture, &srvDesc, descHandle);
+}
 
-    return textureUploadHeap;
+void D3DUtils::CreateNullSRV(ID3D12Device *device, D3D12_CPU_DESCRIPTOR_HANDLE descHandle, bool isCubemap)
+{
+    // A null view still needs a format and the dimension the shader declares.
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format                          = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srvDesc.ViewDimension = isCubemap ? D3D12_SRV_DIMENSION_TEXTURECUBE : D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.TextureCube.MipLevels = 1;
+    device->CreateShaderResourceView(nullptr, &srvDesc, descHandle);
 }
 
 void D3DUtils::CreateDDSTexture(ID3D12Device *device, ID3D12CommandQueue *cmdQueue, std::wstring filename,
@@ -104,16 +273,8 @@ void D3DUtils::CreateDDSTexture(ID3D12Device *device, ID3D12CommandQueue *cmdQue
     // Wait for the upload thread to terminate
     uploadResourcesFinished.wait();
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-    srvDesc.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-    srvDesc.ViewDimension               = isCubemap ? D3D12_SRV_DIMENSION_TEXTURECUBE : D3D12_SRV_DIMENSION_TEXTURE2D;
-    srvDesc.TextureCube.MostDetailedMip = 0;
-    srvDesc.TextureCube.MipLevels       = (*res)->GetDesc().MipLevels;
-    srvDesc.TextureCube.ResourceMinLODClamp = 0.0f;
-    srvDesc.Format                          = (*res)->GetDesc().Format;
-
     handle = Graphics::s_Texture.Alloc(1);
-    device->CreateShaderResourceView((*res), &srvDesc, D3D12_CPU_DESCRIPTOR_HANDLE(handle));
+    CreateTextureSRV(device, *res, D3D12_CPU_DESCRIPTOR_HANDLE(handle), isCubemap);
 }
 
 void D3DUtils::CreateDscriptor(ID3D12Device *device, uint32_t numDesc, D3D12_DESCRIPTOR_HEAP_TYPE type,
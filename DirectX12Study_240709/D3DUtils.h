@@ -1,5 +1,6 @@
 #pragma once
 
+#include "TextureImage.h"
 #include <stdexcept>
 
 using namespace DirectX;
@@ -38,6 +39,15 @@ inline void ThrowIfFailed(HRESULT hr)
 
 class DescriptorHandle;
 
+// Texture stored inside a model file, copied out of aiTexture. Either an encoded file (png, jpg) or raw texels in
+// aiTexel order (b, g, r, a).
+struct EmbeddedTexture
+{
+    std::vector<uint8_t> data;
+    uint32_t width  = 0; // raw texels, 0 : data is an encoded file
+    uint32_t height = 0;
+};
+
 class D3DUtils
 {
   public:
@@ -79,12 +89,36 @@ class D3DUtils
         (*buffer)->Unmap(0, nullptr);
     }
 
+    // Reads the file and uploads it with its full mip chain from MipGenerator.
     static ID3D12Resource *CreateTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
                                          const std::string &filename, ID3D12Resource **texture,
                                          D3D12_CPU_DESCRIPTOR_HANDLE &descHandle, XMFLOAT3 color = {},
                                          bool isSRGB = false);
+    static ID3D12Resource *CreateTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                         const TextureImage &image, ID3D12Resource **texture,
+                                         D3D12_CPU_DESCRIPTOR_HANDLE &descHandle);
+    // Without a view, for textures seen through several descriptors. Returns the upload heap.
+    static ID3D12Resource *CreateTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                         const TextureImage &image, ID3D12Resource **texture);
     static void CreateDDSTexture(ID3D12Device *device, ID3D12CommandQueue *cmdQueue, std::wstring filename,
                                  ID3D12Resource **res, DescriptorHandle &handle);
+    // Through DirectXTK's DDS loader, uploaded like CreateTexture without a view. Returns the upload heap.
+    static ID3D12Resource *CreateDDSTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                            const std::wstring &filename, ID3D12Resource **texture);
+    // Bytes of a row and of a level, a row of 4x4 blocks for the BC formats.
+    static void GetPitch(DXGI_FORMAT format, uint32_t width, uint32_t height, size_t &rowPitch, size_t &slicePitch);
+
+    // Only file IO and decoding, safe to call from any thread.
+    static TextureImage ReadTexture(const std::string &filename, XMFLOAT3 color = {}, bool isSRGB = false);
+    // Decodes in memory, nothing touches the disk. Black if the data can't be decoded.
+    static TextureImage ReadTexture(const EmbeddedTexture &texture, bool isSRGB = false);
+    // Records the copy into batch instead of a command list. Leaves the texture in PIXEL_SHADER_RESOURCE.
+    static void UploadTexture(ID3D12Device *device, ResourceUploadBatch &batch, const TextureImage &image,
+                              ID3D12Resource **texture);
+    static void CreateTextureSRV(ID3D12Device *device, ID3D12Resource *texture, D3D12_CPU_DESCRIPTOR_HANDLE descHandle,
+                                 bool isCubemap = false);
+    // View of no resource, reads as zero. Holds the slot of a texture that is still loading.
+    static void CreateNullSRV(ID3D12Device *device, D3D12_CPU_DESCRIPTOR_HANDLE descHandle, bool isCubemap = false);
     static void CreateDscriptor(ID3D12Device *device, uint32_t numDesc, D3D12_DESCRIPTOR_HEAP_TYPE type,
                                 D3D12_DESCRIPTOR_HEAP_FLAGS flag, ID3D12DescriptorHeap **descHeap);
     static void CreateShader(const std::wstring filename, ID3DBlob **vsShader, const std::string mainEntry,
@@ -0,0 +1,162 @@
+#include "pch.h"
+
+#include "DDSCache.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include <fstream>
+
+namespace
+{
+// The DDS file layout, DirectXTK keeps its DDS.h private.
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11]; // s_tag, DDSCache::sm_version, source hash low and high
+    DDSPixelFormat ddspf;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDXT10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDS_HEADER is 124 bytes");
+
+const uint32_t s_magic = 0x20534444; // "DDS "
+const uint32_t s_dx10  = 0x30315844; // "DX10"
+const uint32_t s_tag   = 0x48434444; // "DDCH", written by DDSCache
+
+bool IsUpToDate(const std::string &path, uint64_t sourceHash)
+{
+    MappedFile file;
+    if (!file.Open(path) || file.GetSize() < sizeof(uint32_t) + sizeof(DDSHeader) + sizeof(DDSHeaderDXT10))
+    {
+        return false;
+    }
+
+    uint32_t magic;
+    DDSHeader header;
+    memcpy(&magic, file.GetData(), sizeof(magic));
+    memcpy(&header, file.GetData() + sizeof(magic), sizeof(header));
+    return magic == s_magic && header.reserved1[0] == s_tag && header.reserved1[1] == DDSCache::sm_version &&
+           header.reserved1[2] == uint32_t(sourceHash) && header.reserved1[3] == uint32_t(sourceHash >> 32);
+}
+} // namespace
+
+std::string DDSCache::Fetch(const std::string &sourcePath, const DDSCacheSettings &settings, TextureImage &image)
+{
+    const std::string path    = GetCachePath(sourcePath, settings);
+    const uint64_t sourceHash = MeshCache::HashFile(sourcePath);
+    if (sourceHash != 0 && IsUpToDate(path, sourceHash))
+    {
+        return path;
+    }
+
+    image = D3DUtils::ReadTexture(sourcePath, {}, settings.isSRGB);
+    MipGenerator::Generate(image, settings.mips);
+
+    CompressStats stats;
+    if (TextureCompressor::Compress(image, settings.format, &stats))
+    {
+        TextureCompressor::Report(sourcePath, stats);
+        if (sourceHash != 0)
+            Save(path, image, sourceHash);
+    }
+    return "";
+}
+
+bool DDSCache::Save(const std::string &path, const TextureImage &image, uint64_t sourceHash)
+{
+    size_t rowPitch, slicePitch;
+    D3DUtils::GetPitch(image.format, image.width, image.height, rowPitch, slicePitch);
+
+    DDSHeader header         = {};
+    header.size              = sizeof(DDSHeader);
+    header.flags             = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, size, format, mips, linear size
+    header.height            = image.height;
+    header.width             = image.width;
+    header.pitchOrLinearSize = uint32_t(slicePitch);
+    header.mipMapCount       = image.mipLevels;
+    header.reserved1[0]      = s_tag;
+    header.reserved1[1]      = sm_version;
+    header.reserved1[2]      = uint32_t(sourceHash);
+    header.reserved1[3]      = uint32_t(sourceHash >> 32);
+    header.ddspf.size        = sizeof(DDSPixelFormat);
+    header.ddspf.flags       = 0x4; // fourCC
+    header.ddspf.fourCC      = s_dx10;
+    header.caps              = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+
+    DDSHeaderDXT10 dx10    = {};
+    dx10.dxgiFormat        = uint32_t(image.format);
+    dx10.resourceDimension = 3; // texture 2D
+    dx10.arraySize         = 1;
+
+    // Write next to the target and swap like MeshCache, a reader never sees a half written file.
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&s_magic), sizeof(s_magic));
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(&dx10), sizeof(dx10));
+        out.write(reinterpret_cast<const char *>(image.pixels.data()), std::streamsize(image.pixels.size()));
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    return ::MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+std::string DDSCache::GetCachePath(const std::string &sourcePath, const DDSCacheSettings &settings)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix      = [&hash](const void *data, size_t size) {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ static_cast<const uint8_t *>(data)[i]) * 1099511628211ull;
+        }
+    };
+    mix(&settings.format, sizeof(settings.format));
+    mix(&settings.isSRGB, sizeof(settings.isSRGB));
+    mix(&settings.mips.filter, sizeof(settings.mips.filter));
+    mix(&settings.mips.isNormalMap, sizeof(settings.mips.isNormalMap));
+    mix(&settings.mips.isWrap, sizeof(settings.mips.isWrap));
+    mix(&settings.mips.kaiserWidth, sizeof(settings.mips.kaiserWidth));
+    mix(&settings.mips.kaiserAlpha, sizeof(settings.mips.kaiserAlpha));
+
+    char name[17] = {};
+    sprintf_s(name, "%016llx", hash);
+    return sourcePath + "." + name + ".dds";
+}
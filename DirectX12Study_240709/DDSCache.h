@@ -0,0 +1,33 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+
+// What the cached DDS of a texture file depends on besides the file.
+struct DDSCacheSettings
+{
+    BC_FORMAT format = BC_FORMAT_BC7;
+    bool isSRGB      = false;
+    MipSettings mips;
+};
+
+// Block compressed copies of texture files with their mip chains, so only the first run pays for MipGenerator and
+// TextureCompressor. The cache file sits next to the source as "<filename>.<hash of the settings>.dds", a plain DX10
+// DDS that DirectXTK loads. The hash of the source file is kept in the reserved words of its header, a changed
+// source writes the file again.
+class DDSCache
+{
+  public:
+    // Bump when MipGenerator or TextureCompressor change what they write.
+    static const uint32_t sm_version = 1;
+
+    // The cache file of sourcePath if it's up to date, image is left alone then. Otherwise "" and image holds the
+    // source with its mips, compressed unless TextureCompressor refuses it, and the cache file is written for the
+    // next run. Safe to call from several jobs for different files.
+    static std::string Fetch(const std::string &sourcePath, const DDSCacheSettings &settings, TextureImage &image);
+
+    static bool Save(const std::string &path, const TextureImage &image, uint64_t sourceHash);
+
+  private:
+    static std::string GetCachePath(const std::string &sourcePath, const DDSCacheSettings &settings);
+};
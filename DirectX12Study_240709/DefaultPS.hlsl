@@ -132,8 +132,10 @@ float3 GetNoramlWorld(PSInput input)
     
     if (mapFlags & 0x10)
     {
-        float3 normal = normalTexture.Sample(linearClampSS, input.texCoord).xyz;
-        normal = 2.0 * normal - 1.0;
+        // BC5 keeps only x and y, z of the unit tangent space normal faces out.
+        float3 normal;
+        normal.xy = 2.0 * normalTexture.Sample(linearClampSS, input.texCoord).xy - 1.0;
+        normal.z = sqrt(saturate(1.0 - dot(normal.xy, normal.xy)));
         
         // This case => OpenGL file.
         if(mapFlags & 0x40)
@@ -2,36 +2,45 @@
 
 Texture2D heightTexture : register(t8);
 
+#ifdef QUANTIZED
+// QuantizedVertex, the input assembler already converts UNORM16, SNORM16 and half floats to float.
+struct QuantizedVSInput
+{
+    float4 posQuantized : POSITION;
+    float2 normalOct : NORMAL;
+    float2 tangentOct : TANGENT;
+    float2 texCoord : TEXCOORD;
+};
+
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+PSInput main(QuantizedVSInput quantized)
+{
+    VSInput input;
+    input.posModel = positionMin + quantized.posQuantized.xyz * positionExtent;
+    input.normalModel = DecodeOctahedral(quantized.normalOct);
+    input.texCoord = texCoordOffset + quantized.texCoord;
+    input.tangentModel = DecodeOctahedral(quantized.tangentOct);
+#else
 PSInput main(VSInput input)
 {
+#endif
     PSInput output;
     
 #ifdef SKINNED
-    float weights[8];
-    weights[0] = input.boneWeights0.x;
-    weights[1] = input.boneWeights0.y;
-    weights[2] = input.boneWeights0.z;
-    weights[3] = input.boneWeights0.w;
-    weights[4] = input.boneWeights1.x;
-    weights[5] = input.boneWeights1.y;
-    weights[6] = input.boneWeights1.z;
-    weights[7] = input.boneWeights1.w;
-    
-    uint indices[8];
-    indices[0] = input.boneIndices0.x;
-    indices[1] = input.boneIndices0.y;
-    indices[2] = input.boneIndices0.z;
-    indices[3] = input.boneIndices0.w;
-    indices[4] = input.boneIndices1.x;
-    indices[5] = input.boneIndices1.y;
-    indices[6] = input.boneIndices1.z;
-    indices[7] = input.boneIndices1.w;
-    
+    // 4 influences, the loader keeps the largest 4 and renormalizes them.
     float3 posModel = float3(0.0f, 0.0f, 0.0f);
     
-    for (int i = 0; i < 8; i++)
+    [unroll]
+    for (int i = 0; i < 4; i++)
     {
-        posModel += weights[i] * mul(float4(input.posModel, 1.0), bonesTransform[indices[i]]).xyz;
+        posModel += input.boneWeights[i] * mul(float4(input.posModel, 1.0), bonesTransform[boneOffset + input.boneIndices[i]]).xyz;
     }
     
     input.posModel = posModel;
@@ -12,6 +12,7 @@
 // #include "QuadTree.h"
 #include "OceanModel.h"
 #include "Terrain.h"
+#include "TextureCache.h"
 #include "FrameResource.h"
 // https://sketchfab.com/3d-models/gm-bigcity-f80855b6286944459392fc723ed0b50f#download
 // https://free3d.com/3d-model/sci-fi-downtown-city-53758.html
@@ -47,48 +48,40 @@ bool Engine::Initialize()
 		L"SkyboxSpecularHDR.dds", L"SkyboxBrdf.dds");
 
 	// Create the model.
+	// The files are read on the job system, FinishCharacter initializes the model once both are in. It is added now
+	// because Update expects it at m_opaqueList[0], and is skipped until then.
+	Model* skinnedModel = new SkinnedMeshModel;
+	//Model* gun = new Model;
+	if (!skinnedModel)
 	{
-		Model* skinnedModel = new SkinnedMeshModel;
-		//Model* gun = new Model;
-		if (!skinnedModel)
-		{
-			return false;
-		}
-		{
-			std::string basePath = "../../Asset/Model/";
-			std::vector<std::string> animClips = { "test4.fbx", "Running_60.fbx", "Right Strafe Walking.fbx",
-												  "Left Strafe Walking.fbx", "Walking Backward.fbx" };
+		return false;
+	}
+	skinnedModel->m_isPending = true;
+	m_opaqueList.push_back(skinnedModel);
 
-			AnimationData animData = {};
-			for (const auto& clip : animClips)
-			{
-				auto [_, anim] = GeometryGenerator::ReadFromAnimationFile(basePath.c_str(), clip.c_str());
-
-				if (animData.clips.empty())
-				{
-					animData = anim;
-				}
-				else
-				{
-					animData.clips.push_back(anim.clips.front());
-				}
-			}
+	const std::string basePath = "../../Asset/Model/";
 
-			auto [model, material] = GeometryGenerator::ReadFromModelFile(basePath.c_str(), "test4.fbx", true);
+	m_animFile = m_assetLoader.Load<AnimationFile>([basePath]() {
+		std::vector<std::string> animClips = { "test4.fbx", "Running_60.fbx", "Right Strafe Walking.fbx",
+											  "Left Strafe Walking.fbx", "Walking Backward.fbx" };
 
-			((SkinnedMeshModel*)skinnedModel)->Initialize(m_device, m_commandList, model, material, animData);
-			skinnedModel->GetMaterialConstCPU().useAlbedoMap = m_useTexture;
-			skinnedModel->GetMaterialConstCPU().albedoFactor = Vector3(0.3f);
-		}
-		m_opaqueList.push_back(skinnedModel);
-	}
+		// The first file gives the skeleton, the others only their clips.
+		AnimationFile file = GeometryGenerator::ReadFromAnimationFile(basePath.c_str(), animClips.front().c_str());
+		GeometryGenerator::ReadAnimationClipFiles(basePath.c_str(),
+			std::vector<std::string>(animClips.begin() + 1, animClips.end()), file.second);
+		return file;
+	}, [this](AnimationFile&) { FinishCharacter(); });
+
+	m_modelFile = m_assetLoader.Load<ModelFile>(
+		[basePath]() { return GeometryGenerator::ReadFromModelFile(basePath.c_str(), "test4.fbx", true); },
+		[this](ModelFile&) { FinishCharacter(); });
 
 	{
 		m_terrain = new Terrain;
 		MeshData grid = GeometryGenerator::MakeSquareGrid(255, 255, 50.0f, Vector2(25.0f));
 		s_TerrainSRV = Graphics::s_Texture.Alloc(1);
-		m_uploadResource = D3DUtils::CreateTexture(m_device, m_commandList, "../../Asset/GroundDirtRocky020_COL_4K.jpg",
-			&m_terrainTexResource, D3D12_CPU_DESCRIPTOR_HANDLE(s_TerrainSRV));
+		m_assetLoader.LoadTexture("../../Asset/GroundDirtRocky020_COL_4K.jpg", D3D12_CPU_DESCRIPTOR_HANDLE(s_TerrainSRV),
+			false, {}, [this](TextureAsset& texture) { m_terrainTexResource = texture.resource; });
 
 		uint8_t* image = nullptr;
 		int width = 0;
@@ -148,6 +141,8 @@ bool Engine::Initialize()
 	}
 
 	std::cout << m_terrain->GetMeshComponentSize() << std::endl;
+	Mesh::sm_indexStats.Report(); // models still loading show up in the Debugging section
+	g_TextureCache.GetStats().Report();
 
 	m_frustum = new Frustum;
 
@@ -194,11 +189,50 @@ bool Engine::Initialize()
 	// global const setting.
 	m_globalConstsData.envStrength = 0.0f;
 
+	// The character is in m_opaqueList while it loads, its constants get the last slot when it is initialized.
 	AppBase::SetFrameResource(m_opaqueList.size() + 1 + m_lightSpheres.size(), MAX_LIGHTS);
 
 	return true;
 }
 
+void Engine::FinishCharacter()
+{
+	if (!m_animFile.IsReady() || !m_modelFile.IsReady())
+	{
+		return;
+	}
+
+	auto& [_, animData] = m_animFile.Get();
+	auto& [model, material] = m_modelFile.Get();
+	SkinnedMeshModel* skinnedModel = (SkinnedMeshModel*)m_opaqueList[0];
+
+	// Called from AssetLoader::Update at the start of a frame, the list of the last frame is closed.
+	ThrowIfFailed(m_commandList->Reset(m_commandAllocator, nullptr));
+
+	skinnedModel->EnableCpuSkinning();
+	// Far away models play baked palettes (AnimationLodSettings::bakedLod).
+	auto animAsset = AnimationAsset::Create(std::move(animData));
+	if (m_isBakeReportFlag)
+	{
+		AnimationBaker::Report(animAsset->GetData(), { 15.0f, 30.0f, 60.0f }, 0.01f);
+	}
+	animAsset->Bake(m_device, 30.0f);
+
+	skinnedModel->Initialize(m_device, m_commandList, model, material, animAsset);
+	skinnedModel->GetMaterialConstCPU().useAlbedoMap = m_useTexture;
+	skinnedModel->GetMaterialConstCPU().albedoFactor = Vector3(0.3f);
+
+	ThrowIfFailed(m_commandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { m_commandList };
+	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	// Run resets m_commandAllocator after this frame, the copies have to be done by then. Once per model.
+	WaitForGpu();
+
+	m_animFile = {};
+	m_modelFile = {};
+}
+
 void Engine::Update(const float dt)
 {
 	AppBase::Update(dt);
@@ -261,12 +295,12 @@ void Engine::Update(const float dt)
 	//m_light[1].position =
 	//    Vector3::Transform(m_light[1].position, Matrix::CreateTranslation(Vector3(0.0f, height, 0.0f)));
 
-	if (((SkinnedMeshModel*)m_opaqueList[0])->GetAnim().clips.size() > 0)
+	if (((SkinnedMeshModel*)m_opaqueList[0])->HasAnimation())
 	{
 		// update animation.
 
 		{
-			static int frameCount = 0;
+			static double animTime = 0.0;
 			static int state = 0;
 
 			//if (GameInput::IsFirstPressed(GameInput::kKey_w))
@@ -354,13 +388,38 @@ void Engine::Update(const float dt)
 
 			//m_opaqueList[0]->Move(dt);
 
-			((SkinnedMeshModel*)m_opaqueList[0])->UpdateAnimation(state, frameCount++);
+			animTime += dt;
+			((SkinnedMeshModel*)m_opaqueList[0])->UpdateAnimationLod(m_camera->GetPosition());
+			((SkinnedMeshModel*)m_opaqueList[0])->UpdateAnimation(state, animTime);
+			((SkinnedMeshModel*)m_opaqueList[0])->UploadAnimation(m_curFrameResource);
 		}
 	}
 
 	m_frustum->ConstructFrustum(m_camera->GetFarZ(), m_globalConstsData.view.Transpose(),
 		m_globalConstsData.proj.Transpose());
 
+	// Cull the character with the bounds of its skinned pose. Shadows don't check m_isDraw.
+	{
+		SkinnedMeshModel* skinned = (SkinnedMeshModel*)m_opaqueList[0];
+		if (skinned->HasCpuSkinning())
+		{
+			const BoundingBox bounds = skinned->GetSkinnedBounds();
+			const float radius = XMMax(bounds.Extents.x, XMMax(bounds.Extents.y, bounds.Extents.z));
+			skinned->m_isDraw = m_frustum->CheckCube(bounds.Center.x, bounds.Center.y, bounds.Center.z, radius);
+		}
+	}
+
+	m_clusterStats = {};
+	for (auto& e : m_opaqueList)
+	{
+		if (e->m_isPending)
+			continue;
+		e->UpdateLod(m_camera->GetPosition());
+		// Against the main camera only, the scene pass draws the result with RenderVisible.
+		e->CullClusters(m_frustum->GetPlanes(), m_camera->GetPosition());
+		m_clusterStats.Add(e->GetClusterStats());
+	}
+
 	//m_DebugQaudTree->Update();
 
 	//m_postProcess.GetConstCPU().exposure     = m_exposureFactor;
@@ -460,6 +519,15 @@ void Engine::UpdateGui(const float frameRate)
 	if (ImGui::CollapsingHeader("Debugging"))
 	{
 		// ImGui::Text("The number of triangles is %d in this frame.", m_quadTree->GetNumRenderTriangles());
+		ImGui::Text("Clusters drawn: %u / %u, triangles culled: %.1f%%", m_clusterStats.numVisibleMeshlets,
+			m_clusterStats.numMeshlets, m_clusterStats.GetCulledRatio() * 100.0f);
+		ImGui::Text("Character mesh LOD: %u", m_opaqueList[0]->GetLod());
+		const IndexBufferStats& indexStats = Mesh::sm_indexStats;
+		ImGui::Text("16 bit index buffers: %u / %u, %llu KB instead of %llu KB", indexStats.num16BitMeshes,
+			indexStats.numMeshes, indexStats.numBytes / 1024, indexStats.num32BitBytes / 1024);
+		const TextureCacheStats& textureStats = g_TextureCache.GetStats();
+		ImGui::Text("Textures: %u unique / %u requested, %llu KB instead of %llu KB", textureStats.numCreated,
+			textureStats.numRequested, textureStats.numBytes / 1024, textureStats.numRequestedBytes / 1024);
 
 		ImGui::Checkbox("First person view", &m_isFPV);
 		ImGui::Checkbox("Draw as normal", &m_drawAsNormal);
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "AnimationData.h"
 #include "AppBase.h"
+#include "MeshData.h"
+#include "MeshletBuilder.h"
 
 class Model;
 class Terrain;
@@ -23,6 +26,13 @@ class Engine : public AppBase
     virtual void EndFrame();
     virtual void WorkerThread(int threadIndex);
 
+  private:
+    using AnimationFile = std::pair<std::vector<MeshData>, AnimationData>;
+    using ModelFile     = std::pair<std::vector<MeshData>, std::vector<MaterialConsts>>;
+
+    // Initializes the character (m_opaqueList[0]) once both of its files are in. Main thread, from their onReady.
+    void FinishCharacter();
+
   private:
     std::string m_basePath = "";
     // Model *m_terrain       = nullptr;
@@ -42,9 +52,16 @@ class Engine : public AppBase
     DebugQuadTree *m_DebugQaudTree = nullptr;
 
     bool m_isDebugTreeFlag = false;
+    bool m_isBakeReportFlag = false; // bakes the animation at 15, 30 and 60 fps on startup and prints the error
 
     ID3D12Resource *m_uploadResource     = nullptr;
     ID3D12Resource *m_terrainTexResource = nullptr;
 
     float m_height = 0.0f;
+
+    ClusterCullStats m_clusterStats; // summed over the models, last frame
+
+    // Files of the character while they load, FinishCharacter releases them.
+    AssetHandle<AnimationFile> m_animFile;
+    AssetHandle<ModelFile> m_modelFile;
 };
@@ -31,10 +31,12 @@ FrameResource::FrameResource(int numModels, int numLights, DescriptorHandle dept
 	m_materialConstsBuffer = new UploadBuffer<MaterialConsts>();
 	m_globalConstsBuffer = new UploadBuffer<GlobalConsts>();
 	m_shadowConstsBuffer = new UploadBuffer<GlobalConsts>();
+	m_bonePaletteBuffer = new UploadBuffer<Matrix>();
 	m_meshConstsBuffer->Initialize(Graphics::g_Device, numModels);
 	m_materialConstsBuffer->Initialize(Graphics::g_Device, numModels);
 	m_globalConstsBuffer->Initialize(Graphics::g_Device, 1);
 	m_shadowConstsBuffer->Initialize(Graphics::g_Device, numLights);
+	m_bonePaletteBuffer->Initialize(Graphics::g_Device, g_MaxBonePaletteMatrices);
 
 	m_shadowHandle = depthHandle;
 
@@ -52,6 +54,7 @@ FrameResource::~FrameResource()
 	SAFE_DELETE(m_materialConstsBuffer);
 	SAFE_DELETE(m_globalConstsBuffer);
 	SAFE_DELETE(m_shadowConstsBuffer);
+	SAFE_DELETE(m_bonePaletteBuffer);
 
 	for (int i = 0; i < g_NumCommandList; i++)
 	{
@@ -88,3 +91,18 @@ void FrameResource::Init()
 		ThrowIfFailed(m_sceneCommandLists[i]->Reset(m_sceneCommandAllocators[i], m_scenePSO));
 	}
 }
+
+uint32_t FrameResource::AllocateBonePalette(const Matrix* palette, uint32_t count)
+{
+	if (m_bonePaletteOffset + count > g_MaxBonePaletteMatrices)
+	{
+		assert(false && "bone palette buffer is full");
+		return 0;
+	}
+
+	const uint32_t offset = m_bonePaletteOffset;
+	m_bonePaletteBuffer->Upload(int(offset), palette, count);
+	m_bonePaletteOffset += count;
+
+	return offset;
+}
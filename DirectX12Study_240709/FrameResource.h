@@ -7,6 +7,7 @@
 const int g_NumContext = 3;
 const int g_NumCommandList = 3;
 const int g_NumFrameResource = 3;
+const int g_MaxBonePaletteMatrices = 16384; // skinning matrices of every character in one frame
 
 class FrameResource
 {
@@ -34,10 +35,19 @@ public:
 	UploadBuffer<MaterialConsts>* m_materialConstsBuffer = nullptr;
 	UploadBuffer<GlobalConsts>* m_globalConstsBuffer = nullptr;
 	UploadBuffer<GlobalConsts>* m_shadowConstsBuffer = nullptr;
+	UploadBuffer<Matrix>* m_bonePaletteBuffer = nullptr;
+	uint32_t m_bonePaletteOffset = 0;
 
 	DescriptorHandle m_shadowHandle;
 
 public:
 	void Init();
+
+	// Copies a skinning palette into this frame's bone buffer and returns the index of its first matrix.
+	uint32_t AllocateBonePalette(const Matrix* palette, uint32_t count);
+	void ResetBonePalette()
+	{
+		m_bonePaletteOffset = 0;
+	}
 };
 
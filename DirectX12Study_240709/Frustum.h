@@ -11,6 +11,12 @@ class Frustum
 
     bool CheckCube(float xCenter, float yCenter, float zCenter, float radius);
 
+    // World space, normalized, pointing inside.
+    const Vector4 *GetPlanes() const
+    {
+        return m_plane;
+    }
+
   private:
     Vector4 m_plane[6];
 };
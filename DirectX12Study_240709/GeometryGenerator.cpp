@@ -1,9 +1,38 @@
 #include "pch.h"
 
 #include "GeometryGenerator.h"
+#include "AnimationCompressor.h"
+#include "JobSystem.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "ModelLoader.h"
+#include "Stopwatch.h"
 #include <DirectXMesh.h>
 
+namespace
+{
+// Welds and reorders every mesh of a model file for the vertex cache and builds its LOD chain, one job per mesh.
+void OptimizeMeshes(std::vector<MeshData> &meshes, const char *filename)
+{
+    std::vector<MeshOptimizeStats> stats(meshes.size());
+    g_JobSystem.ParallelFor(uint32_t(meshes.size()), 1, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            stats[i] = MeshOptimizer::Optimize(meshes[i]);
+            MeshSimplifier::BuildLods(meshes[i]);
+        }
+    });
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const std::string name = std::string(filename) + " mesh " + std::to_string(i);
+        MeshOptimizer::Report(name, stats[i]);
+        MeshSimplifier::Report(name, meshes[i]);
+    }
+}
+} // namespace
+
 MeshData GeometryGenerator::MakeTriangle(const float x)
 {
     MeshData meshData = {};
@@ -404,6 +433,8 @@ MeshData GeometryGenerator::MakeSphere(float radius, uint32_t sliceCount, uint32
         meshData.vertices[i].tangent = tangents[i];
     }
 
+    MeshOptimizer::Optimize(meshData);
+
     return meshData;
 }
 
@@ -453,12 +484,29 @@ void NomalizeModel(std::vector<MeshData> &meshes, const float sacle, AnimationDa
 auto GeometryGenerator::ReadFromModelFile(const char *filepath, const char *filename, bool isAnim)
     -> std::pair<std::vector<MeshData>, std::vector<MaterialConsts>>
 {
+    const std::string source = std::string(filepath) + filename;
+    const uint32_t flags     = isAnim ? MeshCache::IMPORT_SKINNED : 0;
+
+    const Stopwatch stopwatch;
+
+    MeshCache::Content cached;
+    if (MeshCache::Load(source, flags, cached))
+    {
+        std::cout << "Loaded " << filename << " from the mesh cache in " << stopwatch.GetElapsedMs() << " ms"
+                  << std::endl;
+        return {std::move(cached.meshes), std::move(cached.materials)};
+    }
+
     ModelLoader modelLoader((const char *)filepath, (const char *)filename, isAnim);
 
     auto meshes   = modelLoader.Meshes();
     auto material = modelLoader.Materials();
 
     NomalizeModel(meshes, 1.0f, modelLoader.Animation());
+    OptimizeMeshes(meshes, filename);
+
+    std::cout << "Imported " << filename << " in " << stopwatch.GetElapsedMs() << " ms" << std::endl;
+    MeshCache::Save(source, flags, {meshes, material, AnimationData()});
 
     // Mesh Data  ִ vector vector 1 MeshData ȯѴ.
     return {meshes, material};
@@ -467,12 +515,100 @@ auto GeometryGenerator::ReadFromModelFile(const char *filepath, const char *file
 auto GeometryGenerator::ReadFromAnimationFile(const char *filepath, const char *filename)
     -> std::pair<std::vector<MeshData>, AnimationData>
 {
+    const std::string source = std::string(filepath) + filename;
+    const uint32_t flags     = MeshCache::IMPORT_SKINNED | MeshCache::IMPORT_ANIMATION;
+
+    const Stopwatch stopwatch;
+
+    MeshCache::Content cached;
+    if (MeshCache::Load(source, flags, cached))
+    {
+        std::cout << "Loaded " << filename << " from the mesh cache in " << stopwatch.GetElapsedMs() << " ms"
+                  << std::endl;
+        return {std::move(cached.meshes), std::move(cached.anim)};
+    }
+
     ModelLoader modelLoader((const char *)filepath, (const char *)filename, true);
 
     auto meshes = modelLoader.Meshes();
     auto &anim  = modelLoader.Animation();
 
     NomalizeModel(meshes, 1.0f, anim);
+    OptimizeMeshes(meshes, filename);
+
+    AnimationCompressor::Compress(anim);
+
+    std::cout << "Imported " << filename << " in " << stopwatch.GetElapsedMs() << " ms" << std::endl;
+    MeshCache::Save(source, flags, {meshes, {}, anim});
 
     return {meshes, anim};
-}
\ No newline at end of file
+}
+void GeometryGenerator::ReadAnimationClipFiles(const char *filepath, const std::vector<std::string> &filenames,
+                                               AnimationData &anim)
+{
+    const uint32_t numFiles = uint32_t(filenames.size());
+
+    std::vector<AnimationClip> clips(numFiles);
+    std::vector<AnimationCompressor::Stats> stats(numFiles);
+    std::vector<uint8_t> loaded(numFiles, 0);
+    std::vector<uint8_t> fromCache(numFiles, 0);
+    std::vector<double> loadTime(numFiles, 0.0);
+
+    // Clips map their channels to the bones of anim, so the cache entry depends on the skeleton too.
+    const uint64_t skeletonKey = MeshCache::HashSkeleton(anim);
+
+    // One file per job. Each job has its own Assimp importer.
+    g_JobSystem.ParallelFor(numFiles, 1, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const Stopwatch stopwatch;
+
+            const std::string source = std::string(filepath) + filenames[i];
+
+            MeshCache::Content cached;
+            if (MeshCache::Load(source, MeshCache::IMPORT_CLIPS, cached, skeletonKey) && !cached.anim.clips.empty())
+            {
+                clips[i]     = std::move(cached.anim.clips.front());
+                loaded[i]    = 1;
+                fromCache[i] = 1;
+                loadTime[i]  = stopwatch.GetElapsedMs();
+                continue;
+            }
+
+            auto fileClips = ModelLoader::LoadAnimationClips(filepath, filenames[i].c_str(), anim);
+            if (fileClips.empty())
+            {
+                continue;
+            }
+
+            clips[i]    = std::move(fileClips.front());
+            stats[i]    = AnimationCompressor::Compress(clips[i]);
+            loaded[i]   = 1;
+            loadTime[i] = stopwatch.GetElapsedMs();
+
+            MeshCache::Content content;
+            content.anim.clips.push_back(clips[i]);
+            MeshCache::Save(source, MeshCache::IMPORT_CLIPS, content, skeletonKey);
+        }
+    });
+
+    for (uint32_t i = 0; i < numFiles; i++)
+    {
+        if (!loaded[i])
+        {
+            std::cout << "No animation clip in " << filenames[i] << std::endl;
+            continue;
+        }
+
+        if (fromCache[i])
+        {
+            std::cout << "Loaded " << filenames[i] << " from the mesh cache in " << loadTime[i] << " ms" << std::endl;
+        }
+        else
+        {
+            std::cout << "Imported " << filenames[i] << " in " << loadTime[i] << " ms" << std::endl;
+            AnimationCompressor::Report(clips[i], stats[i]);
+        }
+        anim.clips.push_back(std::move(clips[i]));
+    }
+}
@@ -21,4 +21,8 @@ class GeometryGenerator
         -> std::pair<std::vector<MeshData>, std::vector<MaterialConsts>>;
     static auto ReadFromAnimationFile(const char *filepath, const char *filename)
         -> std::pair<std::vector<MeshData>, AnimationData>;
+    // Appends the first clip of every file to anim, which must already hold the skeleton.
+    // Only the clips are imported, and the files are read in parallel on g_JobSystem.
+    static void ReadAnimationClipFiles(const char *filepath, const std::vector<std::string> &filenames,
+                                       AnimationData &anim);
 };
@@ -18,6 +18,7 @@ namespace Graphics
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> basicILDesc;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> skinnedILDesc;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> quantizedILDesc;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> normalILDesc;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> skyboxILDesc;
 	std::vector<D3D12_INPUT_ELEMENT_DESC> postEffectsILDesc;
@@ -26,6 +27,7 @@ namespace Graphics
 
 	ID3DBlob* basicVS;
 	ID3DBlob* skinnedVS;
+	ID3DBlob* quantizedVS;
 	ID3DBlob* skyboxVS;
 	ID3DBlob* uiVS;
 	ID3DBlob* postEffecstVS;
@@ -63,11 +65,14 @@ namespace Graphics
 	ID3D12PipelineState* skinnedSolidPSO;
 	ID3D12PipelineState* defaultWirePSO;
 	ID3D12PipelineState* skinnedWirePSO;
+	ID3D12PipelineState* quantizedSolidPSO;
+	ID3D12PipelineState* quantizedWirePSO;
 	ID3D12PipelineState* normalPSO;
 	ID3D12PipelineState* blendCoverPSO;
 	ID3D12PipelineState* skyboxPSO;
 	ID3D12PipelineState* depthOnlyPSO;
 	ID3D12PipelineState* depthOnlySkinnedPSO;
+	ID3D12PipelineState* depthOnlyQuantizedPSO;
 	ID3D12PipelineState* postEffectsPSO;
 	ID3D12PipelineState* postProcessPSO;
 	ID3D12PipelineState* billBoardPointsPSO;
@@ -153,6 +158,8 @@ namespace Graphics
 
 		D3DUtils::CreateShader(L"DefaultVS.hlsl", &skinnedVS, "main", "vs_5_1", { {"SKINNED", "1"}, {NULL, NULL} });
 
+		D3DUtils::CreateShader(L"DefaultVS.hlsl", &quantizedVS, "main", "vs_5_1", { {"QUANTIZED", "1"}, {NULL, NULL} });
+
 		D3DUtils::CreateShader(L"UIShader.hlsl", &uiVS, "vsmain", "vs_5_1");
 
 		D3DUtils::CreateShader(L"PostEffectsVS.hlsl", &postEffecstVS, "main", "vs_5_1");
@@ -201,10 +208,15 @@ namespace Graphics
 			{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 			{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 			{"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-			{"BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-			{"BLENDWEIGHT", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 60, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-			{"BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, 76, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-			{"BLENDINDICES", 1, DXGI_FORMAT_R8G8B8A8_UINT, 0, 80, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0} };
+			{"BLENDWEIGHT", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+			{"BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0} };
+
+		// QuantizedVertex
+		quantizedILDesc = {
+			{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+			{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+			{"TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+			{"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0} };
 
 		normalILDesc = { {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 						{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0} };
@@ -416,6 +428,14 @@ namespace Graphics
 		psoDesc.RasterizerState = wireCW;
 		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&skinnedWirePSO)));
 
+		psoDesc.InputLayout = { quantizedILDesc.data(), UINT(quantizedILDesc.size()) };
+		psoDesc.VS = CD3DX12_SHADER_BYTECODE(quantizedVS);
+		psoDesc.RasterizerState = solidMSSACW;
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&quantizedSolidPSO)));
+
+		psoDesc.RasterizerState = wireCW;
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&quantizedWirePSO)));
+
 		psoDesc.InputLayout = { billBoardILDesc.data(), UINT(billBoardILDesc.size()) };
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(billBoardVS);
 		psoDesc.GS = CD3DX12_SHADER_BYTECODE(billBoardGS);
@@ -450,6 +470,10 @@ namespace Graphics
 		psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
 		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&depthOnlySkinnedPSO)));
 
+		psoDesc.InputLayout = { quantizedILDesc.data(), UINT(quantizedILDesc.size()) };
+		psoDesc.VS = CD3DX12_SHADER_BYTECODE(quantizedVS);
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&depthOnlyQuantizedPSO)));
+
 		psoDesc.InputLayout = { billBoardILDesc.data(), UINT(billBoardILDesc.size()) };
 		psoDesc.RasterizerState = solidCW;
 		psoDesc.VS = CD3DX12_SHADER_BYTECODE(billBoardVS);
@@ -522,9 +546,12 @@ namespace Graphics
 		SAFE_RELEASE(postProcessPSO);
 		SAFE_RELEASE(billBoardPointsPSO);
 		SAFE_RELEASE(postEffectsPSO);
+		SAFE_RELEASE(depthOnlyQuantizedPSO);
 		SAFE_RELEASE(depthOnlySkinnedPSO);
 		SAFE_RELEASE(depthOnlyPSO);
 		SAFE_RELEASE(skyboxPSO);
+		SAFE_RELEASE(quantizedWirePSO);
+		SAFE_RELEASE(quantizedSolidPSO);
 		SAFE_RELEASE(skinnedWirePSO);
 		SAFE_RELEASE(skinnedSolidPSO);
 		SAFE_RELEASE(defaultWirePSO);
@@ -548,6 +575,7 @@ namespace Graphics
 		SAFE_RELEASE(dummyPS);
 		SAFE_RELEASE(skyboxPS);
 		SAFE_RELEASE(skyboxVS);
+		SAFE_RELEASE(quantizedVS);
 		SAFE_RELEASE(skinnedVS);
 		SAFE_RELEASE(uiVS);
 		SAFE_RELEASE(postEffecstVS);
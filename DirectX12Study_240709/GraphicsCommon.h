@@ -25,6 +25,7 @@ namespace Graphics
 
 	extern std::vector<D3D12_INPUT_ELEMENT_DESC> basicILDesc;
 	extern std::vector<D3D12_INPUT_ELEMENT_DESC> skinnedILDesc;
+	extern std::vector<D3D12_INPUT_ELEMENT_DESC> quantizedILDesc;
 	extern std::vector<D3D12_INPUT_ELEMENT_DESC> normalILDesc;
 	extern std::vector<D3D12_INPUT_ELEMENT_DESC> skyboxILDesc;
 	extern std::vector<D3D12_INPUT_ELEMENT_DESC> postEffectsILDesc;
@@ -33,6 +34,7 @@ namespace Graphics
 
 	extern ID3DBlob* basicVS;
 	extern ID3DBlob* skinnedVS;
+	extern ID3DBlob* quantizedVS;
 	extern ID3DBlob* skyboxVS;
 	extern ID3DBlob* uiVS;
 	extern ID3DBlob* postEffecstVS;
@@ -70,11 +72,14 @@ namespace Graphics
 	extern ID3D12PipelineState* skinnedSolidPSO;
 	extern ID3D12PipelineState* defaultWirePSO;
 	extern ID3D12PipelineState* skinnedWirePSO;
+	extern ID3D12PipelineState* quantizedSolidPSO;
+	extern ID3D12PipelineState* quantizedWirePSO;
 	extern ID3D12PipelineState* normalPSO;
 	extern ID3D12PipelineState* blendCoverPSO;
 	extern ID3D12PipelineState* skyboxPSO;
 	extern ID3D12PipelineState* depthOnlyPSO;
 	extern ID3D12PipelineState* depthOnlySkinnedPSO;
+	extern ID3D12PipelineState* depthOnlyQuantizedPSO;
 	extern ID3D12PipelineState* postEffectsPSO;
 	extern ID3D12PipelineState* postProcessPSO;
 	extern ID3D12PipelineState* billBoardPointsPSO;
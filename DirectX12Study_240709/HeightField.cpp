@@ -0,0 +1,159 @@
+#include "HeightField.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+void HeightField::Initialize(const std::vector<XMFLOAT3> &positions, const int numSlices, const int numStacks)
+{
+    assert(positions.size() == size_t(numSlices + 1) * size_t(numStacks + 1));
+
+    m_numSlices = uint32_t(numSlices);
+    m_numStacks = uint32_t(numStacks);
+
+    m_heights.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        m_heights[i] = positions[i].y;
+    }
+
+    // Row/column coordinates are copied from the mesh so the generated triangles are bit-identical
+    // to the ones in the index buffer.
+    m_columnX.resize(numSlices + 1);
+    for (int i = 0; i <= numSlices; i++)
+    {
+        m_columnX[i] = positions[i].x;
+    }
+
+    m_rowZ.resize(numStacks + 1);
+    for (int j = 0; j <= numStacks; j++)
+    {
+        m_rowZ[j] = positions[(numSlices + 1) * j].z;
+    }
+
+    m_stepX = (m_columnX.back() - m_columnX.front()) / float(numSlices);
+    m_stepZ = (m_rowZ.back() - m_rowZ.front()) / float(numStacks);
+}
+
+bool HeightField::GetCellRange(const BoundingSphere &sphere, int &minX, int &maxX, int &minZ, int &maxZ) const
+{
+    if (m_heights.empty())
+    {
+        return false;
+    }
+
+    const float r = sphere.Radius;
+
+    float x0 = (sphere.Center.x - r - m_columnX.front()) / m_stepX;
+    float x1 = (sphere.Center.x + r - m_columnX.front()) / m_stepX;
+    float z0 = (sphere.Center.z - r - m_rowZ.front()) / m_stepZ;
+    float z1 = (sphere.Center.z + r - m_rowZ.front()) / m_stepZ;
+
+    if (x0 > x1)
+        std::swap(x0, x1);
+    if (z0 > z1)
+        std::swap(z0, z1);
+
+    // Grow by one cell so that vertices which are a rounding error away from the uniform spacing
+    // are still tested.
+    minX = int(floorf(x0)) - 1;
+    maxX = int(floorf(x1)) + 1;
+    minZ = int(floorf(z0)) - 1;
+    maxZ = int(floorf(z1)) + 1;
+
+    if (maxX < 0 || maxZ < 0 || minX >= int(m_numSlices) || minZ >= int(m_numStacks))
+    {
+        return false;
+    }
+
+    minX = XMMax(minX, 0);
+    minZ = XMMax(minZ, 0);
+    maxX = XMMin(maxX, int(m_numSlices) - 1);
+    maxZ = XMMin(maxZ, int(m_numStacks) - 1);
+
+    return true;
+}
+
+void HeightField::GetCellTriangles(const int i, const int j, XMFLOAT3 tri[6]) const
+{
+    const XMFLOAT3 p00 = XMFLOAT3(m_columnX[i], Height(i, j), m_rowZ[j]);
+    const XMFLOAT3 p10 = XMFLOAT3(m_columnX[i + 1], Height(i + 1, j), m_rowZ[j]);
+    const XMFLOAT3 p01 = XMFLOAT3(m_columnX[i], Height(i, j + 1), m_rowZ[j + 1]);
+    const XMFLOAT3 p11 = XMFLOAT3(m_columnX[i + 1], Height(i + 1, j + 1), m_rowZ[j + 1]);
+
+    tri[0] = p00;
+    tri[1] = p10;
+    tri[2] = p01;
+
+    tri[3] = p01;
+    tri[4] = p10;
+    tri[5] = p11;
+}
+
+bool HeightField::Intersects(const BoundingSphere &sphere) const
+{
+    int minX, maxX, minZ, maxZ;
+    if (!GetCellRange(sphere, minX, maxX, minZ, maxZ))
+    {
+        return false;
+    }
+
+    XMFLOAT3 tri[6];
+    for (int j = minZ; j <= maxZ; j++)
+    {
+        for (int i = minX; i <= maxX; i++)
+        {
+            GetCellTriangles(i, j, tri);
+
+            if (sphere.Intersects(XMLoadFloat3(&tri[0]), XMLoadFloat3(&tri[1]), XMLoadFloat3(&tri[2])) ||
+                sphere.Intersects(XMLoadFloat3(&tri[3]), XMLoadFloat3(&tri[4]), XMLoadFloat3(&tri[5])))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void HeightField::AddPairs(const std::vector<CollisionShape> &shapes, std::vector<XMFLOAT3> &triangles,
+                           std::vector<CollisionPair> &pairs) const
+{
+    XMFLOAT3 tri[6];
+    for (uint32_t s = 0; s < uint32_t(shapes.size()); s++)
+    {
+        const CollisionShape &shape = shapes[s];
+
+        BoundingSphere bounds(shape.p0, shape.radius);
+        uint32_t type = CollisionPair::SPHERE_TRIANGLE;
+        if (shape.type == CollisionShape::CAPSULE)
+        {
+            const XMVECTOR p0 = XMLoadFloat3(&shape.p0);
+            const XMVECTOR p1 = XMLoadFloat3(&shape.p1);
+            XMStoreFloat3(&bounds.Center, XMVectorScale(XMVectorAdd(p0, p1), 0.5f));
+            bounds.Radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(p1, p0))) * 0.5f + shape.radius;
+            type          = CollisionPair::CAPSULE_TRIANGLE;
+        }
+
+        int minX, maxX, minZ, maxZ;
+        if (!GetCellRange(bounds, minX, maxX, minZ, maxZ))
+        {
+            continue;
+        }
+
+        for (int j = minZ; j <= maxZ; j++)
+        {
+            for (int i = minX; i <= maxX; i++)
+            {
+                GetCellTriangles(i, j, tri);
+
+                for (int t = 0; t < 2; t++)
+                {
+                    pairs.push_back({type, s, uint32_t(triangles.size() / 3)});
+                    triangles.insert(triangles.end(), tri + 3 * t, tri + 3 * t + 3);
+                }
+            }
+        }
+    }
+}
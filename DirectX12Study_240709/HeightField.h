@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ContactGenerator.h"
+#include <DirectXCollision.h>
+
+using DirectX::BoundingSphere;
+
+// Height field built from a MakeSquareGrid mesh that lies on the XZ plane.
+// Only the per-vertex heights and the row/column coordinates are kept. Triangles are
+// generated on demand for the cells under a query volume, so the cost of a contact test
+// depends on the size of the volume and not on the size of the terrain.
+class HeightField
+{
+  public:
+    // positions : vertices laid out as MakeSquareGrid(numSlices, numStacks, ...) after rotating it onto the XZ plane.
+    void Initialize(const std::vector<XMFLOAT3> &positions, const int numSlices, const int numStacks);
+
+    bool Intersects(const BoundingSphere &sphere) const;
+
+    // Broadphase for ContactGenerator. Appends the triangles of the cells under each shape and a pair for every one
+    // of them, a capsule is bounded by the sphere around its segment.
+    void AddPairs(const std::vector<CollisionShape> &shapes, std::vector<XMFLOAT3> &triangles,
+                  std::vector<CollisionPair> &pairs) const;
+
+    // Cell range [minX, maxX] x [minZ, maxZ] that can touch the sphere footprint. false if it is outside the grid.
+    bool GetCellRange(const BoundingSphere &sphere, int &minX, int &maxX, int &minZ, int &maxZ) const;
+
+    // Same two triangles (and winding) as the index buffer of MakeSquareGrid for cell (i, j).
+    void GetCellTriangles(const int i, const int j, XMFLOAT3 tri[6]) const;
+
+    uint32_t GetNumSlices() const
+    {
+        return m_numSlices;
+    }
+    uint32_t GetNumStacks() const
+    {
+        return m_numStacks;
+    }
+
+  private:
+    float Height(const int i, const int j) const
+    {
+        return m_heights[(m_numSlices + 1) * j + i];
+    }
+
+  private:
+    uint32_t m_numSlices = 0;
+    uint32_t m_numStacks = 0;
+
+    std::vector<float> m_heights; // (numSlices + 1) * (numStacks + 1)
+    std::vector<float> m_columnX; // numSlices + 1
+    std::vector<float> m_rowZ;    // numStacks + 1
+
+    float m_stepX = 0.0f;
+    float m_stepZ = 0.0f; // negative for MakeSquareGrid (rows go from +z to -z)
+};
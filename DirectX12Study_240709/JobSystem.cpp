@@ -0,0 +1,133 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <memory>
+
+JobSystem g_JobSystem;
+
+namespace
+{
+// Index passed to jobs run by this thread. The main thread (and any thread outside the pool) is 0.
+thread_local uint32_t t_threadIndex = 0;
+} // namespace
+
+void JobSystem::Initialize(uint32_t numWorkers)
+{
+    Shutdown();
+
+    m_quit = false;
+    for (uint32_t i = 0; i < numWorkers; i++)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+    }
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cv.notify_all();
+
+    for (auto &t : m_workers)
+    {
+        t.join();
+    }
+    m_workers.clear();
+}
+
+void JobSystem::Dispatch(Job job)
+{
+    if (m_workers.empty())
+    {
+        job(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push(std::move(job));
+    }
+    m_cv.notify_one();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const ParallelJob &job)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    batchSize               = std::max(batchSize, 1u);
+    const uint32_t nBatches = (count + batchSize - 1) / batchSize;
+
+    const uint32_t callerIndex = t_threadIndex;
+
+    if (m_workers.empty() || nBatches == 1)
+    {
+        job(0, count, callerIndex);
+        return;
+    }
+
+    struct Context
+    {
+        std::atomic<uint32_t> next{0};
+        std::atomic<uint32_t> finished{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    // Helpers that get scheduled after the loop is finished still touch the context.
+    auto ctx = std::make_shared<Context>();
+
+    auto runBatches = [ctx, count, batchSize, nBatches, &job](uint32_t threadIndex) {
+        uint32_t done = 0;
+        for (uint32_t b = ctx->next++; b < nBatches; b = ctx->next++)
+        {
+            const uint32_t begin = b * batchSize;
+            job(begin, std::min(begin + batchSize, count), threadIndex);
+            done++;
+        }
+
+        if (done > 0 && (ctx->finished += done) == nBatches)
+        {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            ctx->cv.notify_all();
+        }
+    };
+
+    const uint32_t numHelpers = std::min(uint32_t(m_workers.size()), nBatches - 1);
+    for (uint32_t i = 0; i < numHelpers; i++)
+    {
+        // job is only referenced while batches remain, i.e. before this function returns.
+        Dispatch(runBatches);
+    }
+
+    runBatches(callerIndex);
+
+    std::unique_lock<std::mutex> lock(ctx->mutex);
+    ctx->cv.wait(lock, [&ctx, nBatches]() { return ctx->finished == nBatches; });
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex)
+{
+    t_threadIndex = threadIndex;
+
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return m_quit || !m_jobs.empty(); });
+
+            if (m_quit && m_jobs.empty())
+            {
+                return;
+            }
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+
+        job(threadIndex);
+    }
+}
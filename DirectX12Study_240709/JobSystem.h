@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Small worker pool for CPU side jobs (collision, animation, asset processing).
+// Render command recording keeps using the dedicated threads in AppBase.
+class JobSystem
+{
+  public:
+    using Job         = std::function<void(uint32_t threadIndex)>;
+    using ParallelJob = std::function<void(uint32_t begin, uint32_t end, uint32_t threadIndex)>;
+
+    ~JobSystem()
+    {
+        Shutdown();
+    }
+
+    // numWorkers == 0 runs every job on the calling thread.
+    void Initialize(uint32_t numWorkers);
+    void Shutdown();
+
+    // Worker threads + the calling thread. Valid thread indices are [0, GetNumThreads()).
+    uint32_t GetNumThreads() const
+    {
+        return uint32_t(m_workers.size()) + 1;
+    }
+
+    // Runs job on a worker. Workers use thread indices 1..N.
+    void Dispatch(Job job);
+
+    // Splits [0, count) into batches of batchSize and blocks until every batch is done.
+    // The calling thread takes batches too with its own thread index (0 on the main thread, the worker
+    // index inside a job), so this never waits on a busy pool and can be called from a job as well.
+    void ParallelFor(uint32_t count, uint32_t batchSize, const ParallelJob &job);
+
+  private:
+    void WorkerLoop(uint32_t threadIndex);
+
+  private:
+    std::vector<std::thread> m_workers;
+    std::queue<Job> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_quit = false;
+};
+
+extern JobSystem g_JobSystem;
@@ -0,0 +1,62 @@
+#pragma once
+
+// Read only view of a whole file, the pages are read on first access.
+class MappedFile
+{
+  public:
+    MappedFile()                   = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (m_data)
+            ::UnmapViewOfFile(m_data);
+        if (m_mapping)
+            ::CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            ::CloseHandle(m_file);
+    }
+
+    bool Open(const std::string &path)
+    {
+        m_file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size = {};
+        if (!::GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        {
+            return false;
+        }
+        m_size = size_t(size.QuadPart);
+
+        m_mapping = ::CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t *>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        return m_data != nullptr;
+    }
+
+    const uint8_t *GetData() const
+    {
+        return m_data;
+    }
+
+    size_t GetSize() const
+    {
+        return m_size;
+    }
+
+  private:
+    HANDLE m_file         = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping      = nullptr;
+    const uint8_t *m_data = nullptr;
+    size_t m_size         = 0;
+};
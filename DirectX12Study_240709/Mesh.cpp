@@ -1,3 +1,44 @@
 #include "pch.h"
 
-#include "Mesh.h"
\ No newline at end of file
+#include "Mesh.h"
+
+IndexBufferStats Mesh::sm_indexStats;
+
+void IndexBufferStats::Report() const
+{
+    std::cout << "Index buffers : " << num16BitMeshes << " / " << numMeshes << " meshes 16 bit, "
+              << numBytes / 1024 << " KB instead of " << num32BitBytes / 1024 << " KB" << std::endl;
+}
+
+const EmbeddedTexture *MeshData::FindEmbeddedTexture(const std::string &filename) const
+{
+    if (filename.size() < 2 || filename[0] != '*' || !embeddedTextures)
+        return nullptr;
+
+    const size_t index = size_t(strtoull(filename.c_str() + 1, nullptr, 10));
+    return index < embeddedTextures->size() ? &(*embeddedTextures)[index] : nullptr;
+}
+
+void Mesh::CreateIndexBuffer(ID3D12Device *device, const MeshData &meshData)
+{
+    const ConstArray<MeshData::index_t> indices = meshData.GetIndices();
+    indexCount                                  = uint32_t(indices.size());
+    indexFormat                                 = meshData.GetIndexFormat();
+
+    uint32_t size = indexCount * sizeof(uint32_t);
+    if (indexFormat == DXGI_FORMAT_R16_UINT)
+    {
+        const std::vector<uint16_t> indices16(indices.begin(), indices.end());
+        size = indexCount * sizeof(uint16_t);
+        D3DUtils::CreateDefaultBuffer(device, &indexBuffer, indices16.data(), size);
+        sm_indexStats.num16BitMeshes++;
+    }
+    else
+    {
+        D3DUtils::CreateDefaultBuffer(device, &indexBuffer, indices.data, size);
+    }
+
+    sm_indexStats.numMeshes++;
+    sm_indexStats.numBytes += size;
+    sm_indexStats.num32BitBytes += indexCount * sizeof(uint32_t);
+}
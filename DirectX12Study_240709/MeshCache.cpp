@@ -0,0 +1,486 @@
+#include "pch.h"
+
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t importFlags;
+    uint32_t layout;
+    uint64_t sourceSize;
+    uint64_t sourceTime;
+    uint64_t sourceHash;
+};
+
+const char s_magic[4] = {'M', 'C', 'H', 'E'};
+
+// Arrays handed out as views into the mapping start at this offset multiple from the start of the file.
+const size_t s_viewAlignment = 16;
+
+// Size and last write time of the source, so an unchanged source isn't hashed.
+bool GetSourceStamp(const std::string &path, uint64_t &size, uint64_t &time)
+{
+    std::error_code error;
+    size = uint64_t(std::filesystem::file_size(path, error));
+    if (error)
+    {
+        return false;
+    }
+    time = uint64_t(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
+
+// Sizes of the structs copied as raw bytes. A layout change without a version bump still misses.
+uint32_t GetLayout()
+{
+    return uint32_t(sizeof(Vertex)) | uint32_t(sizeof(SkinnedVertex)) << 8 |
+           uint32_t(sizeof(MaterialConsts) / 4) << 16 | uint32_t(sizeof(Matrix)) << 24;
+}
+
+uint64_t Fnv1a(const uint8_t *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+class Writer
+{
+  public:
+    void Bytes(const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        m_data.insert(m_data.end(), bytes, bytes + size);
+    }
+
+    template <typename T> void Pod(const T &value)
+    {
+        Bytes(&value, sizeof(T));
+    }
+
+    template <typename T> void Array(const std::vector<T> &v)
+    {
+        Pod(uint64_t(v.size()));
+        Bytes(v.data(), v.size() * sizeof(T));
+    }
+
+    template <typename T> void Count(const std::vector<T> &v)
+    {
+        Pod(uint64_t(v.size()));
+    }
+
+    // Array read back as a view, padded to s_viewAlignment.
+    template <typename T> void View(const ConstArray<T> &a)
+    {
+        Pod(uint64_t(a.size()));
+        m_data.resize((m_data.size() + s_viewAlignment - 1) / s_viewAlignment * s_viewAlignment);
+        Bytes(a.data, a.size() * sizeof(T));
+    }
+
+    void String(const std::string &s)
+    {
+        Pod(uint64_t(s.size()));
+        Bytes(s.data(), s.size());
+    }
+
+    template <typename M> void Map(const M &m)
+    {
+        Pod(uint64_t(m.size()));
+        for (const auto &[key, value] : m)
+        {
+            Item(key);
+            Item(value);
+        }
+    }
+
+    const std::vector<uint8_t> &GetData() const
+    {
+        return m_data;
+    }
+
+  private:
+    void Item(const std::string &s)
+    {
+        String(s);
+    }
+
+    template <typename T> void Item(const T &value)
+    {
+        Pod(value);
+    }
+
+  private:
+    std::vector<uint8_t> m_data;
+};
+
+// Mirror of Writer. Any read past the end marks the reader as failed and leaves the rest untouched.
+class Reader
+{
+  public:
+    Reader(const uint8_t *begin, const uint8_t *end) : m_begin(begin), m_cur(begin), m_end(end)
+    {
+    }
+
+    bool IsOk() const
+    {
+        return m_ok;
+    }
+
+    void Bytes(void *data, size_t size)
+    {
+        if (!m_ok || size_t(m_end - m_cur) < size)
+        {
+            m_ok = false;
+            return;
+        }
+        memcpy(data, m_cur, size);
+        m_cur += size;
+    }
+
+    template <typename T> void Pod(T &value)
+    {
+        Bytes(&value, sizeof(T));
+    }
+
+    template <typename T> void Array(std::vector<T> &v)
+    {
+        const uint64_t count = ReadCount(sizeof(T));
+        v.resize(size_t(count));
+        Bytes(v.data(), v.size() * sizeof(T));
+    }
+
+    template <typename T> void Count(std::vector<T> &v)
+    {
+        v.resize(size_t(ReadCount(1)));
+    }
+
+    // Points into the data instead of copying, valid as long as the data is.
+    template <typename T> void View(ConstArray<T> &a)
+    {
+        const uint64_t count = ReadCount(sizeof(T));
+        const size_t padding = (s_viewAlignment - size_t(m_cur - m_begin) % s_viewAlignment) % s_viewAlignment;
+        if (!m_ok || uint64_t(m_end - m_cur) < padding + count * sizeof(T))
+        {
+            m_ok = false;
+            return;
+        }
+        m_cur += padding;
+        a = ConstArray<T>(reinterpret_cast<const T *>(m_cur), size_t(count));
+        m_cur += count * sizeof(T);
+    }
+
+    void String(std::string &s)
+    {
+        s.resize(size_t(ReadCount(1)));
+        Bytes(s.data(), s.size());
+    }
+
+    template <typename M> void Map(M &m)
+    {
+        const uint64_t count = ReadCount(1);
+        for (uint64_t i = 0; i < count && m_ok; i++)
+        {
+            typename M::key_type key;
+            typename M::mapped_type value;
+            Item(key);
+            Item(value);
+            m.emplace(std::move(key), std::move(value));
+        }
+    }
+
+  private:
+    // Element counts can't be larger than what is left in the file.
+    uint64_t ReadCount(size_t elementSize)
+    {
+        uint64_t count = 0;
+        Pod(count);
+        if (!m_ok || count > uint64_t(m_end - m_cur) / elementSize)
+        {
+            m_ok = false;
+            return 0;
+        }
+        return count;
+    }
+
+    void Item(std::string &s)
+    {
+        String(s);
+    }
+
+    template <typename T> void Item(T &value)
+    {
+        Pod(value);
+    }
+
+  private:
+    const uint8_t *m_begin;
+    const uint8_t *m_cur;
+    const uint8_t *m_end;
+    bool m_ok = true;
+};
+
+template <typename Archive, typename Channel> void TransferChannel(Archive &ar, Channel &channel)
+{
+    ar.Pod(channel.min);
+    ar.Pod(channel.extent);
+    ar.Array(channel.times);
+    ar.Array(channel.floatTimes);
+    ar.Array(channel.values);
+    ar.Array(channel.floatValues);
+}
+
+template <typename Archive, typename Texture> void TransferTexture(Archive &ar, Texture &texture)
+{
+    ar.Pod(texture.width);
+    ar.Pod(texture.height);
+    ar.Array(texture.data);
+}
+
+// Vertices and indices are the bulk of the file, Load leaves them in the mapping.
+void TransferMeshArrays(Writer &ar, const MeshData &mesh)
+{
+    ar.View(mesh.GetVertices());
+    ar.View(mesh.GetSkinnedVertices());
+    ar.View(mesh.GetIndices());
+}
+
+void TransferMeshArrays(Reader &ar, MeshData &mesh)
+{
+    ar.View(mesh.mappedVertices);
+    ar.View(mesh.mappedSkinnedVertices);
+    ar.View(mesh.mappedIndices);
+}
+
+// The embedded textures are shared by all meshes of a model, stored once.
+void TransferEmbeddedTextures(Writer &ar, const std::vector<MeshData> &meshes)
+{
+    static const std::vector<EmbeddedTexture> s_noTextures;
+    const auto &textures = meshes.empty() || !meshes[0].embeddedTextures ? s_noTextures : *meshes[0].embeddedTextures;
+    ar.Count(textures);
+    for (const auto &texture : textures)
+        TransferTexture(ar, texture);
+}
+
+void TransferEmbeddedTextures(Reader &ar, std::vector<MeshData> &meshes)
+{
+    auto textures = std::make_shared<std::vector<EmbeddedTexture>>();
+    ar.Count(*textures);
+    for (auto &texture : *textures)
+        TransferTexture(ar, texture);
+
+    if (!textures->empty())
+    {
+        for (auto &mesh : meshes)
+            mesh.embeddedTextures = textures;
+    }
+}
+
+// Same walk for writing (const Content) and reading.
+template <typename Archive, typename Content> void Transfer(Archive &ar, Content &content)
+{
+    ar.Count(content.meshes);
+    for (auto &mesh : content.meshes)
+    {
+        TransferMeshArrays(ar, mesh);
+        ar.Array(mesh.lods);
+        ar.String(mesh.albedoTextureFilename);
+        ar.String(mesh.metallicTextureFilename);
+        ar.String(mesh.roughnessTextureFilename);
+        ar.String(mesh.normalTextureFilename);
+        ar.String(mesh.heightTextureFilename);
+        ar.String(mesh.aoTextureFilename);
+        ar.String(mesh.emissionTextureFilename);
+    }
+    TransferEmbeddedTextures(ar, content.meshes);
+    ar.Array(content.materials);
+
+    auto &anim = content.anim;
+    ar.Map(anim.boneNameToId);
+    ar.Map(anim.boneIdToName);
+    ar.Array(anim.boneParentId);
+    ar.Array(anim.offsetMatrix);
+    ar.Pod(anim.defaultMatrix);
+
+    ar.Count(anim.clips);
+    for (auto &clip : anim.clips)
+    {
+        ar.String(clip.name);
+        ar.Pod(clip.duration);
+        ar.Pod(clip.tickPerSecond);
+        ar.Pod(clip.numChannels);
+
+        ar.Count(clip.tracks);
+        for (auto &track : clip.tracks)
+        {
+            ar.Array(track.posTimes);
+            ar.Array(track.pos);
+            ar.Array(track.rotTimes);
+            ar.Array(track.rot);
+            ar.Array(track.scaleTimes);
+            ar.Array(track.scale);
+        }
+
+        ar.Count(clip.compressedTracks);
+        for (auto &track : clip.compressedTracks)
+        {
+            TransferChannel(ar, track.pos);
+            ar.Array(track.rot.times);
+            ar.Array(track.rot.floatTimes);
+            ar.Array(track.rot.values);
+            TransferChannel(ar, track.scale);
+        }
+    }
+}
+} // namespace
+
+bool MeshCache::Load(const std::string &sourcePath, uint32_t importFlags, Content &content, uint64_t key)
+{
+    const std::string path = GetCachePath(sourcePath, importFlags, key);
+
+    // The header alone first, a stale file is never mapped.
+    Header header;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.read(reinterpret_cast<char *>(&header), sizeof(Header)))
+        {
+            return false;
+        }
+    }
+    if (memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 || header.version != sm_version ||
+        header.importFlags != importFlags || header.layout != GetLayout())
+    {
+        return false;
+    }
+
+    uint64_t sourceSize = 0, sourceTime = 0;
+    if (!GetSourceStamp(sourcePath, sourceSize, sourceTime) || header.sourceSize != sourceSize)
+    {
+        return false;
+    }
+
+    // Touched without a change of size (copied, checked out again) : the hash decides, and a match stores the new
+    // time so the next load skips the hash again.
+    if (header.sourceTime != sourceTime)
+    {
+        const uint64_t sourceHash = HashFile(sourcePath);
+        if (sourceHash == 0 || header.sourceHash != (sourceHash ^ key))
+        {
+            return false;
+        }
+
+        header.sourceTime = sourceTime;
+        std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    }
+
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(path))
+    {
+        return false;
+    }
+
+    // Replaced by another Save since the header was read. The new time may not have been stored.
+    Header mapped;
+    Reader reader(file->GetData(), file->GetData() + file->GetSize());
+    reader.Pod(mapped);
+    mapped.sourceTime = header.sourceTime;
+    if (!reader.IsOk() || memcmp(&mapped, &header, sizeof(Header)) != 0)
+    {
+        return false;
+    }
+
+    Content loaded;
+    Transfer(reader, loaded);
+    if (!reader.IsOk())
+    {
+        return false;
+    }
+
+    for (auto &mesh : loaded.meshes)
+    {
+        mesh.mappedFile = file;
+    }
+
+    content = std::move(loaded);
+    return true;
+}
+
+bool MeshCache::Save(const std::string &sourcePath, uint32_t importFlags, const Content &content, uint64_t key)
+{
+    const uint64_t sourceHash = HashFile(sourcePath);
+    Header header             = {};
+    if (sourceHash == 0 || !GetSourceStamp(sourcePath, header.sourceSize, header.sourceTime))
+    {
+        return false;
+    }
+
+    header.version     = sm_version;
+    header.importFlags = importFlags;
+    header.layout      = GetLayout();
+    header.sourceHash  = sourceHash ^ key;
+    memcpy(header.magic, s_magic, sizeof(s_magic));
+
+    Writer writer;
+    writer.Pod(header);
+    Transfer(writer, content);
+
+    // Write next to the target and swap, a reader never sees a half written file.
+    const std::string path    = GetCachePath(sourcePath, importFlags, key);
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(writer.GetData().data()), std::streamsize(writer.GetData().size()));
+        if (!out)
+        {
+            return false;
+        }
+    }
+
+    return ::MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+uint64_t MeshCache::HashFile(const std::string &path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return 0;
+    }
+
+    return Fnv1a(file.GetData(), file.GetSize());
+}
+
+uint64_t MeshCache::HashSkeleton(const AnimationData &skeleton)
+{
+    uint64_t hash = Fnv1a(nullptr, 0);
+    for (const auto &[id, name] : skeleton.boneIdToName)
+    {
+        hash = Fnv1a(reinterpret_cast<const uint8_t *>(&id), sizeof(id), hash);
+        hash = Fnv1a(reinterpret_cast<const uint8_t *>(name.data()), name.size(), hash);
+    }
+    return hash;
+}
+
+std::string MeshCache::GetCachePath(const std::string &sourcePath, uint32_t importFlags, uint64_t key)
+{
+    if (key == 0)
+    {
+        return sourcePath + "." + std::to_string(importFlags) + ".meshcache";
+    }
+
+    char name[17] = {};
+    sprintf_s(name, "%016llx", key);
+    return sourcePath + "." + std::to_string(importFlags) + "." + name + ".meshcache";
+}
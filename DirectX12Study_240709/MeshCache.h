@@ -0,0 +1,48 @@
+#pragma once
+
+#include "AnimationData.h"
+#include "ConstantBuffer.h"
+#include "Mesh.h"
+
+// Binary copy of what GeometryGenerator builds from a model file (after ModelLoader, NomalizeModel,
+// MeshOptimizer, MeshSimplifier and AnimationCompressor), so later runs skip Assimp and the LOD build. The cache
+// file sits next to the source as "<filename>.<importFlags>.meshcache", or "<filename>.<importFlags>.<key>.meshcache"
+// with a key, and is read through a file mapping. It is used only if the version, the import flags and the struct
+// sizes match and the source has the size and write time it had at Save. A source with a new time but the same size
+// is hashed once (mixed with key), a match keeps the file. Vertices and indices aren't copied out, the loaded meshes
+// point into the mapping (MeshData::mappedFile).
+class MeshCache
+{
+  public:
+    // Bump when ModelLoader, ObjParser, NomalizeModel, MeshOptimizer, MeshSimplifier, AnimationCompressor or the
+    // cached structs change.
+    static const uint32_t sm_version = 8;
+
+    // Bits of importFlags. They select what was imported, each combination has its own file.
+    enum IMPORT_FLAG
+    {
+        IMPORT_SKINNED   = 1 << 0, // ModelLoader isAnim
+        IMPORT_ANIMATION = 1 << 1, // ReadFromAnimationFile, AnimationData is compressed
+        IMPORT_CLIPS     = 1 << 2, // ReadAnimationClipFiles, only clips, key is HashSkeleton
+    };
+
+    struct Content
+    {
+        std::vector<MeshData> meshes;
+        std::vector<MaterialConsts> materials;
+        AnimationData anim;
+    };
+
+    // False if there is no usable cache file for the source. key : anything else the content depends on, every key
+    // gets its own file. Safe to call from several threads for different files.
+    static bool Load(const std::string &sourcePath, uint32_t importFlags, Content &content, uint64_t key = 0);
+    static bool Save(const std::string &sourcePath, uint32_t importFlags, const Content &content, uint64_t key = 0);
+
+    // FNV-1a over the contents of the file, 0 if it can't be read.
+    static uint64_t HashFile(const std::string &path);
+    // Bone names and ids, clips map their channels to bones with them.
+    static uint64_t HashSkeleton(const AnimationData &skeleton);
+
+  private:
+    static std::string GetCachePath(const std::string &sourcePath, uint32_t importFlags, uint64_t key);
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <directxtk/SimpleMath.h>
+#include <dxgiformat.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+using DirectX::SimpleMath::Vector2;
+using DirectX::SimpleMath::Vector3;
+using DirectX::SimpleMath::Vector4;
+
+// Vertices and meshes on the CPU, as loaded and processed before upload. Only the DXGI format enum, so the mesh
+// tools build without D3D12 or windows.h. Mesh.h adds the GPU side.
+
+struct EmbeddedTexture;
+
+// Read only run of T owned by someone else, a vector of MeshData or a file mapped by MeshCache.
+template <typename T> struct ConstArray
+{
+    const T *data = nullptr;
+    size_t count  = 0;
+
+    ConstArray() = default;
+    ConstArray(const T *d, size_t n) : data(d), count(n)
+    {
+    }
+    ConstArray(const std::vector<T> &v) : data(v.data()), count(v.size())
+    {
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+    bool empty() const
+    {
+        return count == 0;
+    }
+    const T &operator[](size_t i) const
+    {
+        return data[i];
+    }
+    const T *begin() const
+    {
+        return data;
+    }
+    const T *end() const
+    {
+        return data + count;
+    }
+};
+
+struct Vertex
+{
+    Vertex() : position(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f), texCoord(0.0f, 0.0f)
+    {
+    }
+    Vertex(const Vector3 &p, const Vector3 &n, const Vector2 &t) : position(p), normal(n), texCoord(t)
+    {
+    }
+    Vertex(float px, float py, float pz, float nx, float ny, float nz, float tx, float ty)
+        : position(px, py, pz), normal(nx, ny, nz), texCoord(tx, ty)
+    {
+    }
+
+    Vector3 position;
+    Vector3 normal;
+    Vector2 texCoord;
+    Vector3 tangent = Vector3(1.0f, 0.0f, 0.0f);
+};
+
+// Up to 4 influences. Weights are UNORM8 and sum to 255, indices are UINT8 (skeletons up to 256 bones).
+struct SkinnedVertex
+{
+    static const uint32_t sm_maxInfluences = 4;
+
+    Vector3 position;
+    Vector3 normal;
+    Vector2 texCoord;
+    Vector3 tangent;
+    uint8_t boneWeights[sm_maxInfluences] = {0, 0, 0, 0};
+    uint8_t boneIndices[sm_maxInfluences] = {0, 0, 0, 0};
+};
+
+// Static vertex packed by VertexQuantizer, 20 bytes instead of 44. position is UNORM16 inside the box of the
+// model (w unused), normal and tangent are octahedral SNORM16, texCoord is half float.
+struct QuantizedVertex
+{
+    uint16_t position[4];
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texCoord[2];
+};
+
+// Part of the index buffer drawn for one level of detail. All levels share the vertex buffer.
+struct MeshLod
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error         = 0.0f; // simplification error, relative to the mesh radius
+};
+
+struct MeshData
+{
+    // 32 bit on the CPU so the mesh tools share one type, the GPU buffer takes the width of GetIndexFormat.
+    using index_t = uint32_t;
+
+    std::vector<Vertex> vertices;
+    std::vector<SkinnedVertex> skinnedVertices;
+    std::vector<index_t> indices;
+    // Built by MeshSimplifier, coarser levels follow LOD 0 in indices. Empty : indices is the only level.
+    std::vector<MeshLod> lods;
+
+    std::string albedoTextureFilename    = "";
+    std::string metallicTextureFilename  = "";
+    std::string roughnessTextureFilename = "";
+    std::string normalTextureFilename    = "";
+    std::string heightTextureFilename    = "";
+    std::string aoTextureFilename        = "";
+    std::string emissionTextureFilename  = "";
+
+    // Set by MeshCache::Load instead of vertices, skinnedVertices and indices: the arrays stay in the cache file,
+    // mapped as long as one of its meshes holds mappedFile. Read the arrays through GetVertices, GetSkinnedVertices
+    // and GetIndices, they take the vector unless it is empty.
+    std::shared_ptr<const void> mappedFile;
+    ConstArray<Vertex> mappedVertices;
+    ConstArray<SkinnedVertex> mappedSkinnedVertices;
+    ConstArray<index_t> mappedIndices;
+
+    // Textures packed in the model file, shared by all its meshes. A texture filename "*<index>" points in here.
+    std::shared_ptr<const std::vector<EmbeddedTexture>> embeddedTextures;
+
+    // The embedded texture a filename refers to, nullptr for a file on disk.
+    const EmbeddedTexture *FindEmbeddedTexture(const std::string &filename) const;
+
+    ConstArray<Vertex> GetVertices() const
+    {
+        return vertices.empty() ? mappedVertices : ConstArray<Vertex>(vertices);
+    }
+    ConstArray<SkinnedVertex> GetSkinnedVertices() const
+    {
+        return skinnedVertices.empty() ? mappedSkinnedVertices : ConstArray<SkinnedVertex>(skinnedVertices);
+    }
+    ConstArray<index_t> GetIndices() const
+    {
+        return indices.empty() ? mappedIndices : ConstArray<index_t>(indices);
+    }
+
+    // For the code that reorders indices in place: copies mapped indices into indices. The vertices stay mapped.
+    std::vector<index_t> &GetWritableIndices()
+    {
+        if (indices.empty())
+        {
+            indices.assign(mappedIndices.begin(), mappedIndices.end());
+        }
+        mappedIndices = {};
+        return indices;
+    }
+
+    // 16 bit indices whenever they can address every vertex, loaded and generated meshes alike.
+    DXGI_FORMAT GetIndexFormat() const
+    {
+        const size_t numVertices = XMMax(GetVertices().size(), GetSkinnedVertices().size());
+        return numVertices <= 65536 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    }
+};
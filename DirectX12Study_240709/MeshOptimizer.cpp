@@ -0,0 +1,493 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+// Forsyth, "Linear-Speed Vertex Cache Optimisation".
+const float s_cacheDecayPower   = 1.5f;
+const float s_lastTriangleScore = 0.75f;
+const float s_valenceBoostScale = 2.0f;
+const float s_valenceBoostPower = 0.5f;
+const uint32_t s_maxValence     = 32; // valence scores beyond this are close enough to 0 to share an entry
+
+struct ScoreTable
+{
+    float cache[MeshOptimizer::sm_cacheSize];
+    float valence[s_maxValence + 1];
+
+    ScoreTable()
+    {
+        for (uint32_t i = 0; i < MeshOptimizer::sm_cacheSize; i++)
+        {
+            // The 3 vertices of the last triangle get a fixed score so the next one doesn't reuse them all.
+            cache[i] = i < 3 ? s_lastTriangleScore
+                             : std::pow(1.0f - float(i - 3) / (MeshOptimizer::sm_cacheSize - 3), s_cacheDecayPower);
+        }
+
+        valence[0] = 0.0f;
+        for (uint32_t i = 1; i <= s_maxValence; i++)
+        {
+            valence[i] = s_valenceBoostScale * std::pow(float(i), -s_valenceBoostPower);
+        }
+    }
+
+    float Get(int32_t cachePos, uint32_t numLiveTriangles) const
+    {
+        if (numLiveTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        const float score = cachePos < 0 ? 0.0f : cache[cachePos];
+        return score + valence[XMMin(numLiveTriangles, s_maxValence)];
+    }
+};
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Applies remap (old index -> new index) to a vertex array. Entries mapped to ~0u are dropped.
+template <typename T> void RemapVertices(std::vector<T> &vertices, const std::vector<uint32_t> &remap, uint32_t count)
+{
+    if (vertices.empty())
+    {
+        return;
+    }
+
+    std::vector<T> remapped(count);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        if (remap[i] != ~0u)
+        {
+            remapped[remap[i]] = vertices[i];
+        }
+    }
+    vertices.swap(remapped);
+}
+
+Vector3 GetPosition(const MeshData &mesh, uint32_t i)
+{
+    return mesh.vertices.empty() ? mesh.skinnedVertices[i].position : mesh.vertices[i].position;
+}
+
+uint32_t GetNumVertices(const MeshData &mesh)
+{
+    return uint32_t(XMMax(mesh.vertices.size(), mesh.skinnedVertices.size()));
+}
+} // namespace
+
+MeshOptimizeStats MeshOptimizer::Optimize(MeshData &mesh, const MeshOptimizeSettings &settings)
+{
+    MeshOptimizeStats stats;
+    stats.numVerticesBefore  = GetNumVertices(mesh);
+    stats.numTrianglesBefore = uint32_t(mesh.indices.size() / 3);
+    stats.before             = AnalyzeVertexCache(mesh.indices, stats.numVerticesBefore);
+
+    if (settings.weld)
+    {
+        Weld(mesh);
+    }
+
+    OptimizeVertexCache(mesh.indices, GetNumVertices(mesh));
+
+    if (settings.optimizeOverdraw)
+    {
+        OptimizeOverdraw(mesh.indices, mesh, settings.overdrawThreshold);
+    }
+
+    OptimizeVertexFetch(mesh);
+
+    stats.numVerticesAfter  = GetNumVertices(mesh);
+    stats.numTrianglesAfter = uint32_t(mesh.indices.size() / 3);
+    stats.after             = AnalyzeVertexCache(mesh.indices, stats.numVerticesAfter);
+
+    return stats;
+}
+
+void MeshOptimizer::Weld(MeshData &mesh)
+{
+    const uint32_t numVertices = GetNumVertices(mesh);
+    const bool hasStatic       = !mesh.vertices.empty();
+    const bool hasSkinned      = !mesh.skinnedVertices.empty();
+
+    // Open addressing table of vertex indices, keyed by the bytes of both streams.
+    uint32_t tableSize = 1;
+    while (tableSize < numVertices * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<uint32_t> table(tableSize, ~0u);
+
+    auto hashVertex = [&](uint32_t i) {
+        uint64_t hash = 14695981039346656037ull;
+        if (hasStatic)
+            hash = HashBytes(&mesh.vertices[i], sizeof(Vertex), hash);
+        if (hasSkinned)
+            hash = HashBytes(&mesh.skinnedVertices[i], sizeof(SkinnedVertex), hash);
+        return hash;
+    };
+    auto equalVertex = [&](uint32_t a, uint32_t b) {
+        if (hasStatic && memcmp(&mesh.vertices[a], &mesh.vertices[b], sizeof(Vertex)) != 0)
+            return false;
+        if (hasSkinned && memcmp(&mesh.skinnedVertices[a], &mesh.skinnedVertices[b], sizeof(SkinnedVertex)) != 0)
+            return false;
+        return true;
+    };
+
+    std::vector<uint32_t> remap(numVertices, ~0u);
+    uint32_t numUnique = 0;
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        uint32_t slot = uint32_t(hashVertex(i)) & (tableSize - 1);
+        while (table[slot] != ~0u && !equalVertex(table[slot], i))
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] == ~0u)
+        {
+            table[slot] = i;
+            remap[i]    = numUnique++;
+        }
+        else
+        {
+            remap[i] = remap[table[slot]];
+        }
+    }
+
+    // Welding can turn thin triangles into degenerate ones, they draw nothing.
+    std::vector<uint32_t> indices;
+    indices.reserve(mesh.indices.size());
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const uint32_t a = remap[mesh.indices[i]];
+        const uint32_t b = remap[mesh.indices[i + 1]];
+        const uint32_t c = remap[mesh.indices[i + 2]];
+        if (a != b && b != c && c != a)
+        {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    }
+    mesh.indices.swap(indices);
+
+    // Copies are bitwise equal, whichever lands last in the slot is fine.
+    RemapVertices(mesh.vertices, remap, numUnique);
+    RemapVertices(mesh.skinnedVertices, remap, numUnique);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t numVertices)
+{
+    static const ScoreTable s_scores;
+
+    const uint32_t numTriangles = uint32_t(indices.size() / 3);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Triangles around every vertex. The first numLive[v] entries of vertex v are the ones not emitted yet.
+    std::vector<uint32_t> offsets(numVertices + 1, 0);
+    for (uint32_t index : indices)
+    {
+        offsets[index + 1]++;
+    }
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+
+    std::vector<uint32_t> numLive(numVertices, 0);
+    std::vector<uint32_t> adjacency(indices.size());
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v                     = indices[t * 3 + k];
+            adjacency[offsets[v] + numLive[v]++] = t;
+        }
+    }
+
+    std::vector<int32_t> cachePos(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (uint32_t v = 0; v < numVertices; v++)
+    {
+        vertexScore[v] = s_scores.Get(-1, numLive[v]);
+    }
+
+    std::vector<float> triangleScore(numTriangles);
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        triangleScore[t] =
+            vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+
+    std::vector<uint8_t> emitted(numTriangles, 0);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(sm_cacheSize + 3);
+    newCache.reserve(sm_cacheSize + 3);
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t best   = uint32_t(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+    uint32_t cursor = 0;
+
+    for (uint32_t n = 0; n < numTriangles; n++)
+    {
+        if (best == ~0u)
+        {
+            // Nothing in the cache touches a live triangle, go on with the first one left.
+            while (emitted[cursor])
+            {
+                cursor++;
+            }
+            best = cursor;
+        }
+
+        const uint32_t tri[3] = {indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]};
+        result.insert(result.end(), tri, tri + 3);
+        emitted[best] = 1;
+
+        newCache.clear();
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = tri[k];
+
+            uint32_t *live = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < numLive[v]; i++)
+            {
+                if (live[i] == best)
+                {
+                    std::swap(live[i], live[numLive[v] - 1]);
+                    numLive[v]--;
+                    break;
+                }
+            }
+
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // The triangle goes to the front of the cache, the rest moves back.
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+
+        // Rescore what moved and push the difference to the live triangles around it.
+        for (uint32_t i = 0; i < uint32_t(newCache.size()); i++)
+        {
+            const uint32_t v = newCache[i];
+            cachePos[v]      = i < sm_cacheSize ? int32_t(i) : -1;
+
+            const float score = s_scores.Get(cachePos[v], numLive[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v]    = score;
+
+            for (uint32_t j = 0; j < numLive[v]; j++)
+            {
+                triangleScore[adjacency[offsets[v] + j]] += delta;
+            }
+        }
+
+        if (newCache.size() > sm_cacheSize)
+        {
+            newCache.resize(sm_cacheSize);
+        }
+        cache.swap(newCache);
+
+        // Next triangle is the best one around the cache.
+        best            = ~0u;
+        float bestScore = -1.0f;
+        for (uint32_t v : cache)
+        {
+            for (uint32_t j = 0; j < numLive[v]; j++)
+            {
+                const uint32_t t = adjacency[offsets[v] + j];
+                if (triangleScore[t] > bestScore)
+                {
+                    best      = t;
+                    bestScore = triangleScore[t];
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t> &indices, const MeshData &mesh, float threshold)
+{
+    const uint32_t numTriangles = uint32_t(indices.size() / 3);
+    const uint32_t numVertices  = GetNumVertices(mesh);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Split the cache ordered triangles into clusters (Sander et al., Tipsify). A cluster ends where the
+    // order jumps (a triangle that misses all its vertices) or, softly, once it is long enough that
+    // restarting the cache keeps its ACMR under threshold times the mesh ACMR.
+    const float maxAcmr = AnalyzeVertexCache(indices, numVertices).acmr * threshold;
+
+    std::vector<uint32_t> clusters; // first triangle of every cluster
+    std::vector<uint32_t> timestamp(numVertices, 0);
+    uint32_t time          = sm_fifoSize + 1;
+    uint32_t clusterMisses = 0;
+    uint32_t clusterSize   = 0;
+
+    for (uint32_t t = 0; t < numTriangles; t++)
+    {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            misses += time - timestamp[indices[t * 3 + k]] > sm_fifoSize;
+        }
+
+        const bool hardBoundary = misses == 3;
+        const bool softBoundary = clusterSize > 0 && float(clusterMisses) <= maxAcmr * clusterSize;
+        if (clusterSize == 0 || hardBoundary || softBoundary)
+        {
+            clusters.push_back(t);
+            clusterMisses = 0;
+            clusterSize   = 0;
+            // Clusters get reordered, so every cluster starts with a cold cache.
+            time += sm_fifoSize + 1;
+        }
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = indices[t * 3 + k];
+            if (time - timestamp[v] > sm_fifoSize)
+            {
+                timestamp[v] = time++;
+                clusterMisses++;
+            }
+        }
+        clusterSize++;
+    }
+    clusters.push_back(numTriangles);
+
+    // Clusters that face away from the center are more likely to be in front, draw them first.
+    const uint32_t numClusters = uint32_t(clusters.size() - 1);
+    std::vector<Vector3> centroids(numClusters);
+    std::vector<Vector3> normals(numClusters);
+
+    Vector3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (uint32_t c = 0; c < numClusters; c++)
+    {
+        Vector3 centroid(0.0f);
+        Vector3 normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            const Vector3 p0 = GetPosition(mesh, indices[t * 3]);
+            const Vector3 p1 = GetPosition(mesh, indices[t * 3 + 1]);
+            const Vector3 p2 = GetPosition(mesh, indices[t * 3 + 2]);
+
+            const Vector3 n = (p1 - p0).Cross(p2 - p0);
+            const float a   = n.Length();
+
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+
+        centroids[c] = area > 0.0f ? centroid / area : Vector3(0.0f);
+        normals[c]   = normal;
+        normals[c].Normalize();
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : Vector3(0.0f);
+
+    std::vector<float> sortKeys(numClusters);
+    std::vector<uint32_t> order(numClusters);
+    for (uint32_t c = 0; c < numClusters; c++)
+    {
+        sortKeys[c] = (centroids[c] - meshCentroid).Dot(normals[c]);
+        order[c]    = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+    {
+        result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData &mesh)
+{
+    // Vertices in the order the index buffer first uses them. Unused vertices are dropped.
+    std::vector<uint32_t> remap(GetNumVertices(mesh), ~0u);
+    uint32_t numUsed = 0;
+    for (auto &index : mesh.indices)
+    {
+        if (remap[index] == ~0u)
+        {
+            remap[index] = numUsed++;
+        }
+        index = remap[index];
+    }
+
+    RemapVertices(mesh.vertices, remap, numUsed);
+    RemapVertices(mesh.skinnedVertices, remap, numUsed);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t numVertices,
+                                                   uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty() || numVertices == 0)
+    {
+        return stats;
+    }
+
+    // A vertex is in the FIFO if it was inserted less than cacheSize insertions ago.
+    std::vector<uint32_t> timestamp(numVertices, 0);
+    uint32_t time   = cacheSize + 1;
+    uint32_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        if (time - timestamp[index] > cacheSize)
+        {
+            timestamp[index] = time++;
+            misses++;
+        }
+    }
+
+    stats.acmr = float(misses) / float(indices.size() / 3);
+    stats.atvr = float(misses) / float(numVertices);
+    return stats;
+}
+
+void MeshOptimizer::Report(const std::string &name, const MeshOptimizeStats &stats)
+{
+    std::cout << name << " : vertices " << stats.numVerticesBefore << " -> " << stats.numVerticesAfter
+              << ", triangles " << stats.numTrianglesBefore << " -> " << stats.numTrianglesAfter << ", ACMR "
+              << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR " << stats.before.atvr << " -> "
+              << stats.after.atvr << std::endl;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MeshData.h"
+
+struct MeshOptimizeSettings
+{
+    bool weld               = true;  // merge bitwise identical vertices, drops degenerate triangles
+    bool optimizeOverdraw   = false; // sort triangle clusters front to back from the outside
+    float overdrawThreshold = 1.05f; // ACMR the overdraw pass may give up, relative to the cache optimized one
+};
+
+// Post transform cache statistics of an index buffer, simulated with a FIFO cache.
+struct VertexCacheStats
+{
+    float acmr = 0.0f; // cache misses per triangle, 0.5 is the ideal for a regular grid, 3 the worst
+    float atvr = 0.0f; // cache misses per vertex, 1 is the ideal
+};
+
+struct MeshOptimizeStats
+{
+    uint32_t numVerticesBefore  = 0;
+    uint32_t numVerticesAfter   = 0;
+    uint32_t numTrianglesBefore = 0;
+    uint32_t numTrianglesAfter  = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Reorders MeshData for the GPU before upload: weld, vertex cache order (Forsyth), optional overdraw order,
+// then vertex fetch order. vertices and skinnedVertices are kept in step. The rendered result is the same,
+// only duplicate vertices and degenerate triangles are removed.
+class MeshOptimizer
+{
+  public:
+    static MeshOptimizeStats Optimize(MeshData &mesh, const MeshOptimizeSettings &settings = {});
+
+    // Steps of Optimize, usable on their own.
+    static void Weld(MeshData &mesh);
+    static void OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t numVertices);
+    static void OptimizeOverdraw(std::vector<uint32_t> &indices, const MeshData &mesh, float threshold);
+    static void OptimizeVertexFetch(MeshData &mesh);
+
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices, uint32_t numVertices,
+                                               uint32_t cacheSize = sm_fifoSize);
+
+    static void Report(const std::string &name, const MeshOptimizeStats &stats);
+
+  public:
+    static const uint32_t sm_cacheSize = 32; // LRU cache modelled by the Forsyth scoring
+    static const uint32_t sm_fifoSize  = 16; // FIFO cache used for the statistics
+};
@@ -0,0 +1,497 @@
+#include "pch.h"
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+// A level removing less than this isn't worth its indices.
+const float s_minReduction = 0.85f;
+// A collapse may turn a surrounding triangle by at most ~78 degrees.
+const float s_minNormalDot = 0.2f;
+
+// Sum of the squared distances to a set of planes, each weighted by the area of its triangle.
+struct Quadric
+{
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+    double w  = 0.0;
+
+    void AddPlane(const Vector3 &n, float d, float weight)
+    {
+        a2 += weight * n.x * n.x;
+        ab += weight * n.x * n.y;
+        ac += weight * n.x * n.z;
+        ad += weight * n.x * d;
+        b2 += weight * n.y * n.y;
+        bc += weight * n.y * n.z;
+        bd += weight * n.y * d;
+        c2 += weight * n.z * n.z;
+        cd += weight * n.z * d;
+        d2 += weight * d * d;
+        w += weight;
+    }
+
+    void Add(const Quadric &q)
+    {
+        a2 += q.a2;
+        ab += q.ab;
+        ac += q.ac;
+        ad += q.ad;
+        b2 += q.b2;
+        bc += q.bc;
+        bd += q.bd;
+        c2 += q.c2;
+        cd += q.cd;
+        d2 += q.d2;
+        w += q.w;
+    }
+
+    // Mean squared distance of p to the planes.
+    double Error(const Vector3 &p) const
+    {
+        if (w <= 0.0)
+        {
+            return 0.0;
+        }
+
+        const double x = p.x, y = p.y, z = p.z;
+        const double e = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+                         2.0 * (ad * x + bd * y + cd * z) + d2;
+        return std::fabs(e) / w;
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    uint32_t source;
+    uint32_t target;
+};
+
+uint32_t GetNumVertices(const MeshData &mesh)
+{
+    return uint32_t(XMMax(mesh.vertices.size(), mesh.skinnedVertices.size()));
+}
+
+Vector3 GetPosition(const MeshData &mesh, uint32_t i)
+{
+    return mesh.vertices.empty() ? mesh.skinnedVertices[i].position : mesh.vertices[i].position;
+}
+
+// Share of the bone weight two skinned vertices don't have in common, 0 same influences, 1 disjoint.
+float WeightDistance(const SkinnedVertex &a, const SkinnedVertex &b)
+{
+    auto weightOf = [](const SkinnedVertex &v, uint8_t bone) {
+        uint32_t weight = 0;
+        for (uint32_t i = 0; i < SkinnedVertex::sm_maxInfluences; i++)
+        {
+            weight += v.boneIndices[i] == bone ? v.boneWeights[i] : 0;
+        }
+        return int32_t(weight);
+    };
+
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < SkinnedVertex::sm_maxInfluences; i++)
+    {
+        if (a.boneWeights[i] > 0)
+            sum += std::abs(int32_t(a.boneWeights[i]) - weightOf(b, a.boneIndices[i]));
+        if (b.boneWeights[i] > 0 && weightOf(a, b.boneIndices[i]) == 0)
+            sum += b.boneWeights[i];
+    }
+    return float(sum) / (2.0f * 255.0f);
+}
+
+// Vertex -> first vertex with a bitwise equal position. Split vertices (UV seams, hard edges) share an id,
+// topology is looked at through these ids.
+std::vector<uint32_t> BuildPositionIds(const std::vector<Vector3> &positions)
+{
+    const uint32_t numVertices = uint32_t(positions.size());
+    uint32_t tableSize         = 1;
+    while (tableSize < numVertices * 2)
+    {
+        tableSize *= 2;
+    }
+    std::vector<uint32_t> table(tableSize, ~0u);
+
+    std::vector<uint32_t> ids(numVertices);
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        uint32_t hash        = 2166136261u;
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&positions[i]);
+        for (size_t k = 0; k < sizeof(Vector3); k++)
+        {
+            hash = (hash ^ bytes[k]) * 16777619u;
+        }
+
+        uint32_t slot = hash & (tableSize - 1);
+        while (table[slot] != ~0u && memcmp(&positions[table[slot]], &positions[i], sizeof(Vector3)) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] == ~0u)
+        {
+            table[slot] = i;
+        }
+        ids[i] = table[slot];
+    }
+    return ids;
+}
+
+// Positions that must not move : split vertices (seams) and the ends of border or non-manifold edges.
+std::vector<uint8_t> FindLocked(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &positionIds)
+{
+    std::vector<uint8_t> locked(positionIds.size(), 0);
+
+    std::vector<uint32_t> firstVertex(positionIds.size(), ~0u);
+    for (uint32_t v : indices)
+    {
+        const uint32_t p = positionIds[v];
+        if (firstVertex[p] == ~0u)
+            firstVertex[p] = v;
+        else if (firstVertex[p] != v)
+            locked[p] = 1;
+    }
+
+    // Directed edges between positions. A manifold edge appears once each way.
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint64_t a = positionIds[indices[i + k]];
+            const uint64_t b = positionIds[indices[i + (k + 1) % 3]];
+            edges.push_back(a << 32 | b);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        const uint64_t reverse = edges[i] << 32 | edges[i] >> 32;
+        const auto range       = std::equal_range(edges.begin(), edges.end(), reverse);
+        const bool isRepeated  = (i > 0 && edges[i - 1] == edges[i]) ||
+                                (i + 1 < edges.size() && edges[i + 1] == edges[i]);
+        if (range.first == range.second || range.second - range.first > 1 || isRepeated)
+        {
+            locked[uint32_t(edges[i] >> 32)] = 1;
+            locked[uint32_t(edges[i])]       = 1;
+        }
+    }
+    return locked;
+}
+
+// Triangles around every position id, compressed rows.
+void BuildAdjacency(const std::vector<uint32_t> &indices, const std::vector<uint32_t> &positionIds,
+                    std::vector<uint32_t> &offsets, std::vector<uint32_t> &triangles)
+{
+    offsets.assign(positionIds.size() + 1, 0);
+    for (uint32_t v : indices)
+    {
+        offsets[positionIds[v] + 1]++;
+    }
+    for (size_t i = 0; i < positionIds.size(); i++)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+
+    triangles.resize(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        triangles[fill[positionIds[indices[i]]]++] = uint32_t(i / 3);
+    }
+}
+} // namespace
+
+void MeshSimplifier::BuildLods(MeshData &mesh, const MeshLodSettings &settings)
+{
+    mesh.lods.clear();
+
+    const uint32_t numVertices = GetNumVertices(mesh);
+    if (mesh.indices.empty() || settings.maxLods < 2)
+    {
+        return;
+    }
+
+    // Errors are relative to the radius around the center of the bounds.
+    Vector3 minP(FLT_MAX), maxP(-FLT_MAX);
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        minP = Vector3::Min(minP, GetPosition(mesh, i));
+        maxP = Vector3::Max(maxP, GetPosition(mesh, i));
+    }
+    const Vector3 center = (minP + maxP) * 0.5f;
+    float radius         = 0.0f;
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        radius = XMMax(radius, (GetPosition(mesh, i) - center).Length());
+    }
+    if (radius <= 0.0f)
+    {
+        return;
+    }
+
+    std::vector<MeshLod> lods = {{0, uint32_t(mesh.indices.size()), 0.0f}};
+    std::vector<uint32_t> previous = mesh.indices;
+    while (lods.size() < settings.maxLods)
+    {
+        // Each level starts from the previous one, its error adds up.
+        const size_t target = size_t(float(previous.size() / 3) * settings.reduction) * 3;
+        float error         = 0.0f;
+        std::vector<uint32_t> indices =
+            Simplify(mesh, previous, target, settings.maxError, radius, settings.maxWeightDistance, &error);
+        if (indices.empty() || float(indices.size()) > float(previous.size()) * s_minReduction)
+        {
+            break;
+        }
+
+        MeshOptimizer::OptimizeVertexCache(indices, numVertices);
+        lods.push_back({uint32_t(mesh.indices.size()), uint32_t(indices.size()), lods.back().error + error});
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+        previous.swap(indices);
+    }
+
+    if (lods.size() > 1)
+    {
+        mesh.lods = std::move(lods);
+    }
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const MeshData &mesh, const std::vector<uint32_t> &input,
+                                               size_t targetIndexCount, float maxError, float radius,
+                                               float maxWeightDistance, float *error)
+{
+    const uint32_t numVertices = GetNumVertices(mesh);
+    const bool isSkinned       = !mesh.skinnedVertices.empty();
+
+    std::vector<Vector3> positions(numVertices);
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        positions[i] = GetPosition(mesh, i);
+    }
+    const std::vector<uint32_t> positionIds = BuildPositionIds(positions);
+    const std::vector<uint8_t> locked       = FindLocked(input, positionIds);
+    auto pid                                = [&](uint32_t v) { return positionIds[v]; };
+
+    // Quadrics live on position ids, split vertices are one point of the surface.
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i < input.size(); i += 3)
+    {
+        const Vector3 &p0 = positions[input[i]];
+        const Vector3 &p1 = positions[input[i + 1]];
+        const Vector3 &p2 = positions[input[i + 2]];
+
+        Vector3 n          = (p1 - p0).Cross(p2 - p0);
+        const float length = n.Length();
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+        n /= length;
+
+        Quadric q;
+        q.AddPlane(n, -n.Dot(p0), length * 0.5f);
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            quadrics[pid(input[i + k])].Add(q);
+        }
+    }
+
+    const double maxErrorSq = double(maxError * radius) * double(maxError * radius);
+    double resultErrorSq    = 0.0;
+
+    std::vector<uint32_t> indices = input;
+    std::vector<uint32_t> adjOffsets, adjTriangles;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(numVertices);
+    std::vector<uint8_t> touched(numVertices);
+    std::vector<uint32_t> ring;
+
+    auto cost = [&](uint32_t source, uint32_t target) {
+        Quadric q = quadrics[pid(source)];
+        q.Add(quadrics[pid(target)]);
+        return q.Error(positions[target]);
+    };
+
+    // Moving source onto target must keep the surface a manifold (link condition) and not fold any triangle.
+    auto canCollapse = [&](uint32_t source, uint32_t target) {
+        const uint32_t ps = pid(source);
+        const uint32_t pt = pid(target);
+
+        ring.clear();
+        uint32_t numShared = 0;
+        for (uint32_t i = adjOffsets[ps]; i < adjOffsets[ps + 1]; i++)
+        {
+            const uint32_t *tri  = &indices[adjTriangles[i] * 3];
+            const bool hasTarget = pid(tri[0]) == pt || pid(tri[1]) == pt || pid(tri[2]) == pt;
+            numShared += hasTarget;
+
+            Vector3 before[3], after[3];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (pid(tri[k]) != ps)
+                {
+                    ring.push_back(pid(tri[k]));
+                }
+                before[k] = positions[tri[k]];
+                after[k]  = pid(tri[k]) == ps ? positions[target] : before[k];
+            }
+            if (hasTarget)
+            {
+                continue;
+            }
+
+            const Vector3 n0 = (before[1] - before[0]).Cross(before[2] - before[0]);
+            const Vector3 n1 = (after[1] - after[0]).Cross(after[2] - after[0]);
+            if (n0.Dot(n1) < s_minNormalDot * n0.Length() * n1.Length() || n1.LengthSquared() <= 0.0f)
+            {
+                return false;
+            }
+        }
+
+        // Neighbours of both ends may only be the far corners of the triangles on the edge.
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+        uint32_t numCommon = 0;
+        for (uint32_t i = adjOffsets[pt]; i < adjOffsets[pt + 1]; i++)
+        {
+            const uint32_t *tri = &indices[adjTriangles[i] * 3];
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t p = pid(tri[k]);
+                auto it          = std::lower_bound(ring.begin(), ring.end(), p);
+                if (p != pt && p != ps && it != ring.end() && *it == p)
+                {
+                    numCommon++;
+                    ring.erase(it);
+                }
+            }
+        }
+        return numCommon == numShared;
+    };
+
+    while (indices.size() > targetIndexCount)
+    {
+        BuildAdjacency(indices, positionIds, adjOffsets, adjTriangles);
+
+        // Every edge once (a manifold edge is in two triangles, once each way), in its cheaper direction.
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t a = indices[i + k];
+                const uint32_t b = indices[i + (k + 1) % 3];
+                if (pid(a) >= pid(b))
+                {
+                    continue;
+                }
+                const bool isWeightMatch =
+                    !isSkinned || WeightDistance(mesh.skinnedVertices[a], mesh.skinnedVertices[b]) <= maxWeightDistance;
+                if (!isWeightMatch)
+                {
+                    continue;
+                }
+
+                const double costAB = locked[pid(a)] ? DBL_MAX : cost(a, b);
+                const double costBA = locked[pid(b)] ? DBL_MAX : cost(b, a);
+                if (costAB == DBL_MAX && costBA == DBL_MAX)
+                {
+                    continue;
+                }
+                collapses.push_back(costAB <= costBA ? Collapse{costAB, a, b} : Collapse{costBA, b, a});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        // Collapses of one pass don't share a triangle, so each is checked against positions that stay put.
+        for (uint32_t i = 0; i < numVertices; i++)
+        {
+            remap[i] = i;
+        }
+        std::fill(touched.begin(), touched.end(), uint8_t(0));
+
+        const size_t numToRemove = (indices.size() - targetIndexCount) / 3;
+        size_t numRemoved        = 0;
+        for (const Collapse &c : collapses)
+        {
+            if (c.cost > maxErrorSq || numRemoved >= numToRemove)
+            {
+                break;
+            }
+
+            const uint32_t ps = pid(c.source);
+            const uint32_t pt = pid(c.target);
+            if (touched[ps] || touched[pt] || !canCollapse(c.source, c.target))
+            {
+                continue;
+            }
+
+            for (uint32_t i = adjOffsets[ps]; i < adjOffsets[ps + 1]; i++)
+            {
+                const uint32_t *tri = &indices[adjTriangles[i] * 3];
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    touched[pid(tri[k])] = 1;
+                }
+            }
+
+            // The source isn't split (not locked), it is the only vertex at its position.
+            remap[c.source] = c.target;
+            quadrics[pt].Add(quadrics[ps]);
+            resultErrorSq = XMMax(resultErrorSq, c.cost);
+            numRemoved += 2; // an interior edge takes its two triangles with it
+        }
+
+        if (numRemoved == 0)
+        {
+            break;
+        }
+
+        size_t numIndices = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const uint32_t a = remap[indices[i]];
+            const uint32_t b = remap[indices[i + 1]];
+            const uint32_t c = remap[indices[i + 2]];
+            if (pid(a) != pid(b) && pid(b) != pid(c) && pid(c) != pid(a))
+            {
+                indices[numIndices++] = a;
+                indices[numIndices++] = b;
+                indices[numIndices++] = c;
+            }
+        }
+        indices.resize(numIndices);
+    }
+
+    if (error)
+    {
+        *error = float(std::sqrt(resultErrorSq)) / radius;
+    }
+    return indices;
+}
+
+void MeshSimplifier::Report(const std::string &name, const MeshData &mesh)
+{
+    std::cout << name << " : ";
+    if (mesh.lods.empty())
+    {
+        std::cout << "no LODs" << std::endl;
+        return;
+    }
+
+    for (size_t i = 0; i < mesh.lods.size(); i++)
+    {
+        std::cout << (i ? ", " : "LOD triangles ") << mesh.lods[i].indexCount / 3 << " (" << mesh.lods[i].error
+                  << ")";
+    }
+    std::cout << std::endl;
+}
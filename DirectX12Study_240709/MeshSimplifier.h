@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Mesh.h"
+
+struct MeshLodSettings
+{
+    uint32_t maxLods        = 4;     // LOD 0 included
+    float reduction         = 0.5f;  // triangles kept from one level to the next
+    float maxError          = 0.05f; // per level, relative to the mesh radius
+    float maxWeightDistance = 0.25f; // skinned vertices only collapse onto bone weights this close (0 to 1)
+};
+
+// Quadric error edge collapse (Garland and Heckbert) onto existing vertices, so coarser levels are only index
+// buffers over the same vertices. Vertices on UV seams, open borders and non-manifold edges never move, and a
+// skinned vertex only collapses onto a vertex with similar bone weights.
+class MeshSimplifier
+{
+  public:
+    // Appends the coarser levels to mesh.indices and fills mesh.lods. Stops early when a level can't be reduced
+    // within maxError, so a mesh can end up with fewer levels or none.
+    static void BuildLods(MeshData &mesh, const MeshLodSettings &settings = {});
+
+    // Simplifies the triangle list indices (over the vertices of mesh) down to targetIndexCount or as close as
+    // maxError (relative to radius) allows. error : largest error of a collapse, relative to radius.
+    static std::vector<uint32_t> Simplify(const MeshData &mesh, const std::vector<uint32_t> &indices,
+                                          size_t targetIndexCount, float maxError, float radius,
+                                          float maxWeightDistance, float *error = nullptr);
+
+    static void Report(const std::string &name, const MeshData &mesh);
+};
@@ -0,0 +1,424 @@
+#include "MeshletBuilder.h"
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+struct Float3
+{
+    float x, y, z;
+
+    Float3 operator+(const Float3 &o) const
+    {
+        return {x + o.x, y + o.y, z + o.z};
+    }
+
+    Float3 operator-(const Float3 &o) const
+    {
+        return {x - o.x, y - o.y, z - o.z};
+    }
+
+    Float3 operator*(float s) const
+    {
+        return {x * s, y * s, z * s};
+    }
+};
+
+float Dot(const Float3 &a, const Float3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Float3 Cross(const Float3 &a, const Float3 &b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+float Length(const Float3 &a)
+{
+    return std::sqrt(Dot(a, a));
+}
+
+// Below this the normal cone is wider than ~84 degrees and could never cull anything.
+const float s_minConeDot = 0.1f;
+
+class MeshletWriter
+{
+  public:
+    MeshletWriter(const std::vector<uint32_t> &indices, const float *positions, size_t numVertices, size_t stride,
+                  const MeshletSettings &settings)
+        : m_indices(indices), m_settings(settings)
+    {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(positions);
+        m_positions.resize(numVertices);
+        for (size_t i = 0; i < numVertices; i++)
+        {
+            const float *p = reinterpret_cast<const float *>(bytes + i * stride);
+            m_positions[i] = {p[0], p[1], p[2]};
+        }
+
+        const size_t numTriangles = indices.size() / 3;
+        m_centroids.resize(numTriangles);
+        m_normals.resize(numTriangles);
+        for (size_t t = 0; t < numTriangles; t++)
+        {
+            const Float3 &p0 = m_positions[indices[t * 3 + 0]];
+            const Float3 &p1 = m_positions[indices[t * 3 + 1]];
+            const Float3 &p2 = m_positions[indices[t * 3 + 2]];
+
+            // Clockwise front faces, the cross product points out of the surface.
+            const Float3 n     = Cross(p1 - p0, p2 - p0);
+            const float length = Length(n);
+            m_centroids[t]     = (p0 + p1 + p2) * (1.0f / 3.0f);
+            m_normals[t]       = length > 0.0f ? n * (1.0f / length) : Float3{0.0f, 0.0f, 0.0f};
+        }
+
+        // Vertex -> triangle adjacency, compressed rows.
+        m_adjacencyOffsets.assign(numVertices + 1, 0);
+        for (uint32_t i : indices)
+        {
+            m_adjacencyOffsets[i + 1]++;
+        }
+        for (size_t i = 0; i < numVertices; i++)
+        {
+            m_adjacencyOffsets[i + 1] += m_adjacencyOffsets[i];
+        }
+        m_adjacency.resize(indices.size());
+        std::vector<uint32_t> fill(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            m_adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+
+        m_emitted.assign(numTriangles, false);
+        m_localVertex.assign(numVertices, ~0u);
+    }
+
+    MeshletData Build()
+    {
+        const uint32_t numTriangles = uint32_t(m_centroids.size());
+        uint32_t cursor             = 0;
+
+        for (uint32_t numEmitted = 0; numEmitted < numTriangles;)
+        {
+            while (m_emitted[cursor])
+            {
+                cursor++;
+            }
+
+            Add(cursor);
+            numEmitted++;
+            while (m_triangles.size() < m_settings.maxTriangles)
+            {
+                const uint32_t next = FindNext(cursor);
+                if (next == ~0u)
+                {
+                    break;
+                }
+                Add(next);
+                numEmitted++;
+            }
+            Flush();
+        }
+
+        return std::move(m_data);
+    }
+
+  private:
+    uint32_t CountNewVertices(uint32_t triangle) const
+    {
+        uint32_t count = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            count += m_localVertex[m_indices[triangle * 3 + k]] == ~0u;
+        }
+        return count;
+    }
+
+    // Fewest new vertices first, then closest to the meshlet. Connected triangles are tried first, the next few
+    // in index order are the fallback so a meshlet doesn't end early on a seam or an unwelded mesh.
+    uint32_t FindNext(uint32_t cursor)
+    {
+        const uint32_t numVertices = uint32_t(m_vertices.size());
+        const Float3 center        = m_centroidSum * (1.0f / float(m_triangles.size()));
+
+        uint32_t best      = ~0u;
+        uint32_t bestNew   = 4;
+        float bestDistance = FLT_MAX;
+        auto consider      = [&](uint32_t t) {
+            const uint32_t numNew = CountNewVertices(t);
+            if (numVertices + numNew > m_settings.maxVertices || numNew > bestNew)
+            {
+                return;
+            }
+
+            const Float3 d       = m_centroids[t] - center;
+            const float distance = Dot(d, d);
+            if (numNew < bestNew || distance < bestDistance)
+            {
+                best         = t;
+                bestNew      = numNew;
+                bestDistance = distance;
+            }
+        };
+
+        // Drop emitted candidates while scanning, the list only holds the border of the meshlet.
+        size_t numLive = 0;
+        for (size_t i = 0; i < m_candidates.size(); i++)
+        {
+            const uint32_t t = m_candidates[i];
+            if (!m_emitted[t])
+            {
+                m_candidates[numLive++] = t;
+                consider(t);
+            }
+        }
+        m_candidates.resize(numLive);
+
+        if (best == ~0u)
+        {
+            const uint32_t numTriangles = uint32_t(m_emitted.size());
+            for (uint32_t t = cursor, numTried = 0; t < numTriangles && numTried < s_fallbackWindow; t++)
+            {
+                if (!m_emitted[t])
+                {
+                    consider(t);
+                    numTried++;
+                }
+            }
+        }
+        return best;
+    }
+
+    void Add(uint32_t triangle)
+    {
+        m_emitted[triangle] = true;
+        m_triangles.push_back(triangle);
+        m_centroidSum = m_centroidSum + m_centroids[triangle];
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = m_indices[triangle * 3 + k];
+            if (m_localVertex[v] != ~0u)
+            {
+                continue;
+            }
+
+            m_localVertex[v] = uint32_t(m_vertices.size());
+            m_vertices.push_back(v);
+            for (uint32_t i = m_adjacencyOffsets[v]; i < m_adjacencyOffsets[v + 1]; i++)
+            {
+                if (!m_emitted[m_adjacency[i]])
+                {
+                    m_candidates.push_back(m_adjacency[i]);
+                }
+            }
+        }
+    }
+
+    void Flush()
+    {
+        Meshlet meshlet;
+        meshlet.vertexOffset   = uint32_t(m_data.vertices.size());
+        meshlet.triangleOffset = uint32_t(m_data.triangles.size());
+        meshlet.vertexCount    = uint32_t(m_vertices.size());
+        meshlet.triangleCount  = uint32_t(m_triangles.size());
+
+        m_data.vertices.insert(m_data.vertices.end(), m_vertices.begin(), m_vertices.end());
+        for (uint32_t t : m_triangles)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                m_data.triangles.push_back(uint8_t(m_localVertex[m_indices[t * 3 + k]]));
+            }
+        }
+
+        m_data.meshlets.push_back(meshlet);
+        m_data.bounds.push_back(ComputeBounds());
+
+        for (uint32_t v : m_vertices)
+        {
+            m_localVertex[v] = ~0u;
+        }
+        m_vertices.clear();
+        m_triangles.clear();
+        m_candidates.clear();
+        m_centroidSum = {0.0f, 0.0f, 0.0f};
+    }
+
+    MeshletBounds ComputeBounds() const
+    {
+        Float3 minP = {FLT_MAX, FLT_MAX, FLT_MAX};
+        Float3 maxP = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        for (uint32_t v : m_vertices)
+        {
+            const Float3 &p = m_positions[v];
+            minP            = {std::fmin(minP.x, p.x), std::fmin(minP.y, p.y), std::fmin(minP.z, p.z)};
+            maxP            = {std::fmax(maxP.x, p.x), std::fmax(maxP.y, p.y), std::fmax(maxP.z, p.z)};
+        }
+
+        const Float3 center = (minP + maxP) * 0.5f;
+        float radius        = 0.0f;
+        for (uint32_t v : m_vertices)
+        {
+            radius = std::fmax(radius, Length(m_positions[v] - center));
+        }
+
+        Float3 axis = {0.0f, 0.0f, 0.0f};
+        for (uint32_t t : m_triangles)
+        {
+            axis = axis + m_normals[t];
+        }
+
+        MeshletBounds bounds;
+        bounds.center[0] = center.x;
+        bounds.center[1] = center.y;
+        bounds.center[2] = center.z;
+        bounds.radius    = radius;
+
+        const float axisLength = Length(axis);
+        if (axisLength <= 0.0f)
+        {
+            return bounds;
+        }
+        axis = axis * (1.0f / axisLength);
+
+        float minDot = 1.0f;
+        for (uint32_t t : m_triangles)
+        {
+            // Degenerate triangles have no facing, they can't keep the meshlet from being culled.
+            if (Dot(m_normals[t], m_normals[t]) > 0.0f)
+            {
+                minDot = std::fmin(minDot, Dot(axis, m_normals[t]));
+            }
+        }
+
+        bounds.coneAxis[0] = axis.x;
+        bounds.coneAxis[1] = axis.y;
+        bounds.coneAxis[2] = axis.z;
+        bounds.coneCutoff  = minDot < s_minConeDot ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+        return bounds;
+    }
+
+  private:
+    static const uint32_t s_fallbackWindow = 32;
+
+    const std::vector<uint32_t> &m_indices;
+    const MeshletSettings &m_settings;
+
+    std::vector<Float3> m_positions;
+    std::vector<Float3> m_centroids;
+    std::vector<Float3> m_normals;
+    std::vector<uint32_t> m_adjacencyOffsets;
+    std::vector<uint32_t> m_adjacency;
+    std::vector<bool> m_emitted;
+    std::vector<uint32_t> m_localVertex; // mesh vertex -> index in the open meshlet, ~0u when not in it
+
+    // Open meshlet.
+    std::vector<uint32_t> m_vertices;
+    std::vector<uint32_t> m_triangles;
+    std::vector<uint32_t> m_candidates;
+    Float3 m_centroidSum = {0.0f, 0.0f, 0.0f};
+
+    MeshletData m_data;
+};
+} // namespace
+
+MeshletData MeshletBuilder::Build(const std::vector<uint32_t> &indices, const float *positions, size_t numVertices,
+                                  size_t stride, const MeshletSettings &settings)
+{
+    assert(settings.maxVertices <= 256 && settings.maxTriangles > 0);
+
+    if (indices.size() < 3)
+    {
+        return {};
+    }
+    return MeshletWriter(indices, positions, numVertices, stride, settings).Build();
+}
+
+std::vector<uint32_t> MeshletBuilder::BuildIndices(const MeshletData &data)
+{
+    std::vector<uint32_t> indices;
+    indices.reserve(data.triangles.size());
+    for (const Meshlet &meshlet : data.meshlets)
+    {
+        for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++)
+        {
+            indices.push_back(data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset + i]]);
+        }
+    }
+    return indices;
+}
+
+bool MeshletBuilder::IsVisible(const MeshletBounds &bounds, const float planes[6][4], const float eye[3],
+                               bool cullBackfaces)
+{
+    const Float3 center = {bounds.center[0], bounds.center[1], bounds.center[2]};
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        if (Dot({planes[i][0], planes[i][1], planes[i][2]}, center) + planes[i][3] < -bounds.radius)
+        {
+            return false;
+        }
+    }
+
+    if (cullBackfaces && bounds.coneCutoff < 1.0f)
+    {
+        // Every triangle faces away when the eye sits inside the back cone, widened by the radius.
+        const Float3 toCenter = center - Float3{eye[0], eye[1], eye[2]};
+        const Float3 axis     = {bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2]};
+        if (Dot(toCenter, axis) >= bounds.coneCutoff * Length(toCenter) + bounds.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+ClusterCullStats MeshletBuilder::Cull(const MeshletData &data, const float planes[6][4], const float eye[3],
+                                      bool cullBackfaces, std::vector<MeshletRange> &visible)
+{
+    ClusterCullStats stats;
+    stats.numMeshlets = uint32_t(data.meshlets.size());
+
+    for (size_t i = 0; i < data.meshlets.size(); i++)
+    {
+        const Meshlet &meshlet = data.meshlets[i];
+        stats.numTriangles += meshlet.triangleCount;
+        if (!IsVisible(data.bounds[i], planes, eye, cullBackfaces))
+        {
+            continue;
+        }
+
+        stats.numVisibleMeshlets++;
+        stats.numVisibleTriangles += meshlet.triangleCount;
+
+        // Neighbouring meshlets are neighbours in the index buffer, merge them into one draw.
+        const uint32_t indexCount = meshlet.triangleCount * 3;
+        if (!visible.empty() && visible.back().firstIndex + visible.back().indexCount == meshlet.triangleOffset)
+        {
+            visible.back().indexCount += indexCount;
+        }
+        else
+        {
+            visible.push_back({meshlet.triangleOffset, indexCount});
+        }
+    }
+    return stats;
+}
+
+void MeshletBuilder::Report(const std::string &name, const MeshletData &data)
+{
+    size_t numCones = 0;
+    for (const MeshletBounds &bounds : data.bounds)
+    {
+        numCones += bounds.coneCutoff < 1.0f;
+    }
+
+    const float numMeshlets = data.meshlets.empty() ? 1.0f : float(data.meshlets.size());
+    std::cout << name << " : " << data.meshlets.size() << " meshlets, " << float(data.vertices.size()) / numMeshlets
+              << " vertices and " << float(data.triangles.size() / 3) / numMeshlets << " triangles on average, "
+              << numCones << " can be backface culled" << std::endl;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MeshletSettings
+{
+    uint32_t maxVertices  = 64;  // mesh shader friendly limits, a meshlet fits one 128 thread group
+    uint32_t maxTriangles = 124;
+};
+
+// A cluster of triangles. vertices[vertexOffset..] maps the local vertex numbers used by
+// triangles[triangleOffset..] (3 per triangle) to the mesh vertices.
+struct Meshlet
+{
+    uint32_t vertexOffset   = 0;
+    uint32_t triangleOffset = 0;
+    uint32_t vertexCount    = 0;
+    uint32_t triangleCount  = 0;
+};
+
+// Object space bounds for cluster culling. coneCutoff is the sine of the half angle of the normal cone,
+// 1 when the normals spread too far for the cone to ever cull.
+struct MeshletBounds
+{
+    float center[3]   = {0.0f, 0.0f, 0.0f};
+    float radius      = 0.0f;
+    float coneAxis[3] = {0.0f, 0.0f, 0.0f};
+    float coneCutoff  = 1.0f;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds;
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+};
+
+// Part of an index buffer written by MeshletBuilder::BuildIndices.
+struct MeshletRange
+{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+struct ClusterCullStats
+{
+    uint32_t numMeshlets         = 0;
+    uint32_t numVisibleMeshlets  = 0;
+    uint32_t numTriangles        = 0;
+    uint32_t numVisibleTriangles = 0;
+
+    float GetCulledRatio() const
+    {
+        return numTriangles ? 1.0f - float(numVisibleTriangles) / float(numTriangles) : 0.0f;
+    }
+
+    void Add(const ClusterCullStats &other)
+    {
+        numMeshlets += other.numMeshlets;
+        numVisibleMeshlets += other.numVisibleMeshlets;
+        numTriangles += other.numTriangles;
+        numVisibleTriangles += other.numVisibleTriangles;
+    }
+};
+
+// Splits a triangle list into meshlets and culls them against a frustum and by their normal cone.
+// Without mesh shaders the index buffer is rewritten in meshlet order, so any run of visible meshlets is one
+// DrawIndexedInstanced. Only standard C++, the culling runs on plain arrays.
+class MeshletBuilder
+{
+  public:
+    // positions are float3 read every stride bytes. Triangles are taken greedily, each next one is the candidate
+    // adding the fewest vertices and then the closest to the meshlet, so meshlets come out round and their
+    // bounds tight.
+    static MeshletData Build(const std::vector<uint32_t> &indices, const float *positions, size_t numVertices,
+                             size_t stride, const MeshletSettings &settings = {});
+
+    // Index buffer in meshlet order. Meshlet i covers indexCount 3 * triangleCount from firstIndex triangleOffset.
+    static std::vector<uint32_t> BuildIndices(const MeshletData &data);
+
+    // planes are (n, d) with n pointing inside, eye the camera position, both in the space of the bounds.
+    // Visible meshlets are appended as merged ranges. The cone test assumes clockwise front faces, only use it
+    // where back faces aren't seen (closed meshes, height fields).
+    static ClusterCullStats Cull(const MeshletData &data, const float planes[6][4], const float eye[3],
+                                 bool cullBackfaces, std::vector<MeshletRange> &visible);
+
+    static bool IsVisible(const MeshletBounds &bounds, const float planes[6][4], const float eye[3],
+                          bool cullBackfaces);
+
+    static void Report(const std::string &name, const MeshletData &data);
+};
@@ -0,0 +1,320 @@
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "Stopwatch.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace DirectX;
+
+namespace
+{
+// Source texel of a filtered texel.
+struct Tap
+{
+    uint32_t index;
+    float weight;
+};
+
+// numTaps taps per texel of the smaller axis, the short ones padded with zero weights.
+struct AxisFilter
+{
+    std::vector<Tap> taps;
+    uint32_t numTaps = 0;
+};
+
+// Returns the linear row of the level above, decoded into scratch if needed.
+using RowSource = std::function<const XMFLOAT4 *(uint32_t row, XMFLOAT4 *scratch)>;
+
+double BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Linear to 8 bit sRGB, rounded like the exact curve. The table gives the code at the start of a 1/4096 bucket and
+// the linear values halfway between codes finish it, a bucket spans less than 2 codes.
+class SRGBEncoder
+{
+  public:
+    SRGBEncoder()
+    {
+        for (uint32_t code = 0; code < 255; code++)
+            m_halfway[code] = ToLinear((float(code) + 0.5f) / 255.0f);
+
+        uint32_t code = 0;
+        for (uint32_t i = 0; i <= sm_numBuckets; i++)
+        {
+            const float c = float(i) / sm_numBuckets;
+            while (code < 255 && c >= m_halfway[code])
+                code++;
+            m_buckets[i] = uint8_t(code);
+        }
+    }
+
+    uint8_t Encode(float c) const
+    {
+        c             = XMMin(XMMax(c, 0.0f), 1.0f);
+        uint32_t code = m_buckets[uint32_t(c * sm_numBuckets)];
+        while (code < 255 && c >= m_halfway[code])
+            code++;
+        return uint8_t(code);
+    }
+
+    static float ToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+  private:
+    static const uint32_t sm_numBuckets = 4096;
+
+    float m_halfway[255];
+    uint8_t m_buckets[sm_numBuckets + 1];
+};
+
+float Sinc(float x)
+{
+    return std::abs(x) < 1e-6f ? 1.0f : std::sin(XM_PI * x) / (XM_PI * x);
+}
+
+AxisFilter BuildAxis(uint32_t srcSize, uint32_t dstSize, const MipSettings &settings)
+{
+    // In texels of the source, texel i covers [i, i + 1).
+    const bool isBox     = settings.filter == MIP_FILTER_BOX;
+    const float scale    = float(srcSize) / float(dstSize);
+    const float radius   = isBox ? 0.5f * scale : settings.kaiserWidth * scale;
+    const double i0Alpha = BesselI0(settings.kaiserAlpha);
+    const int32_t size   = int32_t(srcSize);
+
+    std::vector<std::vector<Tap>> texels(dstSize);
+    AxisFilter axis;
+    for (uint32_t d = 0; d < dstSize; d++)
+    {
+        const float center = (float(d) + 0.5f) * scale;
+        const int32_t first = int32_t(std::floor(center - radius));
+        const int32_t last  = int32_t(std::ceil(center + radius)) - 1;
+
+        float sum = 0.0f;
+        for (int32_t i = first; i <= last; i++)
+        {
+            float weight = 0.0f;
+            if (isBox)
+            {
+                weight = XMMin(float(i + 1), center + radius) - XMMax(float(i), center - radius);
+            }
+            else
+            {
+                // Sinc at the Nyquist rate of the smaller level, windowed over the radius.
+                const float t = float(i) + 0.5f - center;
+                const float x = t / radius;
+                if (std::abs(x) < 1.0f)
+                    weight = Sinc(t / scale) * float(BesselI0(settings.kaiserAlpha * std::sqrt(1.0 - x * x)) / i0Alpha);
+            }
+            if (weight == 0.0f)
+                continue;
+
+            const uint32_t index =
+                settings.isWrap ? uint32_t((i % size + size) % size) : uint32_t(std::clamp(i, 0, size - 1));
+            texels[d].push_back({index, weight});
+            sum += weight;
+        }
+
+        for (Tap &tap : texels[d])
+            tap.weight /= sum;
+        axis.numTaps = XMMax(axis.numTaps, uint32_t(texels[d].size()));
+    }
+
+    axis.taps.reserve(size_t(dstSize) * axis.numTaps);
+    for (const auto &taps : texels)
+    {
+        axis.taps.insert(axis.taps.end(), taps.begin(), taps.end());
+        axis.taps.resize(axis.taps.size() + axis.numTaps - taps.size(), {taps[0].index, 0.0f});
+    }
+    return axis;
+}
+
+// Filters the level above into dst (linear) and writes it encoded to pixels. Bands of rows run as jobs, each
+// filters the source rows it needs horizontally once and then vertically.
+void FilterLevel(const RowSource &source, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth,
+                 uint32_t dstHeight, const MipSettings &settings, bool isSRGB, std::vector<XMFLOAT4> &dst,
+                 uint8_t *pixels)
+{
+    const AxisFilter columns = BuildAxis(srcWidth, dstWidth, settings);
+    const AxisFilter rows    = BuildAxis(srcHeight, dstHeight, settings);
+    dst.resize(size_t(dstWidth) * dstHeight);
+
+    static const SRGBEncoder s_srgb;
+    const XMVECTORF32 normalScale = {{{0.5f, 0.5f, 0.5f, 1.0f}}};
+    const XMVECTORF32 normalBias  = {{{0.5f, 0.5f, 0.5f, 0.0f}}};
+
+    auto filter = [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        std::vector<uint32_t> srcRows;
+        for (uint32_t y = begin; y < end; y++)
+        {
+            for (uint32_t k = 0; k < rows.numTaps; k++)
+                srcRows.push_back(rows.taps[size_t(y) * rows.numTaps + k].index);
+        }
+        std::sort(srcRows.begin(), srcRows.end());
+        srcRows.erase(std::unique(srcRows.begin(), srcRows.end()), srcRows.end());
+
+        std::vector<XMFLOAT4> scratch(srcWidth);
+        std::vector<XMFLOAT4> filtered(srcRows.size() * dstWidth);
+        for (size_t r = 0; r < srcRows.size(); r++)
+        {
+            const XMFLOAT4 *src = source(srcRows[r], scratch.data());
+            XMFLOAT4 *out       = &filtered[r * dstWidth];
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                const Tap *tap = &columns.taps[size_t(x) * columns.numTaps];
+                XMVECTOR sum   = XMVectorZero();
+                for (uint32_t k = 0; k < columns.numTaps; k++)
+                    sum = XMVectorMultiplyAdd(XMLoadFloat4(&src[tap[k].index]), XMVectorReplicate(tap[k].weight), sum);
+                XMStoreFloat4(&out[x], sum);
+            }
+        }
+
+        std::vector<const XMFLOAT4 *> tapRows(rows.numTaps);
+        for (uint32_t y = begin; y < end; y++)
+        {
+            const Tap *tap = &rows.taps[size_t(y) * rows.numTaps];
+            for (uint32_t k = 0; k < rows.numTaps; k++)
+            {
+                const size_t r = std::lower_bound(srcRows.begin(), srcRows.end(), tap[k].index) - srcRows.begin();
+                tapRows[k]     = &filtered[r * dstWidth];
+            }
+
+            XMFLOAT4 *out  = &dst[size_t(y) * dstWidth];
+            auto *outPixel = reinterpret_cast<PackedVector::XMUBYTEN4 *>(pixels) + size_t(y) * dstWidth;
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                XMVECTOR sum = XMVectorZero();
+                for (uint32_t k = 0; k < rows.numTaps; k++)
+                    sum = XMVectorMultiplyAdd(XMLoadFloat4(&tapRows[k][x]), XMVectorReplicate(tap[k].weight), sum);
+
+                if (settings.isNormalMap)
+                {
+                    // A short average means the normals spread, the shading wants unit length anyway.
+                    const XMVECTOR normal = XMVectorGetX(XMVector3LengthSq(sum)) > 1e-12f
+                                                ? XMVector3Normalize(sum)
+                                                : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+                    sum                   = XMVectorSelect(sum, normal, g_XMSelect1110);
+                    PackedVector::XMStoreUByteN4(&outPixel[x], XMVectorMultiplyAdd(sum, normalScale, normalBias));
+                }
+                else
+                {
+                    // Kaiser lobes can overshoot, stay in range for the next level too.
+                    sum = XMVectorSaturate(sum);
+                    PackedVector::XMStoreUByteN4(&outPixel[x], sum);
+                }
+                XMStoreFloat4(&out[x], sum);
+
+                if (isSRGB)
+                {
+                    outPixel[x].x = s_srgb.Encode(out[x].x);
+                    outPixel[x].y = s_srgb.Encode(out[x].y);
+                    outPixel[x].z = s_srgb.Encode(out[x].z);
+                }
+            }
+        }
+    };
+
+    g_JobSystem.ParallelFor(dstHeight, MipGenerator::sm_rowsPerJob, filter);
+}
+} // namespace
+
+bool MipGenerator::Generate(TextureImage &image, const MipSettings &settings, MipStats *stats)
+{
+    const Stopwatch stopwatch;
+
+    const bool isSRGB = image.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    const bool isRGBA = isSRGB || image.format == DXGI_FORMAT_R8G8B8A8_UNORM;
+    const size_t size = size_t(image.width) * image.height * 4;
+    if (!isRGBA || image.mipLevels != 1 || image.pixels.size() < size || size == 0)
+    {
+        return false;
+    }
+
+    // Decode table of the color channels, alpha is always linear.
+    float decode[256];
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        const float c = float(i) / 255.0f;
+        if (settings.isNormalMap)
+            decode[i] = c * 2.0f - 1.0f;
+        else if (isSRGB)
+            decode[i] = SRGBEncoder::ToLinear(c);
+        else
+            decode[i] = c;
+    }
+
+    const uint32_t numLevels = CountLevels(image.width, image.height);
+
+    size_t total = 0;
+    for (uint32_t level = 0, w = image.width, h = image.height; level < numLevels; level++)
+    {
+        total += size_t(w) * h * 4;
+        w = XMMax(w / 2, 1u);
+        h = XMMax(h / 2, 1u);
+    }
+    image.pixels.resize(total);
+
+    // Level 0 is read from the pixels, every later one from the float copy of the level above.
+    const uint8_t *base = image.pixels.data();
+    const uint32_t baseWidth = image.width;
+    RowSource source = [&](uint32_t row, XMFLOAT4 *scratch) -> const XMFLOAT4 * {
+        const uint8_t *p = base + size_t(row) * baseWidth * 4;
+        for (uint32_t x = 0; x < baseWidth; x++, p += 4)
+            scratch[x] = XMFLOAT4(decode[p[0]], decode[p[1]], decode[p[2]], float(p[3]) / 255.0f);
+        return scratch;
+    };
+
+    std::vector<XMFLOAT4> above, current;
+    size_t offset = size;
+    uint32_t w = image.width, h = image.height;
+    for (uint32_t level = 1; level < numLevels; level++)
+    {
+        const uint32_t nextW = XMMax(w / 2, 1u);
+        const uint32_t nextH = XMMax(h / 2, 1u);
+        FilterLevel(source, w, h, nextW, nextH, settings, isSRGB, current, image.pixels.data() + offset);
+
+        above.swap(current);
+        source = [&above, nextW](uint32_t row, XMFLOAT4 *scratch) -> const XMFLOAT4 * {
+            return &above[size_t(row) * nextW];
+        };
+        offset += size_t(nextW) * nextH * 4;
+        w = nextW;
+        h = nextH;
+    }
+    image.mipLevels = numLevels;
+
+    if (stats)
+    {
+        stats->width     = image.width;
+        stats->height    = image.height;
+        stats->numLevels = numLevels;
+        stats->ms        = stopwatch.GetElapsedMs();
+    }
+    return true;
+}
+
+uint32_t MipGenerator::CountLevels(uint32_t width, uint32_t height)
+{
+    uint32_t numLevels = 1;
+    for (uint32_t size = XMMax(width, height); size > 1; size /= 2)
+        numLevels++;
+    return numLevels;
+}
+
+void MipGenerator::Report(const std::string &name, const MipStats &stats)
+{
+    std::cout << name << " : " << stats.width << "x" << stats.height << ", " << stats.numLevels << " mip levels in "
+              << stats.ms << " ms" << std::endl;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "TextureImage.h"
+#include <string>
+
+enum MIP_FILTER
+{
+    MIP_FILTER_BOX,    // average of the texels a smaller texel covers, the cheapest
+    MIP_FILTER_KAISER, // Kaiser windowed sinc, sharper and with less aliasing
+};
+
+struct MipSettings
+{
+    MIP_FILTER filter = MIP_FILTER_KAISER;
+    bool isNormalMap  = false; // xyz as UNORM, renormalized on every level instead of going shorter
+    bool isWrap       = true;  // filter across the edges like linearWrapSD, clamp otherwise
+    float kaiserWidth = 3.0f;  // taps reach this many texels of the smaller level to each side
+    float kaiserAlpha = 4.0f;  // window shape, larger is smoother with a wider main lobe
+};
+
+struct MipStats
+{
+    uint32_t width     = 0;
+    uint32_t height    = 0;
+    uint32_t numLevels = 0; // 1 when the format isn't supported
+    double ms          = 0.0;
+};
+
+// Builds the mip chain of an RGBA8 TextureImage on the CPU. Every level is filtered from the one above kept in
+// linear float (sRGB is decoded first and encoded last), separably and in bands of rows on g_JobSystem with
+// DirectXMath vectors. Safe to call from a job.
+class MipGenerator
+{
+  public:
+    // Appends the levels to image.pixels and sets image.mipLevels. False and nothing changed for formats other than
+    // R8G8B8A8_UNORM(_SRGB) or an image that already has mips.
+    static bool Generate(TextureImage &image, const MipSettings &settings = {}, MipStats *stats = nullptr);
+
+    // Down to 1x1, each level half the size rounded down.
+    static uint32_t CountLevels(uint32_t width, uint32_t height);
+
+    static void Report(const std::string &name, const MipStats &stats);
+
+  public:
+    static const uint32_t sm_rowsPerJob = 16; // rows of the smaller level filtered by one job
+};
@@ -1,7 +1,10 @@
 #include "pch.h"
 
 #include "AppBase.h"
+#include "DDSCache.h"
+#include "JobSystem.h"
 #include "Model.h"
+#include "TextureCache.h"
 
 DescriptorHandle s_TerrainSRV;
 int32_t s_cbIndex;
@@ -25,43 +28,174 @@ void Model::Initialize(ID3D12Device *device, ID3D12GraphicsCommandList *commandL
     m_useFrameResource = useFrameResource;
     m_isTerrian = isTerrian;
 
-    for (auto &m : meshes)
+    // Textures come from g_TextureCache, the ones it doesn't hold yet are decoded in parallel and only the GPU
+    // part below stays on this thread. A missing map is the shared default texture of its color.
+    static std::string MeshData::*const textureFilenames[] = {
+        &MeshData::albedoTextureFilename, &MeshData::metallicTextureFilename, &MeshData::roughnessTextureFilename,
+        &MeshData::normalTextureFilename, &MeshData::heightTextureFilename,   &MeshData::aoTextureFilename,
+        &MeshData::emissionTextureFilename};
+    const uint32_t numTextures = _countof(textureFilenames);
+    static_assert(_countof(textureFilenames) == TextureTable::sm_numTextures, "one filename per table slot");
+
+    // Texture files are block compressed and cached as DDS. The shader reads only .r of the metallic, roughness,
+    // height and ao maps and .xy of the normal map.
+    static const BC_FORMAT textureFormats[] = {BC_FORMAT_BC7, BC_FORMAT_BC4, BC_FORMAT_BC4, BC_FORMAT_BC5,
+                                               BC_FORMAT_BC4, BC_FORMAT_BC4, BC_FORMAT_BC1};
+    static_assert(_countof(textureFormats) == TextureTable::sm_numTextures, "one format per table slot");
+
+    // Only albedo is sRGB and only the normal map gets renormalized mips. Embedded textures ("*<index>") are hashed
+    // once per model and slot.
+    std::vector<std::shared_ptr<CachedTexture>> textures(meshes.size() * numTextures);
+    std::vector<std::string> keys(textures.size());
+    std::vector<uint32_t> imageSources; // first mesh texture of each image to decode
+    std::unordered_map<std::string, uint32_t> imageIndices;
+    std::map<std::pair<const EmbeddedTexture *, uint32_t>, std::string> embeddedKeys;
+    for (uint32_t i = 0; i < uint32_t(textures.size()); i++)
     {
-        Mesh newMesh;
-        BuildMeshBuffers(device, newMesh, m);
+        const uint32_t slot             = i % numTextures;
+        const MeshData &m               = meshes[i / numTextures];
+        const std::string &filename     = m.*textureFilenames[slot];
+        const EmbeddedTexture *embedded = m.FindEmbeddedTexture(filename);
+        if (embedded)
+        {
+            std::string &key = embeddedKeys[{embedded, slot}];
+            if (key.empty())
+                key = TextureCache::MakeKey(*embedded, slot == 0, slot == 3);
+            keys[i] = key;
+        }
+        else if (filename.empty())
+            keys[i] = TextureCache::MakeKey(XMFLOAT3(0.0f, 0.0f, 0.0f), slot == 0, slot == 3);
+        else
+            keys[i] = TextureCache::MakeKey(filename, slot == 0, slot == 3, textureFormats[slot]);
+
+        textures[i] = g_TextureCache.Find(keys[i]);
+        if (!textures[i] && imageIndices.emplace(keys[i], uint32_t(imageSources.size())).second)
+            imageSources.push_back(i);
+    }
 
-        // Set Texture
-        //  ̸ ٸ  ؽĸ Ѵ. (root desciptor table   ʿ)
+    std::vector<TextureImage> images(imageSources.size());
+    std::vector<std::string> ddsPaths(imageSources.size()); // cached DDS, images[i] is empty then
+    g_JobSystem.ParallelFor(uint32_t(images.size()), 1, [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+        for (uint32_t i = begin; i < end; i++)
         {
-            this->BuildTexture(device, commandList, m.albedoTextureFilename, &newMesh.albedoTexture,
-                               &newMesh.albedoUploadTexture, newMesh.albedoDescriptorHandle, true);
-            m_materialConstData.useAlbedoMap = !m.albedoTextureFilename.empty();
+            const uint32_t slot             = imageSources[i] % numTextures;
+            const MeshData &m               = meshes[imageSources[i] / numTextures];
+            const std::string &filename     = m.*textureFilenames[slot];
+            const EmbeddedTexture *embedded = m.FindEmbeddedTexture(filename);
+
+            DDSCacheSettings settings;
+            settings.format           = textureFormats[slot];
+            settings.isSRGB           = slot == 0;
+            settings.mips.isNormalMap = slot == 3;
+            if (!embedded && !filename.empty())
+            {
+                ddsPaths[i] = DDSCache::Fetch(filename, settings, images[i]);
+                continue;
+            }
+
+            // Embedded textures and default colors have no file to cache next to and stay uncompressed.
+            images[i] = embedded ? D3DUtils::ReadTexture(*embedded, slot == 0)
+                                 : D3DUtils::ReadTexture(filename, {}, slot == 0);
+            MipGenerator::Generate(images[i], settings.mips);
+        }
+    });
 
-            this->BuildTexture(device, commandList, m.metallicTextureFilename, &newMesh.metallicTexture,
-                               &newMesh.metallicUploadTexture, newMesh.metallicDescriptorHandle);
-            m_materialConstData.useMetalnessMap = !m.metallicTextureFilename.empty();
+    for (uint32_t i = 0; i < uint32_t(imageSources.size()); i++)
+    {
+        const uint32_t source = imageSources[i];
+        if (ddsPaths[i].empty())
+            textures[source] = g_TextureCache.Insert(device, commandList, keys[source], images[i]);
+        else
+            textures[source] = g_TextureCache.InsertDDS(device, commandList, keys[source], ddsPaths[i]);
+    }
+    for (uint32_t i = 0; i < uint32_t(textures.size()); i++)
+    {
+        if (!textures[i])
+            textures[i] = textures[imageSources[imageIndices[keys[i]]]];
+    }
+    images = {};
 
-            this->BuildTexture(device, commandList, m.roughnessTextureFilename, &newMesh.roughnessTexture,
-                               &newMesh.roughnessloadTexture, newMesh.roughnessDescriptorHandle);
-            m_materialConstData.useRoughnessMap = !m.roughnessTextureFilename.empty();
+    if (m_useQuantization)
+    {
+        // One box for all meshes, MeshConsts is per model.
+        QuantizeError error;
+        m_quantizeBox = VertexQuantizer::ComputeBox(meshes);
+        m_isQuantized = VertexQuantizer::CanQuantize(meshes, m_quantizeBox, m_quantizeSettings, &error);
 
-            this->BuildTexture(device, commandList, m.normalTextureFilename, &newMesh.normalTexture,
-                               &newMesh.normalLoadTexture, newMesh.normalDescriptorHandle);
-            m_materialConstData.useNormalMap = !m.normalTextureFilename.empty();
+        size_t numVertices = 0;
+        for (const auto &m : meshes)
+            numVertices += m.GetVertices().size();
+        VertexQuantizer::Report("Vertex quantization", numVertices, error, m_isQuantized);
+
+        if (m_isQuantized)
+        {
+            m_meshConstsData.positionMin    = m_quantizeBox.positionMin;
+            m_meshConstsData.positionExtent = m_quantizeBox.positionExtent;
+            m_meshConstsData.texCoordOffset = m_quantizeBox.texCoordOffset;
+        }
+    }
+
+    // Large static models get cluster culling without asking. Nothing says they are closed, so only the frustum
+    // culls them. Only the main camera pass draws the culled meshlets, the shadow pass draws whole levels.
+    if (!m_useClusterCulling)
+    {
+        size_t numTriangles = 0;
+        bool isStatic       = true;
+        for (const auto &m : meshes)
+        {
+            numTriangles += (m.lods.empty() ? m.GetIndices().size() : m.lods[0].indexCount) / 3;
+            isStatic = isStatic && !m.GetVertices().empty();
+        }
+        if (isStatic && numTriangles >= sm_clusterCullTriangles)
+        {
+            std::cout << "Cluster culling on for a static model of " << numTriangles << " triangles" << std::endl;
+            EnableClusterCulling(false);
+        }
+    }
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        MeshData &m = meshes[i];
 
-            this->BuildTexture(device, commandList, m.heightTextureFilename, &newMesh.heightTexture,
-                               &newMesh.heightLoadTexture, newMesh.heightDescriptorHandle);
-            m_meshConstsData.useHeightMap = !m.heightTextureFilename.empty();
+        if (m_useClusterCulling)
+        {
+            BuildClusters(m);
+        }
 
-            this->BuildTexture(device, commandList, m.aoTextureFilename, &newMesh.aoTexture, &newMesh.aoLoadTexture,
-                               newMesh.aoDescriptorHandle);
-            m_materialConstData.useAoMap = !m.aoTextureFilename.empty();
+        Mesh newMesh;
+        BuildMeshBuffers(device, newMesh, m);
+        newMesh.lods = m.lods;
+        m_numLods    = XMMax(m_numLods, uint32_t(m.lods.size()));
 
-            this->BuildTexture(device, commandList, m.emissionTextureFilename, &newMesh.emissionTexture,
-                               &newMesh.emissionLoadTexture, newMesh.emissionDescriptorHandle);
-            m_materialConstData.useEmissiveMap = !m.emissionTextureFilename.empty();
+        // Bounds for the LOD selection.
+        {
+            const ConstArray<Vertex> vertices               = m.GetVertices();
+            const ConstArray<SkinnedVertex> skinnedVertices = m.GetSkinnedVertices();
+            const bool isSkinned                            = vertices.empty();
+            const size_t count                              = isSkinned ? skinnedVertices.size() : vertices.size();
+            if (count > 0)
+            {
+                BoundingSphere sphere;
+                BoundingSphere::CreateFromPoints(
+                    sphere, count, isSkinned ? &skinnedVertices[0].position : &vertices[0].position,
+                    isSkinned ? sizeof(SkinnedVertex) : sizeof(Vertex));
+                if (i == 0)
+                    m_boundingSphere = sphere;
+                else
+                    BoundingSphere::CreateMerged(m_boundingSphere, m_boundingSphere, sphere);
+            }
         }
 
+        // Set Texture, meshes with the same textures share one descriptor table.
+        newMesh.textures                    = g_TextureCache.GetTable(device, &textures[i * numTextures]);
+        m_materialConstData.useAlbedoMap    = !m.albedoTextureFilename.empty();
+        m_materialConstData.useMetalnessMap = !m.metallicTextureFilename.empty();
+        m_materialConstData.useRoughnessMap = !m.roughnessTextureFilename.empty();
+        m_materialConstData.useNormalMap    = !m.normalTextureFilename.empty();
+        m_meshConstsData.useHeightMap       = !m.heightTextureFilename.empty();
+        m_materialConstData.useAoMap        = !m.aoTextureFilename.empty();
+        m_materialConstData.useEmissiveMap  = !m.emissionTextureFilename.empty();
+
         m_meshes.push_back(newMesh);
     }
 
@@ -70,6 +204,7 @@ void Model::Initialize(ID3D12Device *device, ID3D12GraphicsCommandList *commandL
         m_cbIndex = s_cbIndex;
         s_cbIndex++;
     }
+    m_isPending = false;
 }
 
 void Model::Update(UploadBuffer<MeshConsts>* meshGPU, UploadBuffer<MaterialConsts>* materialGPU)
@@ -88,27 +223,120 @@ void Model::Render(ID3D12GraphicsCommandList *commandList)
 {
     for (auto &m : m_meshes)
     {
-        if (!m_isTerrian)
-            commandList->SetGraphicsRootDescriptorTable(4, m.albedoDescriptorHandle);
-        else
-            commandList->SetGraphicsRootDescriptorTable(4, s_TerrainSRV);
+        const MeshLod lod = GetLodRange(m);
+        BindMesh(commandList, m);
+        commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.firstIndex, 0, 0);
 
-        commandList->SetGraphicsRootConstantBufferView(1, m_meshUpload->GetResource()->GetGPUVirtualAddress() + m_cbIndex * sizeof(MeshConsts));
-        commandList->SetGraphicsRootConstantBufferView(2, m_materialUpload->GetResource()->GetGPUVirtualAddress() + m_cbIndex * sizeof(MaterialConsts));
+        m_numRenderTriangles += lod.indexCount;
+    }
 
-        commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        commandList->IASetVertexBuffers(0, 1, &m.VertexBufferView());
-        commandList->IASetIndexBuffer(&m.IndexBufferView());
-        commandList->DrawIndexedInstanced(m.indexCount, 1, 0, 0, 0);
+    m_numRenderTriangles /= 3;
+}
 
-        m_numRenderTriangles += m.indexCount;
+void Model::CullClusters(const Vector4 *planes, const Vector3 &eye)
+{
+    m_clusterStats = {};
+    if (!m_useClusterCulling)
+    {
+        return;
     }
 
-    m_numRenderTriangles /= 3;
+    // The meshlet bounds stay in object space, the planes and the eye are brought there instead. Both transforms
+    // are exact for any affine world, scaled or not.
+    float localPlanes[6][4];
+    const Matrix worldT = m_world.Transpose();
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        Vector4 plane = Vector4::Transform(planes[i], worldT);
+        plane /= Vector3(plane.x, plane.y, plane.z).Length();
+        memcpy(localPlanes[i], &plane, sizeof(localPlanes[i]));
+    }
+    const Vector3 localEye = Vector3::Transform(eye, m_world.Invert());
+
+    // A mirroring world flips the winding, the normal cones would point inside.
+    const bool cullBackfaces = m_cullBackfaces && m_world.Determinant() > 0.0f;
+
+    // The level UpdateLod picked, RenderVisible draws the same one.
+    for (size_t i = 0; i < m_meshlets.size(); i++)
+    {
+        const MeshletData &meshlets = m_meshlets[i][XMMin(m_lod, uint32_t(m_meshlets[i].size()) - 1)];
+        if (meshlets.meshlets.empty())
+        {
+            continue;
+        }
+
+        m_visibleClusters[i].clear();
+        m_clusterStats.Add(
+            MeshletBuilder::Cull(meshlets, localPlanes, &localEye.x, cullBackfaces, m_visibleClusters[i]));
+    }
+}
+
+void Model::UpdateLod(const Vector3 &eyePos, const MeshLodSelectSettings &settings)
+{
+    if (m_numLods < 2)
+    {
+        return;
+    }
+
+    BoundingSphere bounds;
+    m_boundingSphere.Transform(bounds, m_world);
+    const float distance = (Vector3(bounds.Center) - eyePos).Length();
+    const float size     = distance > 0.0f ? bounds.Radius / distance : 1.0f;
+
+    // Coarser once the size is clearly below a threshold, finer once it is clearly above.
+    const uint32_t maxLod = XMMin(m_numLods - 1, uint32_t(_countof(settings.projectedSize)));
+    uint32_t lod          = XMMin(m_lod, maxLod);
+    while (lod < maxLod && size < settings.projectedSize[lod] * (1.0f - settings.hysteresis))
+    {
+        lod++;
+    }
+    while (lod > 0 && size > settings.projectedSize[lod - 1] * (1.0f + settings.hysteresis))
+    {
+        lod--;
+    }
+    m_lod = lod;
+}
+
+void Model::RenderVisible(ID3D12GraphicsCommandList *commandList)
+{
+    if (!m_useClusterCulling)
+    {
+        Render(commandList);
+        return;
+    }
+
+    for (size_t i = 0; i < m_meshes.size(); i++)
+    {
+        // Skinned meshes have no meshlets and are drawn whole.
+        if (m_meshlets[i][XMMin(m_lod, uint32_t(m_meshlets[i].size()) - 1)].meshlets.empty())
+        {
+            const MeshLod lod = GetLodRange(m_meshes[i]);
+            BindMesh(commandList, m_meshes[i]);
+            commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.firstIndex, 0, 0);
+            continue;
+        }
+
+        if (m_visibleClusters[i].empty())
+        {
+            continue;
+        }
+
+        BindMesh(commandList, m_meshes[i]);
+        for (const MeshletRange &range : m_visibleClusters[i])
+        {
+            commandList->DrawIndexedInstanced(range.indexCount, 1, range.firstIndex, 0, 0);
+        }
+    }
 }
 
 void Model::RenderNormal(ID3D12GraphicsCommandList *commandList)
 {
+    // normalPSO reads float positions and normals.
+    if (m_isQuantized)
+    {
+        return;
+    }
+
     for (auto &m : m_meshes)
     {
         commandList->SetGraphicsRootConstantBufferView(1, m_meshUpload->GetResource()->GetGPUVirtualAddress());
@@ -133,22 +361,89 @@ void Model::UpdateWorldMatrix(Matrix worldRow)
 void Model::BuildMeshBuffers(ID3D12Device *device, Mesh &mesh, MeshData &meshData)
 {
     // Create vertex buffer view
-    D3DUtils::CreateDefaultBuffer(device, &mesh.vertexBuffer, meshData.vertices.data(),
-                                  uint32_t(meshData.vertices.size() * sizeof(Vertex)));
-    D3DUtils::CreateDefaultBuffer(device, &mesh.indexBuffer, meshData.indices.data(),
-                                  uint32_t(meshData.indices.size() * sizeof(uint32_t)));
-    mesh.vertexCount = uint32_t(meshData.vertices.size());
-    mesh.stride      = sizeof(Vertex);
-    mesh.indexCount  = uint32_t(meshData.indices.size());
+    const ConstArray<Vertex> vertices = meshData.GetVertices();
+    if (m_isQuantized)
+    {
+        const std::vector<QuantizedVertex> quantized = VertexQuantizer::Encode(vertices, m_quantizeBox);
+        D3DUtils::CreateDefaultBuffer(device, &mesh.vertexBuffer, quantized.data(),
+                                      uint32_t(quantized.size() * sizeof(QuantizedVertex)));
+        mesh.stride = sizeof(QuantizedVertex);
+    }
+    else
+    {
+        D3DUtils::CreateDefaultBuffer(device, &mesh.vertexBuffer, vertices.data,
+                                      uint32_t(vertices.size() * sizeof(Vertex)));
+        mesh.stride = sizeof(Vertex);
+    }
+    mesh.CreateIndexBuffer(device, meshData);
+    mesh.vertexCount = uint32_t(vertices.size());
+}
+
+void Model::BindMesh(ID3D12GraphicsCommandList *commandList, Mesh &mesh)
+{
+    if (!m_isTerrian)
+        commandList->SetGraphicsRootDescriptorTable(4, mesh.textures->handle);
+    else
+        commandList->SetGraphicsRootDescriptorTable(4, s_TerrainSRV);
+
+    commandList->SetGraphicsRootConstantBufferView(1, m_meshUpload->GetResource()->GetGPUVirtualAddress() + m_cbIndex * sizeof(MeshConsts));
+    commandList->SetGraphicsRootConstantBufferView(2, m_materialUpload->GetResource()->GetGPUVirtualAddress() + m_cbIndex * sizeof(MaterialConsts));
+
+    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    commandList->IASetVertexBuffers(0, 1, &mesh.VertexBufferView());
+    commandList->IASetIndexBuffer(&mesh.IndexBufferView());
 }
 
-void Model::BuildTexture(ID3D12Device *device, ID3D12GraphicsCommandList *commandList, const std::string &filename,
-                         ID3D12Resource **texture, ID3D12Resource **uploadTexture, DescriptorHandle &handle,
-                         bool isSRGB)
+MeshLod Model::GetLodRange(const Mesh &mesh) const
 {
-    handle         = Graphics::s_Texture.Alloc(1);
-    *uploadTexture = D3DUtils::CreateTexture(device, commandList, filename, texture,
-                                             D3D12_CPU_DESCRIPTOR_HANDLE(handle), {}, isSRGB);
+    if (mesh.lods.empty())
+    {
+        return {0, mesh.indexCount, 0.0f};
+    }
+    return mesh.lods[XMMin(m_lod, uint32_t(mesh.lods.size()) - 1)];
+}
+
+void Model::BuildClusters(MeshData &meshData)
+{
+    // Every level of detail gets its own meshlets, each level is reordered within its range of the index buffer.
+    std::vector<MeshLod> lods = meshData.lods;
+    if (lods.empty())
+    {
+        lods.push_back({0, uint32_t(meshData.GetIndices().size())});
+    }
+
+    // Skinned meshes move their vertices, the meshlet bounds would be wrong. They are drawn whole.
+    std::vector<MeshletData> levels(lods.size());
+    const ConstArray<Vertex> vertices = meshData.GetVertices();
+    if (!vertices.empty())
+    {
+        // The meshlet order is written back, a mesh from the cache gets its own copy of the indices.
+        auto &indices = meshData.GetWritableIndices();
+        for (size_t l = 0; l < lods.size(); l++)
+        {
+            const auto first = indices.begin() + lods[l].firstIndex;
+            const std::vector<uint32_t> lodIndices(first, first + lods[l].indexCount);
+            levels[l] = MeshletBuilder::Build(lodIndices, &vertices[0].position.x, vertices.size(), sizeof(Vertex));
+
+            MeshletData &meshlets = levels[l];
+            MeshletBuilder::Report("Meshlets LOD " + std::to_string(l), meshlets);
+
+            // Drawn as index ranges, only the meshlets and their bounds are kept. The offsets are moved to the range
+            // of the level, so the culled ranges index the whole buffer.
+            const std::vector<uint32_t> ordered = MeshletBuilder::BuildIndices(meshlets);
+            std::copy(ordered.begin(), ordered.end(), first);
+            for (Meshlet &meshlet : meshlets.meshlets)
+            {
+                meshlet.triangleOffset += lods[l].firstIndex;
+            }
+            meshlets.vertices  = {};
+            meshlets.triangles = {};
+        }
+    }
+
+    // Everything is visible until the first CullClusters.
+    m_visibleClusters.push_back({{lods[0].firstIndex, lods[0].indexCount}});
+    m_meshlets.push_back(std::move(levels));
 }
 
 void Model::DestroyMeshBuffers()
@@ -162,27 +457,9 @@ void Model::DestroyMeshBuffers()
 
 void Model::DestroyTextureResource()
 {
+    // The cache releases a texture with the last mesh using it.
     for (auto &m : m_meshes)
     {
-        SAFE_RELEASE(m.emissionTexture);
-        SAFE_RELEASE(m.emissionLoadTexture);
-
-        SAFE_RELEASE(m.aoTexture);
-        SAFE_RELEASE(m.aoLoadTexture);
-
-        SAFE_RELEASE(m.heightTexture);
-        SAFE_RELEASE(m.heightLoadTexture);
-
-        SAFE_RELEASE(m.normalTexture);
-        SAFE_RELEASE(m.normalLoadTexture);
-
-        SAFE_RELEASE(m.roughnessTexture);
-        SAFE_RELEASE(m.roughnessloadTexture);
-
-        SAFE_RELEASE(m.metallicTexture);
-        SAFE_RELEASE(m.metallicUploadTexture);
-
-        SAFE_RELEASE(m.albedoTexture);
-        SAFE_RELEASE(m.albedoUploadTexture);
+        m.textures = nullptr;
     }
 }
@@ -3,12 +3,21 @@
 #include "AnimationData.h"
 #include "ConstantBuffer.h"
 #include "Mesh.h"
+#include "MeshletBuilder.h"
+#include "VertexQuantizer.h"
 
 using namespace DirectX;
 
 extern DescriptorHandle s_TerrainSRV;
 extern int32_t s_cbIndex;
 
+// Mesh LOD by projected size (bounding radius / distance to the camera), see MeshSimplifier for the levels.
+struct MeshLodSelectSettings
+{
+	float projectedSize[4] = { 0.2f, 0.1f, 0.05f, 0.025f }; // LOD 1 to 4 start below these
+	float hysteresis = 0.15f; // a level changes this far past its threshold, so it doesn't flicker on the edge
+};
+
 class Model
 {
 public:
@@ -23,23 +32,51 @@ public:
 	virtual void RenderNormal(ID3D12GraphicsCommandList* commandList);
 	void UpdateWorldMatrix(Matrix worldRow);
 
+	// Static meshes only, call before Initialize. Every level of detail of a mesh is split into meshlets and drawn in
+	// meshlet order, CullClusters keeps the meshlets of the current level inside the frustum and not facing away from
+	// the eye. The rasterizer doesn't cull back faces, so turn cullBackfaces off for open meshes seen from both sides.
+	// Models with sm_clusterCullTriangles static triangles or more get it with cullBackfaces off anyway.
+	void EnableClusterCulling(bool cullBackfaces = true)
+	{
+		m_useClusterCulling = true;
+		m_cullBackfaces = cullBackfaces;
+	}
+	void CullClusters(const Vector4* planes, const Vector3& eye);
+	// Static meshes only, call before Initialize. Vertices are uploaded as QuantizedVertex when every mesh stays
+	// within settings in the box of the model, otherwise they stay float.
+	void EnableVertexQuantization(const VertexQuantizeSettings& settings = VertexQuantizeSettings())
+	{
+		m_useQuantization = true;
+		m_quantizeSettings = settings;
+	}
+	// Picks the level drawn by Render and RenderVisible (shadows included). No effect on meshes without LODs.
+	void UpdateLod(const Vector3& eyePos, const MeshLodSelectSettings& settings = MeshLodSelectSettings());
+	// Render with the meshlets CullClusters kept, for the view they were culled against: the main camera. Passes from
+	// other views (shadows, reflections) call Render, which draws the whole level. Same as Render without cluster
+	// culling.
+	void RenderVisible(ID3D12GraphicsCommandList* commandList);
+
+	static const uint32_t sm_clusterCullTriangles = 16384; // LOD 0 of all meshes together
+
 private:
 	virtual void BuildMeshBuffers(ID3D12Device* device, Mesh& mesh, MeshData& meshData);
-	void BuildTexture(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const std::string& filename,
-		ID3D12Resource** texture, ID3D12Resource** uploadTexture, DescriptorHandle& handle,
-		bool isSRGB = false);
+	void BuildClusters(MeshData& meshData);
+	void BindMesh(ID3D12GraphicsCommandList* commandList, Mesh& mesh);
+	MeshLod GetLodRange(const Mesh& mesh) const;
 	void DestroyMeshBuffers();
 	void DestroyTextureResource();
 
 public:
 	virtual ID3D12PipelineState* GetPSO(bool isWireFrame)
 	{
+		if (m_isQuantized)
+			return isWireFrame ? Graphics::quantizedWirePSO : Graphics::quantizedSolidPSO;
 		return isWireFrame ? Graphics::defaultWirePSO : Graphics::defaultSolidPSO;
 	}
 
 	virtual ID3D12PipelineState* GetDepthOnlyPSO()
 	{
-		return Graphics::depthOnlyPSO;
+		return m_isQuantized ? Graphics::depthOnlyQuantizedPSO : Graphics::depthOnlyPSO;
 	}
 
 	MeshConsts& GetMeshConstCPU()
@@ -144,6 +181,21 @@ public:
 		return uint32_t(m_meshes.size());
 	}
 
+	const ClusterCullStats& GetClusterStats() const
+	{
+		return m_clusterStats;
+	}
+
+	uint32_t GetLod() const
+	{
+		return m_lod;
+	}
+
+	bool IsQuantized() const
+	{
+		return m_isQuantized;
+	}
+
 protected:
 	UploadBuffer<MeshConsts>* m_meshUpload = nullptr;
 	UploadBuffer<MaterialConsts>* m_materialUpload = nullptr;
@@ -158,7 +210,7 @@ private:
 	uint32_t m_descRef = 0;
 	uint32_t m_descNum = 300;
 
-	BoundingSphere m_boundingSphere = {};
+	BoundingSphere m_boundingSphere = {}; // object space, all meshes
 
 	Matrix m_world = Matrix();
 	Matrix m_worldIT = Matrix();
@@ -177,6 +229,21 @@ private:
 
 	bool m_isTerrian = false;
 
+	// One per mesh and level of detail when cluster culling is on, the visible ranges are of the current level.
+	std::vector<std::vector<MeshletData>> m_meshlets;
+	std::vector<std::vector<MeshletRange>> m_visibleClusters;
+	ClusterCullStats m_clusterStats = {};
+	bool m_useClusterCulling = false;
+	bool m_cullBackfaces = true;
+
+	uint32_t m_lod = 0;
+	uint32_t m_numLods = 1; // most levels of any mesh
+
+	VertexQuantizeSettings m_quantizeSettings = {};
+	QuantizeBox m_quantizeBox = {};
+	bool m_useQuantization = false;
+	bool m_isQuantized = false;
+
 	float m_speed = 0.0001f;
 
 protected:
@@ -186,6 +253,7 @@ public:
 	bool m_castShadow = true;
 	bool m_isDraw = true;
 	bool m_isWire = false;
+	bool m_isPending = false; // added before its files are in, skipped by Update and every pass until Initialize
 
 	bool m_useFrameResource = true;
 };
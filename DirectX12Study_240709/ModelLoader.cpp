@@ -1,8 +1,7 @@
 #include "pch.h"
 
 #include "ModelLoader.h"
-#include <filesystem>
-#include <fstream>
+#include "ObjParser.h"
 
 ModelLoader::ModelLoader(const char *filepath, const char *filename, bool isAnim)
 {
@@ -10,14 +9,15 @@ ModelLoader::ModelLoader(const char *filepath, const char *filename, bool isAnim
 
     uint8_t *fileFullpath = Utils::get_full_directory(filepath, filename);
     const uint8_t *ext    = Utils::get_extension((const char *)fileFullpath);
-    // if (!strcmp((const char *)ext, "obj"))
-    //{
-    //     LoadObjFile((const char *)fileFullpath);
-    // }
-    // else
-    //{
-    LoadModel((const char *)fileFullpath, isAnim);
-    //}
+    // OBJ has no skeleton or animation, ObjParser reads it much faster than Assimp.
+    if (!_stricmp((const char *)ext, "obj"))
+    {
+        LoadObjFile((const char *)fileFullpath);
+    }
+    else
+    {
+        LoadModel((const char *)fileFullpath, isAnim);
+    }
 
     free((void *)ext);
     free(fileFullpath);
@@ -29,83 +29,13 @@ ModelLoader::~ModelLoader()
 
 void ModelLoader::LoadObjFile(const char *filename)
 {
-    FILE *fp = nullptr;
-
-    fopen_s(&fp, filename, "rt");
-    if (!fp)
+    ObjParseStats stats;
+    if (!ObjParser::Load(filename, m_meshes, m_materials, &stats))
     {
+        std::cout << "ERROR::OBJ::can't read " << filename << std::endl;
         return;
     }
-
-    char line[255];
-
-    // read info.
-    fgets(line, sizeof(line), fp);
-    fgets(line, sizeof(line), fp);
-    fgets(line, sizeof(line), fp);
-    fgets(line, sizeof(line), fp);
-
-    MeshData meshData                       = {};
-    std::vector<Vertex> &vertices           = meshData.vertices;
-    std::vector<MeshData::index_t> &indices = meshData.indices;
-    std::vector<XMFLOAT3> posVec            = {};
-    std::vector<XMFLOAT3> normalVec         = {};
-    std::vector<XMFLOAT2> uvVec             = {};
-    while (!feof(fp))
-    {
-        char c;
-        c = fgetc(fp);
-
-        switch (c)
-        {
-        case 'v': // vertex data.
-        {
-            c = fgetc(fp);
-
-            Vertex v;
-            XMFLOAT3 pos    = {};
-            XMFLOAT3 normal = {};
-            XMFLOAT2 uv     = {};
-            if (c == ' ') // position data.
-            {
-                fscanf_s(fp, "%f %f %f", &pos.x, &pos.y, &pos.z);
-                v = Vertex(pos, normal, uv);
-                vertices.push_back(v);
-            }
-        }
-        break;
-        case 'f': // index data.
-        {
-            MeshData::index_t idx[12] = {};
-            for (int32_t i = 0; i < 12; i += 3)
-            {
-                int ans = fscanf_s(fp, "%d/%d/%d", &idx[i], &idx[i + 1], &idx[i + 2]);
-                if (ans == 3)
-                {
-                    indices.push_back(idx[i]);
-                    indices.push_back(idx[i + 1]);
-                    indices.push_back(idx[i + 2]);
-                }
-            }
-        }
-        break;
-        case 'o': {
-            fgets(line, sizeof(line), fp); // TODO
-            m_meshes.push_back(meshData);
-            vertices.clear();
-            indices.clear();
-        }
-        break;
-        case 's': {
-            fgets(line, sizeof(line), fp);
-            fgets(line, sizeof(line), fp);
-        }
-        break;
-        }
-    }
-
-    m_meshes.push_back(meshData);
-    fclose(fp);
+    ObjParser::Report(filename, stats);
 }
 
 void ModelLoader::LoadModel(const char *filename, bool isAnim)
@@ -130,10 +60,48 @@ void ModelLoader::LoadModel(const char *filename, bool isAnim)
 
     ProcessNode(scene->mRootNode, scene);
 
+    // Embedded textures are copied out as they are and decoded by Model, never written next to the model.
+    if (scene->mNumTextures > 0)
+    {
+        auto textures = std::make_shared<std::vector<EmbeddedTexture>>(scene->mNumTextures);
+        for (unsigned int i = 0; i < scene->mNumTextures; i++)
+        {
+            const aiTexture *texture = scene->mTextures[i];
+            const uint8_t *data      = reinterpret_cast<const uint8_t *>(texture->pcData);
+            EmbeddedTexture &copy    = (*textures)[i];
+            if (texture->mHeight == 0)
+            {
+                // mWidth is the size of the encoded file.
+                copy.data.assign(data, data + texture->mWidth);
+            }
+            else
+            {
+                copy.width  = texture->mWidth;
+                copy.height = texture->mHeight;
+                copy.data.assign(data, data + size_t(texture->mWidth) * texture->mHeight * sizeof(aiTexel));
+            }
+        }
+
+        for (auto &m : m_meshes)
+            m.embeddedTextures = textures;
+    }
+
     if (scene->HasAnimations() && isAnim)
         ReadAnimationClip(scene);
 }
 
+std::string ModelLoader::EmbeddedTextureName(const aiScene *scene, const aiTexture *texture)
+{
+    for (unsigned int i = 0; i < scene->mNumTextures; i++)
+    {
+        if (scene->mTextures[i] == texture)
+        {
+            return "*" + std::to_string(i);
+        }
+    }
+    return "";
+}
+
 aiNode *ModelLoader::FindParent(aiNode *node)
 {
     if (!node)
@@ -236,7 +204,6 @@ MeshData ModelLoader::ProceesMesh(aiMesh *mesh, const aiScene *scene)
             const aiBone *bone = mesh->mBones[i];
 
             m_anim.offsetMatrix.resize(m_anim.boneNameToId.size());
-            m_anim.boneTransform.resize(m_anim.boneNameToId.size());
 
             auto boneID = m_anim.boneNameToId[bone->mName.C_Str()];
 
@@ -259,26 +226,75 @@ MeshData ModelLoader::ProceesMesh(aiMesh *mesh, const aiScene *scene)
             }
         }
 
-        int maxBones = 0;
-        for (size_t i = 0; i < boneWeights.size(); i++)
-        {
-            maxBones = DirectX::XMMax(maxBones, int(boneWeights[i].size()));
-        }
-        std::cout << "Max number of influencing bones per vertex = " << maxBones << std::endl;
+        // UINT8 indices in the vertex.
+        assert(m_anim.boneNameToId.size() <= 256);
+
+        const uint32_t maxInfluences = SkinnedVertex::sm_maxInfluences;
+
+        int maxBones           = 0;
+        size_t numPruned       = 0;
+        float maxDroppedWeight = 0.0f;
 
         meshData.skinnedVertices.resize(meshData.vertices.size());
         for (size_t i = 0; i < meshData.vertices.size(); i++)
         {
-            meshData.skinnedVertices[i].position = meshData.vertices[i].position;
-            meshData.skinnedVertices[i].normal   = meshData.vertices[i].normal;
-            meshData.skinnedVertices[i].texCoord = meshData.vertices[i].texCoord;
+            SkinnedVertex &v = meshData.skinnedVertices[i];
+            v.position       = meshData.vertices[i].position;
+            v.normal         = meshData.vertices[i].normal;
+            v.texCoord       = meshData.vertices[i].texCoord;
+            v.tangent        = meshData.vertices[i].tangent;
+
+            const uint32_t count = uint32_t(boneWeights[i].size());
+            maxBones             = DirectX::XMMax(maxBones, int(count));
+
+            // Keep the largest influences.
+            std::vector<uint32_t> sorted(count);
+            for (uint32_t j = 0; j < count; j++)
+            {
+                sorted[j] = j;
+            }
+            std::sort(sorted.begin(), sorted.end(),
+                      [&](uint32_t l, uint32_t r) { return boneWeights[i][l] > boneWeights[i][r]; });
+
+            const uint32_t kept = DirectX::XMMin(count, maxInfluences);
+            float total         = 0.0f;
+            float keptTotal     = 0.0f;
+            for (uint32_t j = 0; j < count; j++)
+            {
+                total += boneWeights[i][sorted[j]];
+                if (j < kept)
+                {
+                    keptTotal += boneWeights[i][sorted[j]];
+                }
+            }
+
+            if (count > maxInfluences)
+            {
+                numPruned++;
+                maxDroppedWeight = DirectX::XMMax(maxDroppedWeight, total > 0.0f ? 1.0f - keptTotal / total : 0.0f);
+            }
 
-            for (size_t j = 0; j < boneWeights[i].size(); j++)
+            if (kept == 0 || keptTotal <= 0.0f)
             {
-                meshData.skinnedVertices[i].boneWeights[j] = boneWeights[i][j];
-                meshData.skinnedVertices[i].boneIndices[j] = boneIndices[i][j];
+                continue;
             }
+
+            // Renormalize and quantize to UNORM8. The rounding error goes to the largest weight so the
+            // weights still sum to exactly 255.
+            int sum = 0;
+            for (uint32_t j = 0; j < kept; j++)
+            {
+                const int w      = int(boneWeights[i][sorted[j]] / keptTotal * 255.0f + 0.5f);
+                v.boneWeights[j] = uint8_t(std::clamp(w, 0, 255));
+                v.boneIndices[j] = boneIndices[i][sorted[j]];
+                sum += v.boneWeights[j];
+            }
+            v.boneWeights[0] = uint8_t(std::clamp(int(v.boneWeights[0]) + 255 - sum, 0, 255));
         }
+
+        std::cout << "Max number of influencing bones per vertex = " << maxBones << std::endl;
+        std::cout << "Vertices with more than " << maxInfluences << " influences = " << numPruned << " / "
+                  << meshData.skinnedVertices.size() << ", max dropped weight = " << maxDroppedWeight << std::endl;
     }
 
     // material
@@ -318,17 +334,9 @@ MeshData ModelLoader::ProceesMesh(aiMesh *mesh, const aiScene *scene)
             const aiTexture *texture = scene->GetEmbeddedTexture(str.C_Str());
             if (texture)
             {
-                if (texture->CheckFormat("png") || texture->CheckFormat("jpg"))
+                if (texture->mHeight > 0 || texture->CheckFormat("png") || texture->CheckFormat("jpg"))
                 {
-                    std::string filename =
-                        std::string(std::filesystem::path(texture->mFilename.C_Str()).filename().string());
-                    meshData.albedoTextureFilename = basePath + filename;
-                    {
-                        std::ofstream os;
-                        os.open(meshData.albedoTextureFilename, std::ios::binary | std::ios::out);
-                        os.write((char *)texture->pcData, texture->mWidth);
-                        os.close();
-                    }
+                    meshData.albedoTextureFilename = EmbeddedTextureName(scene, texture);
                 }
             }
             else
@@ -344,17 +352,9 @@ MeshData ModelLoader::ProceesMesh(aiMesh *mesh, const aiScene *scene)
             const aiTexture *texture = scene->GetEmbeddedTexture(str.C_Str());
             if (texture)
             {
-                if (texture->CheckFormat("png") || texture->CheckFormat("jpg"))
+                if (texture->mHeight > 0 || texture->CheckFormat("png") || texture->CheckFormat("jpg"))
                 {
-                    std::string filename =
-                        std::string(std::filesystem::path(texture->mFilename.C_Str()).filename().string());
-                    meshData.albedoTextureFilename = basePath + filename;
-                    {
-                        std::ofstream os;
-                        os.open(meshData.albedoTextureFilename, std::ios::binary | std::ios::out);
-                        os.write((char *)texture->pcData, texture->mWidth);
-                        os.close();
-                    }
+                    meshData.albedoTextureFilename = EmbeddedTextureName(scene, texture);
                 }
             }
         }
@@ -398,33 +398,93 @@ void ModelLoader::UpdateBoneIDs(aiNode *node, int *count)
 
 void ModelLoader::ReadAnimationClip(const aiScene *scene)
 {
-    m_anim.clips.resize(scene->mNumAnimations);
+    ReadAnimationClips(scene, m_anim.boneNameToId, m_anim.clips);
+}
+
+std::vector<AnimationClip> ModelLoader::LoadAnimationClips(const char *filepath, const char *filename,
+                                                           const AnimationData &skeleton)
+{
+    std::vector<AnimationClip> clips;
+
+    uint8_t *fileFullpath = Utils::get_full_directory(filepath, filename);
+
+    // Meshes, materials and textures are dropped right after parsing, so none of the mesh
+    // post processing runs. Bones are matched to the skeleton by name.
+    Assimp::Importer import;
+    import.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, aiComponent_MESHES | aiComponent_MATERIALS |
+                                                          aiComponent_TEXTURES | aiComponent_LIGHTS |
+                                                          aiComponent_CAMERAS);
+    const aiScene *scene =
+        import.ReadFile((const char *)fileFullpath, aiProcess_RemoveComponent | aiProcess_ConvertToLeftHanded);
+
+    free(fileFullpath);
+
+    if (!scene || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
+        return clips;
+    }
+
+    ReadAnimationClips(scene, skeleton.boneNameToId, clips);
+
+    return clips;
+}
+
+void ModelLoader::ReadAnimationClips(const aiScene *scene, const std::unordered_map<std::string, int32_t> &boneNameToId,
+                                     std::vector<AnimationClip> &clips)
+{
+    clips.resize(scene->mNumAnimations);
     for (unsigned int i = 0; i < scene->mNumAnimations; i++)
     {
         aiAnimation *ani = scene->mAnimations[i];
 
-        auto &clip = m_anim.clips[i];
+        auto &clip = clips[i];
 
-        clip.name          = ani->mName.C_Str();
-        clip.duration      = ani->mDuration;
-        clip.tickPerSecond = ani->mTicksPerSecond;
+        clip.name     = ani->mName.C_Str();
+        clip.duration = ani->mDuration;
+        // Assimp leaves this at 0 when the file doesn't say, 25 is its own fallback.
+        clip.tickPerSecond = ani->mTicksPerSecond != 0.0 ? ani->mTicksPerSecond : 25.0;
         clip.numChannels   = ani->mNumChannels;
-        clip.keys.resize(m_anim.boneNameToId.size());
+        clip.tracks.resize(boneNameToId.size());
 
         for (unsigned int i = 0; i < ani->mNumChannels; i++)
         {
             const aiNodeAnim *nodeAnim = ani->mChannels[i];
-            const auto boneID          = m_anim.boneNameToId[nodeAnim->mNodeName.C_Str()];
-            clip.keys[boneID].resize(nodeAnim->mNumPositionKeys);
+
+            // Channels of nodes that don't deform the mesh have no bone.
+            auto it = boneNameToId.find(nodeAnim->mNodeName.C_Str());
+            if (it == boneNameToId.end())
+            {
+                continue;
+            }
+
+            auto &track = clip.tracks[it->second];
+
+            track.posTimes.resize(nodeAnim->mNumPositionKeys);
+            track.pos.resize(nodeAnim->mNumPositionKeys);
             for (unsigned int j = 0; j < nodeAnim->mNumPositionKeys; j++)
             {
-                auto pos   = nodeAnim->mPositionKeys[j].mValue;
-                auto rot   = nodeAnim->mRotationKeys[j].mValue;
-                auto scale = nodeAnim->mScalingKeys[j].mValue;
-                auto &key  = clip.keys[boneID][j];
-                key.pos    = {pos.x, pos.y, pos.z};
-                key.rot    = Quaternion(rot.x, rot.y, rot.z, rot.w);
-                key.scale  = {scale.x, scale.y, scale.z};
+                auto pos          = nodeAnim->mPositionKeys[j].mValue;
+                track.posTimes[j] = float(nodeAnim->mPositionKeys[j].mTime);
+                track.pos[j]      = {pos.x, pos.y, pos.z};
+            }
+
+            track.rotTimes.resize(nodeAnim->mNumRotationKeys);
+            track.rot.resize(nodeAnim->mNumRotationKeys);
+            for (unsigned int j = 0; j < nodeAnim->mNumRotationKeys; j++)
+            {
+                auto rot          = nodeAnim->mRotationKeys[j].mValue;
+                track.rotTimes[j] = float(nodeAnim->mRotationKeys[j].mTime);
+                track.rot[j]      = Quaternion(rot.x, rot.y, rot.z, rot.w);
+            }
+
+            track.scaleTimes.resize(nodeAnim->mNumScalingKeys);
+            track.scale.resize(nodeAnim->mNumScalingKeys);
+            for (unsigned int j = 0; j < nodeAnim->mNumScalingKeys; j++)
+            {
+                auto scale          = nodeAnim->mScalingKeys[j].mValue;
+                track.scaleTimes[j] = float(nodeAnim->mScalingKeys[j].mTime);
+                track.scale[j]      = {scale.x, scale.y, scale.z};
             }
         }
     }
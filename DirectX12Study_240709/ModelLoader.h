@@ -30,6 +30,11 @@ class ModelLoader
         return m_anim;
     }
 
+    // Reads only the animation clips of a file and maps their channels to the bones of skeleton by name.
+    // Safe to call from several threads at once.
+    static std::vector<AnimationClip> LoadAnimationClips(const char *filepath, const char *filename,
+                                                         const AnimationData &skeleton);
+
   private:
     void LoadObjFile(const char *filename);
     void LoadModel(const char *filename, bool isAnim = false);
@@ -38,7 +43,11 @@ class ModelLoader
     void FindDeformAnim(const aiScene *scene);
     void UpdateBoneIDs(aiNode *node, int* count);
     void ReadAnimationClip(const aiScene *scene);
+    static void ReadAnimationClips(const aiScene *scene, const std::unordered_map<std::string, int32_t> &boneNameToId,
+                                   std::vector<AnimationClip> &clips);
     aiNode *FindParent(aiNode *node);
+    // "*<index>" of an embedded texture, see MeshData::embeddedTextures.
+    static std::string EmbeddedTextureName(const aiScene *scene, const aiTexture *texture);
 
   private:
     std::string basePath = "";
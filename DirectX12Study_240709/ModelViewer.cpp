@@ -66,24 +66,16 @@ bool ModelViewer::Initialize()
             m_animClips = {"idle.fbx", "Running_60.fbx", "Right Strafe Walking.fbx", "Left Strafe Walking.fbx",
                            "Walking Backward.fbx"};
 
-            AnimationData animData = {};
-            for (const auto &clip : m_animClips)
-            {
-                auto [_, anim] = GeometryGenerator::ReadFromAnimationFile(m_basPath.c_str(), clip.c_str());
-
-                if (animData.clips.empty())
-                {
-                    animData = anim;
-                }
-                else
-                {
-                    animData.clips.push_back(anim.clips.front());
-                }
-            }
+            // The first file gives the skeleton, the others only their clips.
+            auto [_, animData] =
+                GeometryGenerator::ReadFromAnimationFile(m_basPath.c_str(), m_animClips.front().c_str());
+            GeometryGenerator::ReadAnimationClipFiles(
+                m_basPath.c_str(), std::vector<std::string>(m_animClips.begin() + 1, m_animClips.end()), animData);
 
             auto [model, material] = GeometryGenerator::ReadFromModelFile(m_basPath.c_str(), "comp_model.fbx");
 
-            ((SkinnedMeshModel *)skinnedModel)->Initialize(m_device, m_commandList, model, material, animData);
+            ((SkinnedMeshModel *)skinnedModel)->Initialize(m_device, m_commandList, model, material,
+                                                           AnimationAsset::Create(std::move(animData)));
             skinnedModel->GetMaterialConstCPU().useAlbedoMap = m_useTexture;
             skinnedModel->GetMaterialConstCPU().albedoFactor = Vector3(0.3f);
             skinnedModel->UpdateWorldMatrix(XMMatrixTranslation(0.0f, 0.5f, 0.0f));
@@ -291,13 +283,13 @@ void ModelViewer::Update(const float dt)
 
     if (model != nullptr)
     {
-        if (((SkinnedMeshModel *)m_opaqueList[0])->GetAnim().clips.size() > 0)
+        if (((SkinnedMeshModel *)m_opaqueList[0])->HasAnimation())
         {
             // update animation.
 
             {
-                static int frameCount = 0;
-                static int state      = 0;
+                static double animTime = 0.0;
+                static int state       = 0;
 
                 if (GameInput::IsFirstPressed(GameInput::kKey_up))
                 {
@@ -359,7 +351,9 @@ void ModelViewer::Update(const float dt)
                 if (m_aniPlayFlag)
                     state = m_selectedAnim;
 
-                ((SkinnedMeshModel *)m_opaqueList[0])->UpdateAnimation(state, frameCount++);
+                animTime += dt;
+                ((SkinnedMeshModel *)m_opaqueList[0])->UpdateAnimation(state, animTime);
+                ((SkinnedMeshModel *)m_opaqueList[0])->UploadAnimation(m_curFrameResource);
             }
         }
     }
@@ -0,0 +1,707 @@
+#include "pch.h"
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "ObjParser.h"
+#include "Stopwatch.h"
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+const uint32_t s_none = UINT32_MAX;
+
+// Exact in double, so a mantissa below 2^53 scaled by one of them is rounded once.
+const double s_pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Texture statements of a .mtl file and where they go.
+const std::pair<const char *, std::string MeshData::*> s_textureMaps[] = {
+    {"map_Kd", &MeshData::albedoTextureFilename},    {"map_Pm", &MeshData::metallicTextureFilename},
+    {"map_Pr", &MeshData::roughnessTextureFilename}, {"map_Bump", &MeshData::normalTextureFilename},
+    {"bump", &MeshData::normalTextureFilename},      {"norm", &MeshData::normalTextureFilename},
+    {"disp", &MeshData::heightTextureFilename},      {"map_Ke", &MeshData::emissionTextureFilename}};
+
+// What the lines of one chunk define. Face corners are position, texCoord and normal indices, 1 based from the
+// start of the file and 0 when missing. A negative (relative) index needs the counts of the chunks before, it is
+// stored 0 based from the start of the chunk and listed in relativeCorners until Load resolves it.
+struct Chunk
+{
+    std::vector<Vector3> positions;
+    std::vector<Vector2> texCoords;
+    std::vector<Vector3> normals;
+    std::vector<int32_t> corners;    // 3 per corner
+    std::vector<uint32_t> faceSizes; // corners per face
+    std::vector<uint32_t> relativeCorners;
+    std::vector<std::pair<uint32_t, std::string>> useMaterials; // usemtl before face first
+    std::vector<std::string> materialLibs;
+};
+
+// Faces [firstFace, endFace) of a chunk, all of one material.
+struct FaceRun
+{
+    uint32_t chunk;
+    uint32_t firstFace;
+    uint32_t endFace;
+    uint32_t firstCorner;
+};
+
+struct ObjMaterial
+{
+    MaterialConsts consts = {};
+    MeshData textures; // only the texture filenames
+};
+
+bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char *SkipSpaces(const char *p, const char *end)
+{
+    while (p < end && IsSpace(*p))
+        p++;
+    return p;
+}
+
+bool IsKeyword(const char *p, const char *end, const char *keyword)
+{
+    const size_t length = strlen(keyword);
+    return size_t(end - p) >= length && memcmp(p, keyword, length) == 0 &&
+           (size_t(end - p) == length || IsSpace(p[length]));
+}
+
+bool EqualsNoCase(const std::string &a, const char *b)
+{
+    if (a.size() != strlen(b))
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i]))
+            return false;
+    }
+    return true;
+}
+
+// Rest of the line without the surrounding spaces.
+std::string ReadName(const char *p, const char *end)
+{
+    p = SkipSpaces(p, end);
+    while (end > p && IsSpace(end[-1]))
+        end--;
+    return std::string(p, end);
+}
+
+bool ParseInt(const char *&p, const char *end, int32_t &value)
+{
+    const char *s       = p;
+    const bool negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+'))
+        s++;
+    if (s == end || unsigned(*s - '0') > 9)
+        return false;
+
+    int64_t v = 0;
+    for (; s < end && unsigned(*s - '0') <= 9; s++)
+        v = XMMin(v * 10 + (*s - '0'), int64_t(INT32_MAX));
+
+    value = int32_t(negative ? -v : v);
+    p     = s;
+    return true;
+}
+
+// Missing values stay 0, the element still counts for the indices.
+void ParseFloats(const char *p, const char *end, float *values, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        p = SkipSpaces(p, end);
+        if (!ObjParser::ParseFloat(p, end, values[i]))
+            return;
+    }
+}
+
+void ParseFace(const char *p, const char *end, Chunk &chunk)
+{
+    const int32_t counts[3] = {int32_t(chunk.positions.size()), int32_t(chunk.texCoords.size()),
+                               int32_t(chunk.normals.size())};
+
+    const size_t firstCorner   = chunk.corners.size();
+    const size_t firstRelative = chunk.relativeCorners.size();
+
+    // v, v/vt, v//vn or v/vt/vn
+    while (true)
+    {
+        p                = SkipSpaces(p, end);
+        int32_t index[3] = {0, 0, 0};
+        if (!ParseInt(p, end, index[0]))
+            break;
+        if (p < end && *p == '/')
+        {
+            p++;
+            ParseInt(p, end, index[1]);
+            if (p < end && *p == '/')
+            {
+                p++;
+                ParseInt(p, end, index[2]);
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            if (index[i] < 0)
+            {
+                chunk.relativeCorners.push_back(uint32_t(chunk.corners.size()));
+                index[i] += counts[i];
+            }
+            chunk.corners.push_back(index[i]);
+        }
+    }
+
+    const size_t size = (chunk.corners.size() - firstCorner) / 3;
+    if (size < 3)
+    {
+        chunk.corners.resize(firstCorner);
+        chunk.relativeCorners.resize(firstRelative);
+        return;
+    }
+    chunk.faceSizes.push_back(uint32_t(size));
+}
+
+void ParseLine(const char *p, const char *end, Chunk &chunk)
+{
+    if (end - p < 2)
+        return;
+
+    switch (p[0])
+    {
+    case 'v':
+        if (IsSpace(p[1]))
+        {
+            Vector3 position;
+            ParseFloats(p + 2, end, &position.x, 3);
+            chunk.positions.push_back(position);
+        }
+        else if (IsKeyword(p, end, "vt"))
+        {
+            Vector2 texCoord;
+            ParseFloats(p + 3, end, &texCoord.x, 2);
+            chunk.texCoords.push_back(texCoord);
+        }
+        else if (IsKeyword(p, end, "vn"))
+        {
+            Vector3 normal;
+            ParseFloats(p + 3, end, &normal.x, 3);
+            chunk.normals.push_back(normal);
+        }
+        break;
+    case 'f':
+        if (IsSpace(p[1]))
+            ParseFace(p + 2, end, chunk);
+        break;
+    case 'u':
+        if (IsKeyword(p, end, "usemtl"))
+            chunk.useMaterials.emplace_back(uint32_t(chunk.faceSizes.size()), ReadName(p + 6, end));
+        break;
+    case 'm':
+        if (IsKeyword(p, end, "mtllib"))
+            chunk.materialLibs.push_back(ReadName(p + 6, end));
+        break;
+    }
+}
+
+void ParseChunk(const char *p, const char *end, Chunk &chunk)
+{
+    while (p < end)
+    {
+        const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+            lineEnd = end;
+        ParseLine(SkipSpaces(p, lineEnd), lineEnd, chunk);
+        p = lineEnd + 1;
+    }
+}
+
+void ReadMaterialLib(const std::string &path, const std::string &folder,
+                     std::unordered_map<std::string, ObjMaterial> &library)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "ObjParser : can't open " << path << std::endl;
+        return;
+    }
+
+    ObjMaterial *material = nullptr;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const char *end        = line.data() + line.size();
+        const char *p          = SkipSpaces(line.data(), end);
+        const char *keywordEnd = p;
+        while (keywordEnd < end && !IsSpace(*keywordEnd))
+            keywordEnd++;
+        const std::string keyword(p, keywordEnd);
+
+        if (keyword == "newmtl")
+        {
+            material = &library[ReadName(keywordEnd, end)];
+            continue;
+        }
+        if (!material || keyword.empty() || keyword[0] == '#')
+            continue;
+
+        if (keyword == "Kd")
+            ParseFloats(keywordEnd, end, &material->consts.albedoFactor.x, 3);
+        else if (keyword == "Ke")
+            ParseFloats(keywordEnd, end, &material->consts.emissionFactor.x, 3);
+        else if (keyword == "Pm")
+            ParseFloats(keywordEnd, end, &material->consts.metalnessFactor, 1);
+        else if (keyword == "Pr")
+            ParseFloats(keywordEnd, end, &material->consts.roughnessFactor, 1);
+        else
+        {
+            for (const auto &map : s_textureMaps)
+            {
+                if (EqualsNoCase(keyword, map.first))
+                {
+                    // Options (-bm 1 ...) come first, the file name is the last token.
+                    const std::string rest = ReadName(keywordEnd, end);
+                    const size_t space     = rest.find_last_of(" \t");
+                    material->textures.*map.second =
+                        folder + (space == std::string::npos ? rest : rest.substr(space + 1));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+uint32_t HashKey(const uint32_t *key)
+{
+    uint32_t h = key[0] * 0x9E3779B1u ^ key[1] * 0x85EBCA77u ^ key[2] * 0xC2B2AE3Du;
+    return h ^ (h >> 15);
+}
+
+// Open addressing map from position/texCoord/normal index tuples to vertices, keys holds 3 per vertex.
+class WeldTable
+{
+  public:
+    explicit WeldTable(size_t expected)
+    {
+        size_t size = 64;
+        while (size < expected * 2)
+            size *= 2;
+        m_slots.assign(size, s_none);
+    }
+
+    // The vertex of key, or s_none after reserving the slot for vertex.
+    uint32_t FindOrInsert(const uint32_t *key, uint32_t vertex, const std::vector<uint32_t> &keys)
+    {
+        if ((m_count + 1) * 2 > m_slots.size())
+            Grow(keys);
+
+        const size_t mask = m_slots.size() - 1;
+        for (size_t slot = HashKey(key) & mask;; slot = (slot + 1) & mask)
+        {
+            const uint32_t found = m_slots[slot];
+            if (found == s_none)
+            {
+                m_slots[slot] = vertex;
+                m_count++;
+                return s_none;
+            }
+            if (memcmp(&keys[3 * found], key, 3 * sizeof(uint32_t)) == 0)
+                return found;
+        }
+    }
+
+  private:
+    void Grow(const std::vector<uint32_t> &keys)
+    {
+        std::vector<uint32_t> old(m_slots.size() * 2, s_none);
+        old.swap(m_slots);
+
+        const size_t mask = m_slots.size() - 1;
+        for (uint32_t vertex : old)
+        {
+            if (vertex == s_none)
+                continue;
+            size_t slot = HashKey(&keys[3 * vertex]) & mask;
+            while (m_slots[slot] != s_none)
+                slot = (slot + 1) & mask;
+            m_slots[slot] = vertex;
+        }
+    }
+
+    std::vector<uint32_t> m_slots;
+    size_t m_count = 0;
+};
+
+// Welds and triangulates the faces of runs into mesh. Returns the faces skipped for an index out of range.
+uint32_t BuildMesh(const std::vector<Chunk> &chunks, const std::vector<FaceRun> &runs,
+                   const std::vector<Vector3> &positions, const std::vector<Vector2> &texCoords,
+                   const std::vector<Vector3> &normals, MeshData &mesh)
+{
+    size_t numCorners = 0, numTriangles = 0;
+    for (const FaceRun &run : runs)
+    {
+        for (uint32_t f = run.firstFace; f < run.endFace; f++)
+        {
+            numCorners += chunks[run.chunk].faceSizes[f];
+            numTriangles += chunks[run.chunk].faceSizes[f] - 2;
+        }
+    }
+
+    const uint32_t limits[3] = {uint32_t(positions.size()), uint32_t(texCoords.size()), uint32_t(normals.size())};
+
+    // Closed meshes share each vertex between about 4 corners, reserve for that and grow past it.
+    WeldTable table(numCorners / 4);
+    std::vector<uint32_t> keys;    // 3 per vertex
+    std::vector<uint32_t> polygon; // 3 per corner of the current face, then its vertices
+    std::vector<uint32_t> faceVertices;
+    keys.reserve(3 * (numCorners / 4));
+    mesh.vertices.reserve(numCorners / 4);
+    mesh.indices.reserve(numTriangles * 3);
+    uint32_t numInvalid = 0;
+
+    for (const FaceRun &run : runs)
+    {
+        const Chunk &chunk = chunks[run.chunk];
+        uint32_t corner    = run.firstCorner;
+        for (uint32_t f = run.firstFace; f < run.endFace; f++)
+        {
+            const uint32_t size = chunk.faceSizes[f];
+            const int32_t *face = &chunk.corners[3 * size_t(corner)];
+            corner += size;
+
+            // 0 based indices, s_none for a missing texCoord or normal.
+            polygon.resize(3 * size);
+            bool isValid = true;
+            for (uint32_t i = 0; i < 3 * size; i++)
+            {
+                const uint32_t slot = i % 3;
+                if (face[i] == 0 && slot > 0)
+                {
+                    polygon[i] = s_none;
+                    continue;
+                }
+                polygon[i] = uint32_t(face[i] - 1);
+                isValid    = isValid && face[i] > 0 && polygon[i] < limits[slot];
+            }
+            if (!isValid)
+            {
+                numInvalid++;
+                continue;
+            }
+
+            faceVertices.resize(size);
+            for (uint32_t i = 0; i < size; i++)
+            {
+                const uint32_t *key   = &polygon[3 * i];
+                const uint32_t vertex = uint32_t(mesh.vertices.size());
+                const uint32_t found  = table.FindOrInsert(key, vertex, keys);
+                if (found != s_none)
+                {
+                    faceVertices[i] = found;
+                    continue;
+                }
+
+                keys.insert(keys.end(), key, key + 3);
+                Vertex v;
+                v.position = positions[key[0]];
+                v.position.z *= -1.0f;
+                if (key[1] != s_none)
+                    v.texCoord = Vector2(texCoords[key[1]].x, 1.0f - texCoords[key[1]].y);
+                if (key[2] != s_none)
+                {
+                    v.normal = normals[key[2]];
+                    v.normal.z *= -1.0f;
+                }
+                mesh.vertices.push_back(v);
+                faceVertices[i] = vertex;
+            }
+
+            // Fan, clockwise once z is flipped.
+            for (uint32_t i = 1; i + 1 < size; i++)
+            {
+                mesh.indices.push_back(faceVertices[0]);
+                mesh.indices.push_back(faceVertices[i + 1]);
+                mesh.indices.push_back(faceVertices[i]);
+            }
+        }
+    }
+
+    // Vertices the file gave no normal.
+    bool hasMissingNormals = false;
+    for (size_t i = 0; i < mesh.vertices.size() && !hasMissingNormals; i++)
+        hasMissingNormals = keys[3 * i + 2] == s_none;
+
+    if (hasMissingNormals)
+    {
+        for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        {
+            Vertex &v0           = mesh.vertices[mesh.indices[i]];
+            Vertex &v1           = mesh.vertices[mesh.indices[i + 1]];
+            Vertex &v2           = mesh.vertices[mesh.indices[i + 2]];
+            const Vector3 normal = (v1.position - v0.position).Cross(v2.position - v0.position);
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (keys[3 * mesh.indices[i + k] + 2] == s_none)
+                    mesh.vertices[mesh.indices[i + k]].normal += normal;
+            }
+        }
+        for (size_t i = 0; i < mesh.vertices.size(); i++)
+        {
+            if (keys[3 * i + 2] == s_none)
+                mesh.vertices[i].normal.Normalize();
+        }
+    }
+
+    return numInvalid;
+}
+} // namespace
+
+bool ObjParser::Load(const std::string &path, std::vector<MeshData> &meshes, std::vector<MaterialConsts> &materials,
+                     ObjParseStats *stats)
+{
+    const Stopwatch stopwatch;
+
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    const char *data  = reinterpret_cast<const char *>(file.GetData());
+    const size_t size = file.GetSize();
+
+    // Each chunk starts after the first line break past its nominal start.
+    const size_t numChunks = (size + sm_chunkSize - 1) / sm_chunkSize;
+    std::vector<size_t> bounds(numChunks + 1, size);
+    bounds[0] = 0;
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        const size_t at     = XMMax(i * sm_chunkSize, bounds[i - 1]);
+        const void *newline = at < size ? memchr(data + at, '\n', size - at) : nullptr;
+        bounds[i]           = newline ? size_t(static_cast<const char *>(newline) - data) + 1 : size;
+    }
+
+    std::vector<Chunk> chunks(numChunks);
+    g_JobSystem.ParallelFor(uint32_t(numChunks), 1, [&](uint32_t first, uint32_t last, uint32_t threadIndex) {
+        for (uint32_t i = first; i < last; i++)
+            ParseChunk(data + bounds[i], data + bounds[i + 1], chunks[i]);
+    });
+
+    // Concatenate the elements and make every index absolute.
+    size_t totals[3] = {0, 0, 0};
+    for (const Chunk &chunk : chunks)
+    {
+        totals[0] += chunk.positions.size();
+        totals[1] += chunk.texCoords.size();
+        totals[2] += chunk.normals.size();
+    }
+
+    std::vector<Vector3> positions;
+    std::vector<Vector2> texCoords;
+    std::vector<Vector3> normals;
+    positions.reserve(totals[0]);
+    texCoords.reserve(totals[1]);
+    normals.reserve(totals[2]);
+
+    std::vector<std::string> materialLibs;
+    for (Chunk &chunk : chunks)
+    {
+        const int32_t bases[3] = {int32_t(positions.size()), int32_t(texCoords.size()), int32_t(normals.size())};
+        for (uint32_t corner : chunk.relativeCorners)
+            chunk.corners[corner] += bases[corner % 3] + 1;
+
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        chunk.positions = {};
+        chunk.texCoords = {};
+        chunk.normals   = {};
+
+        for (const std::string &lib : chunk.materialLibs)
+        {
+            if (std::find(materialLibs.begin(), materialLibs.end(), lib) == materialLibs.end())
+                materialLibs.push_back(lib);
+        }
+    }
+
+    const double parseMs = stopwatch.GetElapsedMs();
+
+    // One mesh per material, in the order of first use.
+    std::vector<std::string> meshMaterials;
+    std::unordered_map<std::string, uint32_t> meshOfMaterial;
+    std::vector<std::vector<FaceRun>> runs;
+    std::string material = "";
+    uint32_t numFaces    = 0;
+    for (uint32_t c = 0; c < uint32_t(chunks.size()); c++)
+    {
+        const Chunk &chunk = chunks[c];
+        const uint32_t end = uint32_t(chunk.faceSizes.size());
+        size_t next        = 0;
+        uint32_t face = 0, corner = 0;
+        while (face < end || next < chunk.useMaterials.size())
+        {
+            while (next < chunk.useMaterials.size() && chunk.useMaterials[next].first <= face)
+                material = chunk.useMaterials[next++].second;
+            if (face == end)
+                break;
+
+            const uint32_t runEnd = next < chunk.useMaterials.size() ? chunk.useMaterials[next].first : end;
+            auto found            = meshOfMaterial.find(material);
+            if (found == meshOfMaterial.end())
+            {
+                found = meshOfMaterial.emplace(material, uint32_t(runs.size())).first;
+                meshMaterials.push_back(material);
+                runs.emplace_back();
+            }
+            runs[found->second].push_back({c, face, runEnd, corner});
+
+            for (; face < runEnd; face++)
+                corner += chunk.faceSizes[face];
+        }
+        numFaces += end;
+    }
+
+    std::vector<MeshData> built(runs.size());
+    std::vector<uint32_t> numInvalid(runs.size(), 0);
+    g_JobSystem.ParallelFor(uint32_t(runs.size()), 1, [&](uint32_t first, uint32_t last, uint32_t threadIndex) {
+        for (uint32_t i = first; i < last; i++)
+            numInvalid[i] = BuildMesh(chunks, runs[i], positions, texCoords, normals, built[i]);
+    });
+
+    std::unordered_map<std::string, ObjMaterial> library;
+    const std::string parent = std::filesystem::path(path).parent_path().string();
+    const std::string folder = parent.empty() ? "" : parent + "/";
+    for (const std::string &lib : materialLibs)
+        ReadMaterialLib(folder + lib, folder, library);
+
+    ObjParseStats result;
+    for (size_t i = 0; i < built.size(); i++)
+    {
+        result.numInvalidFaces += numInvalid[i];
+        if (built[i].indices.empty())
+            continue;
+
+        const auto found = library.find(meshMaterials[i]);
+        if (found != library.end())
+        {
+            for (const auto &map : s_textureMaps)
+                built[i].*map.second = found->second.textures.*map.second;
+        }
+        materials.push_back(found != library.end() ? found->second.consts : MaterialConsts{});
+
+        result.numVertices += uint32_t(built[i].vertices.size());
+        result.numTriangles += uint32_t(built[i].indices.size() / 3);
+        meshes.push_back(std::move(built[i]));
+    }
+
+    if (stats)
+    {
+        result.fileSize     = size;
+        result.numChunks    = uint32_t(numChunks);
+        result.numPositions = uint32_t(positions.size());
+        result.numTexCoords = uint32_t(texCoords.size());
+        result.numNormals   = uint32_t(normals.size());
+        result.numFaces     = numFaces;
+        result.parseMs      = parseMs;
+        result.buildMs      = stopwatch.GetElapsedMs() - parseMs;
+        *stats              = result;
+    }
+    return true;
+}
+
+bool ObjParser::ParseFloat(const char *&p, const char *end, float &value)
+{
+    const char *s       = p;
+    const bool negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+'))
+        s++;
+    const char *digits = s;
+
+    uint64_t mantissa = 0;
+    int32_t numDigits = 0; // significant, leading zeros don't count
+    int32_t exponent  = 0;
+    bool hasDigits    = false;
+    bool isTruncated  = false;
+    for (; s < end && unsigned(*s - '0') <= 9; s++)
+    {
+        hasDigits = true;
+        if (numDigits < 19)
+        {
+            mantissa = mantissa * 10 + (*s - '0');
+            numDigits += mantissa != 0;
+        }
+        else
+        {
+            exponent++;
+            isTruncated = true;
+        }
+    }
+    if (s < end && *s == '.')
+    {
+        for (s++; s < end && unsigned(*s - '0') <= 9; s++)
+        {
+            hasDigits = true;
+            if (numDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                numDigits += mantissa != 0;
+                exponent--;
+            }
+            else
+            {
+                isTruncated = true;
+            }
+        }
+    }
+    if (hasDigits && s < end && (*s == 'e' || *s == 'E'))
+    {
+        const char *e = s + 1;
+        int32_t e10   = 0;
+        if (ParseInt(e, end, e10))
+        {
+            exponent = int32_t(XMMax(XMMin(int64_t(exponent) + e10, int64_t(100000)), int64_t(-100000)));
+            s        = e;
+        }
+    }
+
+    if (hasDigits && !isTruncated && numDigits <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        const double scale = s_pow10[exponent < 0 ? -exponent : exponent];
+        const double v     = exponent < 0 ? double(mantissa) / scale : double(mantissa) * scale;
+        value              = float(negative ? -v : v);
+        p              = s;
+        return true;
+    }
+
+    // Long mantissas, large exponents, inf and nan.
+    float parsed      = 0.0f;
+    const auto result = std::from_chars(digits, end, parsed);
+    if (result.ec == std::errc::invalid_argument)
+    {
+        return false;
+    }
+    value = negative ? -parsed : parsed;
+    p     = result.ptr;
+    return true;
+}
+
+void ObjParser::Report(const std::string &name, const ObjParseStats &stats)
+{
+    const double megabytes = double(stats.fileSize) / (1024.0 * 1024.0);
+    const double totalMs   = stats.parseMs + stats.buildMs;
+    std::cout << name << " : " << megabytes << " MB in " << totalMs << " ms (" << megabytes / (totalMs / 1000.0)
+              << " MB/s, " << stats.numChunks << " chunks, parse " << stats.parseMs << " ms, weld " << stats.buildMs
+              << " ms), " << stats.numPositions << " positions, " << stats.numTexCoords << " texCoords, "
+              << stats.numNormals << " normals, " << stats.numFaces << " faces -> " << stats.numVertices
+              << " vertices, " << stats.numTriangles << " triangles";
+    if (stats.numInvalidFaces > 0)
+        std::cout << ", " << stats.numInvalidFaces << " faces with invalid indices skipped";
+    std::cout << std::endl;
+}
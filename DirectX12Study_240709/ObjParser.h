@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ConstantBuffer.h"
+#include "Mesh.h"
+
+struct ObjParseStats
+{
+    size_t fileSize          = 0;
+    uint32_t numChunks       = 0;
+    uint32_t numPositions    = 0;
+    uint32_t numTexCoords    = 0;
+    uint32_t numNormals      = 0;
+    uint32_t numFaces        = 0;
+    uint32_t numInvalidFaces = 0; // index out of range, skipped
+    uint32_t numVertices     = 0; // welded position/texCoord/normal tuples
+    uint32_t numTriangles    = 0;
+    double parseMs           = 0.0;
+    double buildMs           = 0.0;
+};
+
+// Wavefront OBJ reader. The file is mapped and cut into line aligned chunks parsed in parallel on g_JobSystem,
+// then the faces of each material are welded into an indexed MeshData, one job per material. The result matches
+// what Assimp gives ModelLoader with aiProcess_Triangulate | aiProcess_ConvertToLeftHanded : z and v flipped,
+// clockwise triangles, one mesh and one MaterialConsts per material.
+class ObjParser
+{
+  public:
+    // mtllib files are read from the folder of path. Vertices without a normal in the file get the area weighted
+    // normal of their faces. False if path can't be read.
+    static bool Load(const std::string &path, std::vector<MeshData> &meshes, std::vector<MaterialConsts> &materials,
+                     ObjParseStats *stats = nullptr);
+
+    // Decimal float at p, p moves past it. Up to 15 significant digits and exponents up to 22 are converted with one
+    // rounding in double, anything else goes to std::from_chars.
+    static bool ParseFloat(const char *&p, const char *end, float &value);
+
+    static void Report(const std::string &name, const ObjParseStats &stats);
+
+  public:
+    static const size_t sm_chunkSize = 4 << 20; // text per job
+};
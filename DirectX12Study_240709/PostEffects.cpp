@@ -10,10 +10,8 @@ void PostEffects::Initialize()
 
     D3DUtils::CreateDefaultBuffer(Graphics::g_Device, &mesh.vertexBuffer, square.vertices.data(),
                                   uint32_t(square.vertices.size() * sizeof(Vertex)));
-    D3DUtils::CreateDefaultBuffer(Graphics::g_Device, &mesh.indexBuffer, square.indices.data(),
-                                  uint32_t(square.indices.size() * sizeof(MeshData::index_t)));
+    mesh.CreateIndexBuffer(Graphics::g_Device, square);
     mesh.vertexCount = uint32_t(square.vertices.size());
-    mesh.indexCount  = uint32_t(square.indices.size());
     mesh.stride      = sizeof(Vertex);
 }
 
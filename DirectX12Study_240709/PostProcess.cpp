@@ -11,10 +11,8 @@ void PostProcess::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* cm
 
 	D3DUtils::CreateDefaultBuffer(Graphics::g_Device, &mesh.vertexBuffer, square.vertices.data(),
 		uint32_t(square.vertices.size() * sizeof(Vertex)));
-	D3DUtils::CreateDefaultBuffer(Graphics::g_Device, &mesh.indexBuffer, square.indices.data(),
-		uint32_t(square.indices.size() * sizeof(MeshData::index_t)));
+	mesh.CreateIndexBuffer(Graphics::g_Device, square);
 	mesh.vertexCount = uint32_t(square.vertices.size());
-	mesh.indexCount = uint32_t(square.indices.size());
 	mesh.stride = sizeof(Vertex);
 
 	m_bloomBuffers.resize(bloomLevels);
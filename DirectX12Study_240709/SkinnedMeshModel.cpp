@@ -1,42 +1,191 @@
 #include "pch.h"
 
+#include "FrameResource.h"
 #include "SkinnedMeshModel.h"
 
+namespace
+{
+// Spreads reduced rate updates of the models over frames.
+uint32_t s_animPhase = 0;
+} // namespace
+
 void SkinnedMeshModel::Initialize(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
                                   std::vector<MeshData> meshes, std::vector<MaterialConsts> material,
-                                  AnimationData anim)
+                                  std::shared_ptr<AnimationAsset> anim)
 {
-    if (!anim.clips.empty())
-    {
-        m_anim = anim;
+    m_anim      = anim;
+    m_animPhase = s_animPhase++;
 
-        m_boneTransform.Initialize(device, uint32_t(m_anim.clips.front().keys.size()));
+    if (HasAnimation())
+    {
+        m_palette.assign(m_anim->GetData().GetNumBones(), Matrix());
 
-        Matrix m = Matrix();
-        for (size_t i = 0; i < m_anim.clips.front().keys.size(); i++)
+        if (m_useCpuSkinning)
         {
-            m_boneTransform.Upload(int(i), (void *)&m);
+            m_cpuSkinner.Initialize(meshes, m_cpuSkinningBVH);
         }
     }
 
     Model::Initialize(device, commandList, meshes, material);
 }
 
-void SkinnedMeshModel::UpdateAnimation(int clipID, int frameCount)
+void SkinnedMeshModel::UpdateAnimationLod(const Vector3 &eyePos, const AnimationLodSettings &settings)
+{
+    const float distance = (GetWorldRow().Translation() - eyePos).Length();
+    const float size     = distance > 0.0f ? settings.radius / distance : 1.0f;
+
+    uint32_t lod = 0;
+    while (lod < 3 && size < settings.projectedSize[lod])
+    {
+        lod++;
+    }
+
+    m_animLod         = lod;
+    m_skipDetailBones = lod >= settings.skipDetailBonesLod;
+    m_useBaked        = m_anim && m_anim->HasBaked() && lod >= settings.bakedLod;
+}
+
+void SkinnedMeshModel::UpdateAnimation(int clipID, double time)
+{
+    const uint32_t interval = 1u << m_animLod;
+    const double dt         = m_animFrame > 0 ? time - m_lastAnimTime : 0.0;
+
+    const bool restart = clipID != m_lodClipID || m_posePalette[1].empty();
+    const bool due     = restart || (m_animFrame + m_animPhase) % interval == 0 || time >= m_poseTime[1];
+
+    m_lastAnimTime = time;
+    m_animFrame++;
+    m_lodClipID = clipID;
+
+    if (m_useBaked)
+    {
+        m_bakedOffset = m_anim->UpdateBaked(m_animState, clipID, time);
+        m_lodClipID   = -1; // restart the blend when the model goes back to live evaluation
+    }
+    else if (interval == 1)
+    {
+        m_palette = m_anim->Update(m_animState, clipID, time, m_skipDetailBones);
+        m_posePalette[1].clear();
+    }
+    else
+    {
+        if (due)
+        {
+            // Blend from what is on screen now to the pose at the next update of this model.
+            m_posePalette[0] = restart ? m_anim->Update(m_animState, clipID, time, m_skipDetailBones) : m_palette;
+            m_poseTime[0]    = time;
+
+            m_poseTime[1]    = time + XMMax(dt, 0.0) * interval;
+            m_posePalette[1] = m_anim->Update(m_animState, clipID, m_poseTime[1], m_skipDetailBones);
+        }
+
+        const double span = m_poseTime[1] - m_poseTime[0];
+        const float f     = span > 0.0 ? float(std::clamp((time - m_poseTime[0]) / span, 0.0, 1.0)) : 1.0f;
+
+        m_palette.resize(m_posePalette[1].size());
+        for (size_t i = 0; i < m_palette.size(); i++)
+        {
+            m_palette[i] = Matrix::Lerp(m_posePalette[0][i], m_posePalette[1][i], f);
+        }
+    }
+
+    // Root motion follows the real time on every path, whatever the pose update rate is.
+    m_anim->UpdateRootMotion(m_animState, clipID, time);
+    m_rootMotion = m_anim->GetRootMotion(m_animState);
+
+    if (m_useCpuSkinning && !m_useBaked)
+    {
+        m_cpuSkinner.Skin(m_palette);
+    }
+}
+
+BoundingBox SkinnedMeshModel::GetSkinnedBounds()
 {
-    m_anim.Update(clipID, frameCount);
+    BoundingBox bounds;
+    m_cpuSkinner.GetBounds().Transform(bounds, m_rootMotion * GetWorldRow());
+    return bounds;
+}
+
+bool SkinnedMeshModel::IntersectsSkinned(const Vector3 &origin, const Vector3 &dir, float &dist)
+{
+    const Matrix world    = m_rootMotion * GetWorldRow();
+    const Matrix worldInv = world.Invert();
+
+    // Model space ray. The world matrix may scale, so the hit distance is measured again in world space.
+    const Vector3 localOrigin = Vector3::Transform(origin, worldInv);
+    Vector3 localDir          = Vector3::TransformNormal(dir, worldInv);
+    localDir.Normalize();
 
-    for (size_t i = 0; i < m_anim.clips.front().keys.size(); i++)
+    float localDist = 0.0f;
+    if (!m_cpuSkinner.Intersects(localOrigin, localDir, localDist))
     {
-        Matrix m = m_anim.Get(clipID, int(i), frameCount).Transpose();
-        m_boneTransform.Upload(int(i), &m);
+        return false;
     }
+
+    dist = (Vector3::Transform(localOrigin + localDir * localDist, world) - origin).Length();
+    return true;
+}
+
+void SkinnedMeshModel::UploadAnimation(FrameResource *frame)
+{
+    if (!HasAnimation())
+    {
+        return;
+    }
+
+    if (m_useBaked)
+    {
+        // Nothing to copy, the shader reads the baked frame.
+        m_meshConstsData.boneOffset = m_bakedOffset;
+        m_bonePaletteGPU            = m_anim->GetBakedPaletteGPU();
+    }
+    else
+    {
+        // Every character of the frame goes into the frame's bone buffer. The shader finds this one by boneOffset.
+        m_meshConstsData.boneOffset = frame->AllocateBonePalette(m_palette.data(), uint32_t(m_palette.size()));
+        m_bonePaletteGPU            = frame->m_bonePaletteBuffer->GetResource()->GetGPUVirtualAddress();
+    }
+
+    // Update() already ran this frame. Upload the offset and the new root motion to the same frame resource.
+    UpdateRootMotion();
+    if (m_useFrameResource)
+    {
+        frame->m_meshConstsBuffer->Upload(m_cbIndex, &m_meshConstsData);
+    }
+}
+
+void SkinnedMeshModel::Update(UploadBuffer<MeshConsts> *meshGPU, UploadBuffer<MaterialConsts> *materialGPU)
+{
+    UpdateRootMotion();
+
+    Model::Update(meshGPU, materialGPU);
+}
+
+// The shared palette has no root motion. Apply it through the world matrix of this model.
+void SkinnedMeshModel::UpdateRootMotion()
+{
+    if (!HasAnimation())
+    {
+        return;
+    }
+
+    Matrix world   = m_rootMotion * GetWorldRow();
+    Matrix worldIT = world;
+    worldIT.Translation(Vector3(0.0f));
+    worldIT = worldIT.Invert().Transpose();
+
+    m_meshConstsData.world   = world.Transpose();
+    m_meshConstsData.worldIT = worldIT.Transpose();
 }
 
 void SkinnedMeshModel::Render(ID3D12GraphicsCommandList *commandList)
 {
-    //commandList->SetGraphicsRootConstantBufferView(7, m_boneTransform.GetResource()->GetGPUVirtualAddress());
-    commandList->SetGraphicsRootShaderResourceView(7, m_boneTransform.GetResource()->GetGPUVirtualAddress());
+    if (m_bonePaletteGPU == 0)
+    {
+        return; // UploadAnimation has not run yet
+    }
+
+    commandList->SetGraphicsRootShaderResourceView(7, m_bonePaletteGPU);
 
     Model::Render(commandList);
 }
@@ -44,11 +193,10 @@ void SkinnedMeshModel::Render(ID3D12GraphicsCommandList *commandList)
 void SkinnedMeshModel::BuildMeshBuffers(ID3D12Device *device, Mesh &mesh, MeshData &meshData)
 {
     // Create vertex buffer view
-    D3DUtils::CreateDefaultBuffer(device, &mesh.vertexBuffer, meshData.skinnedVertices.data(),
-                                  uint32_t(meshData.skinnedVertices.size() * sizeof(SkinnedVertex)));
-    D3DUtils::CreateDefaultBuffer(device, &mesh.indexBuffer, meshData.indices.data(),
-                                  uint32_t(meshData.indices.size() * sizeof(uint32_t)));
-    mesh.vertexCount = uint32_t(meshData.skinnedVertices.size());
+    const ConstArray<SkinnedVertex> vertices = meshData.GetSkinnedVertices();
+    D3DUtils::CreateDefaultBuffer(device, &mesh.vertexBuffer, vertices.data,
+                                  uint32_t(vertices.size() * sizeof(SkinnedVertex)));
+    mesh.CreateIndexBuffer(device, meshData);
+    mesh.vertexCount = uint32_t(vertices.size());
     mesh.stride      = sizeof(SkinnedVertex);
-    mesh.indexCount  = uint32_t(meshData.indices.size());
 }
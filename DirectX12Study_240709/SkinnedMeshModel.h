@@ -1,18 +1,72 @@
 #pragma once
 
+#include "AnimationAsset.h"
+#include "CpuSkinner.h"
 #include "Model.h"
 
+// Animation LOD by projected size (bounding radius / distance to the camera).
+// LOD n evaluates the pose every 2^n frames and blends between evaluated poses in between.
+struct AnimationLodSettings
+{
+    float radius                = 1.0f;                  // models are normalized to about 1
+    float projectedSize[3]      = {0.1f, 0.05f, 0.025f}; // LOD 1, 2 and 3 start below these
+    uint32_t skipDetailBonesLod = 2;                     // fingers and end bones keep the first key from here on
+    uint32_t bakedLod           = 3;                     // baked palettes from here on, if the asset has them
+};
+
+class FrameResource;
+
 class SkinnedMeshModel : public Model
 {
   public:
     void Initialize(ID3D12Device *device, ID3D12GraphicsCommandList *commandList, std::vector<MeshData> meshe,
-                    std::vector<MaterialConsts> material, AnimationData anim = {});
-    void UpdateAnimation(int clipID, int frameCount);
+                    std::vector<MaterialConsts> material, std::shared_ptr<AnimationAsset> anim = nullptr);
+    // Call before UpdateAnimation.
+    void UpdateAnimationLod(const Vector3 &eyePos, const AnimationLodSettings &settings = AnimationLodSettings());
+    // time : playback time in seconds.
+    void UpdateAnimation(int clipID, double time);
+    // Copies the palette into the frame's bone buffer. Call after UpdateAnimation, before rendering.
+    void UploadAnimation(FrameResource *frame);
+    virtual void Update(UploadBuffer<MeshConsts> *meshGPU, UploadBuffer<MaterialConsts> *materialGPU) override;
     virtual void Render(ID3D12GraphicsCommandList *commandList);
 
-    AnimationData GetAnim()
+    // Skins the positions on the CPU as well after every UpdateAnimation, for tight bounds and picking.
+    // Call before Initialize. Models playing baked palettes keep their last result.
+    void EnableCpuSkinning(bool buildBVH = false)
+    {
+        m_useCpuSkinning = true;
+        m_cpuSkinningBVH = buildBVH;
+    }
+
+    bool HasCpuSkinning() const
+    {
+        return m_useCpuSkinning && m_cpuSkinner.GetNumMeshes() > 0;
+    }
+
+    // World space bounds of the skinned mesh. Needs EnableCpuSkinning.
+    BoundingBox GetSkinnedBounds();
+
+    // World space ray against the skinned triangles. Needs EnableCpuSkinning.
+    bool IntersectsSkinned(const Vector3 &origin, const Vector3 &dir, float &dist);
+
+    bool HasAnimation() const
     {
-        return m_anim;
+        return m_anim && !m_anim->GetData().clips.empty();
+    }
+
+    const AnimationData &GetAnim() const
+    {
+        return m_anim->GetData();
+    }
+
+    const AnimationState &GetAnimState() const
+    {
+        return m_animState;
+    }
+
+    uint32_t GetAnimationLod() const
+    {
+        return m_animLod;
     }
 
     virtual ID3D12PipelineState *GetPSO(bool isWireFrame) override
@@ -27,8 +81,29 @@ class SkinnedMeshModel : public Model
 
   private:
     virtual void BuildMeshBuffers(ID3D12Device *device, Mesh &mesh, MeshData &meshData) override;
+    void UpdateRootMotion();
 
   private:
-    UploadBuffer<Matrix> m_boneTransform;
-    AnimationData m_anim;
+    D3D12_GPU_VIRTUAL_ADDRESS m_bonePaletteGPU = 0;
+    std::shared_ptr<AnimationAsset> m_anim;
+    AnimationState m_animState;
+    std::vector<Matrix> m_palette;
+    Matrix m_rootMotion = Matrix();
+
+    // animation LOD
+    uint32_t m_animLod     = 0;
+    bool m_skipDetailBones = false;
+    bool m_useBaked        = false;
+    uint32_t m_bakedOffset = 0;
+    uint32_t m_animPhase   = 0;
+    uint32_t m_animFrame   = 0;
+    int32_t m_lodClipID    = -1;
+    double m_lastAnimTime  = 0.0;
+    double m_poseTime[2]   = {0.0, 0.0}; // evaluated poses to blend between
+    std::vector<Matrix> m_posePalette[2];
+
+    // CPU skinning
+    CpuSkinner m_cpuSkinner;
+    bool m_useCpuSkinning = false;
+    bool m_cpuSkinningBVH = false;
 };
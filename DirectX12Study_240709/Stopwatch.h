@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+
+// Wall time since construction, for the load, bake and skinning timings. std::chrono only, so the sources that build
+// without windows.h can use it too.
+class Stopwatch
+{
+  public:
+    double GetElapsedMs() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_begin).count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_begin = std::chrono::steady_clock::now();
+};
@@ -1,5 +1,6 @@
 #include "pch.h"
 
+#include "MeshOptimizer.h"
 #include "Model.h"
 #include "Terrain.h"
 #include "Frustum.h"
@@ -94,7 +95,13 @@ void Terrain::InitDivideQuad(QuadTree **node, const float cx, const float cz, co
     (*node)->meshData = _m;
     //   Ʈ ߰
     (*node)->model = new Model;
-    (*node)->model->Initialize(m_device, m_commandList, {_m}, {}, true);
+
+    // The chunk is a triangle soup. Welded, its meshlets can share vertices, meshData keeps the soup for GetHeight.
+    MeshData welded = _m;
+    MeshOptimizer::Optimize(welded);
+    (*node)->model->EnableClusterCulling();
+    (*node)->model->EnableVertexQuantization();
+    (*node)->model->Initialize(m_device, m_commandList, {welded}, {}, true);
     (*node)->model->GetMaterialConstCPU().useAlbedoMap = true;
     (*node)->model->GetMaterialConstCPU().metalnessFactor = 0.0f;
     (*node)->model->GetMaterialConstCPU().roughnessFactor = 1.0f;
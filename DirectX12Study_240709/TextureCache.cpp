@@ -0,0 +1,160 @@
+#include "pch.h"
+
+#include "AppBase.h"
+#include "TextureCache.h"
+#include <filesystem>
+
+TextureCache g_TextureCache;
+
+namespace
+{
+// The mips of a normal map are renormalized, so they differ from the same file read as color.
+std::string ColorSpace(bool isSRGB, bool isNormalMap)
+{
+    return isSRGB ? "|srgb" : isNormalMap ? "|normal" : "|linear";
+}
+} // namespace
+
+CachedTexture::~CachedTexture()
+{
+    SAFE_RELEASE(resource);
+    SAFE_RELEASE(upload);
+}
+
+void TextureCacheStats::Report() const
+{
+    std::cout << "Texture cache : " << numCreated << " unique / " << numRequested << " requested textures, "
+              << numTablesCreated << " / " << numTablesRequested << " descriptor tables, " << numBytes / 1024
+              << " KB instead of " << numRequestedBytes / 1024 << " KB" << std::endl;
+}
+
+std::string TextureCache::MakeKey(const std::string &filename, bool isSRGB, bool isNormalMap, BC_FORMAT format)
+{
+    // "a/../b.png" and "b.png" are one file.
+    return "file:" + std::filesystem::path(filename).lexically_normal().generic_string() +
+           ColorSpace(isSRGB, isNormalMap) + "|" + TextureCompressor::GetName(format);
+}
+
+std::string TextureCache::MakeKey(const EmbeddedTexture &texture, bool isSRGB, bool isNormalMap)
+{
+    // By content, the same texture embedded in two models is shared and a freed model can't alias a new one.
+    uint64_t hash = 14695981039346656037ull;
+    for (uint8_t b : texture.data)
+    {
+        hash = (hash ^ b) * 1099511628211ull;
+    }
+    return "embedded:" + std::to_string(hash) + ":" + std::to_string(texture.data.size()) +
+           ColorSpace(isSRGB, isNormalMap);
+}
+
+std::string TextureCache::MakeKey(XMFLOAT3 color, bool isSRGB, bool isNormalMap)
+{
+    return "color:" + std::to_string(color.x) + "," + std::to_string(color.y) + "," + std::to_string(color.z) +
+           ColorSpace(isSRGB, isNormalMap);
+}
+
+std::shared_ptr<CachedTexture> TextureCache::Find(const std::string &key)
+{
+    auto it = m_textures.find(key);
+    return it != m_textures.end() ? it->second.lock() : nullptr;
+}
+
+std::shared_ptr<CachedTexture> TextureCache::Insert(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                                    const std::string &key, const TextureImage &image)
+{
+    auto texture      = NewTexture(key);
+    texture->upload   = D3DUtils::CreateTexture(device, commandList, image, &texture->resource);
+    texture->numBytes = image.pixels.size();
+
+    m_textures[key] = texture;
+    m_stats.numCreated++;
+    m_stats.numBytes += texture->numBytes;
+
+    return texture;
+}
+
+std::shared_ptr<CachedTexture> TextureCache::InsertDDS(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                                       const std::string &key, const std::string &ddsPath)
+{
+    const std::wstring wPath(ddsPath.begin(), ddsPath.end());
+
+    auto texture      = NewTexture(key);
+    texture->upload   = D3DUtils::CreateDDSTexture(device, commandList, wPath, &texture->resource);
+    texture->numBytes = std::filesystem::file_size(ddsPath);
+
+    m_textures[key] = texture;
+    m_stats.numCreated++;
+    m_stats.numBytes += texture->numBytes;
+
+    return texture;
+}
+
+std::shared_ptr<TextureTable> TextureCache::GetTable(ID3D12Device *device,
+                                                     const std::shared_ptr<CachedTexture> *textures)
+{
+    m_stats.numTablesRequested++;
+
+    TableKey key;
+    for (uint32_t i = 0; i < TextureTable::sm_numTextures; i++)
+    {
+        key[i] = textures[i].get();
+        m_stats.numRequested++;
+        m_stats.numRequestedBytes += textures[i]->numBytes;
+    }
+
+    // A live table keeps its textures alive, so its key can't have been reused by other textures.
+    auto &entry = m_tables[key];
+    if (std::shared_ptr<TextureTable> table = entry.lock())
+    {
+        return table;
+    }
+
+    DescriptorHandle handle;
+    if (!m_retiredTables.empty() && m_retiredTables.front().fence <= m_completedFence)
+    {
+        handle = m_retiredTables.front().handle;
+        m_retiredTables.pop();
+    }
+    else
+    {
+        handle = Graphics::s_Texture.Alloc(TextureTable::sm_numTextures);
+    }
+
+    // The descriptors go back to the cache with the last mesh using the table, frames in flight may still read them.
+    std::shared_ptr<TextureTable> table(new TextureTable, [this, key](TextureTable *released) {
+        m_tables.erase(key);
+        m_retiredTables.push({released->handle, m_nextFence});
+        delete released;
+    });
+    table->handle = handle;
+    for (uint32_t i = 0; i < TextureTable::sm_numTextures; i++)
+    {
+        table->textures[i]         = textures[i];
+        const DescriptorHandle srv = handle + i * Graphics::s_Texture.m_descriptorSize;
+        D3DUtils::CreateTextureSRV(device, textures[i]->resource, D3D12_CPU_DESCRIPTOR_HANDLE(srv));
+    }
+
+    entry = table;
+    m_stats.numTablesCreated++;
+
+    return table;
+}
+
+void TextureCache::Update(uint64_t nextFence, uint64_t completedFence)
+{
+    m_nextFence      = nextFence;
+    m_completedFence = completedFence;
+}
+
+std::shared_ptr<CachedTexture> TextureCache::NewTexture(const std::string &key)
+{
+    // Drops the entry with the last reference, unless key was inserted again while this one was alive.
+    return std::shared_ptr<CachedTexture>(new CachedTexture, [this, key](CachedTexture *released) {
+        auto it = m_textures.find(key);
+        if (it != m_textures.end() && it->second.expired())
+        {
+            m_textures.erase(it);
+        }
+        delete released;
+    });
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "DescriptorHeap.h"
+#include "TextureCompressor.h"
+#include <memory>
+
+// Texture owned by TextureCache handles, released with the last one.
+struct CachedTexture
+{
+    ~CachedTexture();
+
+    ID3D12Resource *resource = nullptr;
+    ID3D12Resource *upload   = nullptr; // kept as long as the texture, nothing tracks when the copy is done
+    uint64_t numBytes        = 0;       // pixels of the image or size of the DDS file
+};
+
+// SRVs of the material textures of a mesh (t4 ~ t10), contiguous for root parameter 4. Meshes using the same
+// textures share one table.
+struct TextureTable
+{
+    static const uint32_t sm_numTextures = 7; // albedo, metallic, roughness, normal, height, ao, emission
+
+    DescriptorHandle handle;
+    std::shared_ptr<CachedTexture> textures[sm_numTextures];
+};
+
+struct TextureCacheStats
+{
+    uint32_t numRequested       = 0; // textures of the tables asked for by meshes
+    uint32_t numCreated         = 0; // of those, decoded and uploaded
+    uint32_t numTablesRequested = 0;
+    uint32_t numTablesCreated   = 0; // descriptor tables written, reused ones included
+    uint64_t numRequestedBytes  = 0; // what uploading every request would take
+    uint64_t numBytes           = 0;
+
+    void Report() const;
+};
+
+// Textures shared by every model, keyed by file, embedded texture or solid color (the default of a missing map).
+// The cache only holds weak references, a texture and a table live as long as a mesh uses them and take their entry
+// with them. Main thread only, like the descriptor heap it allocates from.
+class TextureCache
+{
+  public:
+    // format : what the file is compressed to, the same file may be used by maps of several formats.
+    static std::string MakeKey(const std::string &filename, bool isSRGB, bool isNormalMap = false,
+                               BC_FORMAT format = BC_FORMAT_NONE);
+    static std::string MakeKey(const EmbeddedTexture &texture, bool isSRGB, bool isNormalMap = false);
+    static std::string MakeKey(XMFLOAT3 color, bool isSRGB, bool isNormalMap = false);
+
+    // nullptr if key has to be created with Insert.
+    std::shared_ptr<CachedTexture> Find(const std::string &key);
+    // Records the upload into commandList.
+    std::shared_ptr<CachedTexture> Insert(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                          const std::string &key, const TextureImage &image);
+    // The same from a DDS file, see DDSCache.
+    std::shared_ptr<CachedTexture> InsertDDS(ID3D12Device *device, ID3D12GraphicsCommandList *commandList,
+                                             const std::string &key, const std::string &ddsPath);
+
+    // textures holds TextureTable::sm_numTextures entries, in table order.
+    std::shared_ptr<TextureTable> GetTable(ID3D12Device *device, const std::shared_ptr<CachedTexture> *textures);
+
+    // nextFence : what the frame being recorded signals, completedFence : the last value the GPU passed.
+    // The descriptors of a released table are only rewritten once the frames that may have drawn with it are done.
+    void Update(uint64_t nextFence, uint64_t completedFence);
+
+    const TextureCacheStats &GetStats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    using TableKey = std::array<const CachedTexture *, TextureTable::sm_numTextures>;
+
+    struct RetiredTable
+    {
+        DescriptorHandle handle;
+        uint64_t fence; // nextFence when it was released
+    };
+
+    std::shared_ptr<CachedTexture> NewTexture(const std::string &key);
+
+    std::unordered_map<std::string, std::weak_ptr<CachedTexture>> m_textures;
+    std::map<TableKey, std::weak_ptr<TextureTable>> m_tables;
+    std::queue<RetiredTable> m_retiredTables; // descriptors of released tables, the heap can't free. Fence order.
+    uint64_t m_nextFence      = 1;
+    uint64_t m_completedFence = 0;
+    TextureCacheStats m_stats;
+};
+
+extern TextureCache g_TextureCache;
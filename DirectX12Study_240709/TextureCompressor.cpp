@@ -0,0 +1,830 @@
+#include "JobSystem.h"
+#include "Stopwatch.h"
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+// 4x4 texels of a level, row by row, rgba.
+using Block = uint8_t[16][4];
+
+// Interpolation weights of the 4 and 2 bit BC7 indices, out of 64.
+const uint32_t s_bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+const uint32_t s_bc7Weights2[4] = {0, 21, 43, 64};
+
+// Fills the bits of a 128 bit block from the lowest one up.
+class BitWriter
+{
+  public:
+    void Write(uint64_t value, uint32_t numBits)
+    {
+        if (m_numBits < 64)
+        {
+            m_bits[0] |= value << m_numBits;
+            if (m_numBits + numBits > 64)
+                m_bits[1] |= value >> (64 - m_numBits);
+        }
+        else
+        {
+            m_bits[1] |= value << (m_numBits - 64);
+        }
+        m_numBits += numBits;
+    }
+
+    void Store(uint8_t *out) const
+    {
+        memcpy(out, m_bits, sizeof(m_bits));
+    }
+
+  private:
+    uint64_t m_bits[2] = {};
+    uint32_t m_numBits = 0;
+};
+
+float Clamp255(float v)
+{
+    return v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v;
+}
+
+// Line through the texels of a block along their largest spread, as the two ends of their projections on it.
+// N : channels used, the first ones of each texel.
+template <int N> void FitLine(const Block &block, float ends[2][4])
+{
+    float mean[N] = {};
+    for (const auto &texel : block)
+    {
+        for (int c = 0; c < N; c++)
+            mean[c] += texel[c];
+    }
+    for (int c = 0; c < N; c++)
+        mean[c] /= 16.0f;
+
+    float cov[N][N] = {};
+    for (const auto &texel : block)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = i; j < N; j++)
+                cov[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+        }
+    }
+    for (int i = 0; i < N; i++)
+    {
+        for (int j = 0; j < i; j++)
+            cov[i][j] = cov[j][i];
+    }
+
+    // Power iteration from the row of the widest channel, it can't start orthogonal to the axis.
+    int widest = 0;
+    for (int c = 1; c < N; c++)
+    {
+        if (cov[c][c] > cov[widest][widest])
+            widest = c;
+    }
+    float axis[N];
+    for (int c = 0; c < N; c++)
+        axis[c] = cov[widest][c];
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[N] = {}, length = 0.0f;
+        for (int i = 0; i < N; i++)
+        {
+            for (int j = 0; j < N; j++)
+                next[i] += cov[i][j] * axis[j];
+            length = std::max(length, std::fabs(next[i]));
+        }
+        if (length < 1e-8f)
+            break;
+        for (int c = 0; c < N; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < N; c++)
+        length += axis[c] * axis[c];
+    length = std::sqrt(length);
+
+    float minT = 0.0f, maxT = 0.0f;
+    if (length > 1e-6f)
+    {
+        for (int c = 0; c < N; c++)
+            axis[c] /= length;
+
+        minT = std::numeric_limits<float>::max();
+        maxT = -minT;
+        for (const auto &texel : block)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < N; c++)
+                t += (texel[c] - mean[c]) * axis[c];
+            minT = std::min(minT, t);
+            maxT = std::max(maxT, t);
+        }
+    }
+
+    for (int c = 0; c < N; c++)
+    {
+        ends[0][c] = Clamp255(mean[c] + axis[c] * minT);
+        ends[1][c] = Clamp255(mean[c] + axis[c] * maxT);
+    }
+}
+
+// Least squares ends of a line given where each texel sits on it (0 : first end, 1 : second end). False if the
+// texels don't pin it down, all at one weight.
+template <int N> bool SolveEnds(const Block &block, const float weights[16], float ends[2][4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float a[N] = {}, b[N] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const float w = weights[i];
+        aa += (1.0f - w) * (1.0f - w);
+        ab += (1.0f - w) * w;
+        bb += w * w;
+        for (int c = 0; c < N; c++)
+        {
+            a[c] += (1.0f - w) * block[i][c];
+            b[c] += w * block[i][c];
+        }
+    }
+
+    const float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f)
+    {
+        return false;
+    }
+    for (int c = 0; c < N; c++)
+    {
+        ends[0][c] = Clamp255((bb * a[c] - ab * b[c]) / det);
+        ends[1][c] = Clamp255((aa * b[c] - ab * a[c]) / det);
+    }
+    return true;
+}
+
+uint32_t Expand5(uint32_t v)
+{
+    return (v << 3) | (v >> 2);
+}
+
+uint32_t Expand6(uint32_t v)
+{
+    return (v << 2) | (v >> 4);
+}
+
+uint16_t Pack565(const float color[4])
+{
+    const uint32_t r = uint32_t(color[0] * 31.0f / 255.0f + 0.5f);
+    const uint32_t g = uint32_t(color[1] * 63.0f / 255.0f + 0.5f);
+    const uint32_t b = uint32_t(color[2] * 31.0f / 255.0f + 0.5f);
+    return uint16_t(r << 11 | g << 5 | b);
+}
+
+// Colors of a 4 color BC1 block in index order. BC3 blocks are always read this way.
+void ColorPalette(uint16_t c0, uint16_t c1, int32_t palette[4][3])
+{
+    const int32_t e0[3] = {int32_t(Expand5(c0 >> 11)), int32_t(Expand6((c0 >> 5) & 63)), int32_t(Expand5(c0 & 31))};
+    const int32_t e1[3] = {int32_t(Expand5(c1 >> 11)), int32_t(Expand6((c1 >> 5) & 63)), int32_t(Expand5(c1 & 31))};
+    for (int c = 0; c < 3; c++)
+    {
+        palette[0][c] = e0[c];
+        palette[1][c] = e1[c];
+        palette[2][c] = (2 * e0[c] + e1[c] + 1) / 3;
+        palette[3][c] = (e0[c] + 2 * e1[c] + 1) / 3;
+    }
+}
+
+// Endpoints whose 1/3 color is nearest to each 8 bit value, a block of one color then only errs by that.
+class SingleColorTable
+{
+  public:
+    SingleColorTable()
+    {
+        Build(m_match5, 31, Expand5);
+        Build(m_match6, 63, Expand6);
+    }
+
+    // Both endpoints reading as the 1/3 color (index 2) of the block.
+    void Match(const uint8_t color[4], uint16_t &c0, uint16_t &c1) const
+    {
+        c0 = uint16_t(m_match5[color[0]][0] << 11 | m_match6[color[1]][0] << 5 | m_match5[color[2]][0]);
+        c1 = uint16_t(m_match5[color[0]][1] << 11 | m_match6[color[1]][1] << 5 | m_match5[color[2]][1]);
+    }
+
+  private:
+    static void Build(uint8_t match[256][2], uint32_t maxCode, uint32_t (*expand)(uint32_t))
+    {
+        for (int32_t value = 0; value < 256; value++)
+        {
+            int32_t bestError = INT32_MAX;
+            for (uint32_t q0 = 0; q0 <= maxCode; q0++)
+            {
+                for (uint32_t q1 = 0; q1 <= maxCode; q1++)
+                {
+                    const int32_t color = int32_t(2 * expand(q0) + expand(q1) + 1) / 3;
+                    const int32_t error = std::abs(color - value);
+                    if (error < bestError)
+                    {
+                        bestError       = error;
+                        match[value][0] = uint8_t(q0);
+                        match[value][1] = uint8_t(q1);
+                    }
+                }
+            }
+        }
+    }
+
+    uint8_t m_match5[256][2];
+    uint8_t m_match6[256][2];
+};
+
+const SingleColorTable s_singleColor;
+
+// BC1 color block, 8 bytes. Returns the squared error of rgb.
+uint32_t EncodeColorBlock(const Block &block, uint8_t *out)
+{
+    bool isSolid = true;
+    for (const auto &texel : block)
+        isSolid = isSolid && texel[0] == block[0][0] && texel[1] == block[0][1] && texel[2] == block[0][2];
+
+    uint16_t bestC0 = 0, bestC1 = 0;
+    uint8_t bestIndices[16] = {};
+    uint32_t bestError      = UINT32_MAX;
+
+    // Keeps c0 > c1 for the 4 color mode and picks the nearest color of each texel.
+    auto evaluate = [&](uint16_t c0, uint16_t c1, uint8_t indices[16]) {
+        if (c0 < c1)
+            std::swap(c0, c1);
+        if (c0 == c1 && c1 > 0)
+            c1--;
+        else if (c0 == c1)
+            c0++;
+
+        int32_t palette[4][3];
+        ColorPalette(c0, c1, palette);
+
+        uint32_t error = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t nearest = UINT32_MAX;
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                const int32_t dr = palette[j][0] - block[i][0];
+                const int32_t dg = palette[j][1] - block[i][1];
+                const int32_t db = palette[j][2] - block[i][2];
+                const uint32_t d = uint32_t(dr * dr + dg * dg + db * db);
+                if (d < nearest)
+                {
+                    nearest    = d;
+                    indices[i] = uint8_t(j);
+                }
+            }
+            error += nearest;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            bestC0    = c0;
+            bestC1    = c1;
+            memcpy(bestIndices, indices, 16);
+        }
+    };
+
+    uint8_t indices[16];
+    if (isSolid)
+    {
+        uint16_t c0, c1;
+        s_singleColor.Match(block[0], c0, c1);
+        evaluate(c0, c1, indices);
+    }
+    else
+    {
+        float ends[2][4];
+        FitLine<3>(block, ends);
+        for (uint32_t iteration = 0; iteration < 3; iteration++)
+        {
+            // In the order evaluate puts them, so the indices refer to ends[0] and ends[1].
+            if (Pack565(ends[0]) < Pack565(ends[1]))
+                std::swap(ends[0], ends[1]);
+            evaluate(Pack565(ends[0]), Pack565(ends[1]), indices);
+
+            static const float s_weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+            float weights[16];
+            for (uint32_t i = 0; i < 16; i++)
+                weights[i] = s_weights[indices[i]];
+            if (!SolveEnds<3>(block, weights, ends))
+                break;
+        }
+    }
+
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < 16; i++)
+        bits |= uint32_t(bestIndices[i]) << (2 * i);
+    memcpy(out, &bestC0, 2);
+    memcpy(out + 2, &bestC1, 2);
+    memcpy(out + 4, &bits, 4);
+    return bestError;
+}
+
+// BC4 block of one channel, 8 bytes, in the 8 value mode. Returns the squared error.
+uint32_t EncodeChannelBlock(const uint8_t values[16], uint8_t *out)
+{
+    uint8_t minValue = 255, maxValue = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        minValue = std::min(minValue, values[i]);
+        maxValue = std::max(maxValue, values[i]);
+    }
+
+    uint64_t bestBits  = uint64_t(maxValue) | uint64_t(minValue) << 8;
+    uint32_t bestError = UINT32_MAX;
+    if (minValue == maxValue)
+    {
+        // Index 0 is e0 in either mode.
+        memcpy(out, &bestBits, 8);
+        return 0;
+    }
+
+    Block line = {};
+    for (uint32_t i = 0; i < 16; i++)
+        line[i][0] = values[i];
+
+    float ends[2][4] = {{float(maxValue)}, {float(minValue)}};
+    for (uint32_t iteration = 0; iteration < 3; iteration++)
+    {
+        int32_t e0 = int32_t(ends[0][0] + 0.5f), e1 = int32_t(ends[1][0] + 0.5f);
+        if (e0 < e1)
+            std::swap(e0, e1);
+        if (e0 == e1 && e1 > 0)
+            e1--;
+        else if (e0 == e1)
+            e0++;
+
+        // Index 0 and 1 are the ends, 2 ~ 7 the steps from e0 to e1.
+        int32_t palette[8] = {e0, e1};
+        for (int32_t k = 1; k < 7; k++)
+            palette[k + 1] = ((7 - k) * e0 + k * e1 + 3) / 7;
+
+        uint64_t bits  = uint64_t(e0) | uint64_t(e1) << 8;
+        uint32_t error = 0;
+        float weights[16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t nearest = UINT32_MAX, index = 0;
+            for (uint32_t j = 0; j < 8; j++)
+            {
+                const int32_t d = palette[j] - values[i];
+                if (uint32_t(d * d) < nearest)
+                {
+                    nearest = uint32_t(d * d);
+                    index   = j;
+                }
+            }
+            error += nearest;
+            bits |= uint64_t(index) << (16 + 3 * i);
+            weights[i] = index == 0 ? 0.0f : index == 1 ? 1.0f : float(index - 1) / 7.0f;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            bestBits  = bits;
+        }
+
+        ends[0][0] = float(e0);
+        ends[1][0] = float(e1);
+        if (error == 0 || !SolveEnds<1>(line, weights, ends))
+            break;
+    }
+
+    memcpy(out, &bestBits, 8);
+    return bestError;
+}
+
+// Nearest 7 bit value and shared p bit of a BC7 mode 6 endpoint.
+void QuantizeBC7Endpoint(const float end[4], uint32_t q[4], uint32_t &p)
+{
+    float bestError = std::numeric_limits<float>::max();
+    for (uint32_t pBit = 0; pBit < 2; pBit++)
+    {
+        uint32_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            candidate[c]      = uint32_t(std::min(std::max((end[c] - pBit) * 0.5f + 0.5f, 0.0f), 127.0f));
+            const float delta = float(candidate[c] << 1 | pBit) - end[c];
+            error += delta * delta;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            p         = pBit;
+            memcpy(q, candidate, sizeof(candidate));
+        }
+    }
+}
+
+// BC7 mode 6 block, 16 bytes: one rgba line with 7 bit endpoints, a p bit each and 4 bit indices. Returns the
+// squared error of rgba.
+uint32_t EncodeBC7Mode6(const Block &block, uint8_t *out)
+{
+    uint32_t bestQ[2][4] = {}, bestP[2] = {};
+    uint8_t bestIndices[16] = {};
+    uint32_t bestError      = UINT32_MAX;
+
+    float ends[2][4];
+    FitLine<4>(block, ends);
+    for (uint32_t iteration = 0; iteration < 3; iteration++)
+    {
+        uint32_t q[2][4], p[2];
+        QuantizeBC7Endpoint(ends[0], q[0], p[0]);
+        QuantizeBC7Endpoint(ends[1], q[1], p[1]);
+
+        int32_t e[2][4], dir[4], length2 = 0;
+        for (int c = 0; c < 4; c++)
+        {
+            e[0][c] = int32_t(q[0][c] << 1 | p[0]);
+            e[1][c] = int32_t(q[1][c] << 1 | p[1]);
+            dir[c]  = e[1][c] - e[0][c];
+            length2 += dir[c] * dir[c];
+        }
+
+        int32_t palette[16][4];
+        for (uint32_t j = 0; j < 16; j++)
+        {
+            for (int c = 0; c < 4; c++)
+                palette[j][c] = ((64 - s_bc7Weights[j]) * e[0][c] + s_bc7Weights[j] * e[1][c] + 32) >> 6;
+        }
+
+        // The palette lies on the line, projecting finds the index up to rounding, its neighbors settle that.
+        uint8_t indices[16];
+        float weights[16];
+        uint32_t error = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            int32_t guess = 0;
+            if (length2 > 0)
+            {
+                int32_t dot = 0;
+                for (int c = 0; c < 4; c++)
+                    dot += (block[i][c] - e[0][c]) * dir[c];
+                const float t = std::min(std::max(float(dot) / float(length2), 0.0f), 1.0f) * 64.0f;
+                while (guess < 15 && float(s_bc7Weights[guess + 1]) <= t)
+                    guess++;
+            }
+
+            uint32_t nearest = UINT32_MAX;
+            for (int32_t j = std::max(guess - 1, 0); j <= std::min(guess + 1, 15); j++)
+            {
+                uint32_t d = 0;
+                for (int c = 0; c < 4; c++)
+                    d += uint32_t((palette[j][c] - block[i][c]) * (palette[j][c] - block[i][c]));
+                if (d < nearest)
+                {
+                    nearest    = d;
+                    indices[i] = uint8_t(j);
+                }
+            }
+            error += nearest;
+            weights[i] = float(s_bc7Weights[indices[i]]) / 64.0f;
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            memcpy(bestQ, q, sizeof(q));
+            memcpy(bestP, p, sizeof(p));
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+        if (error == 0 || !SolveEnds<4>(block, weights, ends))
+            break;
+    }
+
+    // The first index is stored without its top bit, swapping the ends mirrors the weights.
+    if (bestIndices[0] >= 8)
+    {
+        std::swap(bestQ[0], bestQ[1]);
+        std::swap(bestP[0], bestP[1]);
+        for (uint8_t &index : bestIndices)
+            index = uint8_t(15 - index);
+    }
+
+    BitWriter writer;
+    writer.Write(1 << 6, 7);
+    for (int c = 0; c < 4; c++)
+    {
+        writer.Write(bestQ[0][c], 7);
+        writer.Write(bestQ[1][c], 7);
+    }
+    writer.Write(bestP[0], 1);
+    writer.Write(bestP[1], 1);
+    writer.Write(bestIndices[0], 3);
+    for (uint32_t i = 1; i < 16; i++)
+        writer.Write(bestIndices[i], 4);
+    writer.Store(out);
+
+    return bestError;
+}
+
+// Codes and indices of a line of N channels with few colors, refined from ends like the BC1 block. quantize turns
+// an end into its code, expand a code into the 8 bit value the decoder sees. Returns the squared error.
+template <int N, typename Quantize, typename Expand>
+uint32_t FitPalette(const Block &block, float ends[2][4], const uint32_t *weights, uint32_t numWeights,
+                    Quantize quantize, Expand expand, uint32_t codes[2][4], uint8_t indices[16])
+{
+    uint32_t bestError = UINT32_MAX;
+    for (uint32_t iteration = 0; iteration < 3; iteration++)
+    {
+        uint32_t q[2][4];
+        int32_t palette[4][4];
+        for (int c = 0; c < N; c++)
+        {
+            q[0][c]          = quantize(ends[0][c]);
+            q[1][c]          = quantize(ends[1][c]);
+            const int32_t e0 = expand(q[0][c]);
+            const int32_t e1 = expand(q[1][c]);
+            for (uint32_t j = 0; j < numWeights; j++)
+                palette[j][c] = ((64 - weights[j]) * e0 + weights[j] * e1 + 32) >> 6;
+        }
+
+        uint8_t tried[16];
+        float fractions[16];
+        uint32_t error = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint32_t nearest = UINT32_MAX;
+            for (uint32_t j = 0; j < numWeights; j++)
+            {
+                uint32_t d = 0;
+                for (int c = 0; c < N; c++)
+                    d += uint32_t((palette[j][c] - block[i][c]) * (palette[j][c] - block[i][c]));
+                if (d < nearest)
+                {
+                    nearest  = d;
+                    tried[i] = uint8_t(j);
+                }
+            }
+            error += nearest;
+            fractions[i] = float(weights[tried[i]]) / 64.0f;
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            memcpy(codes, q, sizeof(q));
+            memcpy(indices, tried, sizeof(tried));
+        }
+        if (error == 0 || !SolveEnds<N>(block, fractions, ends))
+            break;
+    }
+    return bestError;
+}
+
+// BC7 mode 5 block, 16 bytes: an rgb line with 7 bit endpoints and an alpha line with 8 bit ones, 2 bit indices
+// each. Alpha that doesn't follow the color costs mode 6 its precision, here it has its own line.
+uint32_t EncodeBC7Mode5(const Block &block, uint8_t *out)
+{
+    auto quantize7 = [](float v) { return uint32_t(v * 127.0f / 255.0f + 0.5f); };
+    auto expand7   = [](uint32_t q) { return int32_t(q << 1 | q >> 6); };
+    auto quantize8 = [](float v) { return uint32_t(v + 0.5f); };
+    auto expand8   = [](uint32_t q) { return int32_t(q); };
+
+    uint32_t color[2][4], alpha[2][4];
+    uint8_t colorIndices[16], alphaIndices[16];
+    float ends[2][4];
+    FitLine<3>(block, ends);
+    uint32_t error = FitPalette<3>(block, ends, s_bc7Weights2, 4, quantize7, expand7, color, colorIndices);
+
+    Block alphaLine = {};
+    for (uint32_t i = 0; i < 16; i++)
+        alphaLine[i][0] = block[i][3];
+    FitLine<1>(alphaLine, ends);
+    error += FitPalette<1>(alphaLine, ends, s_bc7Weights2, 4, quantize8, expand8, alpha, alphaIndices);
+
+    // Both first indices are stored without their top bit.
+    if (colorIndices[0] >= 2)
+    {
+        std::swap(color[0], color[1]);
+        for (uint8_t &index : colorIndices)
+            index = uint8_t(3 - index);
+    }
+    if (alphaIndices[0] >= 2)
+    {
+        std::swap(alpha[0], alpha[1]);
+        for (uint8_t &index : alphaIndices)
+            index = uint8_t(3 - index);
+    }
+
+    BitWriter writer;
+    writer.Write(1 << 5, 6);
+    writer.Write(0, 2); // no channel rotation
+    for (int c = 0; c < 3; c++)
+    {
+        writer.Write(color[0][c], 7);
+        writer.Write(color[1][c], 7);
+    }
+    writer.Write(alpha[0][0], 8);
+    writer.Write(alpha[1][0], 8);
+    writer.Write(colorIndices[0], 1);
+    for (uint32_t i = 1; i < 16; i++)
+        writer.Write(colorIndices[i], 2);
+    writer.Write(alphaIndices[0], 1);
+    for (uint32_t i = 1; i < 16; i++)
+        writer.Write(alphaIndices[i], 2);
+    writer.Store(out);
+
+    return error;
+}
+
+// Mode 6, or mode 5 where the alpha of the block varies and it does better.
+uint32_t EncodeBC7Block(const Block &block, uint8_t *out)
+{
+    const uint32_t error = EncodeBC7Mode6(block, out);
+
+    bool isAlphaConstant = true;
+    for (const auto &texel : block)
+        isAlphaConstant = isAlphaConstant && texel[3] == block[0][3];
+    if (isAlphaConstant || error == 0)
+    {
+        return error;
+    }
+
+    uint8_t mode5[16];
+    const uint32_t mode5Error = EncodeBC7Mode5(block, mode5);
+    if (mode5Error >= error)
+    {
+        return error;
+    }
+    memcpy(out, mode5, sizeof(mode5));
+    return mode5Error;
+}
+
+// Texels out of the level are clamped, only levels below 4x4 have them.
+void LoadBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block &block)
+{
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        const uint32_t row = std::min(blockY * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            const uint32_t column = std::min(blockX * 4 + x, width - 1);
+            memcpy(block[y * 4 + x], pixels + (size_t(row) * width + column) * 4, 4);
+        }
+    }
+}
+
+void ExtractChannel(const Block &block, uint32_t channel, uint8_t values[16])
+{
+    for (uint32_t i = 0; i < 16; i++)
+        values[i] = block[i][channel];
+}
+
+uint32_t EncodeBlock(BC_FORMAT format, const Block &block, uint8_t *out)
+{
+    uint8_t values[16];
+    switch (format)
+    {
+    case BC_FORMAT_BC1:
+        return EncodeColorBlock(block, out);
+    case BC_FORMAT_BC3:
+        ExtractChannel(block, 3, values);
+        return EncodeChannelBlock(values, out) + EncodeColorBlock(block, out + 8);
+    case BC_FORMAT_BC4:
+        ExtractChannel(block, 0, values);
+        return EncodeChannelBlock(values, out);
+    case BC_FORMAT_BC5: {
+        ExtractChannel(block, 0, values);
+        const uint32_t error = EncodeChannelBlock(values, out);
+        ExtractChannel(block, 1, values);
+        return error + EncodeChannelBlock(values, out + 8);
+    }
+    case BC_FORMAT_BC7:
+        return EncodeBC7Block(block, out);
+    }
+    return 0;
+}
+
+uint32_t GetBlockSize(BC_FORMAT format)
+{
+    return format == BC_FORMAT_BC1 || format == BC_FORMAT_BC4 ? 8 : 16;
+}
+
+uint32_t GetNumChannels(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1:
+        return 3;
+    case BC_FORMAT_BC4:
+        return 1;
+    case BC_FORMAT_BC5:
+        return 2;
+    }
+    return 4;
+}
+} // namespace
+
+bool TextureCompressor::Compress(TextureImage &image, BC_FORMAT format, CompressStats *stats)
+{
+    const Stopwatch stopwatch;
+
+    const bool isSRGB = image.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    const bool isRGBA = isSRGB || image.format == DXGI_FORMAT_R8G8B8A8_UNORM;
+    if (!isRGBA || format == BC_FORMAT_NONE || image.width == 0 || image.height == 0 || image.width % 4 != 0 ||
+        image.height % 4 != 0)
+    {
+        return false;
+    }
+
+    size_t numPixels = 0, numBlocks = 0;
+    for (uint32_t level = 0; level < image.mipLevels; level++)
+    {
+        const uint32_t width  = std::max(image.width >> level, 1u);
+        const uint32_t height = std::max(image.height >> level, 1u);
+        numPixels += size_t(width) * height;
+        numBlocks += size_t((width + 3) / 4) * ((height + 3) / 4);
+    }
+    if (image.pixels.size() < numPixels * 4)
+    {
+        return false;
+    }
+
+    const uint32_t blockSize = GetBlockSize(format);
+    std::vector<uint8_t> blocks(numBlocks * blockSize);
+    std::atomic<uint64_t> level0Error{0};
+
+    const uint8_t *pixels = image.pixels.data();
+    uint8_t *out          = blocks.data();
+    for (uint32_t level = 0; level < image.mipLevels; level++)
+    {
+        const uint32_t width   = std::max(image.width >> level, 1u);
+        const uint32_t height  = std::max(image.height >> level, 1u);
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+
+        auto encode = [&](uint32_t begin, uint32_t end, uint32_t threadIndex) {
+            uint64_t error = 0;
+            for (uint32_t i = begin; i < end; i++)
+            {
+                Block block;
+                LoadBlock(pixels, width, height, i % blocksX, i / blocksX, block);
+                error += EncodeBlock(format, block, out + size_t(i) * blockSize);
+            }
+            if (level == 0)
+                level0Error += error;
+        };
+        g_JobSystem.ParallelFor(blocksX * blocksY, sm_blocksPerJob, encode);
+
+        pixels += size_t(width) * height * 4;
+        out += size_t(blocksX) * blocksY * blockSize;
+    }
+
+    image.pixels = std::move(blocks);
+    image.format = GetDXGIFormat(format, isSRGB);
+
+    if (stats)
+    {
+        const double mse = double(level0Error) / (double(image.width) * image.height * GetNumChannels(format));
+        stats->width     = image.width;
+        stats->height    = image.height;
+        stats->numLevels = image.mipLevels;
+        stats->format    = format;
+        stats->ms        = stopwatch.GetElapsedMs();
+        stats->psnr      = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : std::numeric_limits<double>::infinity();
+    }
+    return true;
+}
+
+DXGI_FORMAT TextureCompressor::GetDXGIFormat(BC_FORMAT format, bool isSRGB)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1:
+        return isSRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+    case BC_FORMAT_BC3:
+        return isSRGB ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+    case BC_FORMAT_BC4:
+        return DXGI_FORMAT_BC4_UNORM;
+    case BC_FORMAT_BC5:
+        return DXGI_FORMAT_BC5_UNORM;
+    case BC_FORMAT_BC7:
+        return isSRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+    }
+    return isSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+}
+
+const char *TextureCompressor::GetName(BC_FORMAT format)
+{
+    static const char *s_names[] = {"RGBA8", "BC1", "BC3", "BC4", "BC5", "BC7"};
+    return s_names[format];
+}
+
+void TextureCompressor::Report(const std::string &name, const CompressStats &stats)
+{
+    std::cout << name << " : " << GetName(stats.format) << ", " << stats.width << "x" << stats.height << ", "
+              << stats.numLevels << " mip levels in " << stats.ms << " ms, PSNR " << stats.psnr << " dB"
+              << std::endl;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "TextureImage.h"
+#include <string>
+
+enum BC_FORMAT
+{
+    BC_FORMAT_NONE, // kept as R8G8B8A8
+    BC_FORMAT_BC1,  // rgb, 4 bits per texel, alpha is dropped
+    BC_FORMAT_BC3,  // rgba, 8 bits, BC1 color with a BC4 alpha block
+    BC_FORMAT_BC4,  // r, 4 bits, for single channel maps
+    BC_FORMAT_BC5,  // rg, 8 bits, two BC4 blocks, for normal maps (z is rebuilt in the shader)
+    BC_FORMAT_BC7,  // rgba, 8 bits, modes 6 and 5, the best quality for color
+};
+
+struct CompressStats
+{
+    uint32_t width     = 0;
+    uint32_t height    = 0;
+    uint32_t numLevels = 0;
+    BC_FORMAT format   = BC_FORMAT_NONE;
+    double ms          = 0.0;
+    double psnr        = 0.0; // dB over the channels the format keeps, level 0
+};
+
+// Block compresses an RGBA8 TextureImage on the CPU, every mip level in blocks of sm_blocksPerJob on g_JobSystem.
+// Plain C++ without intrinsics. The encoders fit a line through each block (principal axis, then least squares on
+// the chosen indices) and measure their error with the same palette the decoder builds, which gives the PSNR for
+// free. sRGB images are compressed in sRGB space and get the _SRGB format where there is one. Safe to call from a
+// job.
+class TextureCompressor
+{
+  public:
+    // Replaces image.pixels with the blocks of each level and sets image.format. False and nothing changed for
+    // formats other than R8G8B8A8_UNORM(_SRGB) or a size that isn't a multiple of 4, D3D12 needs that for level 0.
+    static bool Compress(TextureImage &image, BC_FORMAT format, CompressStats *stats = nullptr);
+
+    static DXGI_FORMAT GetDXGIFormat(BC_FORMAT format, bool isSRGB);
+    static const char *GetName(BC_FORMAT format);
+
+    static void Report(const std::string &name, const CompressStats &stats);
+
+  public:
+    static const uint32_t sm_blocksPerJob = 256;
+};
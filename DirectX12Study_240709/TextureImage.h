@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <dxgiformat.h>
+#include <vector>
+
+// Pixels of a texture file, or of a solid color when there is no file. Filled by D3DUtils::ReadTexture.
+// Only the DXGI format enum, so the CPU texture code builds without D3D12 or windows.h.
+struct TextureImage
+{
+    std::vector<uint8_t> pixels; // mips follow level 0, each tightly packed
+    uint32_t width     = 0;
+    uint32_t height    = 0;
+    uint32_t mipLevels = 1; // set by MipGenerator
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+};
@@ -0,0 +1,140 @@
+#include "VertexCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+const float s_unorm16 = 65535.0f;
+const float s_snorm16 = 32767.0f;
+
+// Same conversions as the input assembler, see the D3D data conversion rules.
+float UnormToFloat(uint16_t v)
+{
+    return float(v) / s_unorm16;
+}
+
+float SnormToFloat(int16_t v)
+{
+    return std::max(float(v) / s_snorm16, -1.0f);
+}
+
+float Dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+} // namespace
+
+uint16_t VertexCodec::EncodeUnorm16(float value, float min, float extent)
+{
+    const float t = extent > 0.0f ? std::min(std::max((value - min) / extent, 0.0f), 1.0f) : 0.0f;
+    return uint16_t(t * s_unorm16 + 0.5f);
+}
+
+float VertexCodec::DecodeUnorm16(uint16_t value, float min, float extent)
+{
+    return min + UnormToFloat(value) * extent;
+}
+
+void VertexCodec::EncodeOctahedral(const float n[3], int16_t out[2])
+{
+    const float sum = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+    if (sum < 1e-20f)
+    {
+        out[0] = out[1] = 0; // +Z
+        return;
+    }
+
+    float x = n[0] / sum;
+    float y = n[1] / sum;
+    if (n[2] < 0.0f)
+    {
+        // Fold the lower half over the diagonals.
+        const float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x              = fx;
+        y              = fy;
+    }
+
+    // Of the 4 neighbouring SNORM16 pairs keep the one decoding closest to n, plain rounding can be a step off.
+    const float baseX = std::floor(x * s_snorm16);
+    const float baseY = std::floor(y * s_snorm16);
+    float bestDot     = -2.0f * std::sqrt(Dot(n, n));
+    for (int i = 0; i < 4; i++)
+    {
+        const int16_t candidate[2] = {int16_t(std::min(std::max(baseX + float(i & 1), -s_snorm16), s_snorm16)),
+                                      int16_t(std::min(std::max(baseY + float(i >> 1), -s_snorm16), s_snorm16))};
+        float decoded[3];
+        DecodeOctahedral(candidate, decoded);
+
+        const float dot = Dot(decoded, n);
+        if (dot > bestDot)
+        {
+            bestDot = dot;
+            out[0]  = candidate[0];
+            out[1]  = candidate[1];
+        }
+    }
+}
+
+void VertexCodec::DecodeOctahedral(const int16_t in[2], float n[3])
+{
+    n[0]          = SnormToFloat(in[0]);
+    n[1]          = SnormToFloat(in[1]);
+    n[2]          = 1.0f - std::abs(n[0]) - std::abs(n[1]);
+    const float t = std::max(-n[2], 0.0f);
+    n[0] += n[0] >= 0.0f ? -t : t;
+    n[1] += n[1] >= 0.0f ? -t : t;
+
+    const float scale = 1.0f / std::sqrt(Dot(n, n));
+    for (int i = 0; i < 3; i++)
+        n[i] *= scale;
+}
+
+uint16_t VertexCodec::FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign     = (bits >> 16) & 0x8000;
+    const uint32_t mantissa = bits & 0x7fffff;
+    const int exponent      = int((bits >> 23) & 0xff) - 127 + 15;
+
+    if (exponent == 128 + 15)
+        return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0)); // inf, nan stays quiet
+    if (exponent >= 31)
+        return uint16_t(sign | 0x7c00);
+    if (exponent < -10)
+        return uint16_t(sign); // below half the smallest denormal
+
+    // Denormals shift the implicit 1 in, the rounding below is the same.
+    const uint32_t full  = exponent > 0 ? mantissa : mantissa | 0x800000;
+    const uint32_t shift = exponent > 0 ? 13 : uint32_t(14 - exponent);
+    uint32_t half        = (exponent > 0 ? uint32_t(exponent) << 10 : 0) | (full >> shift);
+
+    // A carry out of the mantissa bumps the exponent, up to infinity, which is the right result.
+    const uint32_t rest    = full & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1)))
+        half++;
+
+    return uint16_t(sign | half);
+}
+
+float VertexCodec::HalfToFloat(uint16_t value)
+{
+    const uint32_t sign     = uint32_t(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    const uint32_t mantissa = value & 0x3ff;
+
+    if (exponent == 0)
+    {
+        const float denormal = std::ldexp(float(mantissa), -24);
+        return sign ? -denormal : denormal;
+    }
+
+    const uint32_t bits = sign | (exponent == 31 ? 0x7f800000 : (exponent + 112) << 23) | (mantissa << 13);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// The scalar encodings of QuantizedVertex, used by VertexQuantizer. Only standard C++, the decodes follow the
+// input assembler and the QUANTIZED DefaultVS so the CPU round trip is what the GPU draws.
+class VertexCodec
+{
+  public:
+    // t in [min, min + extent] to UNORM16, clamped. A flat axis (extent 0) decodes to min.
+    static uint16_t EncodeUnorm16(float value, float min, float extent);
+    static float DecodeUnorm16(uint16_t value, float min, float extent);
+
+    // Unit vector to the octahedron unfolded on [-1, 1]^2 as SNORM16, rounded to the closest decoded direction.
+    // A zero vector encodes +Z.
+    static void EncodeOctahedral(const float n[3], int16_t out[2]);
+    static void DecodeOctahedral(const int16_t in[2], float n[3]);
+
+    // IEEE half float, rounded to nearest even. Overflow goes to infinity.
+    static uint16_t FloatToHalf(float value);
+    static float HalfToFloat(uint16_t value);
+};
@@ -0,0 +1,139 @@
+#include "pch.h"
+
+#include "VertexCodec.h"
+#include "VertexQuantizer.h"
+#include <cmath>
+
+namespace
+{
+float AngleBetween(const Vector3 &original, const Vector3 &decoded)
+{
+    Vector3 n = original;
+    if (n.LengthSquared() < 1e-12f)
+        return 0.0f; // no direction to keep
+    n.Normalize();
+    return std::acos(XMMin(XMMax(n.Dot(decoded), -1.0f), 1.0f));
+}
+} // namespace
+
+QuantizeBox VertexQuantizer::ComputeBox(const std::vector<MeshData> &meshes)
+{
+    Vector3 posMin(FLT_MAX), posMax(-FLT_MAX);
+    Vector2 texMin(FLT_MAX), texMax(-FLT_MAX);
+
+    for (const auto &m : meshes)
+    {
+        for (const auto &v : m.GetVertices())
+        {
+            posMin = Vector3::Min(posMin, v.position);
+            posMax = Vector3::Max(posMax, v.position);
+            texMin = Vector2::Min(texMin, v.texCoord);
+            texMax = Vector2::Max(texMax, v.texCoord);
+        }
+    }
+
+    QuantizeBox box;
+    if (posMin.x <= posMax.x)
+    {
+        box.positionMin    = posMin;
+        box.positionExtent = posMax - posMin;
+        box.texCoordOffset = (texMin + texMax) * 0.5f;
+    }
+    return box;
+}
+
+bool VertexQuantizer::CanQuantize(const std::vector<MeshData> &meshes, const QuantizeBox &box,
+                                  const VertexQuantizeSettings &settings, QuantizeError *error)
+{
+    QuantizeError worst;
+    bool hasVertices = false;
+
+    for (const auto &m : meshes)
+    {
+        // Skinned meshes keep their own layout.
+        if (m.GetVertices().empty())
+            return false;
+
+        hasVertices = true;
+        for (const auto &v : m.GetVertices())
+        {
+            const Vertex d = Decode(Encode(v, box), box);
+
+            worst.position = XMMax(worst.position, (d.position - v.position).Length());
+            worst.normal   = XMMax(worst.normal, AngleBetween(v.normal, d.normal));
+            worst.tangent  = XMMax(worst.tangent, AngleBetween(v.tangent, d.tangent));
+            worst.texCoord = XMMax(worst.texCoord, std::abs(d.texCoord.x - v.texCoord.x));
+            worst.texCoord = XMMax(worst.texCoord, std::abs(d.texCoord.y - v.texCoord.y));
+        }
+    }
+
+    if (error)
+        *error = worst;
+
+    return hasVertices && worst.position <= settings.maxPositionError &&
+           worst.texCoord <= settings.maxTexCoordError;
+}
+
+std::vector<QuantizedVertex> VertexQuantizer::Encode(ConstArray<Vertex> vertices, const QuantizeBox &box)
+{
+    std::vector<QuantizedVertex> quantized(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+        quantized[i] = Encode(vertices[i], box);
+    return quantized;
+}
+
+QuantizedVertex VertexQuantizer::Encode(const Vertex &v, const QuantizeBox &box)
+{
+    QuantizedVertex q = {};
+
+    q.position[0] = VertexCodec::EncodeUnorm16(v.position.x, box.positionMin.x, box.positionExtent.x);
+    q.position[1] = VertexCodec::EncodeUnorm16(v.position.y, box.positionMin.y, box.positionExtent.y);
+    q.position[2] = VertexCodec::EncodeUnorm16(v.position.z, box.positionMin.z, box.positionExtent.z);
+
+    EncodeOctahedral(v.normal, q.normal);
+    EncodeOctahedral(v.tangent, q.tangent);
+
+    q.texCoord[0] = VertexCodec::FloatToHalf(v.texCoord.x - box.texCoordOffset.x);
+    q.texCoord[1] = VertexCodec::FloatToHalf(v.texCoord.y - box.texCoordOffset.y);
+
+    return q;
+}
+
+Vertex VertexQuantizer::Decode(const QuantizedVertex &q, const QuantizeBox &box)
+{
+    Vertex v;
+    v.position = Vector3(VertexCodec::DecodeUnorm16(q.position[0], box.positionMin.x, box.positionExtent.x),
+                         VertexCodec::DecodeUnorm16(q.position[1], box.positionMin.y, box.positionExtent.y),
+                         VertexCodec::DecodeUnorm16(q.position[2], box.positionMin.z, box.positionExtent.z));
+    v.normal   = DecodeOctahedral(q.normal);
+    v.tangent  = DecodeOctahedral(q.tangent);
+    v.texCoord = box.texCoordOffset + Vector2(VertexCodec::HalfToFloat(q.texCoord[0]),
+                                              VertexCodec::HalfToFloat(q.texCoord[1]));
+    return v;
+}
+
+void VertexQuantizer::EncodeOctahedral(const Vector3 &n, int16_t out[2])
+{
+    const float v[3] = {n.x, n.y, n.z};
+    VertexCodec::EncodeOctahedral(v, out);
+}
+
+Vector3 VertexQuantizer::DecodeOctahedral(const int16_t in[2])
+{
+    Vector3 n;
+    VertexCodec::DecodeOctahedral(in, &n.x);
+    return n;
+}
+
+void VertexQuantizer::Report(const std::string &name, size_t numVertices, const QuantizeError &error,
+                             bool isQuantized)
+{
+    std::cout << name << " : " << numVertices << " vertices, ";
+    if (isQuantized)
+        std::cout << sizeof(Vertex) << " -> " << sizeof(QuantizedVertex) << " bytes per vertex";
+    else
+        std::cout << "kept float vertices";
+    std::cout << ", error position " << error.position << ", normal " << XMConvertToDegrees(error.normal)
+              << " deg, tangent " << XMConvertToDegrees(error.tangent) << " deg, texCoord " << error.texCoord
+              << std::endl;
+}
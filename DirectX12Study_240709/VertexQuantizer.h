@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Mesh.h"
+
+struct VertexQuantizeSettings
+{
+    float maxPositionError = 0.001f;         // object space, past this the model keeps float vertices
+    float maxTexCoordError = 1.0f / 1024.0f; // half floats hold this within 2 of the texCoord offset
+};
+
+// Decode of a model's QuantizedVertex, shared by all its meshes since MeshConsts is per model.
+// position = positionMin + unorm * positionExtent, texCoord = texCoordOffset + half.
+struct QuantizeBox
+{
+    Vector3 positionMin    = Vector3(0.0f);
+    Vector3 positionExtent = Vector3(0.0f);
+    Vector2 texCoordOffset = Vector2(0.0f);
+};
+
+// Worst round trip error over a set of vertices.
+struct QuantizeError
+{
+    float position = 0.0f; // object space
+    float normal   = 0.0f; // radians
+    float tangent  = 0.0f; // radians
+    float texCoord = 0.0f;
+};
+
+// Packs static vertices into QuantizedVertex and back, the CPU side of the QUANTIZED DefaultVS.
+class VertexQuantizer
+{
+  public:
+    // Bounds of every position, texCoordOffset in the middle of the texCoords so half floats keep the most bits.
+    static QuantizeBox ComputeBox(const std::vector<MeshData> &meshes);
+
+    // Round trips every vertex through box. False when a mesh has no static vertices or goes past settings,
+    // the model then stays on 32 bit float vertices.
+    static bool CanQuantize(const std::vector<MeshData> &meshes, const QuantizeBox &box,
+                            const VertexQuantizeSettings &settings = {}, QuantizeError *error = nullptr);
+
+    static std::vector<QuantizedVertex> Encode(ConstArray<Vertex> vertices, const QuantizeBox &box);
+    static QuantizedVertex Encode(const Vertex &v, const QuantizeBox &box);
+    static Vertex Decode(const QuantizedVertex &q, const QuantizeBox &box);
+
+    // Unit vector to the octahedron unfolded on [-1, 1]^2 as SNORM16, rounded to the closest decoded direction.
+    static void EncodeOctahedral(const Vector3 &n, int16_t out[2]);
+    static Vector3 DecodeOctahedral(const int16_t in[2]);
+
+    static void Report(const std::string &name, size_t numVertices, const QuantizeError &error, bool isQuantized);
+};
@@ -0,0 +1,166 @@
+#include "AnimationBaker.h"
+#include "Check.h"
+#include "JobSystem.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace DirectX;
+
+// Bakes a synthetic skeleton at 15, 30 and 60 fps. MeasureError has to stay under the distance the fastest bone
+// travels in half a frame (the baked pose is the nearest frame), and has to shrink as the rate goes up.
+namespace
+{
+const int s_numKeys = 91; // 3 s at 30 keys per second
+
+AnimationData MakeAnimation(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // A spine of six bones with two arms of four, every bone 10 units from its parent.
+    AnimationData anim;
+    auto addBone = [&](int parent) {
+        anim.boneParentId.push_back(parent);
+        anim.offsetMatrix.push_back(
+            Matrix::CreateTranslation(Vector3(0.0f, -10.0f * float(anim.offsetMatrix.size()), 0.0f)));
+        return int(anim.boneParentId.size()) - 1;
+    };
+
+    int spine = addBone(-1);
+    for (int i = 0; i < 5; i++)
+        spine = addBone(spine);
+    for (int side = 0; side < 2; side++)
+    {
+        int arm = spine;
+        for (int i = 0; i < 4; i++)
+            arm = addBone(arm);
+    }
+    anim.defaultMatrix = Matrix::CreateScale(0.5f);
+
+    // Two clips of different lengths. Key times are in ticks at 30 ticks per second.
+    for (int c = 0; c < 2; c++)
+    {
+        AnimationClip clip;
+        clip.name          = c ? "fast" : "slow";
+        clip.duration      = double(s_numKeys - 1 - 20 * c);
+        clip.tickPerSecond = 30.0;
+        clip.numChannels   = anim.GetNumBones();
+        clip.tracks.resize(clip.numChannels);
+
+        for (auto &track : clip.tracks)
+        {
+            Vector3 axis(unit(rng), unit(rng), unit(rng));
+            axis.Normalize();
+            const float speed = (0.05f + 0.03f * unit(rng)) * (1.0f + c);
+
+            for (int k = 0; k <= int(clip.duration); k++)
+            {
+                const float t = float(k);
+                track.posTimes.push_back(t);
+                track.rotTimes.push_back(t);
+                track.pos.push_back(Vector3(0.0f, 10.0f, 0.0f));
+                track.rot.push_back(Quaternion::CreateFromAxisAngle(axis, 0.6f * std::sin(t * speed)));
+            }
+            track.scaleTimes.push_back(0.0f);
+            track.scale.push_back(Vector3(1.0f));
+        }
+        anim.clips.push_back(clip);
+    }
+
+    anim.Prepare();
+    return anim;
+}
+
+// Fastest motion of a bone bind position through the live palette, in model units per second.
+float MaxBoneSpeed(const AnimationData &anim)
+{
+    const uint32_t numBones = anim.GetNumBones();
+    std::vector<Vector3> bindPos(numBones);
+    for (uint32_t i = 0; i < numBones; i++)
+    {
+        bindPos[i] = (anim.offsetMatrix[i].Invert() * anim.defaultMatrix).Translation();
+    }
+
+    const double step = 1.0 / 960.0; // seconds
+    std::vector<AnimationCursor> cursors(numBones);
+    AnimationPose pose;
+    float maxSpeed = 0.0f;
+
+    for (int clipID = 0; clipID < int(anim.clips.size()); clipID++)
+    {
+        const AnimationClip &clip = anim.clips[clipID];
+        std::vector<Vector3> prev;
+        for (double time = 0.0; time * clip.tickPerSecond <= clip.duration; time += step)
+        {
+            anim.Evaluate(clipID, time * clip.tickPerSecond, cursors, pose);
+
+            std::vector<Vector3> cur(numBones);
+            for (uint32_t b = 0; b < numBones; b++)
+            {
+                cur[b] = Vector3::Transform(bindPos[b], pose.palette[b].Transpose());
+                if (!prev.empty())
+                {
+                    maxSpeed = std::max(maxSpeed, (cur[b] - prev[b]).Length() / float(step));
+                }
+            }
+            prev = cur;
+        }
+    }
+    return maxSpeed;
+}
+} // namespace
+
+int main()
+{
+    g_JobSystem.Initialize(3);
+
+    std::mt19937 rng(1);
+    const AnimationData anim = MakeAnimation(rng);
+    const float maxSpeed     = MaxBoneSpeed(anim);
+    CHECK(maxSpeed > 0.0f);
+
+    float prevError = 0.0f;
+    for (const float rate : {15.0f, 30.0f, 60.0f})
+    {
+        const BakedAnimation baked = AnimationBaker::Bake(anim, rate);
+        CHECK(baked.numBones == anim.GetNumBones());
+        CHECK(baked.clips.size() == anim.clips.size());
+
+        // Frames cover [0, duration] of every clip, back to back.
+        uint32_t numFrames = 0;
+        for (size_t c = 0; c < anim.clips.size(); c++)
+        {
+            const AnimationClip &clip = anim.clips[c];
+            const double seconds      = clip.duration / clip.tickPerSecond;
+            CHECK(baked.clips[c].firstFrame == numFrames);
+            CHECK(baked.clips[c].numFrames == uint32_t(std::ceil(seconds * rate)) + 1);
+            CHECK(baked.GetFrame(clip, int(c), 0.0) == numFrames);
+            CHECK(baked.GetFrame(clip, int(c), clip.duration * 0.999999) == numFrames + baked.clips[c].numFrames - 1);
+            numFrames += baked.clips[c].numFrames;
+        }
+        CHECK(baked.palettes.size() == size_t(numFrames) * baked.numBones);
+
+        // The nearest frame is at most half a frame period away.
+        const float error = AnimationBaker::MeasureError(anim, baked, 8);
+        const float bound = maxSpeed * 0.5f / rate;
+        CHECK(error > 0.0f);
+        CHECK(error <= bound * 1.01f);
+        if (prevError > 0.0f)
+        {
+            CHECK(error < 0.75f * prevError);
+        }
+        prevError = error;
+
+        std::cout << rate << " fps : " << numFrames << " frames, " << baked.GetBytes() / 1024.0 << " KB, max error "
+                  << error << " (bound " << bound << ")" << std::endl;
+    }
+
+    // Report checks every rate against the tolerance.
+    CHECK(AnimationBaker::Report(anim, {15.0f, 30.0f, 60.0f}, maxSpeed));
+    CHECK(!AnimationBaker::Report(anim, {15.0f, 60.0f}, prevError * 0.5f));
+
+    g_JobSystem.Shutdown();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
@@ -0,0 +1,181 @@
+#include "AnimationCompressor.h"
+#include "Check.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace DirectX;
+
+// Synthetic tracks through AnimationCompressor. Sampling the compressed clip at every source key has to stay within
+// the tolerances of the settings, and so does the error the compressor reports.
+namespace
+{
+const int s_numKeys = 600; // 20 s at 30 keys per second
+
+Quaternion RotationAt(float t, float speed, const Vector3 &axis)
+{
+    Vector3 a = axis;
+    a.Normalize();
+    return Quaternion(XMQuaternionRotationAxis(a, std::sin(t * speed) * 1.5f + t * 0.3f));
+}
+
+// Bone 0 : root motion walking thousands of units, too wide for the 16-bit step.
+// Bone 1 : constant channels.
+// Bones 2.. : smooth curves, a few linear stretches and noise.
+AnimationClip MakeClip(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    AnimationClip clip;
+    clip.name          = "synthetic";
+    clip.duration      = double(s_numKeys - 1);
+    clip.tickPerSecond = 30.0;
+    clip.numChannels   = 8;
+    clip.tracks.resize(clip.numChannels);
+
+    for (uint32_t b = 0; b < clip.numChannels; b++)
+    {
+        auto &track        = clip.tracks[b];
+        const Vector3 axis = Vector3(unit(rng), unit(rng), unit(rng)) + Vector3(0.0f, 2.0f, 0.0f);
+        const float speed  = 0.02f + 0.01f * b;
+
+        for (int k = 0; k < s_numKeys; k++)
+        {
+            const float t = float(k);
+            track.posTimes.push_back(t);
+            track.rotTimes.push_back(t);
+            track.scaleTimes.push_back(t);
+
+            if (b == 0)
+            {
+                track.pos.push_back(Vector3(t * 8.0f, 90.0f + 3.0f * std::sin(t * 0.4f), t * 2.0f));
+                track.rot.push_back(RotationAt(t, 0.01f, Vector3(0.0f, 1.0f, 0.0f)));
+                track.scale.push_back(Vector3(1.0f));
+            }
+            else if (b == 1)
+            {
+                track.pos.push_back(Vector3(0.0f, 10.0f, 0.0f));
+                track.rot.push_back(Quaternion());
+                track.scale.push_back(Vector3(1.0f));
+            }
+            else
+            {
+                // Holds still for the middle third so the reduction finds linear stretches.
+                const float u     = k > s_numKeys / 3 && k < 2 * s_numKeys / 3 ? float(s_numKeys / 3) : t;
+                const float noise = 0.002f * unit(rng);
+                track.pos.push_back(Vector3(20.0f * std::sin(u * speed) + noise, 5.0f * std::cos(u * speed * 1.7f),
+                                            3.0f * b));
+                track.rot.push_back(RotationAt(u, speed, axis));
+                track.scale.push_back(Vector3(1.0f + 0.1f * std::sin(u * speed)));
+            }
+        }
+    }
+
+    return clip;
+}
+
+// 2 * atan2(|v|, |w|) of conjugate(a) * b in double. An acos of the dot product loses the small angles to rounding.
+double RotationAngle(const Quaternion &a, const Quaternion &b)
+{
+    const double ax = a.x, ay = a.y, az = a.z, aw = a.w;
+    const double bx = b.x, by = b.y, bz = b.z, bw = b.w;
+
+    const double w = aw * bw + ax * bx + ay * by + az * bz;
+    const double x = aw * bx - bw * ax - (ay * bz - az * by);
+    const double y = aw * by - bw * ay - (az * bx - ax * bz);
+    const double z = aw * bz - bw * az - (ax * by - ay * bx);
+    return 2.0 * std::atan2(std::sqrt(x * x + y * y + z * z), std::abs(w));
+}
+
+void TestTolerances(const AnimationCompressionSettings &settings, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+
+    AnimationData anim;
+    anim.clips.push_back(MakeClip(rng));
+    const AnimationClip source = anim.clips[0];
+
+    const AnimationCompressor::Stats stats = AnimationCompressor::Compress(anim.clips[0], settings);
+    const AnimationClip &clip              = anim.clips[0];
+    CHECK(clip.IsCompressed());
+    CHECK(clip.tracks.empty());
+    CHECK(stats.keptKeys < stats.rawKeys);
+    CHECK(stats.compressedBytes < stats.rawBytes);
+
+    CHECK(stats.maxPosError <= settings.posTolerance);
+    CHECK(stats.maxRotError <= settings.rotTolerance);
+    CHECK(stats.maxScaleError <= settings.scaleTolerance);
+
+    // The root motion keeps float positions when it spans more than 65535 position tolerances.
+    const Vector3 walk = source.tracks[0].pos.back() - source.tracks[0].pos.front();
+    CHECK(clip.compressedTracks[0].pos.floatValues.empty() == (walk.Length() / 65535.0f < settings.posTolerance));
+    CHECK(clip.compressedTracks[2].pos.floatValues.empty());
+
+    // Constant channels keep one key.
+    CHECK(clip.compressedTracks[1].pos.times.size() == 1);
+    CHECK(clip.compressedTracks[1].rot.times.size() == 1);
+    CHECK(clip.compressedTracks[1].scale.times.size() == 1);
+
+    // Measured independently through the playback path.
+    double maxPos = 0.0, maxRot = 0.0, maxScale = 0.0;
+    for (uint32_t b = 0; b < clip.numChannels; b++)
+    {
+        const auto &track = source.tracks[b];
+        AnimationCursor cursor;
+        for (size_t k = 0; k < track.pos.size(); k++)
+        {
+            const AnimationClip::Key key = anim.Sample(0, int(b), track.posTimes[k], cursor);
+            maxPos   = std::max(maxPos, double((key.pos - track.pos[k]).Length()));
+            maxRot   = std::max(maxRot, RotationAngle(key.rot, track.rot[k]));
+            maxScale = std::max(maxScale, double((key.scale - track.scale[k]).Length()));
+        }
+    }
+
+    // The playback path samples the same way as the compressor, up to float rounding of the angle.
+    CHECK(maxPos <= settings.posTolerance);
+    CHECK(maxRot <= settings.rotTolerance * 1.01);
+    CHECK(maxScale <= settings.scaleTolerance);
+
+    std::cout << "pos " << settings.posTolerance << ", rot " << settings.rotTolerance << " : " << stats.keptKeys
+              << " / " << stats.rawKeys << " keys, " << stats.rawBytes / 1024.0f << " KB -> "
+              << stats.compressedBytes / 1024.0f << " KB, max error pos " << maxPos << " rot " << maxRot
+              << " scale " << maxScale << std::endl;
+}
+} // namespace
+
+int main()
+{
+    TestTolerances(AnimationCompressionSettings(), 1);
+
+    AnimationCompressionSettings tight;
+    tight.posTolerance   = 0.001f;
+    tight.rotTolerance   = 0.0001f;
+    tight.scaleTolerance = 0.00002f;
+    TestTolerances(tight, 2);
+
+    AnimationCompressionSettings loose;
+    loose.posTolerance   = 0.1f;
+    loose.rotTolerance   = 0.005f;
+    loose.scaleTolerance = 0.001f;
+    TestTolerances(loose, 3);
+
+    // The smallest three encoding alone, over random rotations.
+    std::mt19937 rng(4);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    double maxRot = 0.0;
+    for (int i = 0; i < 10000; i++)
+    {
+        Quaternion q(unit(rng), unit(rng), unit(rng), unit(rng));
+        q.Normalize();
+
+        AnimationClip::CompressedTrack::RotChannel channel;
+        channel.values.resize(3);
+        AnimationCompressor::EncodeRotation(q, channel.values.data());
+        maxRot = std::max(maxRot, RotationAngle(channel.Decode(0), q));
+    }
+    CHECK(maxRot < AnimationCompressionSettings().rotTolerance);
+    std::cout << "smallest three : max error " << maxRot << " rad" << std::endl;
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
@@ -0,0 +1,234 @@
+#include "AnimationCompressor.h"
+#include "Check.h"
+#include "Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace DirectX;
+
+// AnimationData::Evaluate (SoA local pose, local matrices 4 bones at a time) against the AoS loop it replaced: one
+// Key::GetTransform per bone. The AoS loop is also timed per phase to show where a pose spends its time. Both have
+// to produce the same palette.
+namespace
+{
+const int s_numKeys = 600; // 20 s at 30 keys per second
+
+int AddBone(AnimationData &anim, int parent)
+{
+    anim.boneParentId.push_back(parent);
+    anim.offsetMatrix.push_back(Matrix::CreateTranslation(Vector3(0.0f, -float(anim.offsetMatrix.size()), 0.0f)));
+    return int(anim.boneParentId.size()) - 1;
+}
+
+int AddChain(AnimationData &anim, int parent, int length)
+{
+    for (int i = 0; i < length; i++)
+    {
+        parent = AddBone(anim, parent);
+    }
+    return parent;
+}
+
+// Mixamo layout: hips, spine, neck and head, two arms with five fingers of four bones, two legs. 65 bones per copy,
+// the copies hang from the same hips.
+void MakeSkeleton(AnimationData &anim, int numCopies)
+{
+    const int hips = AddBone(anim, -1);
+    for (int c = 0; c < numCopies; c++)
+    {
+        const int spine = AddChain(anim, hips, 3);
+        AddChain(anim, spine, 3);
+        for (int side = 0; side < 2; side++)
+        {
+            const int hand = AddChain(anim, spine, 4);
+            for (int finger = 0; finger < 5; finger++)
+            {
+                AddChain(anim, hand, 4);
+            }
+            AddChain(anim, hips, 5);
+        }
+    }
+}
+
+AnimationClip MakeClip(uint32_t numBones, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    AnimationClip clip;
+    clip.name          = "synthetic";
+    clip.duration      = double(s_numKeys - 1);
+    clip.tickPerSecond = 30.0;
+    clip.numChannels   = numBones;
+    clip.tracks.resize(numBones);
+
+    for (uint32_t b = 0; b < numBones; b++)
+    {
+        auto &track = clip.tracks[b];
+        const Vector3 axis = Vector3(unit(rng), unit(rng), unit(rng));
+        const float speed  = 0.05f + 0.05f * unit(rng);
+        const float phase  = 3.0f * unit(rng);
+
+        for (int k = 0; k < s_numKeys; k++)
+        {
+            const float t = float(k);
+            track.posTimes.push_back(t);
+            track.rotTimes.push_back(t);
+            track.scaleTimes.push_back(t);
+            track.pos.push_back(Vector3(0.0f, 1.0f + 0.1f * std::sin(t * speed + phase), 0.0f));
+            track.rot.push_back(Quaternion(XMQuaternionRotationNormal(XMVector3Normalize(axis),
+                                                                      0.8f * std::sin(t * speed + phase))));
+            track.scale.push_back(Vector3(1.0f));
+        }
+    }
+    return clip;
+}
+
+// Same split as Evaluate: the yaw of the root moves the model, not the palette.
+Quaternion RemoveYaw(const Quaternion &q)
+{
+    const float len = std::sqrt(q.y * q.y + q.w * q.w);
+    if (len < 1e-6f)
+    {
+        return q;
+    }
+    return q * Quaternion(0.0f, -q.y / len, 0.0f, q.w / len);
+}
+
+struct AosTimes
+{
+    double sample = 0.0;
+    double local  = 0.0;
+    double walk   = 0.0;
+};
+
+// The per bone loop Evaluate replaced, timed per phase.
+void EvaluateAos(const AnimationData &anim, double tick, std::vector<AnimationCursor> &cursors,
+                 std::vector<AnimationClip::Key> &keys, std::vector<Matrix> &local, std::vector<Matrix> &model,
+                 std::vector<Matrix> &palette, AosTimes &times)
+{
+    const int numBones = int(anim.GetNumBones());
+
+    Stopwatch sample;
+    for (int boneID = 0; boneID < numBones; boneID++)
+    {
+        keys[boneID] = anim.Sample(0, boneID, tick, cursors[boneID]);
+        if (boneID == anim.rootBone)
+        {
+            keys[boneID].rot = RemoveYaw(keys[boneID].rot);
+        }
+        if (anim.boneParentId[boneID] < 0)
+        {
+            keys[boneID].pos = Vector3(0.0f);
+        }
+    }
+    times.sample += sample.GetElapsedMs();
+
+    Stopwatch localTimer;
+    for (int boneID = 0; boneID < numBones; boneID++)
+    {
+        local[boneID] = keys[boneID].GetTransform();
+    }
+    times.local += localTimer.GetElapsedMs();
+
+    Stopwatch walk;
+    for (const int32_t boneID : anim.evalOrder)
+    {
+        const int parentIdx = anim.boneParentId[boneID];
+        model[boneID]   = parentIdx >= 0 ? local[boneID] * model[parentIdx] : local[boneID];
+        palette[boneID] = (anim.bindTransform[boneID] * model[boneID] * anim.defaultMatrix).Transpose();
+    }
+    times.walk += walk.GetElapsedMs();
+}
+
+float MaxDifference(const std::vector<Matrix> &a, const std::vector<Matrix> &b)
+{
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                maxDiff = std::max(maxDiff, std::abs(a[i].m[r][c] - b[i].m[r][c]));
+            }
+        }
+    }
+    return maxDiff;
+}
+
+void Run(int numCopies, bool compressed)
+{
+    std::mt19937 rng(static_cast<uint32_t>(numCopies));
+
+    AnimationData anim;
+    MakeSkeleton(anim, numCopies);
+    anim.defaultMatrix = Matrix::CreateScale(0.01f);
+    anim.clips.push_back(MakeClip(anim.GetNumBones(), rng));
+    if (compressed)
+    {
+        AnimationCompressor::Compress(anim.clips[0]);
+    }
+    anim.Prepare();
+
+    const uint32_t numBones = anim.GetNumBones();
+    const int numPoses      = 20000 / numCopies;
+
+    std::vector<AnimationCursor> cursors(numBones), aosCursors(numBones);
+    std::vector<AnimationClip::Key> keys(numBones);
+    std::vector<Matrix> local(numBones), model(numBones), palette(numBones);
+    AnimationPose pose;
+    AosTimes aos;
+
+    // Warm up and compare at a few ticks, away from the loop point.
+    for (int i = 0; i < 50; i++)
+    {
+        const double tick = anim.clips[0].GetTick(i * 0.37);
+        anim.Evaluate(0, tick, cursors, pose);
+        EvaluateAos(anim, tick, aosCursors, keys, local, model, palette, aos);
+        CHECK(MaxDifference(pose.palette, palette) < 1e-4f);
+    }
+    aos = AosTimes();
+
+    Stopwatch soaTimer;
+    for (int i = 0; i < numPoses; i++)
+    {
+        anim.Evaluate(0, anim.clips[0].GetTick(i / 60.0), cursors, pose);
+    }
+    const double soaMs = soaTimer.GetElapsedMs();
+
+    Stopwatch lodTimer;
+    for (int i = 0; i < numPoses; i++)
+    {
+        anim.Evaluate(0, anim.clips[0].GetTick(i / 60.0), cursors, pose, true);
+    }
+    const double lodMs = lodTimer.GetElapsedMs();
+
+    for (int i = 0; i < numPoses; i++)
+    {
+        EvaluateAos(anim, anim.clips[0].GetTick(i / 60.0), aosCursors, keys, local, model, palette, aos);
+    }
+    const double aosMs = aos.sample + aos.local + aos.walk;
+
+    auto perPose = [&](double ms) { return ms * 1000.0 / numPoses; };
+    std::cout << std::fixed << std::setprecision(2) << std::setw(3) << numBones << " bones, "
+              << (compressed ? "compressed" : "raw       ") << " : Evaluate " << perPose(soaMs) << " us, "
+              << "detail bones skipped " << perPose(lodMs) << " us, AoS " << perPose(aosMs) << " us (sample "
+              << perPose(aos.sample) << ", local " << perPose(aos.local) << ", walk " << perPose(aos.walk) << ")"
+              << std::endl;
+}
+} // namespace
+
+int main()
+{
+    for (int numCopies : {1, 4})
+    {
+        Run(numCopies, false);
+        Run(numCopies, true);
+    }
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
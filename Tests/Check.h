@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdio>
+
+// Assertions of the headless tests. A failed check is printed and counted, main returns the count so ctest sees it.
+inline int g_numFailures = 0;
+
+#define CHECK(condition)                                                                                               \
+    if (!(condition))                                                                                                  \
+    {                                                                                                                  \
+        std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition);                                    \
+        g_numFailures++;                                                                                               \
+    }
@@ -0,0 +1,157 @@
+#include "Check.h"
+#include "ContactGenerator.h"
+#include "HeightField.h"
+#include "JobSystem.h"
+#include "Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+using namespace DirectX;
+
+// Scaling of the narrow phase over 1 to 16 threads. Spheres and capsules rest on a height field and touch each other,
+// the pair list is the HeightField broadphase plus the sphere/sphere pairs. Every thread count has to produce the
+// same contact list as one thread.
+namespace
+{
+const int s_gridCells  = 128;
+const float s_gridSize = 200.0f;
+
+float SurfaceHeight(float x, float z)
+{
+    return 4.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f) + 1.5f * std::sin((x + z) * 0.21f);
+}
+
+// MakeSquareGrid rotated onto the XZ plane.
+std::vector<XMFLOAT3> MakeTerrain()
+{
+    std::vector<XMFLOAT3> positions;
+    for (int j = 0; j <= s_gridCells; j++)
+    {
+        for (int i = 0; i <= s_gridCells; i++)
+        {
+            const float x = (float(i) / s_gridCells - 0.5f) * s_gridSize;
+            const float z = (0.5f - float(j) / s_gridCells) * s_gridSize;
+            positions.push_back(XMFLOAT3(x, SurfaceHeight(x, z), z));
+        }
+    }
+    return positions;
+}
+
+std::vector<CollisionShape> MakeBodies(int numBodies)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> xz(-0.48f * s_gridSize, 0.48f * s_gridSize);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> radius(0.4f, 1.2f);
+
+    std::vector<CollisionShape> shapes(numBodies);
+    for (int i = 0; i < numBodies; i++)
+    {
+        CollisionShape &shape = shapes[i];
+        shape.radius          = radius(rng);
+
+        const float x = xz(rng);
+        const float z = xz(rng);
+        shape.p0      = XMFLOAT3(x, SurfaceHeight(x, z) + unit(rng) * shape.radius, z);
+
+        // One in four is a capsule lying roughly along the surface.
+        if (i % 4 == 3)
+        {
+            shape.type = CollisionShape::CAPSULE;
+            shape.p1   = XMFLOAT3(x + unit(rng) * 2.0f, shape.p0.y + unit(rng) * 0.5f, z + unit(rng) * 2.0f);
+        }
+    }
+    return shapes;
+}
+
+void AddSpherePairs(const std::vector<CollisionShape> &shapes, std::vector<CollisionPair> &pairs)
+{
+    for (uint32_t a = 0; a < uint32_t(shapes.size()); a++)
+    {
+        for (uint32_t b = a + 1; b < uint32_t(shapes.size()); b++)
+        {
+            if (shapes[a].type != CollisionShape::SPHERE || shapes[b].type != CollisionShape::SPHERE)
+                continue;
+
+            const float dx = shapes[a].p0.x - shapes[b].p0.x;
+            const float dz = shapes[a].p0.z - shapes[b].p0.z;
+            const float r  = shapes[a].radius + shapes[b].radius;
+            if (dx * dx + dz * dz < 4.0f * r * r)
+            {
+                pairs.push_back({CollisionPair::SPHERE_SPHERE, a, b});
+            }
+        }
+    }
+}
+
+bool SameContacts(const std::vector<Contact> &a, const std::vector<Contact> &b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(Contact)) == 0;
+}
+} // namespace
+
+int main()
+{
+    const int numBodies = 4096;
+    const int numRuns   = 20;
+
+    HeightField heightField;
+    heightField.Initialize(MakeTerrain(), s_gridCells, s_gridCells);
+
+    const std::vector<CollisionShape> shapes = MakeBodies(numBodies);
+    std::vector<XMFLOAT3> triangles;
+    std::vector<CollisionPair> pairs;
+    heightField.AddPairs(shapes, triangles, pairs);
+    AddSpherePairs(shapes, pairs);
+
+    // Reversed so the sort inside Generate has work to do, like a broadphase that doesn't emit sorted pairs.
+    std::reverse(pairs.begin(), pairs.end());
+
+    std::cout << numBodies << " bodies, " << pairs.size() << " pairs, " << std::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+
+    std::vector<Contact> reference;
+    double baseMs = 0.0;
+
+    for (uint32_t numThreads : {1u, 2u, 3u, 4u, 6u, 8u, 12u, 16u})
+    {
+        g_JobSystem.Initialize(numThreads - 1);
+
+        // Room for every pair in each buffer, so nothing is dropped whatever the split is.
+        ContactGenerator generator;
+        generator.Initialize(uint32_t(pairs.size()), 64);
+        generator.Generate(shapes, triangles, pairs);
+
+        std::vector<double> times;
+        for (int r = 0; r < numRuns; r++)
+        {
+            Stopwatch stopwatch;
+            generator.Generate(shapes, triangles, pairs);
+            times.push_back(stopwatch.GetElapsedMs());
+        }
+        std::sort(times.begin(), times.end());
+        const double ms = times[times.size() / 2];
+
+        CHECK(generator.GetNumDropped() == 0);
+        if (numThreads == 1)
+        {
+            reference = generator.GetContacts();
+            baseMs    = ms;
+        }
+        CHECK(SameContacts(generator.GetContacts(), reference));
+
+        std::cout << std::setw(2) << numThreads << " threads : " << std::fixed << std::setprecision(3) << ms
+                  << " ms, speedup " << std::setprecision(2) << baseMs / ms << ", efficiency "
+                  << baseMs / ms / numThreads << ", " << generator.GetContacts().size() << " contacts" << std::endl;
+    }
+
+    g_JobSystem.Shutdown();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
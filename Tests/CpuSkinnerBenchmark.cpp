@@ -0,0 +1,221 @@
+#include "Check.h"
+#include "CpuSkinner.h"
+#include "JobSystem.h"
+#include "Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace DirectX;
+
+// CpuSkinner on a synthetic character: tubes along bone chains, four influences per vertex, one mesh per limb like
+// a Mixamo model split by material. Skin is timed over 1 to 16 threads, with and without the BVH refit, against a
+// scalar loop that blends the matrices per vertex. Ray picking is timed with and without the BVH. The results have
+// to match the scalar loop and the brute-force triangle loop.
+namespace
+{
+const uint32_t s_numBones = 64;
+
+// One tube of rings x segments vertices around the y axis, offset along x. Each vertex is weighted to the bones of
+// its ring and its neighbours.
+MeshData MakeTube(uint32_t mesh, uint32_t rings, uint32_t segments, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> jitter(0, 40);
+
+    MeshData meshData;
+    const uint32_t firstBone = mesh * (s_numBones / 8);
+
+    for (uint32_t r = 0; r < rings; r++)
+    {
+        const float v = float(r) / float(rings - 1);
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            const float angle = XM_2PI * float(s) / float(segments);
+
+            SkinnedVertex vertex;
+            vertex.position = Vector3(float(mesh) * 30.0f + 5.0f * std::cos(angle), 100.0f * v,
+                                      5.0f * std::sin(angle));
+            vertex.normal   = Vector3(std::cos(angle), 0.0f, std::sin(angle));
+
+            // Four bones of the limb around the ring, weights summing to 255.
+            const uint32_t bone = firstBone + XMMin(uint32_t(v * 7.0f), 4u);
+            int remaining       = 255;
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                const int w           = XMMin(remaining, 100 - 30 * int(j) + jitter(rng));
+                vertex.boneWeights[j] = uint8_t(w);
+                vertex.boneIndices[j] = uint8_t(bone + j);
+                remaining -= w;
+            }
+            vertex.boneWeights[3] = uint8_t(remaining);
+            vertex.boneIndices[3] = uint8_t(bone + 3);
+
+            meshData.skinnedVertices.push_back(vertex);
+        }
+    }
+
+    for (uint32_t r = 0; r + 1 < rings; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            const uint32_t i00 = r * segments + s;
+            const uint32_t i01 = r * segments + (s + 1) % segments;
+            const uint32_t i10 = i00 + segments;
+            const uint32_t i11 = i01 + segments;
+            meshData.indices.insert(meshData.indices.end(), {i00, i10, i01, i01, i10, i11});
+        }
+    }
+
+    return meshData;
+}
+
+// Transposed like AnimationPose::palette.
+std::vector<Matrix> MakePalette(float time)
+{
+    std::vector<Matrix> palette(s_numBones);
+    for (uint32_t b = 0; b < s_numBones; b++)
+    {
+        const Matrix m = Matrix::CreateTranslation(Vector3(0.0f, -12.0f * float(b % 8), 0.0f)) *
+                         Matrix::CreateRotationX(0.4f * std::sin(time + 0.3f * float(b))) *
+                         Matrix::CreateRotationY(0.2f * float(b % 5)) *
+                         Matrix::CreateTranslation(Vector3(0.0f, 12.0f * float(b % 8), 0.0f));
+        palette[b] = m.Transpose();
+    }
+    return palette;
+}
+
+// The per vertex loop CpuSkinner replaced.
+void SkinScalar(const std::vector<MeshData> &meshes, const std::vector<Matrix> &palette,
+                std::vector<std::vector<Vector3>> &out)
+{
+    out.resize(meshes.size());
+    for (size_t m = 0; m < meshes.size(); m++)
+    {
+        const auto &vertices = meshes[m].skinnedVertices;
+        out[m].resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            Matrix blend = Matrix(palette[vertices[i].boneIndices[0]]) * (vertices[i].boneWeights[0] / 255.0f);
+            for (uint32_t j = 1; j < 4; j++)
+            {
+                blend += Matrix(palette[vertices[i].boneIndices[j]]) * (vertices[i].boneWeights[j] / 255.0f);
+            }
+            out[m][i] = Vector3::Transform(vertices[i].position, blend.Transpose());
+        }
+    }
+}
+
+template <typename Function> double MedianMs(int numRuns, Function function)
+{
+    std::vector<double> times;
+    for (int r = 0; r < numRuns; r++)
+    {
+        Stopwatch stopwatch;
+        function();
+        times.push_back(stopwatch.GetElapsedMs());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+} // namespace
+
+int main()
+{
+    const int numRuns = 20;
+
+    std::mt19937 rng(1);
+    std::vector<MeshData> meshes;
+    size_t numVertices = 0, numTriangles = 0;
+    for (uint32_t m = 0; m < 8; m++)
+    {
+        meshes.push_back(MakeTube(m, 160, 64, rng));
+        numVertices += meshes.back().skinnedVertices.size();
+        numTriangles += meshes.back().indices.size() / 3;
+    }
+    std::cout << meshes.size() << " meshes, " << numVertices << " vertices, " << numTriangles << " triangles"
+              << std::endl;
+
+    const std::vector<Matrix> palette = MakePalette(1.0f);
+
+    std::vector<std::vector<Vector3>> reference;
+    const double scalarMs = MedianMs(numRuns, [&] { SkinScalar(meshes, palette, reference); });
+
+    CpuSkinner skinner, skinnerBVH;
+    skinner.Initialize(meshes);
+    skinnerBVH.Initialize(meshes, true);
+    CHECK(skinner.GetNumMeshes() == meshes.size());
+
+    std::cout << std::fixed << std::setprecision(3) << "scalar      : " << scalarMs << " ms" << std::endl;
+    for (uint32_t numThreads : {1u, 2u, 4u, 8u, 16u})
+    {
+        g_JobSystem.Initialize(numThreads - 1);
+
+        const double soaMs = MedianMs(numRuns, [&] { skinner.Skin(palette); });
+        const double bvhMs = MedianMs(numRuns, [&] { skinnerBVH.Skin(palette); });
+
+        std::cout << std::setw(2) << numThreads << " threads  : " << soaMs << " ms, " << std::setprecision(1)
+                  << numVertices / soaMs / 1000.0 << " M vertices/s, " << std::setprecision(2) << scalarMs / soaMs
+                  << "x scalar, with BVH refit " << std::setprecision(3) << bvhMs << " ms" << std::endl;
+    }
+
+    // Same positions as the scalar loop, and bounds around them up to the rounding of center and extents.
+    const Vector3 lo = Vector3(skinner.GetBounds().Center) - Vector3(skinner.GetBounds().Extents) - Vector3(1e-3f);
+    const Vector3 hi = Vector3(skinner.GetBounds().Center) + Vector3(skinner.GetBounds().Extents) + Vector3(1e-3f);
+    float maxDiff    = 0.0f;
+    for (uint32_t m = 0; m < skinner.GetNumMeshes(); m++)
+    {
+        for (uint32_t i = 0; i < uint32_t(reference[m].size()); i++)
+        {
+            const Vector3 p = skinner.GetPosition(m, i);
+            maxDiff         = XMMax(maxDiff, (p - reference[m][i]).Length());
+            CHECK(Vector3::Min(p, lo) == lo && Vector3::Max(p, hi) == hi);
+        }
+    }
+    CHECK(maxDiff < 1e-3f);
+
+    // Rays from around the model towards random points of its bounds.
+    const BoundingBox &bounds = skinner.GetBounds();
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Vector3> origins, dirs;
+    for (int i = 0; i < 500; i++)
+    {
+        const Vector3 target = Vector3(bounds.Center) + Vector3(unit(rng) * bounds.Extents.x,
+                                                                unit(rng) * bounds.Extents.y,
+                                                                unit(rng) * bounds.Extents.z);
+        Vector3 dir          = Vector3(unit(rng), unit(rng), unit(rng));
+        dir.Normalize();
+        origins.push_back(target - dir * 300.0f);
+        dirs.push_back(dir);
+    }
+
+    int numHits = 0;
+    for (size_t i = 0; i < origins.size(); i++)
+    {
+        float a = 0.0f, b = 0.0f;
+        const bool hitA = skinner.Intersects(origins[i], dirs[i], a);
+        const bool hitB = skinnerBVH.Intersects(origins[i], dirs[i], b);
+        CHECK(hitA == hitB);
+        CHECK(!hitA || std::abs(a - b) < 1e-3f);
+        numHits += hitA;
+    }
+    CHECK(numHits > 0);
+
+    float dist           = 0.0f;
+    const double bruteMs = MedianMs(5, [&] {
+        for (size_t i = 0; i < origins.size(); i++)
+            skinner.Intersects(origins[i], dirs[i], dist);
+    });
+    const double bvhMs = MedianMs(5, [&] {
+        for (size_t i = 0; i < origins.size(); i++)
+            skinnerBVH.Intersects(origins[i], dirs[i], dist);
+    });
+    std::cout << origins.size() << " rays, " << numHits << " hits : " << bruteMs << " ms brute force, " << bvhMs
+              << " ms with BVH" << std::endl;
+
+    g_JobSystem.Shutdown();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
@@ -0,0 +1,211 @@
+#include "Check.h"
+#include "HeightField.h"
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+using namespace DirectX;
+
+// Sphere and capsule queries against grids with random heights. The cell range of HeightField has to find a hit
+// exactly when the brute-force loop over every triangle of the grid does, and AddPairs has to hand the narrow phase
+// every triangle that the brute-force loop finds a contact with.
+namespace
+{
+struct TestGrid
+{
+    int numSlices = 0;
+    int numStacks = 0;
+    std::vector<XMFLOAT3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// MakeSquareGrid rotated onto the XZ plane. The coordinates are accumulated the same way, so the spacing is only
+// uniform up to rounding like in the engine.
+TestGrid MakeGrid(int numSlices, int numStacks, float scale, float amplitude, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> height(-amplitude, amplitude);
+
+    TestGrid grid;
+    grid.numSlices = numSlices;
+    grid.numStacks = numStacks;
+
+    const float dx = 2.0f / numSlices;
+    const float dy = 2.0f / numStacks;
+
+    float y = 1.0f;
+    for (int j = 0; j < numStacks + 1; j++)
+    {
+        float x = -1.0f;
+        for (int i = 0; i < numSlices + 1; i++)
+        {
+            grid.positions.push_back(XMFLOAT3(x * scale, height(rng), y * scale));
+            x += dx;
+        }
+        y -= dy;
+    }
+
+    for (int j = 0; j < numStacks; j++)
+    {
+        for (int i = 0; i < numSlices; i++)
+        {
+            const uint32_t i00 = uint32_t((numSlices + 1) * j + i);
+            const uint32_t i01 = i00 + uint32_t(numSlices + 1);
+            grid.indices.insert(grid.indices.end(), {i00, i00 + 1, i01, i01, i00 + 1, i01 + 1});
+        }
+    }
+
+    return grid;
+}
+
+void GetTriangle(const TestGrid &grid, size_t t, XMFLOAT3 tri[3])
+{
+    for (int k = 0; k < 3; k++)
+    {
+        tri[k] = grid.positions[grid.indices[3 * t + k]];
+    }
+}
+
+bool BruteForceIntersects(const TestGrid &grid, const BoundingSphere &sphere)
+{
+    XMFLOAT3 tri[3];
+    for (size_t t = 0; t < grid.indices.size() / 3; t++)
+    {
+        GetTriangle(grid, t, tri);
+        if (sphere.Intersects(XMLoadFloat3(&tri[0]), XMLoadFloat3(&tri[1]), XMLoadFloat3(&tri[2])))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Contacts of the shape with every triangle of the grid, and with the triangles AddPairs picked for it.
+void CountContacts(const TestGrid &grid, const HeightField &heightField, const CollisionShape &shape,
+                   size_t &bruteForce, size_t &paired, size_t &numPairs)
+{
+    auto collide = [&](const XMFLOAT3 *tri) {
+        Contact contact;
+        return shape.type == CollisionShape::SPHERE
+                   ? ContactGenerator::SphereTriangle(shape.p0, shape.radius, tri, contact)
+                   : ContactGenerator::CapsuleTriangle(shape, tri, contact);
+    };
+
+    bruteForce = 0;
+    XMFLOAT3 tri[3];
+    for (size_t t = 0; t < grid.indices.size() / 3; t++)
+    {
+        GetTriangle(grid, t, tri);
+        bruteForce += collide(tri);
+    }
+
+    std::vector<XMFLOAT3> triangles;
+    std::vector<CollisionPair> pairs;
+    heightField.AddPairs({shape}, triangles, pairs);
+
+    paired   = 0;
+    numPairs = pairs.size();
+    for (const CollisionPair &pair : pairs)
+    {
+        CHECK(pair.a == 0);
+        CHECK(pair.type ==
+              (shape.type == CollisionShape::SPHERE ? CollisionPair::SPHERE_TRIANGLE : CollisionPair::CAPSULE_TRIANGLE));
+        paired += collide(&triangles[3 * pair.b]);
+    }
+    CHECK(triangles.size() == 3 * pairs.size());
+}
+
+void TestGridQueries(int numSlices, int numStacks, float scale, float amplitude, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    const TestGrid grid = MakeGrid(numSlices, numStacks, scale, amplitude, rng);
+
+    HeightField heightField;
+    heightField.Initialize(grid.positions, numSlices, numStacks);
+    CHECK(heightField.GetNumSlices() == uint32_t(numSlices));
+    CHECK(heightField.GetNumStacks() == uint32_t(numStacks));
+
+    // The cell range path builds the same triangles as the index buffer.
+    XMFLOAT3 cell[6], tri[3];
+    for (int j = 0; j < numStacks; j++)
+    {
+        for (int i = 0; i < numSlices; i++)
+        {
+            heightField.GetCellTriangles(i, j, cell);
+            for (int t = 0; t < 2; t++)
+            {
+                GetTriangle(grid, 2 * size_t(numSlices * j + i) + t, tri);
+                for (int k = 0; k < 3; k++)
+                {
+                    const XMFLOAT3 &a = cell[3 * t + k];
+                    CHECK(a.x == tri[k].x && a.y == tri[k].y && a.z == tri[k].z);
+                }
+            }
+        }
+    }
+
+    // Centers around and a bit outside the grid, radii from a fraction of a cell to eight cells. Heights near the
+    // surface so both outcomes are common.
+    const float cellSize = 2.0f * scale / float(std::max(numSlices, numStacks));
+    std::uniform_real_distribution<float> xz(-1.2f * scale, 1.2f * scale);
+    std::uniform_real_distribution<float> radius(0.05f * cellSize, 8.0f * cellSize);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    const int numQueries = 2000;
+    int numHits          = 0;
+    size_t numPairs      = 0;
+    for (int q = 0; q < numQueries; q++)
+    {
+        CollisionShape shape;
+        shape.radius = radius(rng);
+        shape.p0     = XMFLOAT3(xz(rng), unit(rng) * (amplitude + 2.0f * shape.radius), xz(rng));
+
+        const BoundingSphere sphere(shape.p0, shape.radius);
+        const bool hit = heightField.Intersects(sphere);
+        CHECK(hit == BruteForceIntersects(grid, sphere));
+        numHits += hit;
+
+        size_t bruteForce, paired, pairCount;
+        CountContacts(grid, heightField, shape, bruteForce, paired, pairCount);
+        CHECK(paired == bruteForce);
+        numPairs += pairCount;
+
+        // A capsule from the same center, tilted in a random direction.
+        shape.type = CollisionShape::CAPSULE;
+        shape.p1   = XMFLOAT3(shape.p0.x + unit(rng) * cellSize, shape.p0.y + unit(rng) * cellSize,
+                              shape.p0.z + unit(rng) * cellSize);
+        CountContacts(grid, heightField, shape, bruteForce, paired, pairCount);
+        CHECK(paired == bruteForce);
+    }
+
+    // Outcomes that never happen would leave half of the comparison untested.
+    CHECK(numHits > numQueries / 10 && numHits < numQueries * 9 / 10);
+
+    std::cout << numSlices << "x" << numStacks << " grid : " << numHits << " / " << numQueries << " spheres hit, "
+              << double(numPairs) / numQueries << " triangles per sphere out of " << grid.indices.size() / 3
+              << std::endl;
+}
+} // namespace
+
+int main()
+{
+    TestGridQueries(1, 1, 1.0f, 0.2f, 1);
+    TestGridQueries(7, 3, 10.0f, 1.0f, 2);
+    TestGridQueries(25, 25, 50.0f, 3.0f, 3);
+    TestGridQueries(64, 40, 100.0f, 0.5f, 4);
+
+    // Nothing to find on an empty height field or outside the grid.
+    HeightField empty;
+    CHECK(!empty.Intersects(BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 1.0f)));
+
+    std::mt19937 rng(5);
+    const TestGrid grid = MakeGrid(8, 8, 1.0f, 0.1f, rng);
+    HeightField heightField;
+    heightField.Initialize(grid.positions, 8, 8);
+    int minX, maxX, minZ, maxZ;
+    CHECK(!heightField.GetCellRange(BoundingSphere(XMFLOAT3(3.0f, 0.0f, 0.0f), 1.0f), minX, maxX, minZ, maxZ));
+    CHECK(heightField.GetCellRange(BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.1f), minX, maxX, minZ, maxZ));
+    CHECK(minX >= 0 && maxX < 8 && minZ >= 0 && maxZ < 8 && minX <= maxX && minZ <= maxZ);
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
@@ -0,0 +1,340 @@
+#include "Check.h"
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+
+// Builds meshlets for a closed sphere and a height field, checks the limits and the bounds, then culls them for
+// fixed views. Cluster culling has to keep every triangle that is in the frustum and faces the eye, the culled ratio
+// is reported next to the ratio culling each triangle on its own would reach.
+namespace
+{
+struct Float3
+{
+    float x, y, z;
+
+    Float3 operator+(const Float3 &o) const
+    {
+        return {x + o.x, y + o.y, z + o.z};
+    }
+
+    Float3 operator-(const Float3 &o) const
+    {
+        return {x - o.x, y - o.y, z - o.z};
+    }
+
+    Float3 operator*(float s) const
+    {
+        return {x * s, y * s, z * s};
+    }
+};
+
+float Dot(const Float3 &a, const Float3 &b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Float3 Cross(const Float3 &a, const Float3 &b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+Float3 Normalize(const Float3 &a)
+{
+    return a * (1.0f / std::sqrt(Dot(a, a)));
+}
+
+struct TestMesh
+{
+    std::vector<Float3> positions;
+    std::vector<uint32_t> indices;
+
+    // Clockwise front faces like the engine, the cross product points out of the surface.
+    Float3 GetNormal(size_t triangle) const
+    {
+        const Float3 &p0 = positions[indices[triangle * 3 + 0]];
+        const Float3 &p1 = positions[indices[triangle * 3 + 1]];
+        const Float3 &p2 = positions[indices[triangle * 3 + 2]];
+        return Cross(p1 - p0, p2 - p0);
+    }
+};
+
+const float s_pi = 3.14159265f;
+
+// Welded, the poles are single vertices.
+TestMesh MakeSphere(float radius, uint32_t numSlices, uint32_t numStacks)
+{
+    TestMesh mesh;
+    mesh.positions.push_back({0.0f, radius, 0.0f});
+    for (uint32_t j = 1; j < numStacks; j++)
+    {
+        const float phi = s_pi * float(j) / float(numStacks);
+        for (uint32_t i = 0; i < numSlices; i++)
+        {
+            const float theta = 2.0f * s_pi * float(i) / float(numSlices);
+            mesh.positions.push_back({radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi),
+                                      radius * std::sin(phi) * std::sin(theta)});
+        }
+    }
+    mesh.positions.push_back({0.0f, -radius, 0.0f});
+
+    const uint32_t bottom = uint32_t(mesh.positions.size()) - 1;
+    auto ring             = [numSlices](uint32_t j, uint32_t i) { return 1 + (j - 1) * numSlices + i % numSlices; };
+    auto add              = [&mesh](uint32_t a, uint32_t b, uint32_t c) {
+        mesh.indices.insert(mesh.indices.end(), {a, b, c});
+        // Flip the ones wound the other way, so every normal points outside.
+        const size_t t = mesh.indices.size() / 3 - 1;
+        if (Dot(mesh.GetNormal(t), mesh.positions[a]) < 0.0f)
+        {
+            std::swap(mesh.indices[t * 3 + 1], mesh.indices[t * 3 + 2]);
+        }
+    };
+
+    for (uint32_t i = 0; i < numSlices; i++)
+    {
+        add(0, ring(1, i), ring(1, i + 1));
+        add(bottom, ring(numStacks - 1, i + 1), ring(numStacks - 1, i));
+    }
+    for (uint32_t j = 1; j + 1 < numStacks; j++)
+    {
+        for (uint32_t i = 0; i < numSlices; i++)
+        {
+            add(ring(j, i), ring(j + 1, i), ring(j, i + 1));
+            add(ring(j, i + 1), ring(j + 1, i), ring(j + 1, i + 1));
+        }
+    }
+    return mesh;
+}
+
+// Rolling hills on the XZ plane, size x size cells of 1 unit facing +y.
+TestMesh MakeHeightField(uint32_t size)
+{
+    TestMesh mesh;
+    for (uint32_t j = 0; j <= size; j++)
+    {
+        for (uint32_t i = 0; i <= size; i++)
+        {
+            const float x = float(i) - 0.5f * float(size);
+            const float z = float(j) - 0.5f * float(size);
+            mesh.positions.push_back({x, 2.0f * std::sin(x * 0.1f) * std::cos(z * 0.13f), z});
+        }
+    }
+
+    for (uint32_t j = 0; j < size; j++)
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            const uint32_t v = j * (size + 1) + i;
+            mesh.indices.insert(mesh.indices.end(), {v, v + size + 1, v + 1, v + 1, v + size + 1, v + size + 2});
+        }
+    }
+    return mesh;
+}
+
+struct View
+{
+    const char *name;
+    Float3 eye;
+    Float3 target;
+};
+
+// (n, d) with n pointing inside, the layout Frustum hands to Model::CullClusters.
+void MakeFrustum(const View &view, float planes[6][4])
+{
+    const float tanHalfFov = std::tan(s_pi / 6.0f); // 60 degrees vertical, square aspect
+    const float nearZ      = 0.1f;
+    const float farZ       = 200.0f;
+
+    const Float3 forward = Normalize(view.target - view.eye);
+    const Float3 right   = Normalize(Cross({0.0f, 1.0f, 0.0f}, forward));
+    const Float3 up      = Cross(forward, right);
+
+    const Float3 normals[6] = {forward,
+                               forward * -1.0f,
+                               Normalize(right + forward * tanHalfFov),
+                               Normalize(right * -1.0f + forward * tanHalfFov),
+                               Normalize(up + forward * tanHalfFov),
+                               Normalize(up * -1.0f + forward * tanHalfFov)};
+    const Float3 points[6]  = {view.eye + forward * nearZ, view.eye + forward * farZ, view.eye, view.eye, view.eye,
+                               view.eye};
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        planes[i][0] = normals[i].x;
+        planes[i][1] = normals[i].y;
+        planes[i][2] = normals[i].z;
+        planes[i][3] = -Dot(normals[i], points[i]);
+    }
+}
+
+bool IsInside(const float planes[6][4], const Float3 &p)
+{
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        if (Dot({planes[i][0], planes[i][1], planes[i][2]}, p) + planes[i][3] < 0.0f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Triangles a per triangle test can't cull: a corner inside the frustum and, with backface culling, facing the eye.
+// A triangle crossing the frustum with all corners outside counts as culled, the bound stays a bit optimistic.
+bool IsTriangleVisible(const TestMesh &mesh, size_t triangle, const float planes[6][4], const Float3 &eye,
+                       bool cullBackfaces)
+{
+    const Float3 &p0 = mesh.positions[mesh.indices[triangle * 3]];
+    if (cullBackfaces && Dot(mesh.GetNormal(triangle), eye - p0) <= 0.0f)
+    {
+        return false;
+    }
+
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        if (IsInside(planes, mesh.positions[mesh.indices[triangle * 3 + k]]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CheckMeshlets(const TestMesh &mesh, const MeshletData &data, const MeshletSettings &settings)
+{
+    CHECK(data.meshlets.size() == data.bounds.size());
+
+    size_t numTriangles = 0;
+    for (size_t m = 0; m < data.meshlets.size(); m++)
+    {
+        const Meshlet &meshlet      = data.meshlets[m];
+        const MeshletBounds &bounds = data.bounds[m];
+        const Float3 center         = {bounds.center[0], bounds.center[1], bounds.center[2]};
+        const Float3 axis           = {bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2]};
+        const float coneDot         = std::sqrt(std::max(1.0f - bounds.coneCutoff * bounds.coneCutoff, 0.0f));
+        CHECK(meshlet.vertexCount <= settings.maxVertices);
+        CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= settings.maxTriangles);
+        CHECK(meshlet.triangleOffset == numTriangles * 3);
+        numTriangles += meshlet.triangleCount;
+
+        for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+        {
+            const Float3 d = mesh.positions[data.vertices[meshlet.vertexOffset + v]] - center;
+            CHECK(std::sqrt(Dot(d, d)) <= bounds.radius * 1.0001f + 1e-5f);
+        }
+
+        // Every triangle of a cone that can cull lies inside it.
+        for (uint32_t t = 0; t < meshlet.triangleCount && bounds.coneCutoff < 1.0f; t++)
+        {
+            const uint8_t *local = &data.triangles[meshlet.triangleOffset + t * 3];
+            const Float3 &p0     = mesh.positions[data.vertices[meshlet.vertexOffset + local[0]]];
+            const Float3 &p1     = mesh.positions[data.vertices[meshlet.vertexOffset + local[1]]];
+            const Float3 &p2     = mesh.positions[data.vertices[meshlet.vertexOffset + local[2]]];
+            CHECK(Dot(Normalize(Cross(p1 - p0, p2 - p0)), axis) >= coneDot - 1e-4f);
+        }
+    }
+    CHECK(numTriangles == mesh.indices.size() / 3);
+
+    // The reordered index buffer holds the same triangles, each once.
+    auto sortedTriangles = [](const std::vector<uint32_t> &indices) {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            std::array<uint32_t, 3> t = {indices[i], indices[i + 1], indices[i + 2]};
+            std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end()); // keeps the winding
+            triangles.push_back(t);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+    CHECK(sortedTriangles(MeshletBuilder::BuildIndices(data)) == sortedTriangles(mesh.indices));
+}
+
+void CullView(const TestMesh &mesh, const MeshletData &data, const View &view, bool cullBackfaces,
+              float minCulledRatio, float maxCulledRatio)
+{
+    float planes[6][4];
+    MakeFrustum(view, planes);
+
+    std::vector<MeshletRange> visible;
+    const ClusterCullStats stats = MeshletBuilder::Cull(data, planes, &view.eye.x, cullBackfaces, visible);
+
+    // Conservative: no triangle the view sees may be dropped.
+    const std::vector<uint32_t> ordered = MeshletBuilder::BuildIndices(data);
+    TestMesh reordered                  = {mesh.positions, ordered};
+    std::vector<bool> isDrawn(ordered.size() / 3, false);
+    uint32_t numDrawn = 0;
+    for (const MeshletRange &range : visible)
+    {
+        CHECK(range.firstIndex % 3 == 0 && range.indexCount % 3 == 0);
+        for (uint32_t t = range.firstIndex / 3; t < (range.firstIndex + range.indexCount) / 3; t++)
+        {
+            CHECK(!isDrawn[t]);
+            isDrawn[t] = true;
+            numDrawn++;
+        }
+    }
+    CHECK(numDrawn == stats.numVisibleTriangles);
+    CHECK(stats.numTriangles == ordered.size() / 3);
+
+    uint32_t numTriangleVisible = 0;
+    for (size_t t = 0; t < isDrawn.size(); t++)
+    {
+        if (IsTriangleVisible(reordered, t, planes, view.eye, cullBackfaces))
+        {
+            CHECK(isDrawn[t]);
+            numTriangleVisible++;
+        }
+    }
+
+    const float triangleRatio = 1.0f - float(numTriangleVisible) / float(isDrawn.size());
+    std::cout << view.name << (cullBackfaces ? ", backfaces" : ", frustum") << " : " << stats.numVisibleMeshlets
+              << " / " << stats.numMeshlets << " meshlets drawn, " << stats.GetCulledRatio() * 100.0f
+              << "% of the triangles culled (" << triangleRatio * 100.0f << "% per triangle)" << std::endl;
+
+    CHECK(stats.GetCulledRatio() >= minCulledRatio && stats.GetCulledRatio() <= maxCulledRatio);
+}
+} // namespace
+
+int main()
+{
+    const MeshletSettings settings;
+
+    const TestMesh sphere = MakeSphere(1.0f, 96, 64);
+    const MeshletData sphereMeshlets =
+        MeshletBuilder::Build(sphere.indices, &sphere.positions[0].x, sphere.positions.size(), sizeof(Float3));
+    MeshletBuilder::Report("Sphere", sphereMeshlets);
+    CheckMeshlets(sphere, sphereMeshlets, settings);
+
+    // Seen whole from outside, about half of a closed mesh faces away.
+    const View front = {"Sphere in front", {0.0f, 0.0f, -4.0f}, {0.0f, 0.0f, 0.0f}};
+    CullView(sphere, sphereMeshlets, front, false, 0.0f, 0.0f);
+    CullView(sphere, sphereMeshlets, front, true, 0.35f, 0.6f);
+    CullView(sphere, sphereMeshlets, {"Sphere behind", {0.0f, 0.0f, -4.0f}, {0.0f, 0.0f, -8.0f}}, true, 1.0f, 1.0f);
+    CullView(sphere, sphereMeshlets, {"Sphere close", {0.0f, 0.0f, -1.5f}, {0.3f, 0.3f, 0.0f}}, true, 0.6f, 0.95f);
+
+    const TestMesh terrain = MakeHeightField(128);
+    const MeshletData terrainMeshlets =
+        MeshletBuilder::Build(terrain.indices, &terrain.positions[0].x, terrain.positions.size(), sizeof(Float3));
+    MeshletBuilder::Report("Height field", terrainMeshlets);
+    CheckMeshlets(terrain, terrainMeshlets, settings);
+
+    CullView(terrain, terrainMeshlets, {"Height field overview", {0.0f, 150.0f, -1.0f}, {0.0f, 0.0f, 0.0f}}, true,
+             0.0f, 0.05f);
+    CullView(terrain, terrainMeshlets, {"Height field corner", {-60.0f, 8.0f, -60.0f}, {0.0f, 0.0f, 0.0f}}, true,
+             0.15f, 0.6f);
+    CullView(terrain, terrainMeshlets, {"Height field ground", {0.0f, 3.0f, 0.0f}, {40.0f, 0.0f, 10.0f}}, true, 0.6f,
+             0.98f);
+
+    // Smaller limits are kept too.
+    MeshletSettings small;
+    small.maxVertices  = 32;
+    small.maxTriangles = 40;
+    CheckMeshlets(sphere,
+                  MeshletBuilder::Build(sphere.indices, &sphere.positions[0].x, sphere.positions.size(),
+                                        sizeof(Float3), small),
+                  small);
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
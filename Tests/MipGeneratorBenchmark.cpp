@@ -0,0 +1,77 @@
+#include "Check.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// The mip chain of a 4096x4096 sRGB texture, box and Kaiser, over 1 to 16 threads. Generate times itself, the
+// median of a few runs is printed with the texels of level 0 per second.
+namespace
+{
+const uint32_t s_size = 4096;
+
+TextureImage MakeImage(std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    TextureImage image;
+    image.width  = s_size;
+    image.height = s_size;
+    image.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    image.pixels.resize(size_t(s_size) * s_size * 4);
+    for (uint8_t &p : image.pixels)
+    {
+        p = uint8_t(byte(rng));
+    }
+    return image;
+}
+
+double MedianMs(int numRuns, const TextureImage &source, const MipSettings &settings)
+{
+    std::vector<double> times;
+    for (int r = 0; r < numRuns; r++)
+    {
+        TextureImage image = source;
+        MipStats stats;
+        CHECK(MipGenerator::Generate(image, settings, &stats));
+        CHECK(stats.numLevels == 13);
+        times.push_back(stats.ms);
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+} // namespace
+
+int main()
+{
+    const int numRuns = 5;
+
+    std::mt19937 rng(1);
+    const TextureImage source = MakeImage(rng);
+
+    MipSettings box;
+    box.filter = MIP_FILTER_BOX;
+    const MipSettings kaiser;
+
+    std::cout << s_size << "x" << s_size << " sRGB, " << MipGenerator::CountLevels(s_size, s_size) << " levels"
+              << std::endl;
+    for (uint32_t numThreads : {1u, 2u, 4u, 8u, 16u})
+    {
+        g_JobSystem.Initialize(numThreads - 1);
+
+        const double boxMs    = MedianMs(numRuns, source, box);
+        const double kaiserMs = MedianMs(numRuns, source, kaiser);
+
+        const double numTexels = double(s_size) * s_size;
+        std::cout << std::fixed << std::setw(2) << numThreads << " threads : box " << std::setprecision(1) << boxMs
+                  << " ms (" << numTexels / boxMs / 1000.0 << " M texels/s), Kaiser " << kaiserMs << " ms ("
+                  << numTexels / kaiserMs / 1000.0 << " M texels/s)" << std::endl;
+    }
+
+    g_JobSystem.Shutdown();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
@@ -0,0 +1,274 @@
+#include "Check.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// MipGenerator against a box filter written here in double: every level of the chain, power of two or not, has to
+// match to one code. sRGB has to average in linear, normal maps have to stay unit length, a constant image has to
+// stay constant under every filter, and the formats MipGenerator doesn't handle have to be left alone.
+namespace
+{
+struct Level
+{
+    uint32_t width;
+    uint32_t height;
+    size_t offset; // in bytes, into TextureImage::pixels
+};
+
+std::vector<Level> GetLevels(const TextureImage &image)
+{
+    std::vector<Level> levels;
+    size_t offset = 0;
+    for (uint32_t level = 0, w = image.width, h = image.height; level < image.mipLevels; level++)
+    {
+        levels.push_back({w, h, offset});
+        offset += size_t(w) * h * 4;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+    return levels;
+}
+
+TextureImage MakeImage(uint32_t width, uint32_t height, DXGI_FORMAT format, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    TextureImage image;
+    image.width  = width;
+    image.height = height;
+    image.format = format;
+    image.pixels.resize(size_t(width) * height * 4);
+    for (uint8_t &p : image.pixels)
+    {
+        p = uint8_t(byte(rng));
+    }
+    return image;
+}
+
+// Weights of the source texels a destination texel covers, the overlap of [i, i + 1) with its footprint.
+std::vector<std::vector<std::pair<uint32_t, double>>> BoxAxis(uint32_t srcSize, uint32_t dstSize)
+{
+    const double scale = double(srcSize) / double(dstSize);
+    std::vector<std::vector<std::pair<uint32_t, double>>> axis(dstSize);
+    for (uint32_t d = 0; d < dstSize; d++)
+    {
+        const double begin = d * scale;
+        const double end   = (d + 1) * scale;
+        for (uint32_t i = uint32_t(begin); i < srcSize && i < end; i++)
+        {
+            const double weight = std::min(double(i + 1), end) - std::max(double(i), begin);
+            if (weight > 0.0)
+            {
+                axis[d].push_back({i, weight / scale});
+            }
+        }
+    }
+    return axis;
+}
+
+// Every level of a UNORM image box filtered from the one above, in double and without rounding in between.
+void CheckBoxChain(uint32_t width, uint32_t height, std::mt19937 &rng)
+{
+    TextureImage image = MakeImage(width, height, DXGI_FORMAT_R8G8B8A8_UNORM, rng);
+
+    MipSettings settings;
+    settings.filter = MIP_FILTER_BOX;
+    CHECK(MipGenerator::Generate(image, settings));
+    CHECK(image.mipLevels == MipGenerator::CountLevels(width, height));
+
+    const std::vector<Level> levels = GetLevels(image);
+    CHECK(image.pixels.size() == levels.back().offset + size_t(levels.back().width) * levels.back().height * 4);
+
+    std::vector<double> above(image.pixels.begin(), image.pixels.begin() + size_t(width) * height * 4);
+    for (double &c : above)
+    {
+        c /= 255.0;
+    }
+
+    int maxDiff = 0;
+    for (size_t l = 1; l < levels.size(); l++)
+    {
+        const Level &src   = levels[l - 1];
+        const Level &dst   = levels[l];
+        const auto columns = BoxAxis(src.width, dst.width);
+        const auto rows    = BoxAxis(src.height, dst.height);
+
+        std::vector<double> current(size_t(dst.width) * dst.height * 4, 0.0);
+        for (uint32_t y = 0; y < dst.height; y++)
+        {
+            for (uint32_t x = 0; x < dst.width; x++)
+            {
+                double *out = &current[(size_t(y) * dst.width + x) * 4];
+                for (const auto &row : rows[y])
+                {
+                    for (const auto &column : columns[x])
+                    {
+                        const double *in = &above[(size_t(row.first) * src.width + column.first) * 4];
+                        for (uint32_t c = 0; c < 4; c++)
+                        {
+                            out[c] += in[c] * row.second * column.second;
+                        }
+                    }
+                }
+
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    const int expected = int(std::lround(out[c] * 255.0));
+                    const int actual   = image.pixels[dst.offset + (size_t(y) * dst.width + x) * 4 + c];
+                    maxDiff            = std::max(maxDiff, std::abs(expected - actual));
+                }
+            }
+        }
+        above.swap(current);
+    }
+    CHECK(maxDiff <= 1);
+
+    std::cout << "box " << width << "x" << height << " : " << image.mipLevels << " levels, max difference "
+              << maxDiff << std::endl;
+}
+
+// Black and white texels average to linear 0.5, which is code 188 in sRGB. Averaging the codes gives 128.
+void CheckSRGB()
+{
+    TextureImage image;
+    image.width  = 2;
+    image.height = 2;
+    image.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        const uint8_t c = (i == 0 || i == 3) ? 255 : 0;
+        image.pixels.insert(image.pixels.end(), {c, c, c, c});
+    }
+
+    MipSettings settings;
+    settings.filter = MIP_FILTER_BOX;
+    CHECK(MipGenerator::Generate(image, settings));
+    CHECK(image.mipLevels == 2);
+
+    const uint8_t *level1 = &image.pixels[16];
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        CHECK(std::abs(int(level1[c]) - 188) <= 1);
+    }
+    CHECK(std::abs(int(level1[3]) - 128) <= 1); // alpha stays linear
+}
+
+void CheckNormalMap(std::mt19937 &rng)
+{
+    std::normal_distribution<float> gauss;
+
+    TextureImage image;
+    image.width  = 48;
+    image.height = 32;
+    image.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    for (uint32_t i = 0; i < image.width * image.height; i++)
+    {
+        // Tangent space normals around +z.
+        float n[3]      = {0.4f * gauss(rng), 0.4f * gauss(rng), 1.0f};
+        const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (float &c : n)
+        {
+            image.pixels.push_back(uint8_t(std::lround((c / len * 0.5f + 0.5f) * 255.0f)));
+        }
+        image.pixels.push_back(255);
+    }
+
+    MipSettings settings;
+    settings.isNormalMap = true;
+    CHECK(MipGenerator::Generate(image, settings));
+
+    float maxError = 0.0f;
+    for (const Level &level : GetLevels(image))
+    {
+        for (size_t i = 0; i < size_t(level.width) * level.height; i++)
+        {
+            const uint8_t *p = &image.pixels[level.offset + i * 4];
+            float lengthSq   = 0.0f;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                const float n = p[c] / 255.0f * 2.0f - 1.0f;
+                lengthSq += n * n;
+            }
+            maxError = std::max(maxError, std::abs(std::sqrt(lengthSq) - 1.0f));
+        }
+    }
+    // 8 bit codes are 1/127.5 apart on each axis.
+    CHECK(maxError < 0.02f);
+}
+
+void CheckConstant(const MipSettings &settings)
+{
+    const uint8_t color[4] = {10, 100, 200, 50};
+
+    TextureImage image;
+    image.width  = 37;
+    image.height = 19;
+    image.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    for (uint32_t i = 0; i < image.width * image.height; i++)
+    {
+        image.pixels.insert(image.pixels.end(), color, color + 4);
+    }
+
+    CHECK(MipGenerator::Generate(image, settings));
+    CHECK(image.mipLevels == 6);
+
+    int maxDiff = 0;
+    for (size_t i = 0; i < image.pixels.size(); i++)
+    {
+        maxDiff = std::max(maxDiff, std::abs(int(image.pixels[i]) - int(color[i % 4])));
+    }
+    CHECK(maxDiff <= 1);
+}
+} // namespace
+
+int main()
+{
+    g_JobSystem.Initialize(3);
+
+    CHECK(MipGenerator::CountLevels(4096, 4096) == 13);
+    CHECK(MipGenerator::CountLevels(640, 480) == 10);
+    CHECK(MipGenerator::CountLevels(5, 3) == 3);
+    CHECK(MipGenerator::CountLevels(1, 1) == 1);
+
+    std::mt19937 rng(1);
+    CheckBoxChain(64, 64, rng);
+    CheckBoxChain(128, 8, rng);
+    CheckBoxChain(13, 7, rng);
+    CheckBoxChain(100, 3, rng);
+
+    // Taller than the rows of one job, so the bands have to line up.
+    CheckBoxChain(40, 3 * MipGenerator::sm_rowsPerJob * 2 + 6, rng);
+
+    CheckSRGB();
+    CheckNormalMap(rng);
+
+    for (const MIP_FILTER filter : {MIP_FILTER_BOX, MIP_FILTER_KAISER})
+    {
+        for (const bool isWrap : {true, false})
+        {
+            MipSettings settings;
+            settings.filter = filter;
+            settings.isWrap = isWrap;
+            CheckConstant(settings);
+        }
+    }
+
+    // Formats other than RGBA8 and images with mips already are left as they are.
+    TextureImage bc1 = MakeImage(16, 16, DXGI_FORMAT_BC1_UNORM, rng);
+    CHECK(!MipGenerator::Generate(bc1));
+    CHECK(bc1.mipLevels == 1 && bc1.pixels.size() == 16 * 16 * 4);
+
+    TextureImage twice = MakeImage(16, 16, DXGI_FORMAT_R8G8B8A8_UNORM, rng);
+    CHECK(MipGenerator::Generate(twice));
+    const size_t size = twice.pixels.size();
+    CHECK(!MipGenerator::Generate(twice));
+    CHECK(twice.pixels.size() == size);
+
+    g_JobSystem.Shutdown();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
@@ -0,0 +1,495 @@
+#include "Check.h"
+#include "JobSystem.h"
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Compresses generated textures to every BC format, decodes the blocks with a decoder written from the format specs
+// and checks the PSNR of each mip level. The decoder is separate from the encoders on purpose, a block layout or
+// palette the GPU reads differently shows up here even when the encoder's own PSNR looks fine.
+namespace
+{
+using Texel = uint8_t[4];
+
+uint32_t Hash(int x, int y, int octave, uint32_t seed)
+{
+    uint32_t h = uint32_t(x) * 374761393u + uint32_t(y) * 668265263u + uint32_t(octave) * 2246822519u + seed;
+    h          = (h ^ (h >> 13)) * 1274126177u;
+    return h ^ (h >> 16);
+}
+
+// Smoothly interpolated lattice noise in [0, 1].
+float ValueNoise(float x, float y, int octave, uint32_t seed)
+{
+    const int ix = int(std::floor(x));
+    const int iy = int(std::floor(y));
+    float fx     = x - float(ix);
+    float fy     = y - float(iy);
+    fx           = fx * fx * (3.0f - 2.0f * fx);
+    fy           = fy * fy * (3.0f - 2.0f * fy);
+
+    auto value    = [&](int dx, int dy) { return float(Hash(ix + dx, iy + dy, octave, seed) & 0xffff) / 65535.0f; };
+    const float a = value(0, 0) + (value(1, 0) - value(0, 0)) * fx;
+    const float b = value(0, 1) + (value(1, 1) - value(0, 1)) * fx;
+    return a + (b - a) * fy;
+}
+
+uint8_t ToUnorm8(float value)
+{
+    return uint8_t(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Fractal noise with fine grain, close to a photographed material. Every channel differs, alpha included.
+TextureImage MakeNoiseImage(uint32_t size, uint32_t seed, bool isSRGB)
+{
+    TextureImage image;
+    image.width  = size;
+    image.height = size;
+    image.format = isSRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+    image.pixels.resize(size_t(size) * size * 4);
+
+    uint32_t grainState = seed;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            float s         = 0.0f;
+            float t         = 0.0f;
+            float amplitude = 0.5f;
+            float frequency = 32.0f / float(size);
+            for (int octave = 0; octave < 6; octave++)
+            {
+                s += amplitude * ValueNoise(float(x) * frequency, float(y) * frequency, octave, seed);
+                t += amplitude * ValueNoise(float(x) * frequency * 1.7f + 3.0f, float(y) * frequency * 1.7f,
+                                            octave + 10, seed);
+                amplitude *= 0.5f;
+                frequency *= 2.0f;
+            }
+
+            grainState        = grainState * 1664525u + 1013904223u;
+            const float grain = (float(grainState >> 24) / 255.0f - 0.5f) * 0.06f;
+
+            uint8_t *texel = &image.pixels[(size_t(y) * size + x) * 4];
+            texel[0]       = ToUnorm8(0.25f + 0.6f * s + grain);
+            texel[1]       = ToUnorm8(0.2f + 0.5f * s * t + 0.1f * t + grain);
+            texel[2]       = ToUnorm8(0.15f + 0.35f * t + grain);
+            texel[3]       = ToUnorm8(t);
+        }
+    }
+    return image;
+}
+
+// Box filtered levels down to 1x1, appended like MipGenerator does.
+void AddMips(TextureImage &image)
+{
+    uint32_t width = image.width, height = image.height;
+    size_t offset  = 0;
+    while (width > 1 || height > 1)
+    {
+        const uint32_t nextWidth  = std::max(width / 2, 1u);
+        const uint32_t nextHeight = std::max(height / 2, 1u);
+        std::vector<uint8_t> next(size_t(nextWidth) * nextHeight * 4);
+        for (uint32_t y = 0; y < nextHeight; y++)
+        {
+            for (uint32_t x = 0; x < nextWidth; x++)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    uint32_t sum = 0;
+                    for (uint32_t i = 0; i < 4; i++)
+                    {
+                        const uint32_t sx = std::min(x * 2 + i % 2, width - 1);
+                        const uint32_t sy = std::min(y * 2 + i / 2, height - 1);
+                        sum += image.pixels[offset + (size_t(sy) * width + sx) * 4 + c];
+                    }
+                    next[(size_t(y) * nextWidth + x) * 4 + c] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+
+        offset += size_t(width) * height * 4;
+        image.pixels.insert(image.pixels.end(), next.begin(), next.end());
+        image.mipLevels++;
+        width  = nextWidth;
+        height = nextHeight;
+    }
+}
+
+// Reads the bits of a 128 bit BC7 block from the lowest one up.
+class BitReader
+{
+  public:
+    explicit BitReader(const uint8_t *block) : m_block(block)
+    {
+    }
+
+    uint32_t Read(uint32_t numBits)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < numBits; i++, m_pos++)
+            value |= uint32_t((m_block[m_pos / 8] >> (m_pos % 8)) & 1) << i;
+        return value;
+    }
+
+    uint32_t GetPos() const
+    {
+        return m_pos;
+    }
+
+  private:
+    const uint8_t *m_block;
+    uint32_t m_pos = 0;
+};
+
+void DecodeBC4(const uint8_t *block, uint8_t out[16])
+{
+    const uint32_t e0   = block[0], e1 = block[1];
+    uint32_t palette[8] = {e0, e1};
+    if (e0 > e1)
+    {
+        for (uint32_t i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * e0 + i * e1 + 3) / 7;
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; i++)
+            palette[i + 1] = ((5 - i) * e0 + i * e1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    memcpy(&bits, block + 2, 6);
+    for (uint32_t i = 0; i < 16; i++)
+        out[i] = uint8_t(palette[(bits >> (3 * i)) & 7]);
+}
+
+// isBC3 : the color block of BC3 always has 4 colors, BC1 switches to 3 and transparent black when c0 <= c1.
+void DecodeBC1(const uint8_t *block, Texel out[16], bool isBC3)
+{
+    uint16_t c[2];
+    uint32_t indices;
+    memcpy(c, block, 4);
+    memcpy(&indices, block + 4, 4);
+
+    uint32_t palette[4][4];
+    for (uint32_t e = 0; e < 2; e++)
+    {
+        const uint32_t r = c[e] >> 11, g = (c[e] >> 5) & 63, b = c[e] & 31;
+        palette[e][0]    = (r << 3) | (r >> 2);
+        palette[e][1]    = (g << 2) | (g >> 4);
+        palette[e][2]    = (b << 3) | (b >> 2);
+        palette[e][3]    = 255;
+    }
+
+    const bool isFourColors = isBC3 || c[0] > c[1];
+    for (uint32_t ch = 0; ch < 3; ch++)
+    {
+        const uint32_t a = palette[0][ch], b = palette[1][ch];
+        palette[2][ch]   = isFourColors ? (2 * a + b + 1) / 3 : (a + b) / 2;
+        palette[3][ch]   = isFourColors ? (a + 2 * b + 1) / 3 : 0;
+    }
+    palette[2][3] = 255;
+    palette[3][3] = isFourColors ? 255 : 0;
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (uint32_t ch = 0; ch < 4; ch++)
+            out[i][ch] = uint8_t(palette[(indices >> (2 * i)) & 3][ch]);
+    }
+}
+
+uint8_t InterpolateBC7(uint32_t e0, uint32_t e1, uint32_t weight)
+{
+    return uint8_t(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+// Modes 5 and 6, the ones the encoder writes. False for any other mode or a block that doesn't add up to 128 bits.
+bool DecodeBC7(const uint8_t *block, Texel out[16], uint32_t &mode)
+{
+    static const uint32_t s_weights2[4]  = {0, 21, 43, 64};
+    static const uint32_t s_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    BitReader bits(block);
+    mode = 0;
+    while (mode < 8 && bits.Read(1) == 0)
+        mode++;
+
+    uint32_t e[2][4];
+    if (mode == 5)
+    {
+        if (bits.Read(2) != 0)
+            return false; // the encoder never rotates channels
+
+        // 7 bit color and 8 bit alpha endpoints, the colors expanded by repeating the top bit.
+        for (uint32_t ch = 0; ch < 3; ch++)
+        {
+            for (uint32_t i = 0; i < 2; i++)
+            {
+                e[i][ch] = bits.Read(7);
+                e[i][ch] = (e[i][ch] << 1) | (e[i][ch] >> 6);
+            }
+        }
+        e[0][3] = bits.Read(8);
+        e[1][3] = bits.Read(8);
+
+        // 2 bit color indices, then 2 bit alpha indices. The first of each has its top bit implied 0.
+        uint32_t colorIndices[16], alphaIndices[16];
+        for (uint32_t i = 0; i < 16; i++)
+            colorIndices[i] = bits.Read(i == 0 ? 1 : 2);
+        for (uint32_t i = 0; i < 16; i++)
+            alphaIndices[i] = bits.Read(i == 0 ? 1 : 2);
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t ch = 0; ch < 3; ch++)
+                out[i][ch] = InterpolateBC7(e[0][ch], e[1][ch], s_weights2[colorIndices[i]]);
+            out[i][3] = InterpolateBC7(e[0][3], e[1][3], s_weights2[alphaIndices[i]]);
+        }
+        return bits.GetPos() == 128;
+    }
+
+    if (mode != 6)
+        return false;
+
+    // 7 bit rgba endpoints and a p bit per endpoint.
+    for (uint32_t ch = 0; ch < 4; ch++)
+    {
+        e[0][ch] = bits.Read(7);
+        e[1][ch] = bits.Read(7);
+    }
+    const uint32_t p[2] = {bits.Read(1), bits.Read(1)};
+    for (uint32_t ch = 0; ch < 4; ch++)
+    {
+        e[0][ch] = (e[0][ch] << 1) | p[0];
+        e[1][ch] = (e[1][ch] << 1) | p[1];
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        const uint32_t index = bits.Read(i == 0 ? 3 : 4);
+        for (uint32_t ch = 0; ch < 4; ch++)
+            out[i][ch] = InterpolateBC7(e[0][ch], e[1][ch], s_weights4[index]);
+    }
+    return bits.GetPos() == 128;
+}
+
+uint32_t GetBlockSize(BC_FORMAT format)
+{
+    return format == BC_FORMAT_BC1 || format == BC_FORMAT_BC4 ? 8 : 16;
+}
+
+// Channels the format keeps, the ones the PSNR is measured over.
+uint32_t GetNumChannels(BC_FORMAT format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1:
+        return 3;
+    case BC_FORMAT_BC4:
+        return 1;
+    case BC_FORMAT_BC5:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+struct DecodeCounts
+{
+    uint32_t numBlocks    = 0;
+    uint32_t numBadBlocks = 0; // BC7 blocks the decoder can't read
+    uint32_t numMode5     = 0;
+};
+
+// One level back to RGBA8. Texels of the channels a format drops stay 0.
+std::vector<uint8_t> DecodeLevel(const uint8_t *blocks, BC_FORMAT format, uint32_t width, uint32_t height,
+                                 DecodeCounts &counts)
+{
+    std::vector<uint8_t> pixels(size_t(width) * height * 4, 0);
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            const uint8_t *block = blocks + (size_t(by) * blocksX + bx) * GetBlockSize(format);
+            Texel texels[16]     = {};
+            uint8_t values[16];
+            uint32_t mode = 0;
+
+            switch (format)
+            {
+            case BC_FORMAT_BC1:
+                DecodeBC1(block, texels, false);
+                break;
+            case BC_FORMAT_BC3:
+                DecodeBC1(block + 8, texels, true);
+                DecodeBC4(block, values);
+                for (uint32_t i = 0; i < 16; i++)
+                    texels[i][3] = values[i];
+                break;
+            case BC_FORMAT_BC4:
+                DecodeBC4(block, values);
+                for (uint32_t i = 0; i < 16; i++)
+                    texels[i][0] = values[i];
+                break;
+            case BC_FORMAT_BC5:
+                for (uint32_t ch = 0; ch < 2; ch++)
+                {
+                    DecodeBC4(block + ch * 8, values);
+                    for (uint32_t i = 0; i < 16; i++)
+                        texels[i][ch] = values[i];
+                }
+                break;
+            case BC_FORMAT_BC7:
+                if (!DecodeBC7(block, texels, mode))
+                    counts.numBadBlocks++;
+                if (mode == 5)
+                    counts.numMode5++;
+                break;
+            default:
+                break;
+            }
+            counts.numBlocks++;
+
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                const uint32_t x = bx * 4 + i % 4, y = by * 4 + i / 4;
+                if (x < width && y < height)
+                    memcpy(&pixels[(size_t(y) * width + x) * 4], texels[i], 4);
+            }
+        }
+    }
+    return pixels;
+}
+
+double ComputePSNR(const uint8_t *original, const uint8_t *decoded, size_t numTexels, uint32_t numChannels)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < numTexels; i++)
+    {
+        for (uint32_t ch = 0; ch < numChannels; ch++)
+        {
+            const double d = double(original[i * 4 + ch]) - double(decoded[i * 4 + ch]);
+            sum += d * d;
+        }
+    }
+    const double mse = sum / (double(numTexels) * numChannels);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : INFINITY;
+}
+
+// Compresses image with its mips and checks every level against minPSNR. Level 0 also has to match the PSNR the
+// encoder measured with its own palette.
+void CheckFormat(const char *name, TextureImage image, BC_FORMAT format, double minPSNR)
+{
+    const std::vector<uint8_t> original = image.pixels;
+    const bool isSRGB                   = image.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+
+    CompressStats stats;
+    CHECK(TextureCompressor::Compress(image, format, &stats));
+    TextureCompressor::Report(std::string(name) + " " + TextureCompressor::GetName(format), stats);
+    CHECK(image.format == TextureCompressor::GetDXGIFormat(format, isSRGB));
+
+    DecodeCounts counts;
+    size_t pixelOffset = 0, blockOffset = 0;
+    double level0PSNR  = 0.0, worstPSNR = INFINITY;
+    for (uint32_t level = 0; level < image.mipLevels; level++)
+    {
+        const uint32_t width  = std::max(image.width >> level, 1u);
+        const uint32_t height = std::max(image.height >> level, 1u);
+        CHECK(blockOffset < image.pixels.size());
+        if (blockOffset >= image.pixels.size())
+            return;
+
+        const std::vector<uint8_t> decoded =
+            DecodeLevel(image.pixels.data() + blockOffset, format, width, height, counts);
+
+        const double psnr = ComputePSNR(original.data() + pixelOffset, decoded.data(), size_t(width) * height,
+                                        GetNumChannels(format));
+        if (level == 0)
+            level0PSNR = psnr;
+        worstPSNR = std::min(worstPSNR, psnr);
+
+        pixelOffset += size_t(width) * height * 4;
+        blockOffset += size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+    }
+
+    std::cout << "  decoded level 0 " << level0PSNR << " dB, worst level " << worstPSNR << " dB";
+    if (format == BC_FORMAT_BC7)
+        std::cout << ", " << counts.numMode5 << " / " << counts.numBlocks << " blocks in mode 5";
+    std::cout << std::endl;
+
+    CHECK(blockOffset == image.pixels.size());
+    CHECK(counts.numBadBlocks == 0);
+    CHECK(std::abs(level0PSNR - stats.psnr) < 0.01);
+    CHECK(worstPSNR >= minPSNR);
+}
+
+// A block of one color comes back exactly, BC7 only within the rounding of its 7 bit endpoints.
+void CheckSolidColor()
+{
+    TextureImage image;
+    image.width  = 4;
+    image.height = 4;
+    image.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    for (uint32_t i = 0; i < 16; i++)
+        image.pixels.insert(image.pixels.end(), {200, 37, 91, 255});
+
+    for (BC_FORMAT format : {BC_FORMAT_BC1, BC_FORMAT_BC3, BC_FORMAT_BC4, BC_FORMAT_BC5, BC_FORMAT_BC7})
+    {
+        TextureImage compressed = image;
+        CHECK(TextureCompressor::Compress(compressed, format));
+
+        DecodeCounts counts;
+        const std::vector<uint8_t> decoded = DecodeLevel(compressed.pixels.data(), format, 4, 4, counts);
+        const double minPSNR               = format == BC_FORMAT_BC7 ? 50.0 : INFINITY;
+        CHECK(ComputePSNR(image.pixels.data(), decoded.data(), 16, GetNumChannels(format)) >= minPSNR);
+    }
+}
+} // namespace
+
+int main()
+{
+    g_JobSystem.Initialize(3);
+
+    // 256 texels with mips down to 1x1, the levels under 4x4 are padded blocks. The thresholds are the worst level
+    // measured minus 1.5 dB.
+    TextureImage color = MakeNoiseImage(256, 7, true);
+    AddMips(color);
+    CheckFormat("Noise", color, BC_FORMAT_BC1, 30.5);
+    CheckFormat("Noise", color, BC_FORMAT_BC3, 31.5);
+    CheckFormat("Noise", color, BC_FORMAT_BC4, 41.5);
+    CheckFormat("Noise", color, BC_FORMAT_BC5, 42.5);
+    CheckFormat("Noise", color, BC_FORMAT_BC7, 31.0);
+
+    // Without alpha BC7 spends its bits on the color alone.
+    TextureImage opaque = color;
+    for (size_t i = 3; i < opaque.pixels.size(); i += 4)
+        opaque.pixels[i] = 255;
+    CheckFormat("Opaque noise", opaque, BC_FORMAT_BC1, 30.5);
+    CheckFormat("Opaque noise", opaque, BC_FORMAT_BC7, 32.5);
+
+    // Linear data, as normal and mask maps are.
+    TextureImage linear = MakeNoiseImage(64, 3, false);
+    AddMips(linear);
+    CheckFormat("Linear noise", linear, BC_FORMAT_BC5, 40.0);
+    CheckFormat("Linear noise", linear, BC_FORMAT_BC7, 28.5);
+
+    CheckSolidColor();
+
+    // Level 0 has to be whole blocks, and only RGBA8 is compressed.
+    TextureImage odd = MakeNoiseImage(6, 1, false);
+    CHECK(!TextureCompressor::Compress(odd, BC_FORMAT_BC1));
+    TextureImage compressed = MakeNoiseImage(8, 1, false);
+    CHECK(TextureCompressor::Compress(compressed, BC_FORMAT_BC4));
+    CHECK(!TextureCompressor::Compress(compressed, BC_FORMAT_BC1));
+
+    g_JobSystem.Shutdown();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}
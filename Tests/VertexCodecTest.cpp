@@ -0,0 +1,203 @@
+#include "Check.h"
+#include "VertexCodec.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// Round trips the encodings of QuantizedVertex and checks their error bounds: octahedral normals, UNORM16
+// positions in a box and half float texCoords.
+namespace
+{
+const float s_pi = 3.14159265f;
+
+float ToDegrees(float radians)
+{
+    return radians * 180.0f / s_pi;
+}
+
+// In double through atan2, acos of a float dot product alone is off by a few hundredths of a degree near 0.
+float AngleBetween(const float a[3], const float b[3])
+{
+    const double cross[3] = {double(a[1]) * b[2] - double(a[2]) * b[1], double(a[2]) * b[0] - double(a[0]) * b[2],
+                             double(a[0]) * b[1] - double(a[1]) * b[0]};
+    const double dot      = double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2];
+    return float(std::atan2(std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot));
+}
+
+float RoundTripOctahedral(const float n[3])
+{
+    int16_t encoded[2];
+    float decoded[3];
+    VertexCodec::EncodeOctahedral(n, encoded);
+    VertexCodec::DecodeOctahedral(encoded, decoded);
+
+    CHECK(std::abs(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2] - 1.0f) < 1e-5f);
+    return AngleBetween(n, decoded);
+}
+
+void TestOctahedral()
+{
+    // The axes are exact, they sit on the corners and the centre of the unfolded square.
+    const float axes[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    for (const auto &axis : axes)
+    {
+        int16_t encoded[2];
+        float decoded[3];
+        VertexCodec::EncodeOctahedral(axis, encoded);
+        VertexCodec::DecodeOctahedral(encoded, decoded);
+        CHECK(decoded[0] == axis[0] && decoded[1] == axis[1] && decoded[2] == axis[2]);
+    }
+
+    const float zero[3] = {0.0f, 0.0f, 0.0f};
+    int16_t encoded[2];
+    VertexCodec::EncodeOctahedral(zero, encoded);
+    CHECK(encoded[0] == 0 && encoded[1] == 0);
+
+    // Evenly spread directions, then random ones that aren't unit length like the normals of a loaded model.
+    float worst       = 0.0f;
+    const int numDirs = 200000;
+    for (int i = 0; i < numDirs; i++)
+    {
+        const float z    = 1.0f - 2.0f * (float(i) + 0.5f) / float(numDirs);
+        const float r    = std::sqrt(1.0f - z * z);
+        const float phi  = float(i) * 2.39996323f; // golden angle
+        const float n[3] = {r * std::cos(phi), r * std::sin(phi), z};
+        worst            = std::max(worst, RoundTripOctahedral(n));
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    for (int i = 0; i < 200000; i++)
+    {
+        const float n[3] = {u(rng) * 10.0f, u(rng) * 10.0f, u(rng) * 10.0f};
+        if (n[0] * n[0] + n[1] * n[1] + n[2] * n[2] < 1e-6f)
+            continue;
+        worst = std::max(worst, RoundTripOctahedral(n));
+    }
+
+    // On the folded seam z = 0 and along the diagonals.
+    for (int i = 0; i < 3600; i++)
+    {
+        const float angle       = float(i) * s_pi / 1800.0f;
+        const float seam[3]     = {std::cos(angle), std::sin(angle), 0.0f};
+        const float diagonal[3] = {std::cos(angle), std::cos(angle), std::sin(angle)};
+        worst                   = std::max(worst, RoundTripOctahedral(seam));
+        worst                   = std::max(worst, RoundTripOctahedral(diagonal));
+    }
+
+    std::cout << "octahedral : worst " << ToDegrees(worst) << " deg" << std::endl;
+    CHECK(ToDegrees(worst) < 0.01f);
+}
+
+void TestUnorm16()
+{
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+
+    // A unit model, a terrain leaf and a large model off the origin.
+    const float boxes[3][2] = {{-0.5f, 1.0f}, {-6.25f, 12.5f}, {1000.0f, 200.0f}};
+    for (const auto &box : boxes)
+    {
+        const float min    = box[0];
+        const float extent = box[1];
+
+        CHECK(VertexCodec::EncodeUnorm16(min, min, extent) == 0);
+        CHECK(VertexCodec::EncodeUnorm16(min + extent, min, extent) == 65535);
+        CHECK(VertexCodec::DecodeUnorm16(0, min, extent) == min);
+
+        // Outside the box clamps to its faces.
+        CHECK(VertexCodec::EncodeUnorm16(min - extent, min, extent) == 0);
+        CHECK(VertexCodec::EncodeUnorm16(min + extent * 2.0f, min, extent) == 65535);
+
+        // Half a step, plus float rounding of the decode at this magnitude.
+        const float magnitude = std::max(std::abs(min), std::abs(min + extent));
+        const float bound     = extent / 65535.0f * 0.5f + magnitude * 4.0f * FLT_EPSILON;
+
+        float worst = 0.0f;
+        for (int i = 0; i < 100000; i++)
+        {
+            const float value    = min + u(rng) * extent;
+            const uint16_t coded = VertexCodec::EncodeUnorm16(value, min, extent);
+            worst                = std::max(worst, std::abs(VertexCodec::DecodeUnorm16(coded, min, extent) - value));
+        }
+
+        std::cout << "unorm16 extent " << extent << " : worst " << worst << ", bound " << bound << std::endl;
+        CHECK(worst <= bound);
+    }
+
+    // A flat axis decodes to min whatever the value.
+    CHECK(VertexCodec::EncodeUnorm16(3.0f, 2.0f, 0.0f) == 0);
+    CHECK(VertexCodec::DecodeUnorm16(VertexCodec::EncodeUnorm16(2.0f, 2.0f, 0.0f), 2.0f, 0.0f) == 2.0f);
+}
+
+uint32_t FloatBits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void TestHalf()
+{
+    // Every half converts to a float and back to itself. NaNs stay NaN.
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+        const float value = VertexCodec::HalfToFloat(uint16_t(h));
+        if ((h & 0x7c00) == 0x7c00 && (h & 0x3ff))
+        {
+            CHECK(std::isnan(value));
+            CHECK(std::isnan(VertexCodec::HalfToFloat(VertexCodec::FloatToHalf(value))));
+            continue;
+        }
+        CHECK(VertexCodec::FloatToHalf(value) == h);
+    }
+
+    CHECK(VertexCodec::HalfToFloat(0x3c00) == 1.0f);
+    CHECK(VertexCodec::HalfToFloat(0xc000) == -2.0f);
+    CHECK(VertexCodec::HalfToFloat(0x7bff) == 65504.0f);
+    CHECK(VertexCodec::HalfToFloat(0x0001) == std::ldexp(1.0f, -24));
+
+    // Ties round to even.
+    CHECK(VertexCodec::FloatToHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3c00);
+    CHECK(VertexCodec::FloatToHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)) == 0x3c02);
+    CHECK(VertexCodec::FloatToHalf(std::ldexp(1.0f, -25)) == 0x0000);
+    CHECK(VertexCodec::FloatToHalf(3.0f * std::ldexp(1.0f, -26)) == 0x0001);
+    CHECK(VertexCodec::FloatToHalf(65519.0f) == 0x7bff);
+    CHECK(VertexCodec::FloatToHalf(65520.0f) == 0x7c00);
+    CHECK(VertexCodec::FloatToHalf(-1e10f) == 0xfc00);
+    CHECK(VertexCodec::FloatToHalf(1e-30f) == 0x0000);
+    CHECK(FloatBits(VertexCodec::HalfToFloat(VertexCodec::FloatToHalf(-0.0f))) == 0x80000000);
+
+    // texCoords relative to the offset. Within 2 of it the error is at most half an ulp of [1, 2), 2^-11, and
+    // within 4 it stays under the default VertexQuantizeSettings::maxTexCoordError of 1/1024.
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    const float ranges[2][2] = {{2.0f, std::ldexp(1.0f, -11)}, {4.0f, 1.0f / 1024.0f}};
+    for (const auto &range : ranges)
+    {
+        float worst = 0.0f;
+        for (int i = 0; i < 100000; i++)
+        {
+            const float value   = u(rng) * range[0];
+            const float decoded = VertexCodec::HalfToFloat(VertexCodec::FloatToHalf(value));
+            worst               = std::max(worst, std::abs(decoded - value));
+        }
+
+        std::cout << "half within " << range[0] << " : worst " << worst << ", bound " << range[1] << std::endl;
+        CHECK(worst <= range[1]);
+    }
+}
+} // namespace
+
+int main()
+{
+    TestOctahedral();
+    TestUnorm16();
+    TestHalf();
+
+    std::cout << (g_numFailures ? "FAILED" : "OK") << std::endl;
+    return g_numFailures;
+}